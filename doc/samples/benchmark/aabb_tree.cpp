@@ -0,0 +1,161 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <lol/engine.h>
+
+#include <lolbench.h>
+
+namespace lol
+{
+
+struct BenchTreeElement
+{
+    box3 m_box;
+    box3 const &GetAABB() const { return m_box; }
+};
+
+lolbench_declare_fixture(aabb_tree_bench)
+{
+    /* Small boxes scattered in a cube whose volume grows with the count,
+     * so that queries always see about the same number of them */
+    int variant_count() const { return 3; }
+
+    char const *variant_name(int variant) const
+    {
+        static char const *names[] = { "1k", "10k", "100k" };
+        return names[variant];
+    }
+
+    size_t variant_items(int variant) const
+    {
+        return (size_t)element_count(variant);
+    }
+
+    static int element_count(int variant)
+    {
+        static int const counts[] = { 1000, 10000, 100000 };
+        return counts[variant];
+    }
+
+    void setup()
+    {
+        int const count = element_count(m_variant);
+        range = 5.f * lol::pow((float)count, 1.f / 3.f);
+
+        elements.resize(count);
+        input.empty();
+        moves.empty();
+        queries.empty();
+        for (int i = 0; i < count; ++i)
+        {
+            vec3 p(rand(-range, range), rand(-range, range), rand(-range, range));
+            vec3 s(rand(.5f, 2.f), rand(.5f, 2.f), rand(.5f, 2.f));
+            elements[i].m_box = box3(p, p + s);
+            input.push(&elements[i], elements[i].m_box);
+            moves << vec3(rand(-.1f, .1f), rand(-.1f, .1f), rand(-.1f, .1f));
+            queries << elements[i].m_box + vec3(rand(-2.f, 2.f));
+        }
+
+        tree.Build(input, proxies);
+    }
+
+    void teardown()
+    {
+        tree.Clear();
+        elements.empty();
+        input.empty();
+        proxies.empty();
+    }
+
+    lolbench_declare_bench(insert, 1)
+    {
+        DynamicAABBTree3<BenchTreeElement> tmp;
+        for (int i = 0; i < elements.count(); ++i)
+            tmp.Insert(&elements[i], elements[i].m_box);
+        bench_keep(tmp.GetHeight());
+    }
+
+    lolbench_declare_bench(build, 1)
+    {
+        DynamicAABBTree3<BenchTreeElement> tmp;
+        array<int> tmp_proxies;
+        tmp.Build(input, tmp_proxies);
+        bench_keep(tmp.GetHeight());
+    }
+
+    /* Removes every element, then puts it back */
+    lolbench_declare_bench(remove_insert, 1)
+    {
+        for (int i = 0; i < proxies.count(); ++i)
+        {
+            tree.Remove(proxies[i]);
+            proxies[i] = tree.Insert(&elements[i], elements[i].m_box);
+        }
+    }
+
+    /* Moves of about the fat margin, so that only some of them reinsert;
+     * directions alternate so that boxes do not drift across iterations */
+    lolbench_declare_bench(move, 1)
+    {
+        int reinserted = 0;
+        for (int i = 0; i < proxies.count(); ++i)
+        {
+            elements[i].m_box += moves[i];
+            reinserted += tree.Move(proxies[i], elements[i].m_box, moves[i]);
+            moves[i] = -moves[i];
+        }
+        bench_keep(reinserted);
+    }
+
+    lolbench_declare_bench(query, 1)
+    {
+        array<BenchTreeElement *> found;
+        for (int i = 0; i < queries.count(); ++i)
+        {
+            found.empty();
+            tree.FindElements(queries[i], found);
+        }
+        bench_keep(found.count());
+    }
+
+    /* The octree on the same data, for comparison */
+    lolbench_declare_bench(octree_query, 1)
+    {
+        Octree<BenchTreeElement> octree;
+        octree.SetSize(vec3(2.f * range + 4.f));
+        octree.SetMaxDepth(6);
+        for (int i = 0; i < elements.count(); ++i)
+            octree.RegisterElement(&elements[i]);
+
+        array<BenchTreeElement *> found;
+        for (int i = 0; i < queries.count(); ++i)
+        {
+            found.empty();
+            octree.FindElements(queries[i], found);
+        }
+        bench_keep(found.count());
+    }
+
+    float range;
+    array<BenchTreeElement> elements;
+    array<BenchTreeElement *, box3> input;
+    array<vec3> moves;
+    array<box3> queries;
+    array<int> proxies;
+    DynamicAABBTree3<BenchTreeElement> tree;
+};
+
+} /* namespace lol */
@@ -0,0 +1,134 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <lol/engine.h>
+
+#include <lolbench.h>
+
+namespace lol
+{
+
+static size_t const BIGINT_TABLE_SIZE = 256;
+
+/* The same operations for each integer size */
+struct bigint_ops
+{
+    virtual ~bigint_ops() {}
+    virtual void add() = 0;
+    virtual void mul() = 0;
+    virtual void div() = 0;
+    virtual void mod() = 0;
+};
+
+template<typename T>
+struct bigint_ops_t : public bigint_ops
+{
+    bigint_ops_t()
+    {
+        a.resize(BIGINT_TABLE_SIZE);
+        b.resize(BIGINT_TABLE_SIZE);
+        q.resize(BIGINT_TABLE_SIZE);
+        p.resize(BIGINT_TABLE_SIZE);
+
+        /* Fill with random bits; keep the divisors positive and nonzero */
+        for (size_t i = 0; i < BIGINT_TABLE_SIZE; i++)
+        {
+            a[i] = b[i] = T(0);
+            for (int n = 0; n < (int)sizeof(T) / 2; ++n)
+            {
+                a[i] = (a[i] << 16) ^ T(rand(0x10000));
+                b[i] = (b[i] << 16) ^ T(rand(0x10000));
+            }
+            b[i] = (b[i] >> 1) | T(1);
+            p[i] = a[i] * b[i];
+        }
+    }
+
+    virtual void add()
+    {
+        T sum(0);
+        for (size_t i = 0; i < BIGINT_TABLE_SIZE; i++)
+            sum = sum + a[i];
+        bench_keep(sum);
+    }
+
+    virtual void mul()
+    {
+        for (size_t i = 0; i < BIGINT_TABLE_SIZE; i++)
+            p[i] = a[i] * b[i];
+    }
+
+    virtual void div()
+    {
+        for (size_t i = 0; i < BIGINT_TABLE_SIZE; i++)
+            q[i] = T(p[i] / b[i]);
+    }
+
+    virtual void mod()
+    {
+        T sum(0);
+        for (size_t i = 0; i < BIGINT_TABLE_SIZE; i++)
+            sum = sum ^ (p[i] % b[i]);
+        bench_keep(sum);
+    }
+
+    array<T> a, b, q;
+    array<decltype(T() * T())> p;
+};
+
+lolbench_declare_fixture(bigint_bench)
+{
+    int variant_count() const { return 3; }
+
+    char const *variant_name(int variant) const
+    {
+        static char const *names[] = { "256", "1024", "4096" };
+        return names[variant];
+    }
+
+    void setup()
+    {
+        switch (m_variant)
+        {
+        case 0: ops = new bigint_ops_t<int256_t>(); break;
+        case 1: ops = new bigint_ops_t<int1024_t>(); break;
+        case 2: ops = new bigint_ops_t<int4096_t>(); break;
+        }
+    }
+
+    void teardown()
+    {
+        delete ops;
+        ops = nullptr;
+    }
+
+    /* bigint = bigint + bigint */
+    lolbench_declare_bench(add, BIGINT_TABLE_SIZE) { ops->add(); }
+
+    /* bigint2 = bigint * bigint */
+    lolbench_declare_bench(mul, BIGINT_TABLE_SIZE) { ops->mul(); }
+
+    /* bigint = bigint2 / bigint */
+    lolbench_declare_bench(div, BIGINT_TABLE_SIZE) { ops->div(); }
+
+    /* bigint = bigint2 % bigint */
+    lolbench_declare_bench(mod, BIGINT_TABLE_SIZE) { ops->mod(); }
+
+    bigint_ops *ops;
+};
+
+} /* namespace lol */
+
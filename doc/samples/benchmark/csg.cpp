@@ -0,0 +1,124 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <lol/engine.h>
+
+#include <lolbench.h>
+
+namespace lol
+{
+
+lolbench_declare_fixture(csg_bench)
+{
+    /* A sphere combined with a rotated box and a cylinder, at increasing
+     * tessellation levels */
+    int variant_count() const { return 4; }
+
+    char const *variant_name(int variant) const
+    {
+        static char const *names[] = { "div2", "div4", "div6", "div8" };
+        return names[variant];
+    }
+
+    size_t variant_items(int variant) const
+    {
+        /* The icosphere has 20 * n^2 triangles */
+        return (size_t)(20 * divisions(variant) * divisions(variant));
+    }
+
+    static int divisions(int variant)
+    {
+        return 2 + 2 * variant;
+    }
+
+    /* The first operand is always the sphere */
+    void build(EasyMesh &mesh, int other)
+    {
+        int const n = divisions(m_variant);
+
+        mesh.OpenBrace();
+        mesh.AppendSphere(n, 2.f);
+        mesh.OpenBrace();
+        if (other == 0)
+        {
+            mesh.AppendBox(vec3(1.5f));
+            mesh.RotateY(30.f);
+            mesh.RotateX(20.f);
+            mesh.Translate(vec3(.7f, .5f, .3f));
+        }
+        else
+        {
+            mesh.AppendCylinder(4 * (n + 1), 3.f, .8f, .8f,
+                                false, false, true);
+            mesh.RotateX(30.f);
+            mesh.Translate(vec3(-.4f, 0.f, .2f));
+        }
+    }
+
+    static void finish(EasyMesh &mesh)
+    {
+        mesh.CloseBrace();
+        mesh.CloseBrace();
+    }
+
+    /* The CSG benchmarks build their operands, this measures its cost */
+    lolbench_declare_bench(operands, 1)
+    {
+        EasyMesh tmp;
+        build(tmp, 1);
+        finish(tmp);
+        bench_keep(tmp);
+    }
+
+    lolbench_declare_bench(box_union, 1)
+    {
+        EasyMesh tmp;
+        build(tmp, 0);
+        tmp.CsgUnion();
+        finish(tmp);
+        bench_keep(tmp);
+    }
+
+    lolbench_declare_bench(box_sub, 1)
+    {
+        EasyMesh tmp;
+        build(tmp, 0);
+        tmp.CsgSub();
+        finish(tmp);
+        bench_keep(tmp);
+    }
+
+    lolbench_declare_bench(cylinder_and, 1)
+    {
+        EasyMesh tmp;
+        build(tmp, 1);
+        tmp.CsgAnd();
+        finish(tmp);
+        bench_keep(tmp);
+    }
+
+    lolbench_declare_bench(cylinder_sub, 1)
+    {
+        EasyMesh tmp;
+        build(tmp, 1);
+        tmp.CsgSub();
+        finish(tmp);
+        bench_keep(tmp);
+    }
+};
+
+} /* namespace lol */
+
@@ -14,114 +14,174 @@
 #   include "config.h"
 #endif
 
-#include <cstdio>
-
 #include <lol/engine.h>
 
-using namespace lol;
+#include <lolbench.h>
+
+namespace lol
+{
 
 static size_t const HALF_TABLE_SIZE = 1024 * 1024;
-static size_t const HALF_RUNS = 50;
 
-void bench_half(int mode)
+lolbench_declare_fixture(half_bench)
 {
-    float result[10] = { 0.0f };
-    Timer timer;
-
-    /* Set up tables */
-    float *pf = new float[HALF_TABLE_SIZE + 1];
-    half *ph = new half[HALF_TABLE_SIZE + 1];
-
-    for (size_t run = 0; run < HALF_RUNS; run++)
-    {
-        switch (mode)
-        {
-        case 1:
-            for (size_t i = 0; i < HALF_TABLE_SIZE + 1; i++)
-                ph[i] = half::makebits(rand<uint16_t>());
-            break;
-        case 2:
-        default:
-            for (size_t i = 0; i < HALF_TABLE_SIZE + 1; i++)
-                ph[i] = rand(-2.0f, 2.0f);
-            break;
-        }
-
-        /* Convert half to float (array) */
-        timer.Get();
-        half::convert(pf, ph, HALF_TABLE_SIZE);
-        result[0] += timer.Get();
-
-        /* Convert half to float (fast) */
-        timer.Get();
-        for (size_t i = 0; i < HALF_TABLE_SIZE; i++)
+    /* Random bit patterns, including NaNs and denormals, or
+     * normal values in [-2, 2] */
+    int variant_count() const { return 2; }
+
+    char const *variant_name(int variant) const
+    {
+        return variant == 0 ? "bits" : "2.0";
+    }
+
+    void setup()
+    {
+        pf.resize(HALF_TABLE_SIZE + 1);
+        pf2.resize(HALF_TABLE_SIZE);
+        ph.resize(HALF_TABLE_SIZE + 1);
+        ph2.resize(HALF_TABLE_SIZE);
+
+        for (size_t i = 0; i < HALF_TABLE_SIZE + 1; i++)
+            ph[i] = m_variant == 0 ? half::makebits(rand<uint16_t>())
+                                   : half(rand(-2.0f, 2.0f));
+        for (size_t i = 0; i < HALF_TABLE_SIZE + 1; i++)
             pf[i] = (float)ph[i];
-        result[1] += timer.Get();
+    }
+
+    void teardown()
+    {
+        half::set_conversion(half::conversion::automatic);
+        pf.empty(); pf2.empty();
+        ph.empty(); ph2.empty();
+    }
 
-        /* Copy float */
-        timer.Get();
+    /* Array conversions with the default method, then with each one */
+    lolbench_declare_bench(to_float_array, HALF_TABLE_SIZE)
+    {
+        half::set_conversion(half::conversion::automatic);
+        half::convert(pf2.data(), ph.data(), HALF_TABLE_SIZE);
+    }
+
+    lolbench_declare_bench(to_float_array_table, HALF_TABLE_SIZE)
+    {
+        if (!half::set_conversion(half::conversion::table))
+            lolbench_skip();
+        half::convert(pf2.data(), ph.data(), HALF_TABLE_SIZE);
+    }
+
+    lolbench_declare_bench(to_float_array_sse2, HALF_TABLE_SIZE)
+    {
+        if (!half::set_conversion(half::conversion::sse2))
+            lolbench_skip();
+        half::convert(pf2.data(), ph.data(), HALF_TABLE_SIZE);
+    }
+
+    lolbench_declare_bench(to_float_array_f16c, HALF_TABLE_SIZE)
+    {
+        if (!half::set_conversion(half::conversion::f16c))
+            lolbench_skip();
+        half::convert(pf2.data(), ph.data(), HALF_TABLE_SIZE);
+    }
+
+    lolbench_declare_bench(to_float, HALF_TABLE_SIZE)
+    {
         for (size_t i = 0; i < HALF_TABLE_SIZE; i++)
-            pf[i] = pf[i + 1];
-        result[2] += timer.Get();
+            pf2[i] = (float)ph[i];
+    }
 
-        /* Add a half to every float */
-        timer.Get();
+    lolbench_declare_bench(float_copy, HALF_TABLE_SIZE)
+    {
         for (size_t i = 0; i < HALF_TABLE_SIZE; i++)
-            pf[i] += ph[i];
-        result[3] += timer.Get();
+            pf2[i] = pf[i + 1];
+    }
 
-        /* Copy half */
-        timer.Get();
+    lolbench_declare_bench(float_add_half, HALF_TABLE_SIZE)
+    {
         for (size_t i = 0; i < HALF_TABLE_SIZE; i++)
-            ph[i] = ph[i + 1];
-        result[4] += timer.Get();
+            pf2[i] = pf[i] + ph[i];
+    }
 
-        /* Change sign of every half */
-        timer.Get();
+    lolbench_declare_bench(half_copy, HALF_TABLE_SIZE)
+    {
         for (size_t i = 0; i < HALF_TABLE_SIZE; i++)
-            ph[i] = -ph[i];
-        result[5] += timer.Get();
+            ph2[i] = ph[i + 1];
+    }
 
-        /* Convert float to half (array) */
-        timer.Get();
-        half::convert(ph, pf, HALF_TABLE_SIZE);
-        result[6] += timer.Get();
+    lolbench_declare_bench(half_negate, HALF_TABLE_SIZE)
+    {
+        for (size_t i = 0; i < HALF_TABLE_SIZE; i++)
+            ph2[i] = -ph[i];
+    }
+
+    lolbench_declare_bench(from_float_array, HALF_TABLE_SIZE)
+    {
+        half::set_conversion(half::conversion::automatic);
+        half::convert(ph2.data(), pf.data(), HALF_TABLE_SIZE);
+    }
+
+    lolbench_declare_bench(from_float_array_table, HALF_TABLE_SIZE)
+    {
+        if (!half::set_conversion(half::conversion::table))
+            lolbench_skip();
+        half::convert(ph2.data(), pf.data(), HALF_TABLE_SIZE);
+    }
+
+    lolbench_declare_bench(from_float_array_sse2, HALF_TABLE_SIZE)
+    {
+        if (!half::set_conversion(half::conversion::sse2))
+            lolbench_skip();
+        half::convert(ph2.data(), pf.data(), HALF_TABLE_SIZE);
+    }
+
+    lolbench_declare_bench(from_float_array_f16c, HALF_TABLE_SIZE)
+    {
+        if (!half::set_conversion(half::conversion::f16c))
+            lolbench_skip();
+        half::convert(ph2.data(), pf.data(), HALF_TABLE_SIZE);
+    }
+
+    lolbench_declare_bench(from_float_array_round_table, HALF_TABLE_SIZE)
+    {
+        if (!half::set_conversion(half::conversion::table))
+            lolbench_skip();
+        half::convert(ph2.data(), pf.data(), HALF_TABLE_SIZE, true);
+    }
+
+    lolbench_declare_bench(from_float_array_round_sse2, HALF_TABLE_SIZE)
+    {
+        if (!half::set_conversion(half::conversion::sse2))
+            lolbench_skip();
+        half::convert(ph2.data(), pf.data(), HALF_TABLE_SIZE, true);
+    }
+
+    lolbench_declare_bench(from_float_array_round_f16c, HALF_TABLE_SIZE)
+    {
+        if (!half::set_conversion(half::conversion::f16c))
+            lolbench_skip();
+        half::convert(ph2.data(), pf.data(), HALF_TABLE_SIZE, true);
+    }
 
-        /* Convert float to half (fast) */
-        timer.Get();
+    lolbench_declare_bench(from_float, HALF_TABLE_SIZE)
+    {
         for (size_t i = 0; i < HALF_TABLE_SIZE; i++)
-            ph[i] = (half)pf[i];
-        result[7] += timer.Get();
+            ph2[i] = (half)pf[i];
+    }
 
-        /* Convert float to half (accurate) */
-        timer.Get();
+    lolbench_declare_bench(from_float_accurate, HALF_TABLE_SIZE)
+    {
         for (size_t i = 0; i < HALF_TABLE_SIZE; i++)
-            ph[i] = half::makeaccurate(pf[i]);
-        result[8] += timer.Get();
+            ph2[i] = half::makeaccurate(pf[i]);
+    }
 
-        /* Add a float to every half */
-        timer.Get();
+    lolbench_declare_bench(half_add_float, HALF_TABLE_SIZE)
+    {
         for (size_t i = 0; i < HALF_TABLE_SIZE; i++)
-            ph[i] += pf[i];
-        result[9] += timer.Get();
-    }
-
-    delete[] pf;
-    delete[] ph;
-
-    for (size_t i = 0; i < sizeof(result) / sizeof(*result); i++)
-        result[i] *= 1e9f / (HALF_TABLE_SIZE * HALF_RUNS);
-
-    msg::info("                          ns/elem\n");
-    msg::info("float = half (array)     %7.3f\n", result[0]);
-    msg::info("float = half (fast)      %7.3f\n", result[1]);
-    msg::info("float = float            %7.3f\n", result[2]);
-    msg::info("float += half            %7.3f\n", result[3]);
-    msg::info("half = half              %7.3f\n", result[4]);
-    msg::info("half = -half             %7.3f\n", result[5]);
-    msg::info("half = float (array)     %7.3f\n", result[6]);
-    msg::info("half = float (fast)      %7.3f\n", result[7]);
-    msg::info("half = float (accurate)  %7.3f\n", result[8]);
-    msg::info("half += float            %7.3f\n", result[9]);
-}
+            ph2[i] = ph[i] + pf[i];
+    }
+
+    array<float> pf, pf2;
+    array<half> ph, ph2;
+};
+
+} /* namespace lol */
 
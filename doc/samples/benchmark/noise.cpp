@@ -0,0 +1,120 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <lol/engine.h>
+
+#include <lolbench.h>
+
+namespace lol
+{
+
+static int const NOISE_GRID_SIZE = 256;
+static size_t const NOISE_GRID_ITEMS = NOISE_GRID_SIZE * NOISE_GRID_SIZE;
+
+/* The same operations for each kind of noise */
+struct noise_ops
+{
+    virtual ~noise_ops() {}
+    virtual void eval(int octaves) = 0;
+    virtual void eval_grid(int octaves) = 0;
+};
+
+template<typename T, int N>
+struct noise_ops_t : public noise_ops
+{
+    noise_ops_t()
+      : origin(0.5f),
+        step(0.f),
+        dims(1)
+    {
+        /* A 2D slice of the noise domain */
+        step[0] = step[N - 1] = 0.037f;
+        dims[0] = dims[N - 1] = NOISE_GRID_SIZE;
+        values.resize(NOISE_GRID_ITEMS);
+    }
+
+    virtual void eval(int octaves)
+    {
+        for (int j = 0; j < NOISE_GRID_SIZE; j++)
+        for (int i = 0; i < NOISE_GRID_SIZE; i++)
+        {
+            vec_t<int, N> index(0);
+            index[0] = i;
+            index[N - 1] = j;
+            vec_t<float, N> p = origin + step * (vec_t<float, N>)index;
+            values[j * NOISE_GRID_SIZE + i] = octaves > 1
+                                            ? noise.eval_fbm(p, octaves)
+                                            : noise.eval(p);
+        }
+    }
+
+    virtual void eval_grid(int octaves)
+    {
+        noise.eval_grid(origin, step, dims, values.data(), octaves);
+    }
+
+    T noise;
+    vec_t<float, N> origin, step;
+    vec_t<int, N> dims;
+    array<float> values;
+};
+
+lolbench_declare_fixture(noise_bench)
+{
+    int variant_count() const { return 3; }
+
+    char const *variant_name(int variant) const
+    {
+        static char const *names[] = { "simplex2", "simplex3", "perlin3" };
+        return names[variant];
+    }
+
+    void setup()
+    {
+        switch (m_variant)
+        {
+        case 0: ops = new noise_ops_t<simplex_noise<2>, 2>(); break;
+        case 1: ops = new noise_ops_t<simplex_noise<3>, 3>(); break;
+        case 2: ops = new noise_ops_t<perlin_noise<3>, 3>(); break;
+        }
+    }
+
+    void teardown()
+    {
+        delete ops;
+        ops = nullptr;
+    }
+
+    /* float = eval(vec) */
+    lolbench_declare_bench(eval, NOISE_GRID_ITEMS) { ops->eval(1); }
+
+    /* float[] = eval_grid(...) */
+    lolbench_declare_bench(eval_grid, NOISE_GRID_ITEMS) { ops->eval_grid(1); }
+
+    /* float = eval_fbm(vec, 4) */
+    lolbench_declare_bench(eval_fbm, NOISE_GRID_ITEMS) { ops->eval(4); }
+
+    /* float[] = eval_grid(..., 4) */
+    lolbench_declare_bench(eval_grid_fbm, NOISE_GRID_ITEMS)
+    {
+        ops->eval_grid(4);
+    }
+
+    noise_ops *ops;
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,104 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <lol/engine.h>
+
+#include <lolbench.h>
+
+namespace lol
+{
+
+lolbench_declare_fixture(raybatch_bench)
+{
+    /* Rays against a sphere of about 100k triangles: 256×256 camera rays
+     * in screen tiles of 4×2, then the same number of random rays. Items
+     * are rays, so 1000 / (ns per item) gives Mrays/s. */
+    int variant_count() const { return 2; }
+
+    char const *variant_name(int variant) const
+    {
+        static char const *names[] = { "camera", "random" };
+        return names[variant];
+    }
+
+    size_t variant_items(int variant) const
+    {
+        (void)variant;
+        return RAY_COUNT;
+    }
+
+    static int const SCREEN_SIZE = 256;
+    static int const RAY_COUNT = SCREEN_SIZE * SCREEN_SIZE;
+
+    void setup()
+    {
+        /* The icosphere has 20 * n^2 triangles */
+        if (!mesh.GetTriangleCount())
+        {
+            EasyMesh sphere;
+            sphere.AppendSphere(71, 2.f);
+            mesh.Build(&sphere.m_vert[0].m_coord, sphere.m_indices.data(),
+                       sphere.m_indices.count(), sizeof(VertexData));
+        }
+
+        rays.Empty();
+        rays.Reserve(RAY_COUNT);
+        if (m_variant == 0)
+        {
+            vec3 const eye(0.f, 0.f, -5.f);
+            for (int ty = 0; ty < SCREEN_SIZE; ty += 2)
+            for (int tx = 0; tx < SCREEN_SIZE; tx += 4)
+            for (int y = ty; y < ty + 2; ++y)
+            for (int x = tx; x < tx + 4; ++x)
+            {
+                vec2 p = (vec2((float)x, (float)y) + vec2(.5f))
+                           / (float)SCREEN_SIZE * 2.f - vec2(1.f);
+                rays.Push(eye, vec3(p * .5f, 1.f));
+            }
+        }
+        else
+        {
+            for (int i = 0; i < RAY_COUNT; ++i)
+            {
+                vec3 origin(rand(-4.f, 4.f), rand(-4.f, 4.f), rand(-4.f, 4.f));
+                vec3 target(rand(-2.f, 2.f), rand(-2.f, 2.f), rand(-2.f, 2.f));
+                rays.Push(origin, target - origin);
+            }
+        }
+    }
+
+    void teardown()
+    {
+        rays.Empty();
+    }
+
+    lolbench_declare_bench(closest_hit, 1)
+    {
+        rays.Intersect(mesh, RayQuery::ClosestHit);
+        bench_keep(rays.GetHit(0));
+    }
+
+    lolbench_declare_bench(any_hit, 1)
+    {
+        rays.Intersect(mesh, RayQuery::AnyHit);
+        bench_keep(rays.GetHit(0));
+    }
+
+    RayMesh mesh;
+    RayBatch rays;
+};
+
+} /* namespace lol */
@@ -14,69 +14,63 @@
 #   include "config.h"
 #endif
 
-#include <cstdio>
-
 #include <lol/engine.h>
 
-using namespace lol;
+#include <lolbench.h>
+
+namespace lol
+{
 
 static size_t const REAL_TABLE_SIZE = 10000;
-static size_t const REAL_RUNS = 50;
+static size_t const REAL_SLOW_SIZE = REAL_TABLE_SIZE / 128;
 
-void bench_real(int mode)
+lolbench_declare_fixture(real_bench)
 {
-    float result[12] = { 0.0f };
-    Timer timer;
-
-    for (size_t run = 0; run < REAL_RUNS; run++)
+    /* real = real + real */
+    lolbench_declare_bench(real_add, REAL_TABLE_SIZE)
     {
-        switch (mode)
-        {
-        case 1:
-            break;
-        }
-
         real fib1 = 1.0, fib2 = 1.0;
-        timer.Get();
         for (size_t i = 0; i < REAL_TABLE_SIZE; i++)
         {
             real tmp = fib1 + fib2;
             fib1 = fib2;
             fib2 = tmp;
         }
-        result[0] += timer.Get();
+        bench_keep(fib2);
+    }
 
+    /* real = real * real */
+    lolbench_declare_bench(real_mul, REAL_TABLE_SIZE)
+    {
         real fact = 1.0;
-        timer.Get();
         for (size_t i = 0; i < REAL_TABLE_SIZE; i++)
             fact = fact * real(1.0 + i);
-        result[1] += timer.Get();
+        bench_keep(fact);
+    }
 
+    /* real = real / real */
+    lolbench_declare_bench(real_div, REAL_TABLE_SIZE)
+    {
         real invfact = 1.0;
-        timer.Get();
         for (size_t i = 0; i < REAL_TABLE_SIZE; i++)
             invfact = invfact / real(1.0 + i);
-        result[2] += timer.Get();
-
-        timer.Get();
-        for (size_t i = 0; i < REAL_TABLE_SIZE / 128; i++)
-            sin(real(0.01 * i));
-        result[3] += timer.Get() * 128;
+        bench_keep(invfact);
+    }
 
-        timer.Get();
-        for (size_t i = 0; i < REAL_TABLE_SIZE / 128; i++)
-            exp((real)(int)(i - REAL_TABLE_SIZE / 256));
-        result[4] += timer.Get() * 128;
+    /* real = sin(real) */
+    lolbench_declare_bench(real_sin, REAL_SLOW_SIZE)
+    {
+        for (size_t i = 0; i < REAL_SLOW_SIZE; i++)
+            bench_keep(sin(real(0.01 * i)));
     }
 
-    for (size_t i = 0; i < sizeof(result) / sizeof(*result); i++)
-        result[i] *= 1e9f / (REAL_TABLE_SIZE * REAL_RUNS);
+    /* real = exp(real) */
+    lolbench_declare_bench(real_exp, REAL_SLOW_SIZE)
+    {
+        for (size_t i = 0; i < REAL_SLOW_SIZE; i++)
+            bench_keep(exp((real)(int)(i - REAL_SLOW_SIZE / 2)));
+    }
+};
 
-    msg::info("                              ns/elem\n");
-    msg::info("real = real + real           %7.3f\n", result[0]);
-    msg::info("real = real * real           %7.3f\n", result[1]);
-    msg::info("real = real / real           %7.3f\n", result[2]);
-    msg::info("real = sin(real)             %7.3f\n", result[3]);
-    msg::info("real = exp(real)             %7.3f\n", result[4]);
-}
+} /* namespace lol */
 
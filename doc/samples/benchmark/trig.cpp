@@ -14,179 +14,172 @@
 #   include "config.h"
 #endif
 
-#include <cstdio>
-
 #if HAVE_FASTMATH_H
 #   include <fastmath.h>
 #endif
 
 #include <lol/engine.h>
 
-using namespace lol;
+#include <lolbench.h>
+
+#if __GNUC__ && !__SNC__
+#   define LIBC_SIN(x) __builtin_sinf(x)
+#   define LIBC_COS(x) __builtin_cosf(x)
+#   define LIBC_TAN(x) __builtin_tanf(x)
+#else
+#   define LIBC_SIN(x) sinf(x)
+#   define LIBC_COS(x) cosf(x)
+#   define LIBC_TAN(x) tanf(x)
+#endif
+
+#if HAVE_FASTMATH_H && !__native_client__ && !EMSCRIPTEN
+#   define FAST_SIN(x) f_sinf(x)
+#   define FAST_COS(x) f_cosf(x)
+#   define FAST_TAN(x) f_tanf(x)
+#else
+#   define FAST_SIN(x) sinf(x)
+#   define FAST_COS(x) cosf(x)
+#   define FAST_TAN(x) tanf(x)
+#endif
+
+namespace lol
+{
 
 static size_t const TRIG_TABLE_SIZE = 128 * 1024;
-static size_t const TRIG_RUNS = 50;
 
-void bench_trig(int mode)
+lolbench_declare_fixture(trig_bench)
 {
-    float result[12] = { 0.0f };
-    Timer timer;
+    /* Three input ranges: large values, one period, and tiny values */
+    int variant_count() const { return 3; }
 
-    /* Set up tables */
-    float *pf = new float[TRIG_TABLE_SIZE];
-    float *pf2 = new float[TRIG_TABLE_SIZE];
-    float *pf3 = new float[TRIG_TABLE_SIZE];
+    char const *variant_name(int variant) const
+    {
+        static char const *names[] = { "1e5", "pi", "1e-2" };
+        return names[variant];
+    }
 
-    for (size_t run = 0; run < TRIG_RUNS; run++)
+    void setup()
     {
-        switch (mode)
-        {
-        case 1:
-            for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
-                pf[i] = rand(-1e5f, 1e5f);
-            break;
-        case 2:
-            for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
-                pf[i] = rand(-F_PI, F_PI);
-            break;
-        case 3:
-            for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
-                pf[i] = rand(-1e-2f, 1e-2f);
-            break;
-        }
+        static float const range[] = { 1e5f, F_PI, 1e-2f };
 
-        /* Sin */
-        timer.Get();
+        pf.resize(TRIG_TABLE_SIZE);
+        pf2.resize(TRIG_TABLE_SIZE);
+        pf3.resize(TRIG_TABLE_SIZE);
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
-#if __GNUC__ && !__SNC__
-            pf2[i] = __builtin_sinf(pf[i]);
-#else
-            pf2[i] = sinf(pf[i]);
-#endif
-        result[0] += timer.Get();
+            pf[i] = rand(-range[m_variant], range[m_variant]);
+    }
+
+    void teardown()
+    {
+        pf.empty();
+        pf2.empty();
+        pf3.empty();
+    }
 
-        /* Fast sin */
-        timer.Get();
+    /* Sin */
+    lolbench_declare_bench(sin_libc, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
-#if HAVE_FASTMATH_H && !__native_client__ && !EMSCRIPTEN
-            pf2[i] = f_sinf(pf[i]);
-#else
-            pf2[i] = sinf(pf[i]);
-#endif
-        result[1] += timer.Get();
+            pf2[i] = LIBC_SIN(pf[i]);
+    }
 
-        /* Lol sin */
-        timer.Get();
+    lolbench_declare_bench(sin_fastmath, TRIG_TABLE_SIZE)
+    {
+        for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
+            pf2[i] = FAST_SIN(pf[i]);
+    }
+
+    lolbench_declare_bench(sin_lol, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
             pf2[i] = lol_sin(pf[i]);
-        result[2] += timer.Get();
+    }
 
-        /* Cos */
-        timer.Get();
+    lolbench_declare_bench(sin_lol_batch, TRIG_TABLE_SIZE)
+    {
+        lol_sin(pf.data(), pf2.data(), TRIG_TABLE_SIZE);
+    }
+
+    /* Cos */
+    lolbench_declare_bench(cos_libc, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
-#if __GNUC__ && !__SNC__
-            pf2[i] = __builtin_cosf(pf[i]);
-#else
-            pf2[i] = cosf(pf[i]);
-#endif
-        result[3] += timer.Get();
+            pf2[i] = LIBC_COS(pf[i]);
+    }
 
-        /* Fast cos */
-        timer.Get();
+    lolbench_declare_bench(cos_fastmath, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
-#if HAVE_FASTMATH_H && !__native_client__ && !EMSCRIPTEN
-            pf2[i] = f_cosf(pf[i]);
-#else
-            pf2[i] = cosf(pf[i]);
-#endif
-        result[4] += timer.Get();
+            pf2[i] = FAST_COS(pf[i]);
+    }
 
-        /* Lol cos */
-        timer.Get();
+    lolbench_declare_bench(cos_lol, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
             pf2[i] = lol_cos(pf[i]);
-        result[5] += timer.Get();
+    }
 
-        /* Sin & cos */
-        timer.Get();
+    lolbench_declare_bench(cos_lol_batch, TRIG_TABLE_SIZE)
+    {
+        lol_cos(pf.data(), pf2.data(), TRIG_TABLE_SIZE);
+    }
+
+    /* Sin & cos */
+    lolbench_declare_bench(sincos_libc, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
         {
-#if __GNUC__ && !__SNC__
-            pf2[i] = __builtin_sinf(pf[i]);
-            pf3[i] = __builtin_cosf(pf[i]);
-#else
-            pf2[i] = sinf(pf[i]);
-            pf3[i] = cosf(pf[i]);
-#endif
+            pf2[i] = LIBC_SIN(pf[i]);
+            pf3[i] = LIBC_COS(pf[i]);
         }
-        result[6] += timer.Get();
+    }
 
-        /* Fast sin & cos */
-        timer.Get();
+    lolbench_declare_bench(sincos_fastmath, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
         {
-#if HAVE_FASTMATH_H && !__native_client__ && !EMSCRIPTEN
-            pf2[i] = f_sinf(pf[i]);
-            pf3[i] = f_cosf(pf[i]);
-#else
-            pf2[i] = sinf(pf[i]);
-            pf3[i] = cosf(pf[i]);
-#endif
+            pf2[i] = FAST_SIN(pf[i]);
+            pf3[i] = FAST_COS(pf[i]);
         }
-        result[7] += timer.Get();
+    }
 
-        /* Lol sincos */
-        timer.Get();
+    lolbench_declare_bench(sincos_lol, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
             lol_sincos(pf[i], &pf2[i], &pf3[i]);
-        result[8] += timer.Get();
+    }
 
-        /* Tan */
-        timer.Get();
+    lolbench_declare_bench(sincos_lol_batch, TRIG_TABLE_SIZE)
+    {
+        lol_sincos(pf.data(), pf2.data(), pf3.data(), TRIG_TABLE_SIZE);
+    }
+
+    /* Tan */
+    lolbench_declare_bench(tan_libc, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
-#if __GNUC__ && !__SNC__
-            pf2[i] = __builtin_tanf(pf[i]);
-#else
-            pf2[i] = tanf(pf[i]);
-#endif
-        result[9] += timer.Get();
+            pf2[i] = LIBC_TAN(pf[i]);
+    }
 
-        /* Fast tan */
-        timer.Get();
+    lolbench_declare_bench(tan_fastmath, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
-#if HAVE_FASTMATH_H && !__native_client__ && !EMSCRIPTEN
-            pf2[i] = f_tanf(pf[i]);
-#else
-            pf2[i] = tanf(pf[i]);
-#endif
-        result[10] += timer.Get();
+            pf2[i] = FAST_TAN(pf[i]);
+    }
 
-        /* Lol tan */
-        timer.Get();
+    lolbench_declare_bench(tan_lol, TRIG_TABLE_SIZE)
+    {
         for (size_t i = 0; i < TRIG_TABLE_SIZE; i++)
             pf2[i] = lol_tan(pf[i]);
-        result[11] += timer.Get();
-    }
-
-    delete[] pf;
-    delete[] pf2;
-    delete[] pf3;
-
-    for (size_t i = 0; i < sizeof(result) / sizeof(*result); i++)
-        result[i] *= 1e9f / (TRIG_TABLE_SIZE * TRIG_RUNS);
-
-    msg::info("                              ns/elem\n");
-    msg::info("float = sinf(float)          %7.3f\n", result[0]);
-    msg::info("float = f_sinf(float)        %7.3f\n", result[1]);
-    msg::info("float = lol_sin(float)       %7.3f\n", result[2]);
-    msg::info("float = cosf(float)          %7.3f\n", result[3]);
-    msg::info("float = f_cosf(float)        %7.3f\n", result[4]);
-    msg::info("float = lol_cos(float)       %7.3f\n", result[5]);
-    msg::info("float = sinf,cosf(float)     %7.3f\n", result[6]);
-    msg::info("float = f_sinf,f_cosf(float) %7.3f\n", result[7]);
-    msg::info("float = lol_sincos(float)    %7.3f\n", result[8]);
-    msg::info("float = tanf(float)          %7.3f\n", result[9]);
-    msg::info("float = f_tanf(float)        %7.3f\n", result[10]);
-    msg::info("float = lol_tanf(float)      %7.3f\n", result[11]);
-}
+    }
+
+    lolbench_declare_bench(tan_lol_batch, TRIG_TABLE_SIZE)
+    {
+        lol_tan(pf.data(), pf2.data(), TRIG_TABLE_SIZE);
+    }
+
+    array<float> pf, pf2, pf3;
+};
+
+} /* namespace lol */
 
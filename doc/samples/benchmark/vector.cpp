@@ -14,78 +14,183 @@
 #   include "config.h"
 #endif
 
-#include <cstdio>
-
 #include <lol/engine.h>
 
-using namespace lol;
+#include <lolbench.h>
+
+namespace lol
+{
 
 static size_t const MATRIX_TABLE_SIZE = 64 * 1024;
-static size_t const MATRIX_RUNS = 100;
+static size_t const SOA_TABLE_SIZE = 64 * 1024;
 
-void bench_matrix(int mode)
+/* Reference LU-based versions, to measure the closed-form speedup */
+static float lu_determinant(mat4 const &m)
 {
-    float result[5] = { 0.0f };
-    Timer timer;
+    mat4 L, U;
+    vec_t<int, 4> P = p_vector(m);
+    lu_decomposition(permute_rows(m, P), L, U);
+
+    float det = 1.f;
+    for (int i = 0; i < 4; ++i)
+        det *= U[i][i];
+    return permutation_det(P) * det;
+}
 
-    /* Set up tables */
-    mat4 *pm = new mat4[MATRIX_TABLE_SIZE + 1];
-    float *pf = new float[MATRIX_TABLE_SIZE];
+static mat4 lu_inverse(mat4 const &m)
+{
+    mat4 L, U;
+    vec_t<int, 4> P = p_vector(m);
+    lu_decomposition(permute_rows(m, P), L, U);
+    return permute_cols(u_inverse(U) * l_inverse(L), p_transpose(P));
+}
 
-    for (size_t run = 0; run < MATRIX_RUNS; run++)
+lolbench_declare_fixture(matrix_bench)
+{
+    void setup()
     {
-        switch (mode)
-        {
-        case 1:
-            for (size_t i = 0; i < MATRIX_TABLE_SIZE; i++)
-                for (int j = 0; j < 4; j++)
-                    for (int k = 0; k < 4; k++)
-                        pm[i][j][k] = rand(-2.0f, 2.0f);
-            break;
-        }
+        pm.resize(MATRIX_TABLE_SIZE + 1);
+        pr.resize(MATRIX_TABLE_SIZE);
+        pf.resize(MATRIX_TABLE_SIZE);
+
+        for (size_t i = 0; i < MATRIX_TABLE_SIZE + 1; i++)
+            for (int j = 0; j < 4; j++)
+                for (int k = 0; k < 4; k++)
+                    pm[i][j][k] = rand(-2.0f, 2.0f);
+    }
+
+    void teardown()
+    {
+        pm.empty();
+        pr.empty();
+        pf.empty();
+    }
 
-        /* Copy matrices */
-        timer.Get();
+    /* Results are stored in separate tables, so that the input data
+     * stays the same across runs. */
+    lolbench_declare_bench(copy, MATRIX_TABLE_SIZE)
+    {
         for (size_t i = 0; i < MATRIX_TABLE_SIZE; i++)
-            pm[i] = pm[i + 1];
-        result[0] += timer.Get();
+            pr[i] = pm[i + 1];
+    }
 
-        /* Determinant */
-        timer.Get();
+    lolbench_declare_bench(det, MATRIX_TABLE_SIZE)
+    {
         for (size_t i = 0; i < MATRIX_TABLE_SIZE; i++)
             pf[i] = determinant(pm[i]);
-        result[1] += timer.Get();
+    }
 
-        /* Multiply matrices */
-        timer.Get();
+    lolbench_declare_bench(det_lu, MATRIX_TABLE_SIZE)
+    {
+        for (size_t i = 0; i < MATRIX_TABLE_SIZE; i++)
+            pf[i] = lu_determinant(pm[i]);
+    }
+
+    lolbench_declare_bench(mul, MATRIX_TABLE_SIZE)
+    {
+        for (size_t i = 0; i < MATRIX_TABLE_SIZE; i++)
+            pr[i] = pm[i] * pm[i + 1];
+    }
+
+    lolbench_declare_bench(add, MATRIX_TABLE_SIZE)
+    {
         for (size_t i = 0; i < MATRIX_TABLE_SIZE; i++)
-            pm[i] *= pm[i + 1];
-        result[2] += timer.Get();
+            pr[i] = pm[i] + pm[i + 1];
+    }
 
-        /* Add matrices */
-        timer.Get();
+    lolbench_declare_bench(invert, MATRIX_TABLE_SIZE)
+    {
         for (size_t i = 0; i < MATRIX_TABLE_SIZE; i++)
-            pm[i] += pm[i + 1];
-        result[3] += timer.Get();
+            pr[i] = inverse(pm[i]);
+    }
 
-        /* Invert matrix */
-        timer.Get();
+    lolbench_declare_bench(invert_lu, MATRIX_TABLE_SIZE)
+    {
         for (size_t i = 0; i < MATRIX_TABLE_SIZE; i++)
-            pm[i] = inverse(pm[i]);
-        result[4] += timer.Get();
+            pr[i] = lu_inverse(pm[i]);
     }
 
-    delete[] pm;
-    delete[] pf;
+    array<mat4> pm, pr;
+    array<float> pf;
+};
 
-    for (size_t i = 0; i < sizeof(result) / sizeof(*result); i++)
-        result[i] *= 1e9f / (MATRIX_TABLE_SIZE * MATRIX_RUNS);
+lolbench_declare_fixture(soa_bench)
+{
+    void setup()
+    {
+        m = mat4::rotate(radians(10.f), vec3(1.f, 2.f, 3.f))
+          * mat4::translate(vec3(0.1f, 0.2f, 0.3f));
 
-    msg::info("                          ns/elem\n");
-    msg::info("mat4 = mat4              %7.3f\n", result[0]);
-    msg::info("float = mat4.det()       %7.3f\n", result[1]);
-    msg::info("mat4 *= mat4             %7.3f\n", result[2]);
-    msg::info("mat4 += mat4             %7.3f\n", result[3]);
-    msg::info("mat4 = mat4.invert()     %7.3f\n", result[4]);
-}
+        pa.resize(SOA_TABLE_SIZE);
+        pb.resize(SOA_TABLE_SIZE);
+        pr.resize(SOA_TABLE_SIZE);
+        pf.resize(SOA_TABLE_SIZE);
+
+        for (size_t i = 0; i < SOA_TABLE_SIZE; i++)
+        {
+            pa[i] = vec3(rand(-2.0f, 2.0f), rand(-2.0f, 2.0f), rand(-2.0f, 2.0f));
+            pb[i] = vec3(rand(-2.0f, 2.0f), rand(-2.0f, 2.0f), rand(-2.0f, 2.0f));
+        }
+        sa.load(pa.data(), pa.count());
+        sb.load(pb.data(), pb.count());
+    }
+
+    void teardown()
+    {
+        pa.empty(); pb.empty(); pr.empty(); pf.empty();
+        sa.empty(); sb.empty(); sr.empty();
+    }
+
+    /* Each operation on a vec3[] table and on a soa_array */
+    lolbench_declare_bench(transform_points, SOA_TABLE_SIZE)
+    {
+        for (size_t i = 0; i < SOA_TABLE_SIZE; i++)
+            pr[i] = (m * vec4(pa[i], 1.f)).xyz;
+    }
+
+    lolbench_declare_bench(transform_points_soa, SOA_TABLE_SIZE)
+    {
+        lol::transform_points(m, sa, sr);
+    }
+
+    lolbench_declare_bench(normalize, SOA_TABLE_SIZE)
+    {
+        for (size_t i = 0; i < SOA_TABLE_SIZE; i++)
+            pr[i] = lol::normalize(pa[i]);
+    }
+
+    lolbench_declare_bench(normalize_soa, SOA_TABLE_SIZE)
+    {
+        normalize_all(sa, sr);
+    }
+
+    lolbench_declare_bench(dot, SOA_TABLE_SIZE)
+    {
+        for (size_t i = 0; i < SOA_TABLE_SIZE; i++)
+            pf[i] = lol::dot(pa[i], pb[i]);
+    }
+
+    lolbench_declare_bench(dot_soa, SOA_TABLE_SIZE)
+    {
+        dot_all(sa, sb, pf.data());
+    }
+
+    lolbench_declare_bench(lerp, SOA_TABLE_SIZE)
+    {
+        for (size_t i = 0; i < SOA_TABLE_SIZE; i++)
+            pr[i] = mix(pa[i], pb[i], 0.25f);
+    }
+
+    lolbench_declare_bench(lerp_soa, SOA_TABLE_SIZE)
+    {
+        lerp_all(sa, sb, 0.25f, sr);
+    }
+
+    mat4 m;
+    array<vec3> pa, pb, pr;
+    array<float> pf;
+    soa_array<vec3> sa, sb, sr;
+};
+
+} /* namespace lol */
 
@@ -15,59 +15,102 @@
 #endif
 
 #include <cstdio>
+#include <cstdlib>
 
 #include <lol/engine.h>
 
+#include <lolbench.h>
+
 using namespace lol;
 
-void bench_real(int mode);
-void bench_trig(int mode);
-void bench_matrix(int mode);
-void bench_half(int mode);
+static void usage()
+{
+    printf("Usage: benchsuite [-l] [-r <count>] [-t <ms>] [-j <file>] "
+           "[-c <file>]\n");
+    printf("                  [-b <file> [-T <percent>]] [filter...]\n");
+    printf("Options:\n");
+    printf("  -l, --list              list benchmarks and exit\n");
+    printf("  -r, --repeat <count>    number of repetitions (default 11)\n");
+    printf("  -t, --time <ms>         minimum time of one repetition "
+           "(default 10)\n");
+    printf("  -j, --json <file>       save results as JSON\n");
+    printf("  -c, --csv <file>        save results as CSV\n");
+    printf("  -b, --baseline <file>   compare with results from a previous "
+           "run\n");
+    printf("  -T, --threshold <pct>   report regressions above this "
+           "percentage (default 10)\n");
+    printf("  -h, --help              display this help and exit\n");
+    printf("Only benchmarks whose name contains one of the filters are run.\n");
+}
 
 int main(int argc, char **argv)
 {
-    UNUSED(argc, argv);
-
-    msg::info("-----------------------\n");
-    msg::info(" High precision floats\n");
-    msg::info("-----------------------\n");
-    bench_real(1);
-
-    msg::info("--------------------------\n");
-    msg::info(" Trigonometry [-1e5, 1e5]\n");
-    msg::info("--------------------------\n");
-    bench_trig(1);
-
-    msg::info("------------------------\n");
-    msg::info(" Trigonometry [-pi, pi]\n");
-    msg::info("------------------------\n");
-    bench_trig(2);
-
-    msg::info("----------------------------\n");
-    msg::info(" Trigonometry [-1e-2, 1e-2]\n");
-    msg::info("----------------------------\n");
-    bench_trig(3);
-
-    msg::info("----------------------------\n");
-    msg::info(" Float matrices [-2.0, 2.0]\n");
-    msg::info("----------------------------\n");
-    bench_matrix(1);
-
-    msg::info("-------------------------------------\n");
-    msg::info(" Half precision floats (random bits)\n");
-    msg::info("-------------------------------------\n");
-    bench_half(1);
-
-    msg::info("-----------------------------------\n");
-    msg::info(" Half precision floats [-2.0, 2.0]\n");
-    msg::info("-----------------------------------\n");
-    bench_half(2);
+    bench_runner runner;
+    bool list = false;
+
+    lol::getopt opt(argc, argv);
+    opt.add_opt('l', "list",      false);
+    opt.add_opt('r', "repeat",    true);
+    opt.add_opt('t', "time",      true);
+    opt.add_opt('j', "json",      true);
+    opt.add_opt('c', "csv",       true);
+    opt.add_opt('b', "baseline",  true);
+    opt.add_opt('T', "threshold", true);
+    opt.add_opt('h', "help",      false);
+
+    for (;;)
+    {
+        int c = opt.parse();
+        if (c == -1)
+            break;
+
+        switch (c)
+        {
+        case 'l': /* --list */
+            list = true;
+            break;
+        case 'r': /* --repeat */
+            runner.set_repetitions(atoi(opt.arg));
+            break;
+        case 't': /* --time */
+            runner.set_min_time(atof(opt.arg) * 1e-3);
+            break;
+        case 'j': /* --json */
+            runner.set_json_output(opt.arg);
+            break;
+        case 'c': /* --csv */
+            runner.set_csv_output(opt.arg);
+            break;
+        case 'b': /* --baseline */
+            runner.set_baseline(opt.arg);
+            break;
+        case 'T': /* --threshold */
+            runner.set_threshold(atof(opt.arg) * 1e-2);
+            break;
+        case 'h': /* --help */
+            usage();
+            return EXIT_SUCCESS;
+        default:
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    while (opt.index < argc)
+        runner.add_filter(argv[opt.index++]);
+
+    if (list)
+    {
+        runner.List();
+        return EXIT_SUCCESS;
+    }
+
+    bool success = runner.Run();
 
 #if defined _WIN32
     getchar();
 #endif
 
-    return EXIT_SUCCESS;
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
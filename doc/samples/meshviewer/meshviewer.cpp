@@ -166,6 +166,9 @@ void MeshViewer::Start()
     m_ssetup_file_name = "../data/meshviewer.init.lua";
     UpdateSceneSetup();
 
+    //Reloading an edited mesh file only runs its changed commands
+    EasyMesh::SetCmdCache(64 << 20);
+
     //Mesh file
     m_file_status = m_file_check->RegisterFile(m_file_name);
     m_file_loader->AddJob(GetLoadJob(m_file_name));
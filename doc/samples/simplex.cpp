@@ -24,11 +24,46 @@ ivec2 const size(1280 * 1, 720 * 1);
 float const zoom = 0.03f / 1;
 int const octaves = 1;
 
+/* Fill one cell of the image with a 2D slice of N-dimensional noise; the
+ * slice spans axes 0 and “yaxis”, the other coordinates are 1, 2, 3… */
+template<int N>
+static void fill_cell(simplex_noise<N> const &s, int yaxis,
+                      ibox2 const &cell, array2d<vec4> &data)
+{
+    ivec2 cell_size = cell.bb - cell.aa;
+
+    vec_t<float, N> origin, step(0.f);
+    vec_t<int, N> dims(1);
+    for (int i = 1, n = 1; i < N; ++i)
+        if (i != yaxis)
+            origin[i] = zoom * n++;
+
+    origin[0] = zoom * cell.aa.x;
+    origin[yaxis] = zoom * cell.aa.y;
+    step[0] = step[yaxis] = zoom;
+    dims[0] = cell_size.x;
+    dims[yaxis] = cell_size.y;
+
+    /* Octave k has weight 1/2^k, so normalise by the sum of weights */
+    array<float> values;
+    values.resize(cell_size.x * cell_size.y);
+    s.eval_grid(origin, step, dims, values.data(), octaves);
+    float const coeff = 2.f - 2.f / (1 << octaves);
+
+    for (int j = 0; j < cell_size.y; ++j)
+    for (int i = 0; i < cell_size.x; ++i)
+    {
+        float c = saturate(0.5f + 0.5f * values[j * cell_size.x + i] / coeff);
+        data[cell.aa.x + i][cell.aa.y + j] = vec4(c, c, c, 1.f);
+        //data[…] = Color::HSVToRGB(vec4(c, 1.0f, 0.5f, 1.f));
+    }
+}
+
 int main(int argc, char **argv)
 {
     UNUSED(argc, argv);
 
-    srand(time(nullptr));
+    rng::get().seed(time(nullptr));
 
     /* Create an image */
     Image img(size);
@@ -38,80 +73,24 @@ int main(int argc, char **argv)
     simplex_noise<2> s2;
     simplex_noise<3> s3;
     simplex_noise<4> s4;
-    simplex_noise<5> s5;
     simplex_noise<6> s6;
-    simplex_noise<7> s7;
     simplex_noise<8> s8;
-    simplex_noise<9> s9;
-    simplex_noise<10> s10;
-    simplex_noise<11> s11;
     simplex_noise<12> s12;
 
-    /* Fill image with simplex noise */
-    for (int j = 0; j < size.y; ++j)
-    for (int i = 0; i < size.x; ++i)
+    /* Fill image with simplex noise, using three cells per row */
+    auto cell = [](int n)
     {
-        int cell = j / (size.y / 2) * 3 + i / (size.x / 3);
-
-        float x = (float)i, y = (float)j;
-        float sum = 0.f, coeff = 0.f;
-        int const max_k = 1 << octaves;
-        bool b_centre = false, b_sphere1 = false, b_sphere2 = false;
-
-        for (int k = 1; k < max_k; k *= 2)
-        {
-            float t = 0.f;
-
-            switch (cell)
-            {
-            case 0:
-                t = s2.eval(zoom * k * vec2(x, y));
-                break;
-            case 1:
-                t = s3.eval(zoom * k * vec3(x, 1.f, y));
-                break;
-            case 2:
-                t = s4.eval(zoom * k * vec4(x, 1.f, y, 2.f));
-                break;
-            case 3:
-                t = s6.eval(zoom * k * vec6(x, 1.f, 2.f, y, 3.f, 4.f));
-                break;
-            case 4:
-                t = s8.eval(zoom * k * vec8(x, 1.f, 2.f, 3.f,
-                                            y, 4.f, 5.f, 6.f));
-                break;
-            case 5:
-                //t = s12.eval(zoom * k * vec12(x / 2, -x / 2, y / 2, -y / 2,
-                //                              -x / 2, x / 2, -y / 2, y / 2,
-                //                              7.f, 8.f, 9.f, 10.f));
-                t = s12.eval(zoom * k * vec12(x, 1.f, 2.f, 3.f, 4.f, 5.f,
-                                              y, 6.f, 7.f, 8.f, 9.f, 10.f));
-                break;
-            default:
-                break;
-            }
-
-            if (t == -2.f) b_centre = true;
-            if (t == -3.f) b_sphere1 = true;
-            if (t == -4.f) b_sphere2 = true;
-
-            sum += 1.f / k * t;
-            coeff += 1.f / k;
-        }
-
-        if (b_centre)
-            data[i][j] = vec4(1.f, 0.f, 1.f, 1.f);
-        else if (b_sphere1)
-            data[i][j] = vec4(0.f, 1.f, 0.f, 1.f);
-        else if (b_sphere2)
-            data[i][j] = vec4(0.f, 0.f, 1.f, 1.f);
-        else
-        {
-            float c = saturate(0.5f + 0.5f * sum / coeff);
-            data[i][j] = vec4(c, c, c, 1.f);
-            //data[i][j] = Color::HSVToRGB(vec4(c, 1.0f, 0.5f, 1.f));
-        }
-    }
+        ivec2 a(n % 3 * size.x / 3, n / 3 * size.y / 2);
+        ivec2 b((n % 3 + 1) * size.x / 3, (n / 3 + 1) * size.y / 2);
+        return ibox2(a, b);
+    };
+
+    fill_cell(s2, 1, cell(0), data);  /* vec2(x, y) */
+    fill_cell(s3, 2, cell(1), data);  /* vec3(x, 1, y) */
+    fill_cell(s4, 2, cell(2), data);  /* vec4(x, 1, y, 2) */
+    fill_cell(s6, 3, cell(3), data);  /* vec6(x, 1, 2, y, 3, 4) */
+    fill_cell(s8, 4, cell(4), data);  /* vec8(x, 1, 2, 3, y, 4, 5, 6) */
+    fill_cell(s12, 6, cell(5), data); /* vec12(x, 1, …, 5, y, 6, …, 10) */
 
 #if 0
     /* Mark simplex vertices */
@@ -33,16 +33,48 @@ public:
     //GET/SET exec
     int GetCmdNb() { return m_commands.count(); }
     int GetCmd(int i)
+    {
+        Rewind(i);
+        return m_commands[i].m1;
+    }
+
+    //Point the argument getters back at the start of command i
+    void Rewind(int i)
     {
         ASSERT(0 <= i && i < m_commands.count());
         m_f_cur = m_commands[i].m2;
         m_i_cur = m_commands[i].m3;
-        return m_commands[i].m1;
     }
 
     //cmd storage
     void    AddCmd(int cmd) { m_commands.push(cmd, m_floats.count(), m_ints.count()); }
 
+    //Hash of command i and its arguments, chained after seed
+    uint64_t HashCmd(int i, uint64_t seed)
+    {
+        ASSERT(0 <= i && i < m_commands.count());
+        bool last = (i + 1 == m_commands.count());
+        int f_end = last ? m_floats.count() : m_commands[i + 1].m2;
+        int i_end = last ? m_ints.count() : m_commands[i + 1].m3;
+
+        uint64_t ret = Hash(seed, &m_commands[i].m1, sizeof(int));
+        ret = Hash(ret, m_floats.data() + m_commands[i].m2,
+                   (f_end - m_commands[i].m2) * sizeof(float));
+        return Hash(ret, m_ints.data() + m_commands[i].m3,
+                    (i_end - m_commands[i].m3) * sizeof(int));
+    }
+
+    //FNV-1a over 32-bit words, every hashed type is a multiple of that
+    static uint64_t Hash(uint64_t seed, void const *data, size_t bytes)
+    {
+        uint32_t const *p = (uint32_t const *)data;
+        uint64_t ret = seed ^ 0xcbf29ce484222325ull;
+        for (size_t n = 0; n < bytes / sizeof(uint32_t); ++n)
+            ret = (ret ^ p[n]) * 0x100000001b3ull;
+        /* The length separates an empty argument list from a missing one */
+        return (ret ^ bytes) * 0x100000001b3ull;
+    }
+
     //GETTER
     inline float   F()      { return m_floats[m_f_cur++]; }
     inline int     I()      { return m_ints[m_i_cur++]; }
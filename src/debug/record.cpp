@@ -10,12 +10,6 @@
 
 #include <lol/engine-internal.h>
 
-#include <cstring>
-
-#if defined USE_PIPI
-#   include <pipi.h>
-#endif
-
 #include "loldebug.h"
 
 namespace lol
@@ -32,10 +26,8 @@ class DebugRecordData
 private:
     String m_path;
     ivec2 m_size;
-    int m_fps;
-#if defined USE_PIPI
-    pipi_sequence_t *m_sequence;
-#endif
+    float m_fps;
+    Movie *m_movie;
 };
 
 /*
@@ -49,10 +41,8 @@ DebugRecord::DebugRecord(String const &path, float fps)
 
     m_data->m_path = path;
     m_data->m_size = ivec2::zero;
-    m_data->m_fps = (int)(fps + 0.5f);
-#if defined USE_PIPI
-    m_data->m_sequence = nullptr;
-#endif
+    m_data->m_fps = fps;
+    m_data->m_movie = nullptr;
 
     m_drawgroup = DRAWGROUP_CAPTURE;
 }
@@ -72,32 +62,25 @@ void DebugRecord::TickDraw(float seconds, Scene &scene)
     {
         m_data->m_size = size;
 
-#if defined USE_PIPI
-        if (m_data->m_sequence)
-            pipi_close_sequence(m_data->m_sequence);
-
-        m_data->m_sequence = pipi_open_sequence(m_data->m_path, size.x, size.y,
-                                                1 /* RGB */, m_data->m_fps,
-                                                1, 1, 60 * 1024 * 1024);
-#endif
+        delete m_data->m_movie;
+        m_data->m_movie = new Movie(m_data->m_path, size, m_data->m_fps);
     }
 
-#if defined USE_PIPI
-    if (m_data->m_sequence)
+    /* Capture straight into one of the movie’s frame buffers; if the
+     * encoder is lagging behind, the frame is dropped instead. */
+    u8vec4 *buffer = m_data->m_movie->Lock();
+    if (buffer)
     {
-        uint32_t *buffer = new uint32_t[size.x * size.y];
-        Video::Capture(buffer);
-        pipi_feed_sequence(m_data->m_sequence, (uint8_t *)buffer,
-                           size.x, size.y);
-        delete[] buffer;
+        Video::Capture((uint32_t *)buffer);
+        m_data->m_movie->Unlock(buffer);
     }
-#endif
 }
 
 DebugRecord::~DebugRecord()
 {
     Ticker::StopRecording();
 
+    delete m_data->m_movie;
     delete m_data;
 }
 
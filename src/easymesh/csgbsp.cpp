@@ -14,8 +14,13 @@
 namespace lol
 {
 
+//Number of splitting plane candidates tried for each leaf of BuildTree(),
+//and of the triangles sampled to score each of them.
+static int const CSG_BSP_CANDIDATES = 8;
+static int const CSG_BSP_SAMPLES = 32;
+
 //--
-int CsgBsp::AddLeaf(int leaf_type, vec3 origin, vec3 normal, int above_idx)
+int CsgBsp::AddLeaf(int leaf_type, vec3 p0, vec3 p1, vec3 p2, int above_idx)
 {
     if (leaf_type > 2 && leaf_type < -1)
         return -1;
@@ -29,29 +34,50 @@ int CsgBsp::AddLeaf(int leaf_type, vec3 origin, vec3 normal, int above_idx)
     {
         if (m_tree.count() != 0)
             m_tree[above_idx].m_leaves[leaf_type] = (int32_t)m_tree.count();
-        m_tree.push(CsgBspLeaf(origin, normal, above_idx));
+        m_tree.push(CsgBspLeaf(p0, p1, p2, above_idx));
         return m_tree.count() - 1;
     }
 
     return -1;
 }
 
-int CsgBsp::TestPoint(int leaf_idx, vec3 point)
+void CsgBsp::ExtendBBox(vec3 const &p0, vec3 const &p1, vec3 const &p2)
 {
-    if (leaf_idx >= 0 && leaf_idx < m_tree.count())
-    {
-        vec3 p2o = point - m_tree[leaf_idx].m_origin;
+    m_bbox.aa = min(m_bbox.aa, min(p0, min(p1, p2)));
+    m_bbox.bb = max(m_bbox.bb, max(p0, max(p1, p2)));
+}
 
-        if (length(p2o) < TestEpsilon::Get())
-            return LEAF_CURRENT;
+int CsgBsp::TestPoint(int leaf_idx, vec3 point) const
+{
+    double dist;
+    if (leaf_idx >= 0 && leaf_idx < m_tree.count())
+        return TestPoint(m_tree[leaf_idx], point, dist);
+    return LEAF_CURRENT;
+}
 
-        float p2o_dot = dot(normalize(p2o), m_tree[leaf_idx].m_normal);
+//Points closer than TestEpsilon to the plane are on it, the side of the others
+//is exact : when the double precision distance is too small to be trusted, the
+//adaptive Orient3D() predicate decides.
+int CsgBsp::TestPoint(CsgBspLeaf const &leaf, vec3 const &point, double &dist)
+{
+    double const epsilon = TestEpsilon::Get();
+    dvec3 p2o = dvec3(point) - dvec3(leaf.m_origin);
+    double det = dot(leaf.m_plane, p2o);
+    double err = leaf.m_plane_err * (lol::abs(p2o.x) + lol::abs(p2o.y) + lol::abs(p2o.z));
 
-        if (p2o_dot > TestEpsilon::Get())
-            return LEAF_FRONT;
-        else if (p2o_dot < -TestEpsilon::Get())
-            return LEAF_BACK;
+    if (lol::abs(det) <= err)
+    {
+        dist = .0;
+        if (2.0 * err * leaf.m_inv_len < epsilon)
+            return LEAF_CURRENT;
+        det = Orient3D(leaf.m_origin, leaf.m_p1, leaf.m_p2, point);
     }
+
+    dist = det * leaf.m_inv_len;
+    if (dist > epsilon)
+        return LEAF_FRONT;
+    else if (dist < -epsilon)
+        return LEAF_BACK;
     return LEAF_CURRENT;
 }
 
@@ -65,11 +91,15 @@ void CsgBsp::AddTriangleToTree(int const &tri_idx, vec3 const &tri_p0, vec3 cons
     //Tree is empty, so this leaf is the first
     if (m_tree.count() == 0)
     {
-        AddLeaf(LEAF_CURRENT, tri_p0, cross(normalize(tri_p1 - tri_p0), normalize(tri_p2 - tri_p1)), LEAF_CURRENT);
+        m_bbox = box3(tri_p0, tri_p0);
+        ExtendBBox(tri_p0, tri_p1, tri_p2);
+        AddLeaf(LEAF_CURRENT, tri_p0, tri_p1, tri_p2, LEAF_CURRENT);
         m_tree.last().m_tri_list.push(tri_idx, tri_p0, tri_p1, tri_p2);
         return;
     }
 
+    ExtendBBox(tri_p0, tri_p1, tri_p2);
+
     tri_to_process.reserve(20);
     tri_to_process.push(0, tri_p0, tri_p1, tri_p2);
 
@@ -196,14 +226,14 @@ void CsgBsp::AddTriangleToTree(int const &tri_idx, vec3 const &tri_p0, vec3 cons
         //If we had it to an already existing leaf.
         if (Leaf_to_add[i].m2 < m_tree.count() && m_tree[Leaf_to_add[i].m2].m_leaves[Leaf_to_add[i].m1] == LEAF_CURRENT)
         {
-            AddLeaf(Leaf_to_add[i].m1, tri_p0, cross(normalize(tri_p1 - tri_p0), normalize(tri_p2 - tri_p1)), Leaf_to_add[i].m2);
+            AddLeaf(Leaf_to_add[i].m1, tri_p0, tri_p1, tri_p2, Leaf_to_add[i].m2);
             m_tree.last().m_tri_list.push(tri_idx, tri_p0, tri_p1, tri_p2);
         }
 
         /*
         if (Leaf_to_add[i].m6 == -1)
         {
-            AddLeaf(Leaf_to_add[i].m1, tri_p0, cross(normalize(tri_p1 - tri_p0), normalize(tri_p2 - tri_p1)), Leaf_to_add[i].m2);
+            AddLeaf(Leaf_to_add[i].m1, tri_p0, tri_p1, tri_p2, Leaf_to_add[i].m2);
             m_tree.last().m_tri_list.push(tri_idx, tri_p0, tri_p1, tri_p2);
         }
         else
@@ -212,6 +242,170 @@ void CsgBsp::AddTriangleToTree(int const &tri_idx, vec3 const &tri_p0, vec3 cons
     }
 }
 
+void CsgBsp::BuildTree(array< int, vec3, vec3, vec3 > const &tri_list)
+{
+    //Triangles, or pieces of them, waiting for a leaf. They are grouped in
+    //ranges that are handled last-in first-out, so each piece is only stored once.
+    //<Tri_Id in tri_list, v0, v1, v2>
+    array< int, vec3, vec3, vec3 > pieces;
+    //<First_Piece, FW/BW, Leaf_Id>
+    array< int, int, int > ranges;
+    //Front and back pieces of the range being handled
+    array< int, vec3, vec3, vec3 > side_pieces[2];
+
+    m_tree.empty();
+    pieces.reserve(tri_list.count() * 2);
+    for (int i = 0; i < tri_list.count(); i++)
+    {
+        vec3 const &p0 = tri_list[i].m2, &p1 = tri_list[i].m3, &p2 = tri_list[i].m4;
+
+        if (i == 0)
+            m_bbox = box3(p0, p0);
+        ExtendBBox(p0, p1, p2);
+
+        //Flat triangles do not give any plane
+        if (sqlength(cross(p1 - p0, p2 - p0)) > .0f)
+            pieces.push(i, p0, p1, p2);
+    }
+
+    if (pieces.count())
+        ranges.push(0, LEAF_CURRENT, -1);
+
+    while (ranges.count())
+    {
+        int start = ranges.last().m1;
+        int leaf_type = ranges.last().m2;
+        int above_idx = ranges.last().m3;
+        int count = pieces.count() - start;
+        ranges.pop();
+
+        //Pick the splitting plane, scoring a few candidates against a sample of the pieces.
+        int best = start;
+        int best_score = INT_MAX;
+        int candidate_step = lol::max(1, count / CSG_BSP_CANDIDATES);
+        int sample_step = lol::max(1, count / CSG_BSP_SAMPLES);
+        for (int c = start; count > 2 && c < start + count; c += candidate_step)
+        {
+            auto const &tri = tri_list[pieces[c].m1];
+            CsgBspLeaf candidate(tri.m2, tri.m3, tri.m4, -1);
+            int res_nb[3] = { 0, 0, 0 };
+            int split_nb = 0;
+
+            for (int s = start; s < start + count; s += sample_step)
+            {
+                vec3 v[3] = { pieces[s].m2, pieces[s].m3, pieces[s].m4 };
+                int side_nb[3] = { 0, 0, 0 };
+                for (int i = 0; i < 3; i++)
+                {
+                    double dist;
+                    int result = TestPoint(candidate, v[i], dist);
+                    if (result != LEAF_CURRENT)
+                        side_nb[result]++;
+                }
+
+                if (side_nb[LEAF_BACK] && side_nb[LEAF_FRONT])
+                    split_nb++;
+                else if (side_nb[LEAF_BACK] || side_nb[LEAF_FRONT])
+                    res_nb[(side_nb[LEAF_FRONT])?(LEAF_FRONT):(LEAF_BACK)]++;
+            }
+
+            //Splits add pieces to both sides, so they cost more than unbalance.
+            int score = 4 * split_nb + lol::abs(res_nb[LEAF_FRONT] - res_nb[LEAF_BACK]);
+            if (score < best_score)
+            {
+                best_score = score;
+                best = c;
+            }
+        }
+        pieces.swap(start, best);
+
+        auto const &splitter = tri_list[pieces[start].m1];
+        int leaf_idx = AddLeaf(leaf_type, splitter.m2, splitter.m3, splitter.m4, above_idx);
+        CsgBspLeaf &leaf = m_tree[leaf_idx];
+        leaf.m_tri_list << splitter;
+
+        side_pieces[LEAF_FRONT].empty();
+        side_pieces[LEAF_BACK].empty();
+        for (int j = start + 1; j < start + count; j++)
+        {
+            int tri_id = pieces[j].m1;
+            vec3 v[3] = { pieces[j].m2, pieces[j].m3, pieces[j].m4 };
+            double dist[3];
+            int res_nb[3] = { 0, 0, 0 };
+            int res_side[3];
+
+            //Check where each point is located
+            for (int i = 0; i < 3; i++)
+            {
+                res_side[i] = TestPoint(leaf, v[i], dist[i]);
+                if (res_side[i] != LEAF_CURRENT)
+                    res_nb[res_side[i]]++;
+            }
+
+            //Points are located on each sides, clip the piece against the plane.
+            if (res_nb[LEAF_BACK] && res_nb[LEAF_FRONT])
+            {
+                vec3 poly[2][4];
+                int poly_len[2] = { 0, 0 };
+
+                for (int i = 0; i < 3; i++)
+                {
+                    int k = (i + 1) % 3;
+                    if (res_side[i] != LEAF_BACK)
+                        poly[LEAF_FRONT][poly_len[LEAF_FRONT]++] = v[i];
+                    if (res_side[i] != LEAF_FRONT)
+                        poly[LEAF_BACK][poly_len[LEAF_BACK]++] = v[i];
+                    if (res_side[i] != LEAF_CURRENT && res_side[k] != LEAF_CURRENT && res_side[i] != res_side[k])
+                    {
+                        vec3 isec = v[i] + (v[k] - v[i]) * (float)(dist[i] / (dist[i] - dist[k]));
+                        poly[LEAF_FRONT][poly_len[LEAF_FRONT]++] = isec;
+                        poly[LEAF_BACK][poly_len[LEAF_BACK]++] = isec;
+                    }
+                }
+
+                for (int side = 0; side < 2; side++)
+                {
+                    for (int i = 2; i < poly_len[side]; i++)
+                    {
+                        vec3 new_v[3] = { poly[side][0], poly[side][i - 1], poly[side][i] };
+
+                        //Error check : Skip the triangle where two points are on the same location.
+                        bool skip_tri = false;
+                        for (int l = 0; !skip_tri && l < 3; l++)
+                            skip_tri = length(new_v[l] - new_v[(l + 1) % 3]) < TestEpsilon::Get();
+
+                        if (!skip_tri)
+                            side_pieces[side].push(tri_id, new_v[0], new_v[1], new_v[2]);
+                    }
+                }
+            }
+            //All points are on one side, the piece goes to the next leaf
+            else if (res_nb[LEAF_BACK] || res_nb[LEAF_FRONT])
+                side_pieces[(res_nb[LEAF_FRONT])?(LEAF_FRONT):(LEAF_BACK)] << pieces[j];
+            //All points are on the current leaf, add the triangle to the list of this leaf.
+            else
+            {
+                bool already_exist = false;
+                for (int i = 0; !already_exist && i < leaf.m_tri_list.count(); i++)
+                    already_exist = (leaf.m_tri_list[i].m1 == tri_list[tri_id].m1);
+                if (!already_exist)
+                    leaf.m_tri_list << tri_list[tri_id];
+            }
+        }
+
+        //The front range ends up on top, it is handled first.
+        pieces.resize(start);
+        for (int side = LEAF_BACK; side <= LEAF_FRONT; side++)
+        {
+            if (side_pieces[side].count())
+            {
+                ranges.push(pieces.count(), side, leaf_idx);
+                pieces += side_pieces[side];
+            }
+        }
+    }
+}
+
 //return 0 when no split has been done.
 //return 1 when split has been done.
 //return -1 when error.
@@ -221,7 +415,7 @@ int CsgBsp::TestTriangleToTree(vec3 const &tri_p0, vec3 const &tri_p1, vec3 cons
                                array< vec3, int, int, float > &vert_list,
                                //This is the final triangle list : If Side_Status is LEAF_CURRENT, a new test will be done point by point.
                                //<{IN|OUT}side_status, v0, v1, v2>
-                               array< int, int, int, int > &tri_list)
+                               array< int, int, int, int > &tri_list) const
 {
     //This list stores the current triangles to process.
     //<Leaf_Id_List, v0, v1, v2, Should_Point_Test>
@@ -236,6 +430,15 @@ int CsgBsp::TestTriangleToTree(vec3 const &tri_p0, vec3 const &tri_p1, vec3 cons
     vert_list.push(tri_p1, -1, -1, .0f);
     vert_list.push(tri_p2, -1, -1, .0f);
 
+    //The tree is a closed volume, so a triangle away from its bounding box is in front of it.
+    vec3 epsilon(TestEpsilon::Get());
+    box3 tri_box(min(tri_p0, min(tri_p1, tri_p2)) - epsilon, max(tri_p0, max(tri_p1, tri_p2)) + epsilon);
+    if (!TestAABBVsAABB(tri_box, m_bbox))
+    {
+        tri_list.push(LEAF_FRONT, 0, 1, 2);
+        return 0;
+    }
+
     //Let's push the triangle in here.
     tri_to_process.reserve(20);
     tri_to_process.push( array< int >(), 0, 1, 2, 0);
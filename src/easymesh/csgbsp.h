@@ -25,10 +25,28 @@ class CsgBspLeaf
     friend class CsgBsp;
 
 public:
-    CsgBspLeaf(vec3 origin, vec3 normal, int above_idx)
+    CsgBspLeaf(vec3 p0, vec3 p1, vec3 p2, int above_idx)
     {
-        m_origin = origin;
-        m_normal = normal;
+        m_origin = p0;
+        m_p1 = p1;
+        m_p2 = p2;
+
+        //Unnormalised plane normal in double precision, and a bound of
+        //its rounding errors used by CsgBsp::TestPoint(). With e the unit
+        //roundoff, each product in the determinant goes through at most
+        //eight roundings (the differences u, v and w = point - p0, then the
+        //cross and dot products), so |det - exact| <= 8e |u|1 |v|1 |w|1.
+        //The extra slack covers the rounding of the bound itself.
+        dvec3 u = dvec3(p1) - dvec3(p0), v = dvec3(p2) - dvec3(p0);
+        m_plane = cross(u, v);
+        double len = length(m_plane);
+        m_inv_len = (len > .0) ? (1.0 / len) : (.0);
+        double const eps = DBL_EPSILON * 0.5;
+        m_plane_err = (8.0 + 256.0 * eps) * eps
+                    * (lol::abs(u.x) + lol::abs(u.y) + lol::abs(u.z))
+                    * (lol::abs(v.x) + lol::abs(v.y) + lol::abs(v.z));
+        m_normal = vec3(m_plane * m_inv_len);
+
         m_leaves[LEAF_ABOVE] = above_idx;
 
         m_leaves[LEAF_FRONT] = -1;
@@ -38,6 +56,10 @@ public:
 private:
     vec3            m_origin;
     vec3            m_normal;
+    //The other two points of the triangle giving this plane
+    vec3            m_p1, m_p2;
+    dvec3           m_plane;
+    double          m_inv_len, m_plane_err;
     array< int, vec3, vec3, vec3 >    m_tri_list;
     ivec3           m_leaves;
 };
@@ -47,6 +69,10 @@ class CsgBsp
 {
 public:
     void AddTriangleToTree(int const &tri_idx, vec3 const &tri_p0, vec3 const &tri_p1, vec3 const &tri_p2);
+    //Build the whole tree at once from a <tri_idx, v0, v1, v2> list. Each splitting
+    //plane is picked among a few triangles so that the fewest triangles get split
+    //and both sides get the same number of triangles.
+    void BuildTree(array< int, vec3, vec3, vec3 > const &tri_list);
 
     //return 0 when no split has been done.
     //return 1 when split has been done.
@@ -57,13 +83,17 @@ public:
                             array< vec3, int, int, float > &vert_list,
                             //This is the final triangle list : If Side_Status is LEAF_CURRENT, a new test will be done point by point.
                             //<{IN|OUT}side_status, v0, v1, v2>
-                            array< int, int, int, int > &tri_list);
+                            array< int, int, int, int > &tri_list) const;
 
 private:
-    int AddLeaf(int leaf_type, vec3 origin, vec3 normal, int above_idx);
-    int TestPoint(int leaf_idx, vec3 point);
+    int AddLeaf(int leaf_type, vec3 p0, vec3 p1, vec3 p2, int above_idx);
+    void ExtendBBox(vec3 const &p0, vec3 const &p1, vec3 const &p2);
+    int TestPoint(int leaf_idx, vec3 point) const;
+    static int TestPoint(CsgBspLeaf const &leaf, vec3 const &point, double &dist);
 
     array<CsgBspLeaf> m_tree;
+    //Bounding box of all the triangles in the tree
+    box3 m_bbox;
 };
 
 } /* namespace lol */
@@ -13,6 +13,8 @@
 
 #pragma once
 
+#include <memory> /* std::shared_ptr */
+
 #include "commandstack.h"
 #include "easymeshrender.h"
 #include "easymeshbuild.h"
@@ -69,10 +71,13 @@ protected:
 };
 typedef SafeEnum<MeshTransformBase> MeshTransform;
 
+struct EasyMeshCmdResult;
+
 class EasyMesh : public Mesh
 {
     friend class EasyMeshParser;
     friend class GpuEasyMeshData;
+    friend class MeshSimplifier;
 
 public:
     EasyMesh();
@@ -90,10 +95,33 @@ public:
     //-------------------------------------------------------------------------
     bool Compile(char const *command, bool Execute = true);
     void ExecuteCmdStack(bool ExecAllStack = true);
+    /* Run the commands recorded since the last execution, through the
+     * command cache as well, but without the vertex cleanup and the vertex
+     * cache optimisation that end ExecuteCmdStack(). */
+    void ExecuteRecordedCmds();
+    /* The mesh produced by each executed command is memoised, keyed by the
+     * command, its arguments and the state it was applied to, so running an
+     * edited stack again resumes at the first command that changed. The
+     * cache is shared by all meshes and uses at most max_bytes. It is off
+     * by default, and setting max_bytes to 0 turns it off again. When path
+     * is not empty, the CSG, SmoothMesh, SplitTriangles and Simplify
+     * results are also saved to that directory and reused by later runs. */
+    static void SetCmdCache(size_t max_bytes, String const &path = String());
+    static void ClearCmdCache();
 
 private:
     void UpdateVertexDict(array< int, int > &vertex_dict);
 
+    void ExecuteCmd(int cmd);
+    void ExecuteCmds();
+    //Command result cache, see easymeshcache.cpp
+    static bool IsCmdCacheEnabled();
+    static bool IsCmdCacheable(int cmd);
+    uint64_t HashCmdState();
+    std::shared_ptr<EasyMeshCmdResult const> FindCmdResult(uint64_t key, int cmd);
+    void StoreCmdResult(uint64_t key, int cmd);
+    void RestoreCachedCmds(EasyMeshCmdResult const &result, array<int> const &skipped);
+
     //-------------------------------------------------------------------------
     //Mesh CSG operations
     //-------------------------------------------------------------------------
@@ -132,6 +160,17 @@ public:
     void TogglePostBuildNormal();
     /* [cmd:tpbn] When active, prevents vertices cleanup */
     void ToggleVerticeNoCleanup();
+    /* [cmd:si32] Use 32-bit indices on the GPU even if the mesh has less than 65536 vertices */
+    void SetIndex32(bool enable);
+    /* [cmd:sgo] Reorder the mesh for the GPU vertex cache after the build.
+        - overdraw : if (true) triangle clusters are also sorted against overdraw.
+     */
+    void SetGpuOptimize(bool enable, bool overdraw=false);
+    /* [cmd:snw] Choose how face normals are combined into vertex normals.
+        - mode : 0 averages the distinct face normals, 1 weighs them by
+          their angle at the vertex, 2 by their area.
+     */
+    void SetNormalWeighting(int mode);
     /* [cmd:sc] Set both color */
     void SetCurColor(vec4 const &color);
     /* [cmd:sca] Set base color A */
@@ -153,8 +192,19 @@ private:
     VertexData GetLerpVertex(VertexData const &vi, VertexData const &vj, float alpha);
     void AddQuad(int i1, int i2, int i3, int i4, int base, bool duplicate = false);
     void AddTriangle(int i1, int i2, int i3, int base, bool duplicate = false);
-    void ComputeNormals(int start, int vcount);
+    /* Add count vertices as AddVertex() would, or count uninitialised
+     * indices, and return a pointer to the first one for direct writes */
+    VertexData *AddVertices(int count);
+    uint32_t *AddIndices(int count);
+    /* Replace the triangles of the current brace, and drop the brace
+     * vertices they no longer use */
+    void ReplaceBraceTriangles(array<uint32_t> const &indices);
+    /* Reorder clusters of the cache-ordered triangles against overdraw */
+    void SortOverdrawClusters(array<int> &order, array<bool> const &restart);
 public:
+    /* Compute the normals of the vertices used by the vcount indices from
+     * start, as chosen by SetNormalWeighting() */
+    void ComputeNormals(int start, int vcount);
     /* Remove all unused */
     void VerticesCleanup();
     /* Merge vertices AKA: smooth */
@@ -299,6 +349,23 @@ public:
         - smooth_per_pass : n1 value in above explanation.
      */
     void SmoothMesh(int pass, int split_per_pass, int smooth_per_pass);
+    /* [cmd:smpl] Reduce the triangle count with quadric error edge collapses.
+        Vertices only move onto their neighbours, so colours and UVs are
+        kept, as are borders and seams. Normals are computed again.
+        - ratio : Fraction of the triangles to keep.
+     */
+    void Simplify(float ratio);
+    /* [no-cmd] Build a LOD chain in a single simplification pass, lods[i]
+        being a copy of the mesh whose current brace keeps ratio^(i+1) of
+        its triangles.
+     */
+    void BuildLods(array<EasyMesh> &lods, int count, float ratio);
+    /* [no-cmd] Reorder the triangles of the current brace for the GPU
+        post-transform cache with Forsyth's linear-speed algorithm, then
+        the brace vertices by first use.
+        - overdraw : if (true) triangle clusters facing outwards come first.
+     */
+    void OptimizeVertexCache(bool overdraw=false);
 
     //-------------------------------------------------------------------------
     //Mesh shape primitive operations
@@ -407,9 +474,18 @@ public:
 public:
     int GetVertexCount() { return m_vert.count(); }
     vec3 const &GetVertexLocation(int i) { return m_vert[i].m_coord; }
+    /* Size of the GPU indices: 16 bits when all the vertices can be
+     * addressed that way, unless SetIndex32() was used, 32 bits otherwise */
+    int GetIndexSize();
+    /* Write the GPU-ready indices to dst, which must hold
+     * m_indices.count() * GetIndexSize() bytes */
+    void CopyIndices(void *dst);
+    /* Vertex cache misses per triangle (ACMR, x) and per used vertex
+     * (ATVR, y) when drawing the mesh through a FIFO cache */
+    vec2 GetVertexCacheStats(int cache_size=32);
 
 //private:
-    array<uint16_t>     m_indices;
+    array<uint32_t>     m_indices;
     array<VertexData>   m_vert;
 
     //<vert count, indices count>
@@ -15,41 +15,76 @@
 namespace lol
 {
 
+//-----------------------------------------------------------------------------
+//Spatial hash helpers: cells are twice as wide as the matching distance, so
+//matching vertices are in the same cell or in one of the 7 cells sharing the
+//corner of that cell which is nearest to the vertex.
+static inline ivec3 VDictCell(vec3 const &coord, float cell_size, ivec3 *side = nullptr)
+{
+    vec3 c = clamp(coord / cell_size, -1e9f, 1e9f);
+    ivec3 ret((int)floor(c.x), (int)floor(c.y), (int)floor(c.z));
+    if (side)
+        for (int i = 0; i < 3; i++)
+            (*side)[i] = (c[i] - (float)ret[i] < .5f) ? -1 : 1;
+    return ret;
+}
+
+static inline int VDictBucket(ivec3 const &cell, int bucket_count)
+{
+    uint32_t h = (uint32_t)cell.x * 73856093u
+               ^ (uint32_t)cell.y * 19349663u
+               ^ (uint32_t)cell.z * 83492791u;
+    return (int)(h & (uint32_t)(bucket_count - 1));
+}
+
 //-----------------------------------------------------------------------------
 //helpers func to retrieve a vertex.
 int VertexDictionnary::FindVertexMaster(const int search_idx)
 {
     //Resolve current vertex idx in the dictionnary (if exist)
-    for (int j = 0; j < vertex_list.count(); j++)
-        if (vertex_list[j].m1 == search_idx)
-            return vertex_list[j].m3;
-    return VDictType::DoesNotExist;
+    int entry = FindEntry(search_idx);
+    if (entry < 0)
+        return VDictType::DoesNotExist;
+    return vertex_list[entry].m3;
 }
 
 //-----------------------------------------------------------------------------
 //retrieve a list of matching vertices, doesn't include search_idx.
 bool VertexDictionnary::FindMatchingVertices(const int search_idx, array<int> &matching_ids)
 {
-    int cur_mast = FindVertexMaster(search_idx);
+    int entry = FindEntry(search_idx);
+    if (entry < 0)
+        return false;
 
-    if (cur_mast == VDictType::DoesNotExist || cur_mast == VDictType::Alone)
+    int cur_mast = vertex_list[entry].m3;
+    if (cur_mast == VDictType::Alone)
         return false;
 
     if (cur_mast == VDictType::Master)
-        cur_mast = search_idx;
+        cur_mast = entry;
     else
         matching_ids << vertex_list[cur_mast].m1;
 
-    for (int j = 0; j < vertex_list.count(); j++)
-        if (vertex_list[j].m3 == cur_mast && vertex_list[j].m1 != search_idx)
+    for (int j = matching_list[cur_mast].m1; j >= 0; j = matching_list[j].m1)
+        if (vertex_list[j].m1 != search_idx)
             matching_ids << vertex_list[j].m1;
 
     return (matching_ids.count() > 0);
 }
 
+//-----------------------------------------------------------------------------
+//Vertex id of the master of the given vertex, or the vertex itself.
+int VertexDictionnary::FindGroup(int vert_id) const
+{
+    int entry = FindEntry(vert_id);
+    if (entry < 0 || vertex_list[entry].m3 < 0)
+        return vert_id;
+    return vertex_list[vertex_list[entry].m3].m1;
+}
+
 //-----------------------------------------------------------------------------
 //Will return connected vertices (through triangles), if returned vertex has matching ones, it only returns the master.
-bool VertexDictionnary::FindConnectedVertices(const int search_idx, const array<uint16_t> &tri_list, const int tri0, array<int> &connected_vert, array<int> const *ignored_tri)
+bool VertexDictionnary::FindConnectedVertices(const int search_idx, const array<uint32_t> &tri_list, const int tri0, array<int> &connected_vert, array<int> const *ignored_tri)
 {
     array<int> connected_tri;
     FindConnectedTriangles(search_idx, tri_list, tri0, connected_tri, ignored_tri);
@@ -79,37 +114,41 @@ bool VertexDictionnary::FindConnectedVertices(const int search_idx, const array<
     return (connected_vert.count() > 0);
 }
 //-----------------------------------------------------------------------------
-bool VertexDictionnary::FindConnectedTriangles(const int search_idx, const array<uint16_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri)
+bool VertexDictionnary::FindConnectedTriangles(const int search_idx, const array<uint32_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri)
 {
     return FindConnectedTriangles(ivec3(search_idx, search_idx, search_idx), tri_list, tri0, connected_tri, ignored_tri);
 }
 //-----------------------------------------------------------------------------
-bool VertexDictionnary::FindConnectedTriangles(const ivec2 &search_idx, const array<uint16_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri)
+bool VertexDictionnary::FindConnectedTriangles(const ivec2 &search_idx, const array<uint32_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri)
 {
     return FindConnectedTriangles(ivec3(search_idx, search_idx.x), tri_list, tri0, connected_tri, ignored_tri);
 }
 //-----------------------------------------------------------------------------
-bool VertexDictionnary::FindConnectedTriangles(const ivec3 &search_idx, const array<uint16_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri)
+bool VertexDictionnary::FindConnectedTriangles(const ivec3 &search_idx, const array<uint32_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri)
 {
+    UpdateAdjacency(tri_list, tri0);
+
+    //Matching vertices share a group, so only the distinct groups need validation.
     int needed_validation = 0;
-    array<int> vert_list[3];
+    int group_list[3];
     for (int i = 0; i < 3; i++)
     {
-        //Small optim since above func will use this one
-        if ((i == 1 && search_idx[0] == search_idx[1]) ||
-            (i == 2 && (search_idx[0] == search_idx[2] || search_idx[1] == search_idx[2])))
-            continue;
-        else
-        {
-            //increment the validation info, hence empty list aren't taken into account.
-            needed_validation++;
-            vert_list[i] << search_idx[i];
-            FindMatchingVertices(search_idx[i], vert_list[i]);
-        }
+        int group = FindGroup(search_idx[i]);
+        bool already_exist = false;
+        for (int j = 0; !already_exist && j < needed_validation; j++)
+            already_exist = (group_list[j] == group);
+        if (!already_exist)
+            group_list[needed_validation++] = group;
     }
 
-    for (int i = tri0; i < tri_list.count(); i += 3)
+    //The triangles of the first group are the only candidates.
+    int group0 = group_list[0];
+    if (group0 < 0 || group0 + 1 >= adjacency_offsets.count())
+        return (connected_tri.count() > 0);
+
+    for (int k = adjacency_offsets[group0]; k < adjacency_offsets[group0 + 1]; k++)
     {
+        int i = adjacency_tris[k];
         if (ignored_tri)
         {
             bool should_pass = false;
@@ -119,16 +158,16 @@ bool VertexDictionnary::FindConnectedTriangles(const ivec3 &search_idx, const ar
             if (should_pass)
                 continue;
         }
-        int found_validation = 0;
-        for (int j = 0; j < 3; j++)
-        {
-            bool validated = false;
-            for (int k = 0; !validated && k < vert_list[j].count(); k++)
-                for (int l = 0; !validated && l < 3; l++)
-                    if (vert_list[j][k] == tri_list[i + l])
-                        validated = true;
-            found_validation += (validated)?(1):(0);
-        }
+
+        int tri_group[3] = { FindGroup(tri_list[i]), FindGroup(tri_list[i + 1]), FindGroup(tri_list[i + 2]) };
+        int found_validation = 1;
+        for (int j = 1; j < needed_validation; j++)
+            for (int l = 0; l < 3; l++)
+                if (tri_group[l] == group_list[j])
+                {
+                    found_validation++;
+                    break;
+                }
         //triangle is validated store it
         if (found_validation == needed_validation)
             connected_tri << i;
@@ -137,71 +176,239 @@ bool VertexDictionnary::FindConnectedTriangles(const ivec3 &search_idx, const ar
     return (connected_tri.count() > 0);
 }
 
+//-----------------------------------------------------------------------------
+//Build the triangle list of each group, in CSR layout: the triangles of the
+//group g are adjacency_tris[adjacency_offsets[g] .. adjacency_offsets[g + 1]].
+void VertexDictionnary::UpdateAdjacency(const array<uint32_t> &tri_list, const int tri0)
+{
+    if (adjacency_valid && adjacency_src == tri_list.data()
+         && adjacency_count == tri_list.count() && adjacency_tri0 == tri0)
+        return;
+
+    int group_count = entry_list.count();
+    for (int i = tri0; i < tri_list.count(); i++)
+        group_count = lol::max(group_count, (int)tri_list[i] + 1);
+
+    adjacency_offsets.resize(group_count + 1);
+    for (int i = 0; i < adjacency_offsets.count(); i++)
+        adjacency_offsets[i] = 0;
+
+    //1: Count the triangles of each group, once even if several vertices match
+    for (int i = tri0; i + 2 < tri_list.count(); i += 3)
+    {
+        int g0 = FindGroup(tri_list[i]);
+        int g1 = FindGroup(tri_list[i + 1]);
+        int g2 = FindGroup(tri_list[i + 2]);
+        adjacency_offsets[g0 + 1]++;
+        if (g1 != g0)
+            adjacency_offsets[g1 + 1]++;
+        if (g2 != g0 && g2 != g1)
+            adjacency_offsets[g2 + 1]++;
+    }
+
+    for (int g = 0; g < group_count; g++)
+        adjacency_offsets[g + 1] += adjacency_offsets[g];
+
+    //2: Fill the lists, triangles stay sorted since they are visited in order
+    array<int> fill_list = adjacency_offsets;
+    adjacency_tris.resize(adjacency_offsets[group_count]);
+    for (int i = tri0; i + 2 < tri_list.count(); i += 3)
+    {
+        int g0 = FindGroup(tri_list[i]);
+        int g1 = FindGroup(tri_list[i + 1]);
+        int g2 = FindGroup(tri_list[i + 2]);
+        adjacency_tris[fill_list[g0]++] = i;
+        if (g1 != g0)
+            adjacency_tris[fill_list[g1]++] = i;
+        if (g2 != g0 && g2 != g1)
+            adjacency_tris[fill_list[g2]++] = i;
+    }
+
+    adjacency_src = tri_list.data();
+    adjacency_count = tri_list.count();
+    adjacency_tri0 = tri0;
+    adjacency_valid = true;
+}
+
+//-----------------------------------------------------------------------------
+//Append entry to the matching vertices of master.
+void VertexDictionnary::LinkMatching(int master, int entry)
+{
+    int last = matching_list[master].m2;
+    if (last < 0)
+        matching_list[master].m1 = entry;
+    else
+        matching_list[last].m1 = entry;
+    matching_list[master].m2 = entry;
+}
+
+//-----------------------------------------------------------------------------
+//Follow TestEpsilon changes, since the cell size depends on it.
+void VertexDictionnary::UpdateCellSize()
+{
+    float epsilon = TestEpsilon::Get();
+    if (epsilon == cell_epsilon)
+        return;
+
+    cell_epsilon = epsilon;
+    cell_size = epsilon > 0.f ? 2.f * lol::sqrt(epsilon) : 0.f;
+    RehashMasters(bucket_list.count());
+}
+
+//-----------------------------------------------------------------------------
+void VertexDictionnary::RehashMasters(int bucket_count)
+{
+    //Bucket count is a power of two, so that hashes can be masked
+    bucket_count = lol::max(bucket_count, 64);
+    bucket_list.resize(bucket_count);
+    for (int i = 0; i < bucket_count; i++)
+        bucket_list[i] = -1;
+
+    if (cell_size <= 0.f)
+        return;
+
+    for (int i = 0; i < master_list.count(); i++)
+    {
+        int entry = master_list[i];
+        ivec3 cell = VDictCell(vertex_list[entry].m2, cell_size);
+        int bucket = VDictBucket(cell, bucket_count);
+        cell_list[entry].m1 = cell;
+        cell_list[entry].m2 = bucket_list[bucket];
+        bucket_list[bucket] = entry;
+    }
+}
+
 //-----------------------------------------------------------------------------
 //Will update the given list with all the vertices on the same spot.
 void VertexDictionnary::RegisterVertex(const int vert_id, const vec3 vert_coord)
 {
-    for (int j = 0; j < vertex_list.count(); j++)
-        if (vertex_list[j].m1 == vert_id)
-            return;
+    if (vert_id < 0 || FindEntry(vert_id) >= 0)
+        return;
 
-    //First, build the vertex Dictionnary
-    int i = 0;
-    for (; i < master_list.count(); i++)
-    {
-        int cur_mast  = master_list[i];
-        int cur_id    = vertex_list[cur_mast].m1;
-        vec3 cur_loc  = vertex_list[cur_mast].m2;
-        int &cur_type = vertex_list[cur_mast].m3;
+    UpdateCellSize();
+    adjacency_valid = false;
 
-        if (cur_id == vert_id)
-            return;
+    int entry = vertex_list.count();
+    //Push rather than resize(), ids usually come in order and it grows geometrically
+    while (entry_list.count() <= vert_id)
+        entry_list << -1;
+    entry_list[vert_id] = entry;
+    matching_list.push(-1, -1);
 
-        if (sqlength(cur_loc - vert_coord) < TestEpsilon::Get())
+    //First, look for the oldest master in the neighbouring cells
+    ivec3 cell(0);
+    int found = -1;
+    if (cell_size > 0.f)
+    {
+        ivec3 side;
+        cell = VDictCell(vert_coord, cell_size, &side);
+        for (int i = 0; i < 8; i++)
         {
-            if (cur_type == VDictType::Alone)
-                cur_type = VDictType::Master;
-            vertex_list.push(vert_id, vert_coord, cur_mast);
-            return;
+            ivec3 cur_cell = cell + ivec3(i & 1, (i >> 1) & 1, i >> 2) * side;
+            int bucket = VDictBucket(cur_cell, bucket_list.count());
+            for (int cur_mast = bucket_list[bucket]; cur_mast >= 0; cur_mast = cell_list[cur_mast].m2)
+            {
+                if (cell_list[cur_mast].m1 != cur_cell || (found >= 0 && cur_mast > found))
+                    continue;
+                if (sqlength(vertex_list[cur_mast].m2 - vert_coord) < cell_epsilon)
+                    found = cur_mast;
+            }
         }
     }
 
+    if (found >= 0)
+    {
+        int &cur_type = vertex_list[found].m3;
+        if (cur_type == VDictType::Alone)
+            cur_type = VDictType::Master;
+        vertex_list.push(vert_id, vert_coord, found);
+        cell_list.push(cell, -1);
+        LinkMatching(found, entry);
+        return;
+    }
+
     //We're here because we couldn't find any matching vertex
-    master_list.push(vertex_list.count());
+    master_list.push(entry);
     vertex_list.push(vert_id, vert_coord, VDictType::Alone);
+    cell_list.push(cell, -1);
+
+    if (master_list.count() > bucket_list.count())
+        RehashMasters(bucket_list.count() * 2);
+    else if (cell_size > 0.f)
+    {
+        int bucket = VDictBucket(cell, bucket_list.count());
+        cell_list[entry].m2 = bucket_list[bucket];
+        bucket_list[bucket] = entry;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//Rebuild the lookup structures after vertex_list entries have moved.
+void VertexDictionnary::RebuildLinks()
+{
+    for (int i = 0; i < entry_list.count(); i++)
+        entry_list[i] = -1;
+    master_list.empty();
+    matching_list.empty();
+    cell_list.empty();
+
+    for (int i = 0; i < vertex_list.count(); i++)
+    {
+        entry_list[vertex_list[i].m1] = i;
+        matching_list.push(-1, -1);
+        cell_list.push(ivec3(0), -1);
+        if (vertex_list[i].m3 < 0)
+            master_list.push(i);
+        else
+            LinkMatching(vertex_list[i].m3, i);
+    }
+
+    for (int i = 0; i < master_list.count(); i++)
+    {
+        int entry = master_list[i];
+        vertex_list[entry].m3 = (matching_list[entry].m1 >= 0) ? (VDictType::Master) : (VDictType::Alone);
+    }
+
+    RehashMasters(bucket_list.count());
+    adjacency_valid = false;
 }
 
 //-----------------------------------------------------------------------------
 //Will update the given list with all the vertices on the same spot.
 void VertexDictionnary::RemoveVertex(const int vert_id)
 {
-    int j = 0;
-    for (; j < vertex_list.count(); j++)
-        if (vertex_list[j].m1 == vert_id)
-            break;
+    int j = FindEntry(vert_id);
+    if (j < 0)
+        return;
 
-    if (vertex_list[j].m3 == VDictType::Master)
+    //The first matching vertex becomes the new master
+    int jf = (vertex_list[j].m3 == VDictType::Master) ? (matching_list[j].m1) : (-1);
+    for (int i = 0; i < vertex_list.count(); i++)
     {
-        int jf = -1;
-        //change all the master ref in the list
-        for (int i = 0; i < vertex_list.count(); i++)
-        {
-            if (vertex_list[i].m3 == j)
-            {
-                if (jf < 0)
-                {
-                    jf = i;
-                    vertex_list[i].m3 = VDictType::Master;
-                }
-                else
-                    vertex_list[i].m3 = jf;
-            }
-        }
+        int &cur_mast = vertex_list[i].m3;
+        if (i == jf)
+            cur_mast = VDictType::Master;
+        else if (cur_mast == j)
+            cur_mast = jf;
+        if (cur_mast > j)
+            cur_mast--;
     }
     vertex_list.remove(j);
-    for (int i = 0; i < master_list.count(); i++)
-        if (master_list[j] == j)
-            break;
+
+    RebuildLinks();
+}
+
+//-----------------------------------------------------------------------------
+void VertexDictionnary::Clear()
+{
+    vertex_list.empty();
+    master_list.empty();
+    entry_list.empty();
+    matching_list.empty();
+    bucket_list.empty();
+    cell_list.empty();
+    cell_epsilon = -1.f;
+    adjacency_valid = false;
 }
 
 } /* namespace lol */
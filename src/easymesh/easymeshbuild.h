@@ -28,6 +28,19 @@ struct MeshBuildOperationBase : public StructSafeEnum
         IgnoreQuadWeighting = (1 << 4),
         PostBuildComputeNormals = (1 << 5),
         PreventVertCleanup = (1 << 6),
+        //When this flag is up, 32-bit indices are used even for small meshes.
+        Index32 = (1 << 7),
+        //When this flag is up, indices and vertices are reordered for the
+        //GPU vertex cache after the build.
+        OptimizeVertexCache = (1 << 8),
+        //When this flag is also up, triangle clusters are sorted to reduce
+        //overdraw.
+        OptimizeOverdraw = (1 << 9),
+        //When one of these flags is up, vertex normals weigh face normals
+        //by their angle at the vertex, or by their area, instead of
+        //averaging the distinct face normals.
+        AngleWeightedNormals = (1 << 10),
+        AreaWeightedNormals = (1 << 11),
 
         All = 0xffff,
     };
@@ -41,6 +54,11 @@ protected:
         enum_map[IgnoreQuadWeighting] = "IgnoreQuadWeighting";
         enum_map[PostBuildComputeNormals] = "PostBuildComputeNormals";
         enum_map[PreventVertCleanup] = "PreventVertCleanup";
+        enum_map[Index32] = "Index32";
+        enum_map[OptimizeVertexCache] = "OptimizeVertexCache";
+        enum_map[OptimizeOverdraw] = "OptimizeOverdraw";
+        enum_map[AngleWeightedNormals] = "AngleWeightedNormals";
+        enum_map[AreaWeightedNormals] = "AreaWeightedNormals";
         enum_map[All] = "All";
         return true;
     }
@@ -63,12 +81,16 @@ struct EasyMeshCmdTypeBase : public StructSafeEnum
         QuadWeighting,
         PostBuildNormal,
         PreventVertCleanup,
+        Index32,
+        GpuOptimize,
+        NormalWeighting,
         SetColorA,
         SetColorB,
         SetVertColor,
 
         VerticesMerge,
         VerticesSeparate,
+        VerticesCleanup,
 
         Translate,
         Rotate,
@@ -80,6 +102,7 @@ struct EasyMeshCmdTypeBase : public StructSafeEnum
 
         SplitTriangles,
         SmoothMesh,
+        Simplify,
 
         AppendCylinder,
         AppendCapsule,
@@ -104,11 +127,15 @@ protected:
         enum_map[QuadWeighting] = "QuadWeighting";
         enum_map[PostBuildNormal] = "PostBuildNormal";
         enum_map[PreventVertCleanup] = "PreventVertCleanup";
+        enum_map[Index32] = "Index32";
+        enum_map[GpuOptimize] = "GpuOptimize";
+        enum_map[NormalWeighting] = "NormalWeighting";
         enum_map[SetColorA] = "SetColorA";
         enum_map[SetColorB] = "SetColorB";
         enum_map[SetVertColor] = "SetVertColor";
         enum_map[VerticesMerge] = "VerticesMerge";
         enum_map[VerticesSeparate] = "VerticesSeparate";
+        enum_map[VerticesCleanup] = "VerticesCleanup";
         enum_map[Translate] = "Translate";
         enum_map[Rotate] = "Rotate";
         enum_map[RadialJitter] = "RadialJitter";
@@ -118,6 +145,7 @@ protected:
         enum_map[Chamfer] = "Chamfer";
         enum_map[SplitTriangles] = "SplitTriangles";
         enum_map[SmoothMesh] = "SmoothMesh";
+        enum_map[Simplify] = "Simplify";
         enum_map[AppendCylinder] = "AppendCylinder";
         enum_map[AppendCapsule] = "AppendCapsule";
         enum_map[AppendTorus] = "AppendTorus";
@@ -280,6 +308,7 @@ public:
         m_build_flags = 0;
         m_i_cmd = 0;
         m_exec_nb = -1;
+        m_cmd_hash = 0;
         for (int i = 0; i < MeshType::MAX; ++i)
         {
             m_texcoord_build_type[i] = TexCoordBuildType::TriangleDefault;
@@ -290,6 +319,7 @@ public:
     inline CommandStack &CmdStack() { return m_stack; }
     inline int &Cmdi()              { return m_i_cmd; }
     inline int &CmdExecNb()         { return m_exec_nb; }
+    inline uint64_t &CmdHash()      { return m_cmd_hash; }
     inline array<int, int> &LoopStack(){ return m_loop_stack; }
     inline vec4 &ColorA()           { return m_color_a; }
     inline vec4 &ColorB()           { return m_color_b; }
@@ -482,6 +512,9 @@ public:
     CommandStack        m_stack;
     int                 m_i_cmd;
     int                 m_exec_nb;
+    //Hash of the initial state and of every command executed since,
+    //0 when it was not computed because the command cache is disabled
+    uint64_t            m_cmd_hash;
     array<int, int>     m_loop_stack;
     vec4                m_color_a;
     vec4                m_color_b;
@@ -518,24 +551,53 @@ typedef SafeEnum<VDictTypeBase> VDictType;
 
 /* TODO : replace VDict by a proper Half-edge system */
 //a class whose goal is to keep a list of the adjacent vertices for mesh operations purposes
+//Masters are stored in a spatial hash whose cells are 2 * sqrt(TestEpsilon) wide, so registering
+//a vertex only looks at the 8 cells around it. Connected-triangle queries use a vertex->triangle
+//adjacency which is rebuilt when vertices are registered or when tri_list/tri0 change size; it
+//does not notice in-place edits of tri_list, call InvalidateAdjacency() after those.
 class VertexDictionnary
 {
 public:
     int FindVertexMaster(const int search_idx);
     bool FindMatchingVertices(const int search_idx, array<int> &matching_ids);
-    bool FindConnectedVertices(const int search_idx, const array<uint16_t> &tri_list, const int tri0, array<int> &connected_vert, array<int> const *ignored_tri = nullptr);
-    bool FindConnectedTriangles(const int search_idx, const array<uint16_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri = nullptr);
-    bool FindConnectedTriangles(const ivec2 &search_idx, const array<uint16_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri = nullptr);
-    bool FindConnectedTriangles(const ivec3 &search_idx, const array<uint16_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri = nullptr);
+    bool FindConnectedVertices(const int search_idx, const array<uint32_t> &tri_list, const int tri0, array<int> &connected_vert, array<int> const *ignored_tri = nullptr);
+    bool FindConnectedTriangles(const int search_idx, const array<uint32_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri = nullptr);
+    bool FindConnectedTriangles(const ivec2 &search_idx, const array<uint32_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri = nullptr);
+    bool FindConnectedTriangles(const ivec3 &search_idx, const array<uint32_t> &tri_list, const int tri0, array<int> &connected_tri, array<int> const *ignored_tri = nullptr);
     void RegisterVertex(int vert_id, vec3 vert_coord);
     void RemoveVertex(int vert_id);
     bool GetMasterList(array<int> &ret_master_list) { ret_master_list = master_list; return ret_master_list.count() > 0; }
-    void Clear() { vertex_list.empty(); }
+    void InvalidateAdjacency() { adjacency_valid = false; }
+    void Clear();
 private:
+    int FindEntry(int vert_id) const { return (vert_id >= 0 && vert_id < entry_list.count()) ? entry_list[vert_id] : -1; }
+    int FindGroup(int vert_id) const;
+    void LinkMatching(int master, int entry);
+    void UpdateCellSize();
+    void RehashMasters(int bucket_count);
+    void RebuildLinks();
+    void UpdateAdjacency(const array<uint32_t> &tri_list, const int tri0);
+
     //<VertexId, VertexLocation, VertexMasterId>
     array<int, vec3, int>   vertex_list;
     //List of the master_ vertices
     array<int>              master_list;
+    //vertex_list entry of each vertex id, -1 if not registered
+    array<int>              entry_list;
+    //<NextEntry, LastEntry> of the vertices sharing a master, in registration order
+    array<int, int>         matching_list;
+    //Spatial hash of the masters: bucket heads and <Cell, NextEntry> chains
+    array<int>              bucket_list;
+    array<ivec3, int>       cell_list;
+    float                   cell_epsilon = -1.f;
+    float                   cell_size = 0.f;
+    //Vertex->triangle adjacency in CSR layout, indexed by master vertex id
+    array<int>              adjacency_offsets;
+    array<int>              adjacency_tris;
+    uint32_t const         *adjacency_src = nullptr;
+    int                     adjacency_count = 0;
+    int                     adjacency_tri0 = 0;
+    bool                    adjacency_valid = false;
 };
 
 } /* namespace lol */
@@ -0,0 +1,431 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio> /* std::rename, std::remove */
+
+#include <lol/engine-internal.h>
+
+namespace lol
+{
+
+//Bump this whenever a command gives different results, it invalidates the disk cache
+static uint32_t const EASYMESH_CACHE_VERSION = 4;
+static uint32_t const EASYMESH_CACHE_MAGIC = 0x434d5a45; /* "EZMC" */
+
+//These flags only tell what the stack is doing, not how the mesh gets built
+static uint32_t const EASYMESH_CACHE_IGNORED_FLAGS
+    = MeshBuildOperation::CommandRecording | MeshBuildOperation::CommandExecution;
+
+//The mesh state right after a command
+struct EasyMeshCmdResult
+{
+    array<VertexData>   m_vert;
+    array<uint32_t>     m_indices;
+    array<int, int>     m_cursors;
+    vec4                m_color_a;
+    vec4                m_color_b;
+    uint32_t            m_build_flags;
+
+    size_t GetSize() const
+    {
+        return sizeof(*this) + m_vert.bytes() + m_indices.bytes()
+                 + m_cursors.bytes();
+    }
+};
+
+//Shared by all meshes: the keys already cover everything a result depends on.
+//It stays disabled until EasyMesh::SetCmdCache() gives it a budget.
+class EasyMeshCmdCache
+{
+public:
+    EasyMeshCmdCache()
+      : m_max_bytes(0),
+        m_bytes(0),
+        m_newest(0),
+        m_oldest(0)
+    {
+    }
+
+    std::shared_ptr<EasyMeshCmdResult const> Find(uint64_t key)
+    {
+        std::shared_ptr<EasyMeshCmdResult const> ret;
+
+        m_mutex.lock();
+        if (key && m_entries.has_key(key))
+        {
+            Unlink(key);
+            LinkNewest(key);
+            ret = m_entries[key].m_result;
+        }
+        m_mutex.unlock();
+
+        return ret;
+    }
+
+    void Insert(uint64_t key, std::shared_ptr<EasyMeshCmdResult const> const &result)
+    {
+        size_t size = result->GetSize();
+
+        m_mutex.lock();
+        //Do not flush the whole cache for a single huge mesh
+        if (key && size <= m_max_bytes / 4 && !m_entries.has_key(key))
+        {
+            m_entries[key].m_result = result;
+            LinkNewest(key);
+            m_bytes += size;
+            Trim();
+        }
+        m_mutex.unlock();
+    }
+
+    void SetLimits(size_t max_bytes, String const &path)
+    {
+        m_mutex.lock();
+        m_max_bytes = max_bytes;
+        m_path = path;
+        Trim();
+        m_mutex.unlock();
+    }
+
+    void Clear()
+    {
+        m_mutex.lock();
+        m_entries.empty();
+        m_bytes = 0;
+        m_newest = m_oldest = 0;
+        m_mutex.unlock();
+    }
+
+    bool IsEnabled()
+    {
+        return m_max_bytes > 0;
+    }
+
+    String GetFileName(uint64_t key)
+    {
+        m_mutex.lock();
+        String ret = m_path.count() ? String::format("%s/%016llx.ezmc", m_path.C(),
+                                                     (unsigned long long)key)
+                                    : String();
+        m_mutex.unlock();
+        return ret;
+    }
+
+private:
+    //Drop the least recently used results until we fit in the budget
+    void Trim()
+    {
+        while (m_bytes > m_max_bytes && m_oldest)
+        {
+            uint64_t oldest = m_oldest;
+            m_bytes -= m_entries[oldest].m_result->GetSize();
+            Unlink(oldest);
+            m_entries.remove(oldest);
+        }
+    }
+
+    //The entries form a list from the most to the least recently used one,
+    //linked by their keys. A zero key is never computed, so it ends the list.
+    void Unlink(uint64_t key)
+    {
+        uint64_t newer = m_entries[key].m_newer;
+        uint64_t older = m_entries[key].m_older;
+
+        if (newer)
+            m_entries[newer].m_older = older;
+        else
+            m_newest = older;
+
+        if (older)
+            m_entries[older].m_newer = newer;
+        else
+            m_oldest = newer;
+    }
+
+    void LinkNewest(uint64_t key)
+    {
+        m_entries[key].m_newer = 0;
+        m_entries[key].m_older = m_newest;
+
+        if (m_newest)
+            m_entries[m_newest].m_newer = key;
+        else
+            m_oldest = key;
+        m_newest = key;
+    }
+
+    struct Entry
+    {
+        std::shared_ptr<EasyMeshCmdResult const> m_result;
+        uint64_t m_newer, m_older;
+    };
+
+    map<uint64_t, Entry> m_entries;
+    size_t m_max_bytes, m_bytes;
+    uint64_t m_newest, m_oldest;
+    String m_path;
+    mutex m_mutex;
+};
+
+static EasyMeshCmdCache g_cmd_cache;
+
+//-----------------------------------------------------------------------------
+//Commands that only change the cursor or the build flags are cheaper to run
+//again than to copy the mesh for.
+bool EasyMesh::IsCmdCacheable(int cmd)
+{
+    switch (cmd)
+    {
+    case EasyMeshCmdType::LoopStart:
+    case EasyMeshCmdType::LoopEnd:
+    case EasyMeshCmdType::OpenBrace:
+    case EasyMeshCmdType::CloseBrace:
+    case EasyMeshCmdType::ScaleWinding:
+    case EasyMeshCmdType::QuadWeighting:
+    case EasyMeshCmdType::PostBuildNormal:
+    case EasyMeshCmdType::PreventVertCleanup:
+    case EasyMeshCmdType::Index32:
+    case EasyMeshCmdType::GpuOptimize:
+    case EasyMeshCmdType::NormalWeighting:
+    case EasyMeshCmdType::SetColorA:
+    case EasyMeshCmdType::SetColorB:
+        return false;
+    default:
+        return true;
+    }
+}
+
+//The expensive commands also go to the disk cache
+static bool IsCmdWorthSaving(int cmd)
+{
+    return cmd == EasyMeshCmdType::MeshCsg
+        || cmd == EasyMeshCmdType::SmoothMesh
+        || cmd == EasyMeshCmdType::Simplify
+        || cmd == EasyMeshCmdType::SplitTriangles;
+}
+
+//-----------------------------------------------------------------------------
+//File::Read() and File::Write() report an error for empty blocks
+static bool WriteBlock(File &f, void const *data, int bytes)
+{
+    return !bytes || f.Write((uint8_t const *)data, bytes) == bytes;
+}
+
+static bool ReadBlock(File &f, void *data, int bytes)
+{
+    return !bytes || f.Read((uint8_t *)data, bytes) == bytes;
+}
+
+//--
+static bool SaveCmdResult(String const &file_name, uint64_t key,
+                          EasyMeshCmdResult const &result)
+{
+    uint32_t header[] =
+    {
+        EASYMESH_CACHE_MAGIC, EASYMESH_CACHE_VERSION,
+        (uint32_t)key, (uint32_t)(key >> 32),
+        (uint32_t)result.m_vert.count(), (uint32_t)result.m_indices.count(),
+        (uint32_t)result.m_cursors.count(), result.m_build_flags,
+    };
+
+    //Write to a temporary file first, so that no reader sees a partial result
+    String tmp_name = file_name + ".tmp";
+    File f;
+    f.Open(tmp_name, FileAccess::Write, true);
+    if (!f.IsValid())
+        return false;
+
+    bool ok = WriteBlock(f, header, sizeof(header))
+           && WriteBlock(f, &result.m_color_a, sizeof(vec4))
+           && WriteBlock(f, &result.m_color_b, sizeof(vec4))
+           && WriteBlock(f, result.m_vert.data(), result.m_vert.bytes())
+           && WriteBlock(f, result.m_indices.data(), result.m_indices.bytes())
+           && WriteBlock(f, result.m_cursors.data(), result.m_cursors.bytes());
+    f.Close();
+
+    if (ok)
+        ok = std::rename(tmp_name.C(), file_name.C()) == 0;
+    if (!ok)
+        std::remove(tmp_name.C());
+    return ok;
+}
+
+//--
+static std::shared_ptr<EasyMeshCmdResult const> LoadCmdResult(String const &file_name, uint64_t key)
+{
+    File f;
+    f.Open(file_name, FileAccess::Read, true);
+    if (!f.IsValid())
+        return nullptr;
+
+    uint32_t header[8];
+    if (!ReadBlock(f, header, sizeof(header))
+         || header[0] != EASYMESH_CACHE_MAGIC
+         || header[1] != EASYMESH_CACHE_VERSION
+         || header[2] != (uint32_t)key || header[3] != (uint32_t)(key >> 32))
+    {
+        f.Close();
+        return nullptr;
+    }
+
+    //The counts come from the disk: only trust them if the file has exactly
+    //the size they give, so that a damaged file cannot make us allocate
+    //more than it holds
+    uint64_t const bytes = sizeof(header) + 2 * sizeof(vec4)
+        + (uint64_t)header[4] * sizeof(array<VertexData>::element_t)
+        + (uint64_t)header[5] * sizeof(array<uint32_t>::element_t)
+        + (uint64_t)header[6] * sizeof(array<int, int>::element_t);
+    if (header[4] > (uint32_t)INT_MAX || header[5] > (uint32_t)INT_MAX
+         || header[6] > (uint32_t)INT_MAX || header[6] == 0
+         || f.GetSize() < 0 || (uint64_t)f.GetSize() != bytes)
+    {
+        f.Close();
+        return nullptr;
+    }
+
+    std::shared_ptr<EasyMeshCmdResult> ret = std::make_shared<EasyMeshCmdResult>();
+    ret->m_vert.resize((int)header[4]);
+    ret->m_indices.resize((int)header[5]);
+    ret->m_cursors.resize((int)header[6]);
+    ret->m_build_flags = header[7];
+
+    bool ok = ReadBlock(f, &ret->m_color_a, sizeof(vec4))
+           && ReadBlock(f, &ret->m_color_b, sizeof(vec4))
+           && ReadBlock(f, ret->m_vert.data(), ret->m_vert.bytes())
+           && ReadBlock(f, ret->m_indices.data(), ret->m_indices.bytes())
+           && ReadBlock(f, ret->m_cursors.data(), ret->m_cursors.bytes());
+    f.Close();
+
+    //Every index and cursor must stay within the mesh
+    for (int i = 0; ok && i < ret->m_indices.count(); ++i)
+        ok = ret->m_indices[i] < (uint32_t)ret->m_vert.count();
+    for (int i = 0; ok && i < ret->m_cursors.count(); ++i)
+        ok = ret->m_cursors[i].m1 >= 0 && ret->m_cursors[i].m1 <= ret->m_vert.count()
+          && ret->m_cursors[i].m2 >= 0 && ret->m_cursors[i].m2 <= ret->m_indices.count();
+
+    if (!ok)
+        return nullptr;
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+void EasyMesh::SetCmdCache(size_t max_bytes, String const &path)
+{
+    g_cmd_cache.SetLimits(max_bytes, path);
+}
+
+//-----------------------------------------------------------------------------
+void EasyMesh::ClearCmdCache()
+{
+    g_cmd_cache.Clear();
+}
+
+//-----------------------------------------------------------------------------
+bool EasyMesh::IsCmdCacheEnabled()
+{
+    return g_cmd_cache.IsEnabled();
+}
+
+//-----------------------------------------------------------------------------
+//Everything the commands read besides their own arguments
+uint64_t EasyMesh::HashCmdState()
+{
+    EasyMeshBuildData *bd = BD();
+    uint32_t flags = bd->m_build_flags & ~EASYMESH_CACHE_IGNORED_FLAGS;
+    float epsilon = TestEpsilon::Get();
+
+    uint64_t ret = CommandStack::Hash(EASYMESH_CACHE_VERSION, m_vert.data(), m_vert.bytes());
+    ret = CommandStack::Hash(ret, m_indices.data(), m_indices.bytes());
+    ret = CommandStack::Hash(ret, m_cursors.data(), m_cursors.bytes());
+    ret = CommandStack::Hash(ret, &flags, sizeof(flags));
+    ret = CommandStack::Hash(ret, &epsilon, sizeof(epsilon));
+    ret = CommandStack::Hash(ret, &bd->m_color_a, sizeof(vec4));
+    ret = CommandStack::Hash(ret, &bd->m_color_b, sizeof(vec4));
+    ret = CommandStack::Hash(ret, &bd->m_texcoord_offset, sizeof(vec2));
+    ret = CommandStack::Hash(ret, &bd->m_texcoord_offset2, sizeof(vec2));
+    ret = CommandStack::Hash(ret, &bd->m_texcoord_scale, sizeof(vec2));
+    ret = CommandStack::Hash(ret, &bd->m_texcoord_scale2, sizeof(vec2));
+    ret = CommandStack::Hash(ret, bd->m_texcoord_build_type, sizeof(bd->m_texcoord_build_type));
+    ret = CommandStack::Hash(ret, bd->m_texcoord_build_type2, sizeof(bd->m_texcoord_build_type2));
+    for (int i = 0; i < MeshType::MAX; ++i)
+    {
+        ret = CommandStack::Hash(ret, bd->m_texcoord_custom_build[i].data(),
+                                 bd->m_texcoord_custom_build[i].bytes());
+        ret = CommandStack::Hash(ret, bd->m_texcoord_custom_build2[i].data(),
+                                 bd->m_texcoord_custom_build2[i].bytes());
+    }
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<EasyMeshCmdResult const> EasyMesh::FindCmdResult(uint64_t key, int cmd)
+{
+    if (!g_cmd_cache.IsEnabled() || !IsCmdCacheable(cmd))
+        return nullptr;
+
+    std::shared_ptr<EasyMeshCmdResult const> ret = g_cmd_cache.Find(key);
+    if (!ret && IsCmdWorthSaving(cmd))
+    {
+        String file_name = g_cmd_cache.GetFileName(key);
+        if (file_name.count() && (ret = LoadCmdResult(file_name, key)))
+            g_cmd_cache.Insert(key, ret);
+    }
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+void EasyMesh::StoreCmdResult(uint64_t key, int cmd)
+{
+    if (!g_cmd_cache.IsEnabled() || !IsCmdCacheable(cmd))
+        return;
+
+    std::shared_ptr<EasyMeshCmdResult> result = std::make_shared<EasyMeshCmdResult>();
+    result->m_vert = m_vert;
+    result->m_indices = m_indices;
+    result->m_cursors = m_cursors;
+    result->m_color_a = BD()->m_color_a;
+    result->m_color_b = BD()->m_color_b;
+    result->m_build_flags = BD()->m_build_flags & ~EASYMESH_CACHE_IGNORED_FLAGS;
+    g_cmd_cache.Insert(key, result);
+
+    if (IsCmdWorthSaving(cmd))
+    {
+        String file_name = g_cmd_cache.GetFileName(key);
+        if (file_name.count())
+            SaveCmdResult(file_name, key, *result);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//Go back to a cached result, then run the cheap commands skipped after it
+void EasyMesh::RestoreCachedCmds(EasyMeshCmdResult const &result,
+                                 array<int> const &skipped)
+{
+    m_vert = result.m_vert;
+    m_indices = result.m_indices;
+    m_cursors = result.m_cursors;
+    BD()->m_color_a = result.m_color_a;
+    BD()->m_color_b = result.m_color_b;
+    BD()->m_build_flags = (BD()->m_build_flags & EASYMESH_CACHE_IGNORED_FLAGS)
+                        | result.m_build_flags;
+    m_state = MeshRender::NeedConvert;
+
+    for (int i : skipped)
+        ExecuteCmd(BD()->CmdStack().GetCmd(i));
+}
+
+} /* namespace lol */
+
@@ -15,6 +15,41 @@
 namespace lol
 {
 
+//Number of triangles tested against a BSP by each job
+static int const CSG_JOB_TRIANGLES = 256;
+
+//The results of CsgBsp::TestTriangleToTree() for a range of triangles of one mesh
+struct CsgTestJob
+{
+    CsgBsp const *m_bsp;
+    array< int, vec3, vec3, vec3 > const *m_tris;
+    int m_mesh_id, m_start, m_end;
+    //<Result, Vert_Start, Vert_Count, Tri_Start, Tri_Count> for each triangle
+    array< int, int, int, int, int > m_results;
+    array< vec3, int, int, float > m_vert_list;
+    array< int, int, int, int > m_tri_list;
+
+    void Run()
+    {
+        array< vec3, int, int, float > vert_list;
+        array< int, int, int, int > tri_list;
+
+        m_results.reserve(m_end - m_start);
+        for (int i = m_start; i < m_end; i++)
+        {
+            auto const &tri = (*m_tris)[i];
+            int result = m_bsp->TestTriangleToTree(tri.m2, tri.m3, tri.m4, vert_list, tri_list);
+            m_results.push(result, m_vert_list.count(), vert_list.count(), m_tri_list.count(), tri_list.count());
+            for (int k = 0; k < vert_list.count(); k++)
+                m_vert_list << vert_list[k];
+            for (int k = 0; k < tri_list.count(); k++)
+                m_tri_list << tri_list[k];
+            vert_list.empty();
+            tri_list.empty();
+        }
+    }
+};
+
 //-----------------------------------------------------------------------------
 void EasyMesh::CsgUnion() { MeshCsg(CSGUsage::Union); }
 void EasyMesh::CsgSub()   { MeshCsg(CSGUsage::Substract); }
@@ -52,24 +87,55 @@ void EasyMesh::MeshCsg(CSGUsage csg_operation)
 
     //BSP BUILD : We use the brace logic, csg should be used as : "[ exp .... [exp .... csg]]"
     int cursor_start = (m_cursors.count() < 2)?(0):(m_cursors[(m_cursors.count() - 2)].m2);
+    int indices_count = m_indices.count();
+    //<Index_Start, v0, v1, v2> for each triangle of both meshes
+    array< int, vec3, vec3, vec3 > mesh_tris[2];
     for (int mesh_id = 0; mesh_id < 2; mesh_id++)
     {
         int start_point = (mesh_id == 0) ? (cursor_start) : (m_cursors.last().m2);
-        int end_point   = (mesh_id == 0) ? (m_cursors.last().m2) : (m_indices.count());
-        CsgBsp &mesh_bsp      = (mesh_id == 0) ? (mesh_bsp_0) : (mesh_bsp_1);
+        int end_point   = (mesh_id == 0) ? (m_cursors.last().m2) : (indices_count);
+        mesh_tris[mesh_id].reserve((end_point - start_point) / 3);
         for (int i = start_point; i < end_point; i += 3)
-            mesh_bsp.AddTriangleToTree(i, m_vert[m_indices[i]].m_coord,
-                                          m_vert[m_indices[i + 1]].m_coord,
-                                          m_vert[m_indices[i + 2]].m_coord);
+            mesh_tris[mesh_id].push(i, m_vert[m_indices[i]].m_coord,
+                                       m_vert[m_indices[i + 1]].m_coord,
+                                       m_vert[m_indices[i + 2]].m_coord);
     }
 
-    //BSP Usage : let's crunch all triangles on the correct BSP
-    int indices_count = m_indices.count();
+    //Both trees are independent, so they are built in parallel.
+    parallel_for(2, 1, [&](int start, int end)
+    {
+        for (int mesh_id = start; mesh_id < end; mesh_id++)
+            ((mesh_id == 0) ? (mesh_bsp_0) : (mesh_bsp_1)).BuildTree(mesh_tris[mesh_id]);
+    });
+
+    //BSP Usage : the tests only read the trees, so the triangles of both meshes are
+    //split into jobs shared between the threads, and the results are applied to
+    //the mesh afterward.
+    array< CsgTestJob > jobs;
     for (int mesh_id = 0; mesh_id < 2; mesh_id++)
     {
-        int start_point = (mesh_id == 0) ? (cursor_start) : (m_cursors.last().m2);
-        int end_point   = (mesh_id == 0) ? (m_cursors.last().m2) : (indices_count);
-        CsgBsp &mesh_bsp      = (mesh_id == 0) ? (mesh_bsp_1) : (mesh_bsp_0);
+        int tri_count = mesh_tris[mesh_id].count();
+        for (int start = 0; start < tri_count; start += CSG_JOB_TRIANGLES)
+        {
+            jobs.push(CsgTestJob());
+            jobs.last().m_bsp = (mesh_id == 0) ? (&mesh_bsp_1) : (&mesh_bsp_0);
+            jobs.last().m_tris = &mesh_tris[mesh_id];
+            jobs.last().m_mesh_id = mesh_id;
+            jobs.last().m_start = start;
+            jobs.last().m_end = lol::min(start + CSG_JOB_TRIANGLES, tri_count);
+        }
+    }
+
+    parallel_for(jobs.count(), 1, [&](int start, int end)
+    {
+        for (int j = start; j < end; j++)
+            jobs[j].Run();
+    });
+
+    for (int j = 0; j < jobs.count(); j++)
+    {
+        CsgTestJob const &job = jobs[j];
+        int mesh_id = job.m_mesh_id;
         array< vec3, int, int, float > vert_list;
         array< int, int, int, int > tri_list;
         vec3 n0(.0f); vec3 n1(.0f);
@@ -79,11 +145,14 @@ void EasyMesh::MeshCsg(CSGUsage csg_operation)
         vert_list.reserve(3);
         tri_list.reserve(3);
 
-        for (int i = start_point; i < end_point; i += 3)
+        for (int t = 0; t < job.m_results.count(); t++)
         {
-            int Result = mesh_bsp.TestTriangleToTree(m_vert[m_indices[i]].m_coord,
-                                                     m_vert[m_indices[i + 1]].m_coord,
-                                                     m_vert[m_indices[i + 2]].m_coord, vert_list, tri_list);
+            int i = (*job.m_tris)[job.m_start + t].m1;
+            int Result = job.m_results[t].m1;
+            for (int k = 0; k < job.m_results[t].m3; k++)
+                vert_list << job.m_vert_list[job.m_results[t].m2 + k];
+            for (int k = 0; k < job.m_results[t].m5; k++)
+                tri_list << job.m_tri_list[job.m_results[t].m4 + k];
             int tri_base_idx = m_indices.count();
 
             //one split has been done, we need to had the new vertices & the new triangles.
@@ -163,7 +232,7 @@ void EasyMesh::MeshCsg(CSGUsage csg_operation)
                             for (int l = 0; l < 3; l++)
                             {
                                 AddDupVertex(m_indices[tri_idx + l]);
-                                m_indices[tri_idx + l] = (uint16_t)m_vert.count() - 1;
+                                m_indices[tri_idx + l] = (uint32_t)m_vert.count() - 1;
                             }
                         }
                         m_indices[tri_idx + 1] += m_indices[tri_idx + 2];
@@ -183,28 +252,21 @@ void EasyMesh::MeshCsg(CSGUsage csg_operation)
         if (length(m_vert[i].m_normal) < 1.0f)
             i = i;
 
-    int dir = 1;
-    for (int i = 0; i >= 0 && i < triangle_to_kill.count() - 1; i += dir)
+    //Remove the killed triangles, keeping the others in order.
+    array< bool > tri_killed;
+    tri_killed.resize(m_indices.count() / 3, false);
+    for (int i = 0; i < triangle_to_kill.count(); i++)
+        tri_killed[triangle_to_kill[i] / 3] = true;
+    int indices_left = 0;
+    for (int i = 0; i < m_indices.count(); i += 3)
     {
-        if (triangle_to_kill[i] < triangle_to_kill[i + 1] && dir < 0)
-            dir = 1;
-        if (triangle_to_kill[i] == triangle_to_kill[i + 1])
-        {
-            triangle_to_kill.remove(i);
-            dir = -1;
-        }
-        if (triangle_to_kill[i] > triangle_to_kill[i + 1])
-        {
-            triangle_to_kill[i]     += triangle_to_kill[i + 1];
-            triangle_to_kill[i + 1]  = triangle_to_kill[i] - triangle_to_kill[i + 1];
-            triangle_to_kill[i]      = triangle_to_kill[i] - triangle_to_kill[i + 1];
-            dir = -1;
-        }
-        if (i == 0 && dir == -1)
-            dir = 1;
+        if (tri_killed[i / 3])
+            continue;
+        for (int k = 0; k < 3; k++)
+            m_indices[indices_left + k] = m_indices[i + k];
+        indices_left += 3;
     }
-    for (int i = triangle_to_kill.count() - 1; i >= 0; i--)
-        m_indices.remove(triangle_to_kill[i], 3);
+    m_indices.resize(indices_left);
 
     m_cursors.last().m1 = m_vert.count();
     m_cursors.last().m2 = m_indices.count();
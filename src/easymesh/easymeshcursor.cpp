@@ -128,6 +128,22 @@ void EasyMesh::ToggleVerticeNoCleanup()
     BD()->Toggle(MeshBuildOperation::PreventVertCleanup);
 }
 
+//-----------------------------------------------------------------------------
+void EasyMesh::SetIndex32(bool enable)
+{
+    if (BD()->IsEnabled(MeshBuildOperation::CommandRecording))
+    {
+        BD()->CmdStack().AddCmd(EasyMeshCmdType::Index32);
+        BD()->CmdStack() << enable;
+        return;
+    }
+
+    if (enable)
+        BD()->Enable(MeshBuildOperation::Index32);
+    else
+        BD()->Disable(MeshBuildOperation::Index32);
+}
+
 //-----------------------------------------------------------------------------
 void EasyMesh::SetCurColor(vec4 const &color)
 {
@@ -15,6 +15,9 @@
 namespace lol
 {
 
+/* Normals of fewer triangles than this are computed on a single thread */
+static int const NORMAL_THREAD_MIN_TRIANGLES = 8192;
+
 //-----------------------------------------------------------------------------
 void EasyMesh::AddVertex(vec3 const &coord)
 {
@@ -22,6 +25,23 @@ void EasyMesh::AddVertex(vec3 const &coord)
     m_state = MeshRender::NeedConvert;
 }
 
+//-----------------------------------------------------------------------------
+VertexData *EasyMesh::AddVertices(int count)
+{
+    int base = m_vert.count();
+    m_vert.resize(base + count, VertexData(vec3(0.f), vec3(0.f, 1.f, 0.f), BD()->ColorA()));
+    m_state = MeshRender::NeedConvert;
+    return m_vert.data() + base;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t *EasyMesh::AddIndices(int count)
+{
+    int base = m_indices.count();
+    m_indices.resize(base + count);
+    return m_indices.data() + base;
+}
+
 //-----------------------------------------------------------------------------
 void EasyMesh::AddDupVertex(int i)
 {
@@ -105,9 +125,9 @@ void EasyMesh::AddTriangle(int i1, int i2, int i3, int base, bool duplicate)
 {
     if (duplicate)
     {
-        m_indices << (uint16_t)m_vert.count(); AddDupVertex(base + i1);
-        m_indices << (uint16_t)m_vert.count(); AddDupVertex(base + i2);
-        m_indices << (uint16_t)m_vert.count(); AddDupVertex(base + i3);
+        m_indices << (uint32_t)m_vert.count(); AddDupVertex(base + i1);
+        m_indices << (uint32_t)m_vert.count(); AddDupVertex(base + i2);
+        m_indices << (uint32_t)m_vert.count(); AddDupVertex(base + i3);
     }
     else
     {
@@ -117,6 +137,24 @@ void EasyMesh::AddTriangle(int i1, int i2, int i3, int base, bool duplicate)
     }
 }
 
+//-----------------------------------------------------------------------------
+void EasyMesh::SetNormalWeighting(int mode)
+{
+    if (BD()->IsEnabled(MeshBuildOperation::CommandRecording))
+    {
+        BD()->CmdStack().AddCmd(EasyMeshCmdType::NormalWeighting);
+        BD()->CmdStack() << mode;
+        return;
+    }
+
+    BD()->Disable(MeshBuildOperation::AngleWeightedNormals);
+    BD()->Disable(MeshBuildOperation::AreaWeightedNormals);
+    if (mode == 1)
+        BD()->Enable(MeshBuildOperation::AngleWeightedNormals);
+    else if (mode == 2)
+        BD()->Enable(MeshBuildOperation::AreaWeightedNormals);
+}
+
 //-----------------------------------------------------------------------------
 void EasyMesh::ComputeNormals(int start, int vcount)
 {
@@ -125,82 +163,163 @@ void EasyMesh::ComputeNormals(int start, int vcount)
         BD()->IsEnabled(MeshBuildOperation::PostBuildComputeNormals))
         return;
 
-    array< array<vec3> > normals;
-    normals.resize(m_vert.count());
-    for (int i = 0; i < vcount; i += 3)
+    int const tcount = vcount / 3;
+    if (tcount <= 0)
+        return;
+
+    uint32_t const *tris = m_indices.data() + start;
+    bool const angle = BD()->IsEnabled(MeshBuildOperation::AngleWeightedNormals);
+    bool const area = !angle && BD()->IsEnabled(MeshBuildOperation::AreaWeightedNormals);
+
+    //1: Face normals, with the corner angles when they are needed. Area
+    //weighting simply keeps the cross products unnormalised.
+    array<vec3> face_normals, corner_angles;
+    face_normals.resize(tcount);
+    if (angle)
+        corner_angles.resize(tcount);
+
+    parallel_for(tcount, NORMAL_THREAD_MIN_TRIANGLES, [&](int t0, int t1)
     {
-        vec3 v0 = m_vert[m_indices[start + i + 2]].m_coord
-                - m_vert[m_indices[start + i + 0]].m_coord;
-        vec3 v1 = m_vert[m_indices[start + i + 1]].m_coord
-                - m_vert[m_indices[start + i + 0]].m_coord;
-        vec3 n = normalize(cross(v1, v0));
+        for (int t = t0; t < t1; ++t)
+        {
+            vec3 const &p0 = m_vert[tris[3 * t]].m_coord;
+            vec3 const &p1 = m_vert[tris[3 * t + 1]].m_coord;
+            vec3 const &p2 = m_vert[tris[3 * t + 2]].m_coord;
+            vec3 n = cross(p1 - p0, p2 - p0);
+            face_normals[t] = area ? n : normalize(n);
 
-        for (int j = 0; j < 3; j++)
-            normals[m_indices[start + i + j]] << n;
+            if (angle)
+            {
+                float len = length(n);
+                vec3 e0 = p1 - p0, e1 = p2 - p1, e2 = p0 - p2;
+                corner_angles[t] = vec3(atan2(len, -dot(e2, e0)),
+                                        atan2(len, -dot(e0, e1)),
+                                        atan2(len, -dot(e1, e2)));
+            }
+        }
+    });
+
+    //2: Vertex -> corners in CSR layout, over the vertices in use only
+    uint32_t vmin = tris[0], vmax = tris[0];
+    for (int i = 1; i < 3 * tcount; ++i)
+    {
+        vmin = lol::min(vmin, tris[i]);
+        vmax = lol::max(vmax, tris[i]);
     }
 
-    for (int i = 0; i < normals.count(); i++)
+    int const range = (int)(vmax - vmin) + 1;
+    array<int> offsets, corners;
+    offsets.resize(range + 1, 0);
+    for (int i = 0; i < 3 * tcount; ++i)
+        offsets[tris[i] - vmin + 1]++;
+    for (int v = 0; v < range; ++v)
+        offsets[v + 1] += offsets[v];
+    corners.resize(3 * tcount);
+    for (int i = 0; i < 3 * tcount; ++i)
+        corners[offsets[tris[i] - vmin]++] = i;
+    for (int v = range; v > 0; --v)
+        offsets[v] = offsets[v - 1];
+    offsets[0] = 0;
+
+    //3: Each vertex sums its own faces, so threads never share an output
+    parallel_for(range, NORMAL_THREAD_MIN_TRIANGLES, [&](int v0, int v1)
     {
-        if (normals[i].count() > 0)
+        array<vec3> unique;
+        for (int v = v0; v < v1; ++v)
         {
-            //remove doubles
-            for (int j = 0; j < normals[i].count(); ++j)
-                for (int k = j + 1; k < normals[i].count(); ++k)
-                    if (1.f - dot(normals[i][k], normals[i][j]) < .00001f)
-                        normals[i].remove(k--);
-
-            vec3 newv = vec3::zero;
-            for (int j = 0; j < normals[i].count(); ++j)
-                newv += normals[i][j];
-            m_vert[i].m_normal = normalize(newv / (float)normals[i].count());
+            int const begin = offsets[v], end = offsets[v + 1];
+            if (begin == end)
+                continue;
+
+            vec3 sum(0.f);
+            if (angle)
+            {
+                for (int i = begin; i < end; ++i)
+                    sum += face_normals[corners[i] / 3] * corner_angles[corners[i] / 3][corners[i] % 3];
+                m_vert[vmin + v].m_normal = normalize(sum);
+                continue;
+            }
+            if (area)
+            {
+                for (int i = begin; i < end; ++i)
+                    sum += face_normals[corners[i] / 3];
+                m_vert[vmin + v].m_normal = normalize(sum);
+                continue;
+            }
+
+            //Coplanar faces only count once, so that split quads do not
+            //weigh more than single triangles
+            unique.empty();
+            for (int i = begin; i < end; ++i)
+            {
+                vec3 const &n = face_normals[corners[i] / 3];
+                bool found = false;
+                for (int j = 0; !found && j < unique.count(); ++j)
+                    found = 1.f - dot(n, unique[j]) < .00001f;
+                if (!found)
+                    unique << n;
+            }
+            for (int j = 0; j < unique.count(); ++j)
+                sum += unique[j];
+            m_vert[vmin + v].m_normal = normalize(sum / (float)unique.count());
         }
-    }
+    });
 }
 
 //-----------------------------------------------------------------------------
 void EasyMesh::VerticesCleanup()
 {
+    if (BD()->IsEnabled(MeshBuildOperation::CommandRecording))
+    {
+        BD()->CmdStack().AddCmd(EasyMeshCmdType::VerticesCleanup);
+        return;
+    }
+
+    //1: Remove triangles with two vertices on each other, keeping the order
+    //of the others, and mark the vertices still in use
     array<int> vert_ids;
-    vert_ids.resize(m_vert.count(), 0);
+    vert_ids.resize(m_vert.count(), -1);
 
-    //1: Remove triangles with two vertices on each other
-    for (int i = 0; i < m_indices.count(); i += 3)
+    float const min_sqlength = .00001f * .00001f;
+    int icount = 0;
+    for (int i = 0; i + 2 < m_indices.count(); i += 3)
     {
-        bool remove = false;
-        for (int j = 0; !remove && j < 3; ++j)
-            if (length(m_vert[m_indices[i + j]].m_coord - m_vert[m_indices[i + (j + 1) % 3]].m_coord) < .00001f)
-                remove = true;
-        if (remove)
-        {
-            m_indices.remove_swap(i, 3);
-            i -= 3;
-        }
-        else
-        {
-            //1.5: Mark all used vertices
-            for (int j = 0; j < 3; ++j)
-                vert_ids[m_indices[i + j]] = 1;
-        }
+        uint32_t const i0 = m_indices[i], i1 = m_indices[i + 1], i2 = m_indices[i + 2];
+        vec3 const &p0 = m_vert[i0].m_coord;
+        vec3 const &p1 = m_vert[i1].m_coord;
+        vec3 const &p2 = m_vert[i2].m_coord;
+        if (sqlength(p1 - p0) < min_sqlength
+             || sqlength(p2 - p1) < min_sqlength
+             || sqlength(p0 - p2) < min_sqlength)
+            continue;
+
+        m_indices[icount++] = i0;
+        m_indices[icount++] = i1;
+        m_indices[icount++] = i2;
+        vert_ids[i0] = vert_ids[i1] = vert_ids[i2] = 0;
     }
+    if (icount != m_indices.count())
+        m_state = MeshRender::NeedConvert;
+    m_indices.resize(icount);
 
-    //2: Remove all unused vertices
-    array<VertexData> old_vert = m_vert;
-    int shift = 0;
-    m_vert.empty();
+    //2: Move the used vertices down, in place
+    int vcount = 0;
     for (int i = 0; i < vert_ids.count(); ++i)
     {
-        //Unused vertex, update the shift quantity instead of keeping it.
-        if (vert_ids[i] == 0)
-            shift++;
-        else
-            m_vert << old_vert[i];
-        //Always mark it with the shift quantity
-        vert_ids[i] = shift;
+        if (vert_ids[i] < 0)
+            continue;
+        if (vcount != i)
+            m_vert[vcount] = m_vert[i];
+        vert_ids[i] = vcount++;
     }
+    if (vcount == m_vert.count())
+        return;
+    m_vert.resize(vcount);
 
     //3: Update the indices
     for (int i = 0; i < m_indices.count(); ++i)
-        m_indices[i] -= vert_ids[m_indices[i]];
+        m_indices[i] = vert_ids[m_indices[i]];
+    m_state = MeshRender::NeedConvert;
 }
 
 //-----------------------------------------------------------------------------
@@ -238,37 +357,40 @@ void EasyMesh::VerticesSeparate()
         return;
     }
 
-    array< array<int> > new_ids;
-    array<int> vert_ids;
-    vert_ids.resize(m_vert.count(), 0);
-
-    //1: Mark all used vertices
+    //1: Count the uses of every vertex
+    array<int> uses;
+    uses.resize(m_vert.count(), 0);
     for (int i = 0; i < m_indices.count(); ++i)
-        vert_ids[m_indices[i]]++;
+        uses[m_indices[i]]++;
 
-    //2: Update the vertices
+    //2: Each brace vertex gets one duplicate per extra use, all of them
+    //being added in a single pass
     int vbase = m_cursors.last().m1;
     int vcount = m_vert.count();
-    new_ids.resize(vcount);
+    array<int> first_dup;
+    first_dup.resize(vcount, -1);
+    int dup_count = 0;
     for (int i = vbase; i < vcount; i++)
     {
-        while (vert_ids[i] > 1)
+        if (uses[i] > 1)
         {
-            //Add duplicate
-            new_ids[i] << m_vert.count();
-            AddDupVertex(i);
-            vert_ids[i]--;
+            first_dup[i] = vcount + dup_count;
+            dup_count += uses[i] - 1;
         }
     }
 
-    //3: Update the indices
+    m_vert.resize(vcount + dup_count);
+    for (int i = vbase; i < vcount; i++)
+        for (int j = 0; j < uses[i] - 1; ++j)
+            m_vert[first_dup[i] + j] = m_vert[i];
+    m_state = MeshRender::NeedConvert;
+
+    //3: Update the indices, the last use keeps the original vertex
     for (int i = 0; i < m_indices.count(); ++i)
     {
-        if (new_ids[m_indices[i]].count())
-        {
-            int j = new_ids[m_indices[i]].pop();
-            m_indices[i] = j;
-        }
+        int v = m_indices[i];
+        if (first_dup[v] >= 0 && uses[v] > 1)
+            m_indices[i] = first_dup[v] + --uses[v] - 1;
     }
 
     //4: Cleanup
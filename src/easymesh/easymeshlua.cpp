@@ -69,6 +69,11 @@ EasyMeshLuaObject::EasyMeshLuaObject(String const& name) : LuaObject()
 {
     if (!!name.count())
         EasyMeshLuaLoader::RegisterMesh(this, name);
+
+    //Script calls only record commands, GetMesh() runs them: this way they
+    //go through the command cache, and an edited script resumes from the
+    //first command that changed.
+    m_instance.BD()->Enable(MeshBuildOperation::CommandRecording);
 }
 
 //-----------------------------------------------------------------------------
@@ -76,6 +81,17 @@ EasyMeshLuaObject::~EasyMeshLuaObject()
 {
 }
 
+//-----------------------------------------------------------------------------
+EasyMesh& EasyMeshLuaObject::GetMesh()
+{
+    if (m_instance.BD()->IsEnabled(MeshBuildOperation::CommandRecording))
+    {
+        m_instance.BD()->Disable(MeshBuildOperation::CommandRecording);
+        m_instance.ExecuteRecordedCmds();
+    }
+    return m_instance;
+}
+
 //-----------------------------------------------------------------------------
 EasyMeshLuaObject* EasyMeshLuaObject::New(lua_State* l, int arg_nb)
 {
@@ -171,12 +187,16 @@ const LuaObjectLibrary* EasyMeshLuaObject::GetLib()
             { "Duplicate", &EMLO::Duplicate }, { "dup", &EMLO::Duplicate },
             { "Smooth", &EMLO::Smooth }, { "smth", &EMLO::Smooth },
             { "SplitTriangles", &EMLO::SplitTriangles }, { "splt", &EMLO::SplitTriangles },
+            { "Simplify", &EMLO::Simplify }, { "smpl", &EMLO::Simplify },
             { "Chamfer", &EMLO::Chamfer }, { "cf", &EMLO::Chamfer },
             //-----------------------------------------------------------------
             { "ToggleScaleWinding", &EMLO::ToggleScaleWinding }, { "tsw", &EMLO::ToggleScaleWinding },
             { "ToggleQuadWeighting", &EMLO::ToggleQuadWeighting }, { "tqw", &EMLO::ToggleQuadWeighting },
             { "TogglePostBuildNormal", &EMLO::TogglePostBuildNormal }, { "tpbn", &EMLO::TogglePostBuildNormal },
             { "ToggleVerticeNoCleanup", &EMLO::ToggleVerticeNoCleanup }, { "tvnc", &EMLO::ToggleVerticeNoCleanup },
+            { "SetIndex32", &EMLO::SetIndex32 }, { "si32", &EMLO::SetIndex32 },
+            { "SetGpuOptimize", &EMLO::SetGpuOptimize }, { "sgo", &EMLO::SetGpuOptimize },
+            { "SetNormalWeighting", &EMLO::SetNormalWeighting }, { "snw", &EMLO::SetNormalWeighting },
             //-----------------------------------------------------------------
         },
         //Variables
@@ -235,60 +255,120 @@ bool EasyMesh::Compile(char const *command, bool Execute)
     LOL_CALL(LOL_CAT(EZCALL_, LOL_CALL(LOL_COUNT_TO_12, (__VA_ARGS__))), (__VA_ARGS__))
 
 //-----------------------------------------------------------------------------
-void EasyMesh::ExecuteCmdStack(bool ExecAllStack)
+void EasyMesh::ExecuteCmd(int cmd)
 {
 #define DO_EXEC_CMD(MESH_CMD, FUNC_PARAMS)  \
         case EasyMeshCmdType::MESH_CMD:     \
     { EZM_CALL_FUNC FUNC_PARAMS; break; }
 
-    BD()->Enable(MeshBuildOperation::CommandExecution);
-    if (ExecAllStack)
-        BD()->Cmdi() = 0;
+    switch (cmd)
+    {
+        DO_EXEC_CMD(MeshCsg, (MeshCsg, CSGUsage))
+            DO_EXEC_CMD(LoopStart, (LoopStart, int))
+            DO_EXEC_CMD(LoopEnd, (LoopEnd))
+            DO_EXEC_CMD(OpenBrace, (OpenBrace))
+            DO_EXEC_CMD(CloseBrace, (CloseBrace))
+            DO_EXEC_CMD(ScaleWinding, (ToggleScaleWinding))
+            DO_EXEC_CMD(QuadWeighting, (ToggleQuadWeighting))
+            DO_EXEC_CMD(PostBuildNormal, (TogglePostBuildNormal))
+            DO_EXEC_CMD(PreventVertCleanup, (ToggleVerticeNoCleanup))
+            DO_EXEC_CMD(Index32, (SetIndex32, bool))
+            DO_EXEC_CMD(GpuOptimize, (SetGpuOptimize, bool, bool))
+            DO_EXEC_CMD(NormalWeighting, (SetNormalWeighting, int))
+            DO_EXEC_CMD(VerticesMerge, (VerticesMerge))
+            DO_EXEC_CMD(VerticesSeparate, (VerticesSeparate))
+            DO_EXEC_CMD(VerticesCleanup, (VerticesCleanup))
+            DO_EXEC_CMD(SetColorA, (SetCurColorA, vec4))
+            DO_EXEC_CMD(SetColorB, (SetCurColorB, vec4))
+            DO_EXEC_CMD(SetVertColor, (SetVertColor, vec4))
+            DO_EXEC_CMD(Translate, (Translate, vec3))
+            DO_EXEC_CMD(Rotate, (Rotate, float, vec3))
+            DO_EXEC_CMD(RadialJitter, (RadialJitter, float))
+            DO_EXEC_CMD(MeshTranform, (DoMeshTransform, MeshTransform, Axis, Axis, float, float, float, bool))
+            DO_EXEC_CMD(Scale, (Scale, vec3))
+            DO_EXEC_CMD(DupAndScale, (DupAndScale, vec3, bool))
+            DO_EXEC_CMD(Chamfer, (Chamfer, float))
+            DO_EXEC_CMD(SplitTriangles, (SplitTriangles, int))
+            DO_EXEC_CMD(SmoothMesh, (SmoothMesh, int, int, int))
+            DO_EXEC_CMD(Simplify, (Simplify, float))
+            DO_EXEC_CMD(AppendCylinder, (AppendCylinder, int, float, float, float, bool, bool, bool))
+            DO_EXEC_CMD(AppendCapsule, (AppendCapsule, int, float, float))
+            DO_EXEC_CMD(AppendTorus, (AppendTorus, int, float, float))
+            DO_EXEC_CMD(AppendBox, (AppendBox, vec3, float, bool))
+            DO_EXEC_CMD(AppendStar, (AppendStar, int, float, float, bool, bool))
+            DO_EXEC_CMD(AppendExpandedStar, (AppendExpandedStar, int, float, float, float))
+            DO_EXEC_CMD(AppendDisc, (AppendDisc, int, float, bool))
+            DO_EXEC_CMD(AppendSimpleTriangle, (AppendSimpleTriangle, float, bool))
+            DO_EXEC_CMD(AppendSimpleQuad, (AppendSimpleQuad, vec2, vec2, float, bool))
+            DO_EXEC_CMD(AppendCog, (AppendCog, int, float, float, float, float, float, float, float, float, bool))
+    default:
+        ASSERT(0, "Unknown command pseudo bytecode");
+    }
+}
+
+//-----------------------------------------------------------------------------
+void EasyMesh::ExecuteCmds()
+{
+    //Hashing the whole mesh is only worth it when results get cached
+    bool const use_cache = IsCmdCacheEnabled();
+    if (!use_cache)
+        BD()->CmdHash() = 0;
+    else if (BD()->Cmdi() == 0 || BD()->CmdHash() == 0)
+        BD()->CmdHash() = HashCmdState();
+
+    //The latest cached result found, and the cheap commands skipped since:
+    //both are only applied when a command misses the cache.
+    std::shared_ptr<EasyMeshCmdResult const> cached;
+    array<int> skipped;
 
     for (; BD()->Cmdi() < BD()->CmdStack().GetCmdNb() && BD()->CmdExecNb() != 0; ++BD()->Cmdi())
     {
         if (BD()->CmdExecNb() > 0)
             --BD()->CmdExecNb();
 
-        switch (BD()->CmdStack().GetCmd(BD()->Cmdi()))
+        int cmd = BD()->CmdStack().GetCmd(BD()->Cmdi());
+        if (use_cache)
+            BD()->CmdHash() = BD()->CmdStack().HashCmd(BD()->Cmdi(), BD()->CmdHash());
+
+        //Loops only move Cmdi, so they always run
+        if (use_cache && cmd != EasyMeshCmdType::LoopStart && cmd != EasyMeshCmdType::LoopEnd)
         {
-            DO_EXEC_CMD(MeshCsg, (MeshCsg, CSGUsage))
-                DO_EXEC_CMD(LoopStart, (LoopStart, int))
-                DO_EXEC_CMD(LoopEnd, (LoopEnd))
-                DO_EXEC_CMD(OpenBrace, (OpenBrace))
-                DO_EXEC_CMD(CloseBrace, (CloseBrace))
-                DO_EXEC_CMD(ScaleWinding, (ToggleScaleWinding))
-                DO_EXEC_CMD(QuadWeighting, (ToggleQuadWeighting))
-                DO_EXEC_CMD(PostBuildNormal, (TogglePostBuildNormal))
-                DO_EXEC_CMD(PreventVertCleanup, (ToggleVerticeNoCleanup))
-                DO_EXEC_CMD(VerticesMerge, (VerticesMerge))
-                DO_EXEC_CMD(VerticesSeparate, (VerticesSeparate))
-                DO_EXEC_CMD(SetColorA, (SetCurColorA, vec4))
-                DO_EXEC_CMD(SetColorB, (SetCurColorB, vec4))
-                DO_EXEC_CMD(SetVertColor, (SetVertColor, vec4))
-                DO_EXEC_CMD(Translate, (Translate, vec3))
-                DO_EXEC_CMD(Rotate, (Rotate, float, vec3))
-                DO_EXEC_CMD(RadialJitter, (RadialJitter, float))
-                DO_EXEC_CMD(MeshTranform, (DoMeshTransform, MeshTransform, Axis, Axis, float, float, float, bool))
-                DO_EXEC_CMD(Scale, (Scale, vec3))
-                DO_EXEC_CMD(DupAndScale, (DupAndScale, vec3, bool))
-                DO_EXEC_CMD(Chamfer, (Chamfer, float))
-                DO_EXEC_CMD(SplitTriangles, (SplitTriangles, int))
-                DO_EXEC_CMD(SmoothMesh, (SmoothMesh, int, int, int))
-                DO_EXEC_CMD(AppendCylinder, (AppendCylinder, int, float, float, float, bool, bool, bool))
-                DO_EXEC_CMD(AppendCapsule, (AppendCapsule, int, float, float))
-                DO_EXEC_CMD(AppendTorus, (AppendTorus, int, float, float))
-                DO_EXEC_CMD(AppendBox, (AppendBox, vec3, float, bool))
-                DO_EXEC_CMD(AppendStar, (AppendStar, int, float, float, bool, bool))
-                DO_EXEC_CMD(AppendExpandedStar, (AppendExpandedStar, int, float, float, float))
-                DO_EXEC_CMD(AppendDisc, (AppendDisc, int, float, bool))
-                DO_EXEC_CMD(AppendSimpleTriangle, (AppendSimpleTriangle, float, bool))
-                DO_EXEC_CMD(AppendSimpleQuad, (AppendSimpleQuad, vec2, vec2, float, bool))
-                DO_EXEC_CMD(AppendCog, (AppendCog, int, float, float, float, float, float, float, float, float, bool))
-        default:
-            ASSERT(0, "Unknown command pseudo bytecode");
+            std::shared_ptr<EasyMeshCmdResult const> result = FindCmdResult(BD()->CmdHash(), cmd);
+            if (result)
+            {
+                cached = result;
+                skipped.empty();
+                continue;
+            }
+            if (cached && !IsCmdCacheable(cmd))
+            {
+                skipped << BD()->Cmdi();
+                continue;
+            }
+            if (cached)
+            {
+                //The skipped commands read their own arguments, so point
+                //the stack back at the ones of the command about to run
+                RestoreCachedCmds(*cached, skipped);
+                cached = nullptr;
+                BD()->CmdStack().Rewind(BD()->Cmdi());
+            }
         }
+
+        ExecuteCmd(cmd);
+        StoreCmdResult(BD()->CmdHash(), cmd);
     }
+    if (cached)
+        RestoreCachedCmds(*cached, skipped);
+}
+
+//-----------------------------------------------------------------------------
+void EasyMesh::ExecuteCmdStack(bool ExecAllStack)
+{
+    BD()->Enable(MeshBuildOperation::CommandExecution);
+    if (ExecAllStack)
+        BD()->Cmdi() = 0;
+    ExecuteCmds();
     BD()->Disable(MeshBuildOperation::CommandExecution);
 
     if (!BD()->IsEnabled(MeshBuildOperation::PreventVertCleanup))
@@ -297,10 +377,28 @@ void EasyMesh::ExecuteCmdStack(bool ExecAllStack)
     if (BD()->IsEnabled(MeshBuildOperation::PostBuildComputeNormals))
         ComputeNormals(0, m_indices.count());
 
+    if (BD()->IsEnabled(MeshBuildOperation::OptimizeVertexCache))
+        OptimizeVertexCache(BD()->IsEnabled(MeshBuildOperation::OptimizeOverdraw));
+
     BD()->Disable(MeshBuildOperation::PostBuildComputeNormals);
     BD()->Disable(MeshBuildOperation::PreventVertCleanup);
 
+    //The cleanup changed the mesh, so hash what the next commands will see
+    BD()->CmdHash() = IsCmdCacheEnabled() ? HashCmdState() : 0;
+
     if (BD()->CmdExecNb() > 0)
         BD()->CmdExecNb() = -1;
 }
 
+//-----------------------------------------------------------------------------
+void EasyMesh::ExecuteRecordedCmds()
+{
+    BD()->Enable(MeshBuildOperation::CommandExecution);
+    ExecuteCmds();
+    BD()->Disable(MeshBuildOperation::CommandExecution);
+
+    //The commands skipped their normals if asked to leave them for the end
+    if (BD()->IsEnabled(MeshBuildOperation::PostBuildComputeNormals))
+        ComputeNormals(0, m_indices.count());
+}
+
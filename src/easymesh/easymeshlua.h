@@ -23,7 +23,7 @@ public:
     //-------------------------------------------------------------------------
     EasyMeshLuaObject(String const& name);
     virtual ~EasyMeshLuaObject();
-    EasyMesh& GetMesh() { return m_instance; }
+    EasyMesh& GetMesh();
 
     //-------------------------------------------------------------------------
     static EasyMeshLuaObject* New(lua_State* l, int arg_nb);
@@ -97,6 +97,9 @@ public:
     LOLUA_DECLARE_VOID_METHOD_VOID(ToggleQuadWeighting, EMLO, m_instance.ToggleQuadWeighting);
     LOLUA_DECLARE_VOID_METHOD_VOID(TogglePostBuildNormal, EMLO, m_instance.TogglePostBuildNormal);
     LOLUA_DECLARE_VOID_METHOD_VOID(ToggleVerticeNoCleanup, EMLO, m_instance.ToggleVerticeNoCleanup);
+    LOLUA_DECLARE_VOID_METHOD_ARGS(SetIndex32, EMLO, m_instance.SetIndex32, Get<bool>(true));
+    LOLUA_DECLARE_VOID_METHOD_ARGS(SetNormalWeighting, EMLO, m_instance.SetNormalWeighting, Get<int32_t>(0));
+    LOLUA_DECLARE_VOID_METHOD_ARGS(SetGpuOptimize, EMLO, m_instance.SetGpuOptimize, Get<bool>(true), Get<bool>(false));
     //-------------------------------------------------------------------------
     LOLUA_DECLARE_VOID_METHOD_VOID(VerticesMerge, EMLO, m_instance.VerticesMerge);
     LOLUA_DECLARE_VOID_METHOD_VOID(VerticesSeparate, EMLO, m_instance.VerticesSeparate);
@@ -105,6 +108,7 @@ public:
     LOLUA_DECLARE_VOID_METHOD_ARGS(Duplicate, EMLO, m_instance.DupAndScale, Get<vec3>(vec3(1.f)), Get<bool>(true));
     LOLUA_DECLARE_VOID_METHOD_ARGS(Smooth, EMLO, m_instance.SmoothMesh, Get<int32_t>(), Get<int32_t>(), Get<int32_t>());
     LOLUA_DECLARE_VOID_METHOD_ARGS(SplitTriangles, EMLO, m_instance.SplitTriangles, Get<int32_t>());
+    LOLUA_DECLARE_VOID_METHOD_ARGS(Simplify, EMLO, m_instance.Simplify, Get<float>());
     LOLUA_DECLARE_VOID_METHOD_ARGS(Chamfer, EMLO, m_instance.Chamfer, Get<float>());
     //-------------------------------------------------------------------------
     LOLUA_DECLARE_VOID_METHOD_ARGS(SetCurColor, EMLO, m_instance.SetCurColor, Get<vec4>());
@@ -0,0 +1,343 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <algorithm> /* std::sort */
+
+#include <lol/engine-internal.h>
+
+namespace lol
+{
+
+//Size of the LRU cache the triangle order is scored against. Being larger
+//than most hardware caches does not hurt the smaller ones much.
+static int const VERTEX_CACHE_SIZE = 32;
+
+//Past this many triangles, an overdraw cluster ends even if the cache order
+//does not break, so that each cluster stays roughly planar
+static int const OVERDRAW_CLUSTER_SIZE = 512;
+
+//-----------------------------------------------------------------------------
+//Vertex scores from "Linear-Speed Vertex Cache Optimisation", Tom Forsyth
+class VertexCacheScore
+{
+public:
+    VertexCacheScore()
+    {
+        //The last triangle's vertices get a fixed score, so that the next
+        //one does not always come from the same strip
+        for (int i = 0; i < VERTEX_CACHE_SIZE; ++i)
+            m_cache[i] = i < 3 ? .75f
+                       : lol::pow(1.f - (float)(i - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f);
+
+        //Vertices with few triangles left get a boost, to avoid leaving
+        //lone triangles behind
+        m_valence[0] = 0.f;
+        for (int i = 1; i < MAX_VALENCE; ++i)
+            m_valence[i] = 2.f * lol::pow((float)i, -.5f);
+    }
+
+    float Get(int cache_pos, int remaining) const
+    {
+        if (!remaining)
+            return -1.f;
+        float ret = cache_pos < 0 ? 0.f : m_cache[cache_pos];
+        return ret + m_valence[lol::min(remaining, MAX_VALENCE - 1)];
+    }
+
+private:
+    static int const MAX_VALENCE = 64;
+    float m_cache[VERTEX_CACHE_SIZE], m_valence[MAX_VALENCE];
+};
+
+static VertexCacheScore const g_cache_score;
+
+//-----------------------------------------------------------------------------
+void EasyMesh::SetGpuOptimize(bool enable, bool overdraw)
+{
+    if (BD()->IsEnabled(MeshBuildOperation::CommandRecording))
+    {
+        BD()->CmdStack().AddCmd(EasyMeshCmdType::GpuOptimize);
+        BD()->CmdStack() << enable << overdraw;
+        return;
+    }
+
+    if (enable)
+        BD()->Enable(MeshBuildOperation::OptimizeVertexCache);
+    else
+        BD()->Disable(MeshBuildOperation::OptimizeVertexCache);
+
+    if (enable && overdraw)
+        BD()->Enable(MeshBuildOperation::OptimizeOverdraw);
+    else
+        BD()->Disable(MeshBuildOperation::OptimizeOverdraw);
+}
+
+//-----------------------------------------------------------------------------
+void EasyMesh::OptimizeVertexCache(bool overdraw)
+{
+    int const vstart = m_cursors.last().m1;
+    int const istart = m_cursors.last().m2;
+    int const vcount = m_vert.count();
+    int const tcount = (m_indices.count() - istart) / 3;
+    if (tcount < 2)
+        return;
+
+    uint32_t const *tris = m_indices.data() + istart;
+
+    //Vertex -> remaining triangles in CSR layout, emitted triangles being
+    //swapped to the end of each list
+    array<int> adj_offset, adj_count, adj;
+    adj_offset.resize(vcount + 1, 0);
+    adj_count.resize(vcount, 0);
+    for (int i = 0; i < 3 * tcount; ++i)
+        adj_count[tris[i]]++;
+    for (int v = 0; v < vcount; ++v)
+        adj_offset[v + 1] = adj_offset[v] + adj_count[v];
+    adj.resize(3 * tcount);
+    for (int v = 0; v < vcount; ++v)
+        adj_count[v] = 0;
+    for (int i = 0; i < 3 * tcount; ++i)
+        adj[adj_offset[tris[i]] + adj_count[tris[i]]++] = i / 3;
+
+    array<int> cache_pos;
+    array<float> vert_score, tri_score;
+    array<bool> emitted;
+    cache_pos.resize(vcount, -1);
+    vert_score.resize(vcount, 0.f);
+    tri_score.resize(tcount, 0.f);
+    emitted.resize(tcount, false);
+
+    for (int v = 0; v < vcount; ++v)
+        vert_score[v] = g_cache_score.Get(-1, adj_count[v]);
+
+    int best = 0;
+    for (int t = 0; t < tcount; ++t)
+    {
+        tri_score[t] = vert_score[tris[3 * t]] + vert_score[tris[3 * t + 1]]
+                     + vert_score[tris[3 * t + 2]];
+        if (tri_score[t] > tri_score[best])
+            best = t;
+    }
+
+    //The triangle order, and where the cache order broke down
+    array<int> order;
+    array<bool> restart;
+    order.reserve(tcount);
+    restart.reserve(tcount);
+
+    int cache[VERTEX_CACHE_SIZE + 3], cache_count = 0;
+    int next_unemitted = 0;
+    bool fallback = true;
+
+    while (order.count() < tcount)
+    {
+        if (best < 0)
+        {
+            while (emitted[next_unemitted])
+                ++next_unemitted;
+            best = next_unemitted;
+            fallback = true;
+        }
+
+        order << best;
+        restart << fallback;
+        emitted[best] = true;
+        fallback = false;
+
+        //The triangle leaves the lists of its vertices, which move to the
+        //front of the cache
+        int new_cache[VERTEX_CACHE_SIZE + 3], new_count = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            int v = tris[3 * best + k];
+            int *list = adj.data() + adj_offset[v];
+            for (int i = 0; i < adj_count[v]; ++i)
+                if (list[i] == best)
+                {
+                    list[i] = list[--adj_count[v]];
+                    break;
+                }
+            new_cache[new_count++] = v;
+        }
+        for (int i = 0; i < cache_count; ++i)
+        {
+            int v = cache[i];
+            if (v != new_cache[0] && v != new_cache[1] && v != new_cache[2])
+                new_cache[new_count++] = v;
+        }
+
+        //Update the scores of everything in the cache, including the
+        //vertices that just got pushed out
+        for (int i = 0; i < new_count; ++i)
+        {
+            int v = new_cache[i];
+            cache_pos[v] = i < VERTEX_CACHE_SIZE ? i : -1;
+            vert_score[v] = g_cache_score.Get(cache_pos[v], adj_count[v]);
+        }
+
+        best = -1;
+        for (int i = 0; i < new_count; ++i)
+        {
+            int v = new_cache[i];
+            int const *list = adj.data() + adj_offset[v];
+            for (int j = 0; j < adj_count[v]; ++j)
+            {
+                int t = list[j];
+                tri_score[t] = vert_score[tris[3 * t]] + vert_score[tris[3 * t + 1]]
+                             + vert_score[tris[3 * t + 2]];
+                if (best < 0 || tri_score[t] > tri_score[best])
+                    best = t;
+            }
+        }
+
+        cache_count = lol::min(new_count, VERTEX_CACHE_SIZE);
+        for (int i = 0; i < cache_count; ++i)
+            cache[i] = new_cache[i];
+    }
+
+    if (overdraw)
+        SortOverdrawClusters(order, restart);
+
+    //Write the triangles back, then number the brace vertices by first use
+    array<uint32_t> indices;
+    indices.resize(3 * tcount);
+    for (int i = 0; i < tcount; ++i)
+        for (int k = 0; k < 3; ++k)
+            indices[3 * i + k] = tris[3 * order[i] + k];
+
+    array<int> vert_ids;
+    vert_ids.resize(vcount, -1);
+    int next_id = vstart;
+    for (int i = 0; i < indices.count(); ++i)
+        if (indices[i] >= (uint32_t)vstart && vert_ids[indices[i]] < 0)
+            vert_ids[indices[i]] = next_id++;
+    for (int v = vstart; v < vcount; ++v)
+        if (vert_ids[v] < 0)
+            vert_ids[v] = next_id++;
+
+    array<VertexData> vert;
+    vert.resize(vcount - vstart);
+    for (int v = vstart; v < vcount; ++v)
+        vert[vert_ids[v] - vstart] = m_vert[v];
+    for (int v = vstart; v < vcount; ++v)
+        m_vert[v] = vert[v - vstart];
+
+    for (int i = 0; i < indices.count(); ++i)
+        m_indices[istart + i] = indices[i] < (uint32_t)vstart ? indices[i]
+                                                              : (uint32_t)vert_ids[indices[i]];
+
+    m_state = MeshRender::NeedConvert;
+}
+
+//-----------------------------------------------------------------------------
+//Split the cache order into clusters where it already broke down, or where
+//clusters get too large, then draw the clusters facing away from the mesh
+//centre first: they are the most likely to occlude the others. This is the
+//sorting step from "Fast Triangle Reordering for Vertex Locality and
+//Reduced Overdraw", Sander, Nehab and Barczak.
+void EasyMesh::SortOverdrawClusters(array<int> &order, array<bool> const &restart)
+{
+    int const istart = m_cursors.last().m2;
+    uint32_t const *tris = m_indices.data() + istart;
+
+    array<int> cluster_start;
+    for (int i = 0; i < order.count(); ++i)
+        if (restart[i] || i - cluster_start.last() >= OVERDRAW_CLUSTER_SIZE)
+            cluster_start << i;
+    cluster_start << order.count();
+
+    int const cluster_count = cluster_start.count() - 1;
+    if (cluster_count < 2)
+        return;
+
+    //Area-weighted centroids and normals of the whole brace, then of each
+    //cluster
+    array<vec3> centroid, normal;
+    array<float> area;
+    centroid.resize(cluster_count, vec3(0.f));
+    normal.resize(cluster_count, vec3(0.f));
+    area.resize(cluster_count, 0.f);
+
+    vec3 mesh_centroid(0.f);
+    float mesh_area = 0.f;
+    for (int c = 0; c < cluster_count; ++c)
+    {
+        for (int i = cluster_start[c]; i < cluster_start[c + 1]; ++i)
+        {
+            int t = order[i];
+            vec3 const &p0 = m_vert[tris[3 * t]].m_coord;
+            vec3 const &p1 = m_vert[tris[3 * t + 1]].m_coord;
+            vec3 const &p2 = m_vert[tris[3 * t + 2]].m_coord;
+            vec3 n = cross(p1 - p0, p2 - p0);
+            float a = length(n);
+            centroid[c] += a * (p0 + p1 + p2) / 3.f;
+            normal[c] += n;
+            area[c] += a;
+        }
+        mesh_centroid += centroid[c];
+        mesh_area += area[c];
+        if (area[c] > 0.f)
+            centroid[c] /= area[c];
+    }
+    if (mesh_area > 0.f)
+        mesh_centroid /= mesh_area;
+
+    array<float> key;
+    array<int> sorted;
+    key.resize(cluster_count);
+    for (int c = 0; c < cluster_count; ++c)
+    {
+        float len = length(normal[c]);
+        key[c] = len > 0.f ? dot(centroid[c] - mesh_centroid, normal[c] / len) : 0.f;
+        sorted << c;
+    }
+
+    std::sort(sorted.data(), sorted.data() + sorted.count(), [&](int a, int b)
+    {
+        return key[a] > key[b] || (key[a] == key[b] && a < b);
+    });
+
+    array<int> tmp;
+    tmp.reserve(order.count());
+    for (int c = 0; c < cluster_count; ++c)
+        for (int i = cluster_start[sorted[c]]; i < cluster_start[sorted[c] + 1]; ++i)
+            tmp << order[i];
+    order = tmp;
+}
+
+//-----------------------------------------------------------------------------
+vec2 EasyMesh::GetVertexCacheStats(int cache_size)
+{
+    //Hardware caches are FIFO: hits do not move vertices to the front
+    array<int> cache_stamp;
+    cache_stamp.resize(m_vert.count(), -1);
+
+    int misses = 0, used = 0;
+    for (int i = 0; i < m_indices.count(); ++i)
+    {
+        int v = m_indices[i];
+        if (cache_stamp[v] >= 0 && misses - cache_stamp[v] < cache_size)
+            continue;
+        used += cache_stamp[v] < 0;
+        cache_stamp[v] = misses++;
+    }
+
+    int const tcount = m_indices.count() / 3;
+    return vec2(tcount ? (float)misses / tcount : 0.f,
+                used ? (float)misses / used : 0.f);
+}
+
+} /* namespace lol */
@@ -19,6 +19,9 @@
 namespace lol
 {
 
+/* Primitives with fewer vertices than this are built on a single thread */
+static int const PRIMITIVE_THREAD_MIN_VERTICES = 8192;
+
 //-----------------------------------------------------------------------------
 void EasyMesh::AppendCylinder(int nsides, float h, float d1, float d2,
                               bool dualside, bool smooth, bool close)
@@ -60,25 +63,29 @@ void EasyMesh::AppendCylinder(int nsides, float h, float d1, float d2,
 
     //Two passes necessary to ensure "weighted quad" compatibility
     //First pass : Add vertices
+    vec4 const color_b = BD()->ColorB();
+    VertexData *vert = AddVertices(nsides * (smooth ? 2 : 4));
     for (int i = 0; i < nsides; i++)
     {
         /* FIXME: normals should be flipped in two-sided mode, but that
          * means duplicating the vertices again... */
-        AddVertex(p1); SetCurVertNormal(n); SetCurVertTexCoord(uv1); SetCurVertTexCoord2(uv1);
-        AddVertex(p2); SetCurVertNormal(n); SetCurVertTexCoord(uv2); SetCurVertTexCoord2(uv2); SetCurVertColor(BD()->ColorB());
-
-        p1 = rotmat * p1; uv1 += uvadd;
-        p2 = rotmat * p2; uv2 += uvadd;
-
-        if (!smooth)
+        for (int k = 0; k < (smooth ? 1 : 2); k++)
         {
-            AddVertex(p1); SetCurVertNormal(n); SetCurVertTexCoord(uv1); SetCurVertTexCoord2(uv1);
-            AddVertex(p2); SetCurVertNormal(n); SetCurVertTexCoord(uv2); SetCurVertTexCoord2(uv2); SetCurVertColor(BD()->ColorB());
+            vert[0].m_coord = p1; vert[0].m_normal = n; vert[0].m_texcoord = vec4(uv1, uv1);
+            vert[1].m_coord = p2; vert[1].m_normal = n; vert[1].m_texcoord = vec4(uv2, uv2); vert[1].m_color = color_b;
+            vert += 2;
+
+            if (k == 0)
+            {
+                p1 = rotmat * p1; uv1 += uvadd;
+                p2 = rotmat * p2; uv2 += uvadd;
+            }
         }
 
         n = rotmat * n;
     }
     //Second pass : Build quad
+    m_indices.reserve(m_indices.count() + nsides * (dualside ? 12 : 6));
     for (int i = 0; i < nsides; i++)
     {
         if (smooth)
@@ -178,103 +185,122 @@ void EasyMesh::AppendCapsule(int ndivisions, float h, float d)
         2, 5, 0, 6, 5, 2, 6, 9, 10, 4, 9, 6,
         7, 10, 11, 5, 10, 7, 8, 11, 9, 3, 11, 8
     };
-
-    for (unsigned i = 0; i < sizeof(tris) / sizeof(*tris); i += 3)
+    int const face_count = sizeof(tris) / sizeof(*tris) / 3;
+
+    /* Each face is split into ndivisions² triangles with their own three
+     * vertices, so every face knows where its output goes and the faces
+     * can be built in parallel. */
+    int const face_verts = 3 * ndivisions * ndivisions;
+    int const vbase = m_vert.count();
+    VertexData *vert = AddVertices(face_count * face_verts);
+    uint32_t *indices = AddIndices(face_count * face_verts);
+
+    parallel_for(face_count, PRIMITIVE_THREAD_MIN_VERTICES / lol::max(face_verts, 1),
+                 [&](int start, int end)
     {
-        vec3 const &a = vertices[tris[i]];
-        vec3 const &b = vertices[tris[i + 1]];
-        vec3 const &c = vertices[tris[i + 2]];
+        for (int f = start; f < end; f++)
+        {
+            int const i = 3 * f;
+            int n = f * face_verts;
 
-        vec3 const vb = 1.f / ndivisions * (b - a);
-        vec3 const vc = 1.f / ndivisions * (c - a);
+            vec3 const &a = vertices[tris[i]];
+            vec3 const &b = vertices[tris[i + 1]];
+            vec3 const &c = vertices[tris[i + 2]];
 
-        int line = ndivisions + 1;
+            vec3 const vb = 1.f / ndivisions * (b - a);
+            vec3 const vc = 1.f / ndivisions * (c - a);
 
-        for (int v = 0, x = 0, y = 0; x < ndivisions + 1; v++)
-        {
-            vec3 p[] = { a + (float)x * vb + (float)y * vc,
-                         p[0] + vb,
-                         p[0] + vc,
-                         p[0] + vb + vc };
-            vec2 uv[4];
-
-            /* FIXME: when we normalise here, we get a volume that is slightly
-             * smaller than the sphere of radius 1, since we are not using
-             * the midradius. */
-            for (int k = 0; k < 4; k++)
+            int line = ndivisions + 1;
+
+            for (int v = 0, x = 0, y = 0; x < ndivisions + 1; v++)
             {
-                //keep normalized until the end of the UV calculations
-                p[k] = normalize(p[k]);
-
-                uv[k].x = (lol::atan2(p[k].z, p[k].x) + F_PI) / (F_PI * 2.f);
-                if (abs(p[k].y) >= 1.0f)
-                    uv[k].x = -1.f;
-                uv[k].y = lol::atan2(p[k].y, dot(p[k], normalize(p[k] * vec3(1.f,0.f,1.f)))) / F_PI + 0.5f;
-                if (h)
+                vec3 p[] = { a + (float)x * vb + (float)y * vc,
+                             p[0] + vb,
+                             p[0] + vc,
+                             p[0] + vb + vc };
+                vec2 uv[4];
+
+                /* FIXME: when we normalise here, we get a volume that is slightly
+                 * smaller than the sphere of radius 1, since we are not using
+                 * the midradius. */
+                for (int k = 0; k < 4; k++)
                 {
-                    if (uv[k].y > .5f)
-                        uv[k].y = uv_r + uv_h + (uv[k].y - .5f) * uv_r * 2.f;
-                    else
-                        uv[k].y *= uv_r * 2.f;
+                    //keep normalized until the end of the UV calculations
+                    p[k] = normalize(p[k]);
+
+                    uv[k].x = (lol::atan2(p[k].z, p[k].x) + F_PI) / (F_PI * 2.f);
+                    if (abs(p[k].y) >= 1.0f)
+                        uv[k].x = -1.f;
+                    uv[k].y = lol::atan2(p[k].y, dot(p[k], normalize(p[k] * vec3(1.f,0.f,1.f)))) / F_PI + 0.5f;
+                    if (h)
+                    {
+                        if (uv[k].y > .5f)
+                            uv[k].y = uv_r + uv_h + (uv[k].y - .5f) * uv_r * 2.f;
+                        else
+                            uv[k].y *= uv_r * 2.f;
+                    }
+                    p[k] *= r;
                 }
-                p[k] *= r;
-            }
 
-            /* If this is a capsule, grow in the Y direction */
-            if (h > 0.f)
-            {
-                for (int k = 0; k < 4; k++)
-                    p[k].y += (p[k].y > 0.f) ? 0.5f * h : -0.5f * h;
-            }
+                /* If this is a capsule, grow in the Y direction */
+                if (h > 0.f)
+                {
+                    for (int k = 0; k < 4; k++)
+                        p[k].y += (p[k].y > 0.f) ? 0.5f * h : -0.5f * h;
+                }
 
-            /* Add zero, one or two triangles */
-            int id[] = { 0, 1, 2,
-                         1, 3 ,2 };
-            int l = 6;
-            while ((l -= 3) >= 0)
-            {
-                if ((l == 0 && y < line - 1) || (l == 3 && y < line - 2))
+                /* Add zero, one or two triangles */
+                int id[] = { 0, 1, 2,
+                             1, 3 ,2 };
+                int l = 6;
+                while ((l -= 3) >= 0)
                 {
-                    int k = -1;
-                    while (++k < 3)
+                    if ((l == 0 && y < line - 1) || (l == 3 && y < line - 2))
                     {
-                        int rid[] = { id[k + l], id[(k + 1) % 3 + l] };
-                        if (uv[rid[0]].x >= .0f &&
-                            uv[rid[1]].x >= .0f &&
-                            abs(uv[rid[0]].x - uv[rid[1]].x) > .5f)
+                        int k = -1;
+                        while (++k < 3)
                         {
-                            if (uv[rid[0]].x < uv[rid[1]].x)
-                                uv[rid[0]].x += 1.0f;
+                            int rid[] = { id[k + l], id[(k + 1) % 3 + l] };
+                            if (uv[rid[0]].x >= .0f &&
+                                uv[rid[1]].x >= .0f &&
+                                abs(uv[rid[0]].x - uv[rid[1]].x) > .5f)
+                            {
+                                if (uv[rid[0]].x < uv[rid[1]].x)
+                                    uv[rid[0]].x += 1.0f;
+                                else
+                                    uv[rid[1]].x += 1.0f;
+                            }
+                        }
+                        k = -1;
+                        while (++k < 3)
+                        {
+                            int rid[] = { id[k + l], id[(k + 1) % 3 + l], id[(k + 2) % 3 + l] };
+                            vec2 new_uv;
+                            if (uv[rid[0]].x < .0f)
+                                new_uv = vec2((uv[rid[1]].x + uv[rid[2]].x) * .5f, uv[rid[0]].y);
                             else
-                                uv[rid[1]].x += 1.0f;
+                                new_uv = uv[rid[0]];
+                            vert[n + k].m_coord = p[rid[0]];
+                            vert[n + k].m_texcoord = vec4(vec2(0.f, 1.f) - new_uv,
+                                                          vec2(0.f, 1.f) - new_uv);
                         }
+                        indices[n] = vbase + n;
+                        indices[n + 1] = vbase + n + 2;
+                        indices[n + 2] = vbase + n + 1;
+                        n += 3;
                     }
-                    k = -1;
-                    while (++k < 3)
-                    {
-                        int rid[] = { id[k + l], id[(k + 1) % 3 + l], id[(k + 2) % 3 + l] };
-                        AddVertex(p[rid[0]]);
-                        vec2 new_uv;
-                        if (uv[rid[0]].x < .0f)
-                            new_uv = vec2((uv[rid[1]].x + uv[rid[2]].x) * .5f, uv[rid[0]].y);
-                        else
-                            new_uv = uv[rid[0]];
-                        SetCurVertTexCoord(vec2(0.f, 1.f) - new_uv);
-                        SetCurVertTexCoord2(vec2(0.f, 1.f) - new_uv);
-                    }
-                    AddTriangle(0, 2, 1, m_vert.count() - 3);
                 }
-            }
 
-            y++;
-            if (y == line)
-            {
-                x++;
-                y = 0;
-                line--;
+                y++;
+                if (y == line)
+                {
+                    x++;
+                    y = 0;
+                    line--;
+                }
             }
         }
-    }
+    });
 
     ComputeNormals(ibase, m_indices.count() - ibase);
 }
@@ -297,36 +323,65 @@ void EasyMesh::AppendTorus(int ndivisions, float d1, float d2)
     int nidiv = ndivisions; /* Cross-section */
     int njdiv = ndivisions; /* Full circumference */
 
+    //Location on the donut
+    array<vec2> section;
+    section.resize(nidiv);
+    for (int i = 0; i < nidiv; i++)
+    {
+        section[i].x = 0.5f * (r2 - r1) * (float)lol::cos(2.f * F_PI * i / nidiv) + 0.5f * (r1 + r2);
+        section[i].y = 0.5f * (r2 - r1) * (float)lol::sin(2.f * F_PI * i / nidiv);
+    }
+
+    //Center circle
+    array<vec2> circle;
+    circle.resize(njdiv);
     for (int j = 0; j < njdiv; j++)
-    for (int i = 0; i < 2 * nidiv; i++)
     {
-        for (int di = 0; di < 2; di++)
-        for (int dj = 0; dj < 2; dj++)
+        circle[j].x = (float)lol::cos(2.f * F_PI * j / njdiv);
+        circle[j].y = (float)lol::sin(2.f * F_PI * j / njdiv);
+    }
+
+    /* Every quad has its own four vertices and six indices */
+    int const quad_count = njdiv * 2 * nidiv;
+    int const vbase = m_vert.count();
+    VertexData *vert = AddVertices(4 * quad_count);
+    uint32_t *indices = AddIndices(6 * quad_count);
+
+    parallel_for(njdiv, PRIMITIVE_THREAD_MIN_VERTICES / lol::max(8 * nidiv, 1),
+                 [&](int start, int end)
+    {
+        for (int j = start; j < end; j++)
+        for (int i = 0; i < 2 * nidiv; i++)
         {
-            int i2 = (i + di) % nidiv;
-            int j2 = (j + dj) % njdiv;
+            int q = j * 2 * nidiv + i;
+            VertexData *v = vert + 4 * q;
 
-            //Location on the donut
-            float x = 0.5f * (r2 - r1) * (float)lol::cos(2.f * F_PI * i2 / nidiv) + 0.5f * (r1 + r2);
-            float y = 0.5f * (r2 - r1) * (float)lol::sin(2.f * F_PI * i2 / nidiv);
-            float z = 0.0f;
+            for (int di = 0; di < 2; di++)
+            for (int dj = 0; dj < 2; dj++)
+            {
+                float x = section[(i + di) % nidiv].x;
+                float y = section[(i + di) % nidiv].y;
+                float z = 0.0f;
 
-            //Center circle
-            float ca = (float)lol::cos(2.f * F_PI * j2 / njdiv);
-            float sa = (float)lol::sin(2.f * F_PI * j2 / njdiv);
+                float ca = circle[(j + dj) % njdiv].x;
+                float sa = circle[(j + dj) % njdiv].y;
 
-            //Actual location
-            float x2 = x * ca - z * sa;
-            float z2 = z * ca + x * sa;
+                //Actual location
+                float x2 = x * ca - z * sa;
+                float z2 = z * ca + x * sa;
 
-            AddVertex(vec3(x2, y, z2));
-            SetCurVertTexCoord(vec2((float)(i + di) / (float)nidiv, (float)(j + dj) / (float)nidiv));
-            SetCurVertTexCoord2(vec2((float)(i + di) / (float)nidiv, (float)(j + dj) / (float)nidiv));
-        }
+                vec2 uv((float)(i + di) / (float)nidiv, (float)(j + dj) / (float)nidiv);
+                v->m_coord = vec3(x2, y, z2);
+                v->m_texcoord = vec4(uv, uv);
+                ++v;
+            }
 
-        AddTriangle(0, 2, 3, m_vert.count() - 4);
-        AddTriangle(0, 3, 1, m_vert.count() - 4);
-    }
+            uint32_t base = vbase + 4 * q;
+            uint32_t *ind = indices + 6 * q;
+            ind[0] = base; ind[1] = base + 2; ind[2] = base + 3;
+            ind[3] = base; ind[4] = base + 3; ind[5] = base + 1;
+        }
+    });
 
     ComputeNormals(ibase, m_indices.count() - ibase);
 }
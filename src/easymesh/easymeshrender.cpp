@@ -23,6 +23,28 @@ LOLFX_RESOURCE_DECLARE(easymesh_shinydebugnormal);
 LOLFX_RESOURCE_DECLARE(easymesh_shinydebugUV);
 LOLFX_RESOURCE_DECLARE(easymesh_shiny_SK);
 
+//-----------------------------------------------------------------------------
+int EasyMesh::GetIndexSize()
+{
+    if (m_vert.count() > 65536 || BD()->IsEnabled(MeshBuildOperation::Index32))
+        return (int)sizeof(uint32_t);
+    return (int)sizeof(uint16_t);
+}
+
+//-----------------------------------------------------------------------------
+void EasyMesh::CopyIndices(void *dst)
+{
+    if (GetIndexSize() == sizeof(uint32_t))
+    {
+        memcpy(dst, m_indices.data(), m_indices.bytes());
+        return;
+    }
+
+    uint16_t *indices = (uint16_t *)dst;
+    for (int i = 0; i < m_indices.count(); ++i)
+        indices[i] = (uint16_t)m_indices[i];
+}
+
 //-----------------------------------------------------------------------------
 void EasyMesh::MeshConvert()
 {
@@ -30,10 +52,9 @@ void EasyMesh::MeshConvert()
     Shader *shader = Shader::Create(LOLFX_RESOURCE_NAME(easymesh_shiny));
 
     /* Push index buffer to GPU */
-    IndexBuffer *ibo = new IndexBuffer(m_indices.count() * sizeof(uint16_t));
-    uint16_t *indices = (uint16_t *)ibo->Lock(0, 0);
-    for (int i = 0; i < m_indices.count(); ++i)
-        indices[i] = m_indices[i];
+    int index_size = GetIndexSize();
+    IndexBuffer *ibo = new IndexBuffer(m_indices.count() * index_size);
+    CopyIndices(ibo->Lock(0, 0));
     ibo->Unlock();
 
     /* Push vertex buffer to GPU */
@@ -63,7 +84,7 @@ void EasyMesh::MeshConvert()
 
     /* Reference our new data in our submesh */
     m_submeshes.push(new SubMesh(shader, vdecl));
-    m_submeshes.last()->SetIndexBuffer(ibo);
+    m_submeshes.last()->SetIndexBuffer(ibo, index_size);
     m_submeshes.last()->SetVertexBuffer(0, vbo);
 
     m_state = MeshRender::CanRender;
@@ -219,6 +240,7 @@ GpuEasyMeshData::GpuEasyMeshData()
 {
     m_vertexcount = 0;
     m_indexcount = 0;
+    m_indexsize = sizeof(uint16_t);
     m_ibo = nullptr;
 }
 
@@ -262,20 +284,12 @@ void GpuEasyMeshData::AddGpuData(GpuShaderData* gpudata, EasyMesh* src_mesh)
 
     if (!m_ibo)
     {
-        array<uint16_t> indexlist;
-        for (int i = 0; i < src_mesh->m_indices.count(); i += 3)
-        {
-            indexlist << src_mesh->m_indices[i + 0];
-            indexlist << src_mesh->m_indices[i + 1];
-            indexlist << src_mesh->m_indices[i + 2];
-        }
-
-        m_ibo = new IndexBuffer(indexlist.bytes());
-        void *indices = m_ibo->Lock(0, 0);
-        memcpy(indices, &indexlist[0], indexlist.bytes());
-        m_ibo->Unlock();
+        m_indexcount = src_mesh->m_indices.count();
+        m_indexsize = src_mesh->GetIndexSize();
 
-        m_indexcount = indexlist.count();
+        m_ibo = new IndexBuffer(m_indexcount * m_indexsize);
+        src_mesh->CopyIndices(m_ibo->Lock(0, 0));
+        m_ibo->Unlock();
     }
 
     //init to a minimum of gpudata->m_render_mode size
@@ -454,7 +468,7 @@ void GpuEasyMeshData::RenderMeshData(mat4 const &model, int render_mode)
     vdecl->SetStream(vbo, Attribs[0], Attribs[1], Attribs[2], Attribs[3]);
 
     m_ibo->Bind();
-    vdecl->DrawIndexedElements(MeshPrimitive::Triangles, m_indexcount);
+    vdecl->DrawIndexedElements(MeshPrimitive::Triangles, m_indexcount, nullptr, (short)m_indexsize);
     m_ibo->Unbind();
     vdecl->Unbind();
 }
@@ -132,6 +132,8 @@ private:
     //We only need only one ibo for the whole mesh
     IndexBuffer *                       m_ibo;
     int                                 m_indexcount;
+    //2 or 4 bytes, see EasyMesh::GetIndexSize()
+    int                                 m_indexsize;
 };
 
 } /* namespace lol */
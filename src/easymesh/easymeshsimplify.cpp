@@ -0,0 +1,933 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <lol/engine-internal.h>
+
+namespace lol
+{
+
+//Border edges are kept in place by planes orthogonal to their face, weighted
+//this much more than the face planes
+static double const SIMPLIFY_BORDER_WEIGHT = 10.0;
+
+//Vertices at the same position with colours or UVs this close are merged
+static float const SIMPLIFY_ATTRIBUTE_EPSILON = 1e-4f;
+
+//Below this many vertex groups, the setup passes run on a single thread
+static int const SIMPLIFY_THREAD_MIN_GROUPS = 16384;
+
+//Each round sorts the candidate collapses by cost and applies the cheapest
+//ones whose ends no earlier pick touched. Many get skipped that way, so it
+//keeps candidates up to this factor above the cost of the one that would
+//reach the target if none were skipped.
+static float const SIMPLIFY_ROUND_COST_SLACK = 1.5f;
+
+//Collapses are ordered by their cost with this many low bits dropped, that
+//is, to within 1/64th of it, which is plenty next to the above
+static int const SIMPLIFY_COST_BIN_SHIFT = 17;
+
+//-----------------------------------------------------------------------------
+//Sum of squared distances to a set of planes: p.A.p + 2 b.p + c
+struct SimplifyQuadric
+{
+    SimplifyQuadric()
+      : a00(0.0), a01(0.0), a02(0.0), a11(0.0), a12(0.0), a22(0.0),
+        b0(0.0), b1(0.0), b2(0.0), c(0.0)
+    {
+    }
+
+    //Plane dot(n, p) + d = 0, n being normalised
+    void AddPlane(dvec3 const &n, double d, double w)
+    {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+        b0 += w * d * n.x; b1 += w * d * n.y; b2 += w * d * n.z;
+        c += w * d * d;
+    }
+
+    void Add(SimplifyQuadric const &q)
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02;
+        a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+    }
+
+    double Error(dvec3 const &p) const
+    {
+        double ret = p.x * (a00 * p.x + 2.0 * (a01 * p.y + a02 * p.z + b0))
+                   + p.y * (a11 * p.y + 2.0 * (a12 * p.z + b1))
+                   + p.z * (a22 * p.z + 2.0 * b2) + c;
+        return lol::max(ret, 0.0);
+    }
+
+    double a00, a01, a02, a11, a12, a22, b0, b1, b2, c;
+};
+
+//-----------------------------------------------------------------------------
+//Half-edge collapse simplifier for the current brace of a mesh.
+//
+//Vertices are first sorted in position groups, then in wedges: the vertices
+//of a group that share colour and UVs. Topology only looks at groups, and a
+//group always collapses onto a neighbour group, its wedges being remapped to
+//the wedges of that neighbour, so vertex attributes are never interpolated.
+//Groups on a border may only slide along it, groups on a UV or colour seam
+//only along the seam, and anything more complex is locked.
+class MeshSimplifier
+{
+public:
+    enum GroupKind
+    {
+        Manifold,
+        Border,
+        Seam,
+        Locked,
+    };
+
+    MeshSimplifier(EasyMesh &mesh)
+      : m_mesh(mesh),
+        m_vstart(mesh.m_cursors.last().m1),
+        m_istart(mesh.m_cursors.last().m2),
+        m_range_groups(0),
+        m_live(0),
+        m_mark_stamp(0),
+        m_round_stamp(0)
+    {
+        Weld();
+        BuildAdjacency();
+        Classify();
+    }
+
+    int TriangleCount() const { return m_live; }
+
+    //Collapse edges until each of the (decreasing) triangle targets is
+    //reached, and store the indices of each level
+    void Run(array<int> const &targets, array< array<uint32_t> > &levels)
+    {
+        levels.resize(targets.count());
+        m_round.resize(m_range_groups, 0);
+
+        bool retried = false;
+        for (int level = 0; level < targets.count(); ++level)
+        {
+            while (m_live > targets[level])
+            {
+                if (Round(targets[level]))
+                {
+                    retried = false;
+                    continue;
+                }
+
+                //Rejected collapses may have become valid since, give
+                //every group another chance as long as this helps
+                if (retried)
+                    break;
+                retried = true;
+                for (int g = 0; g < m_range_groups; ++g)
+                    m_dirty[g] = !m_dead[g];
+            }
+
+            Snapshot(levels[level]);
+        }
+    }
+
+private:
+    struct Collapse
+    {
+        float m_cost;
+        int m_from, m_to;
+    };
+
+    //Costs are positive, so their bits sort like them
+    static int CostBin(float cost)
+    {
+        union { float f; uint32_t x; } u = { cost };
+        return (int)(u.x >> SIMPLIFY_COST_BIN_SHIFT);
+    }
+
+    //Find the collapse of every dirty group on all threads, then apply the
+    //cheapest ones whose one-rings do not overlap, so that their costs and
+    //rings are still exact when they come up. Returns whether any worked.
+    bool Round(int target)
+    {
+        m_todo.empty();
+        for (int g = 0; g < m_range_groups; ++g)
+        {
+            if (!m_dirty[g])
+                continue;
+            m_dirty[g] = false;
+            m_todo << g;
+
+            //Store the rings of groups that absorbed others in one piece
+            //first, the evaluation pass must not touch the adjacency
+            if (m_chain_next[g] >= 0)
+                GatherRing(g, m_ring);
+        }
+
+        parallel_for(m_todo.count(), SIMPLIFY_THREAD_MIN_GROUPS,
+                     [&](int start, int end)
+        {
+            array<int> ring;
+            for (int i = start; i < end; ++i)
+            {
+                int g = m_todo[i];
+                if (!FindCollapse(g, ring, m_best[g]))
+                    m_best[g].m_from = -1;
+            }
+        });
+
+        //Counting sort of the candidates on their cost bins, after which
+        //each bin count is the end of the bin in m_order
+        m_bins.resize(1 << (32 - SIMPLIFY_COST_BIN_SHIFT));
+        for (int i = 0; i < m_bins.count(); ++i)
+            m_bins[i] = 0;
+        int count = 0;
+        for (int g = 0; g < m_range_groups; ++g)
+            if (!m_dead[g] && m_best[g].m_from >= 0)
+                ++m_bins[CostBin(m_best[g].m_cost)], ++count;
+        for (int i = 0, offset = 0; i < m_bins.count(); ++i)
+        {
+            offset += m_bins[i];
+            m_bins[i] = offset - m_bins[i];
+        }
+        m_order.resize(count);
+        for (int g = 0; g < m_range_groups; ++g)
+            if (!m_dead[g] && m_best[g].m_from >= 0)
+                m_order[m_bins[CostBin(m_best[g].m_cost)]++] = m_best[g];
+
+        //Each collapse removes two triangles, one on a border. Past the
+        //cost of the last one needed, only go a little further.
+        int goal = (m_live - target + 1) / 2;
+        if (goal < count)
+            m_order.resize(m_bins[CostBin(m_order[goal].m_cost
+                                           * SIMPLIFY_ROUND_COST_SLACK)]);
+
+        //Pick the collapses in cost order, as long as both ends are still
+        //untouched this round, marking sources with the round and targets
+        //with its opposite. They are then applied in group order, which is
+        //much kinder to the caches.
+        int const round = ++m_round_stamp;
+        for (int i = 0, removed = 0; i < m_order.count() && removed < m_live - target; ++i)
+        {
+            int a = m_order[i].m_from, b = m_order[i].m_to;
+            if (abs(m_round[a]) == round || abs(m_round[b]) == round)
+                continue;
+            m_round[a] = round;
+            m_round[b] = -round;
+            removed += m_kind[a] == Border ? 1 : 2;
+        }
+
+        int const live = m_live;
+        for (int a = 0; a < m_range_groups && m_live > target; ++a)
+        {
+            if (m_round[a] != round)
+                continue;
+
+            //A rejected group waits for its ring to change
+            m_best[a].m_from = -1;
+            if (!TryCollapse(a, m_best[a].m_to))
+                continue;
+
+            for (int j = 0; j < m_neighbours.count(); ++j)
+                m_dirty[m_neighbours[j]] = true;
+        }
+
+        return m_live != live;
+    }
+
+    //-------------------------------------------------------------------------
+    //Position groups through a hash grid of 16 * epsilon wide cells, then
+    //wedges inside each group. Groups get dense ids, the ones outside of
+    //the current brace coming last.
+    void Weld()
+    {
+        array<VertexData> const &vert = m_mesh.m_vert;
+        int const vcount = vert.count();
+
+        array<int> group, wedge, next_wedge;
+        group.resize(vcount, -1);
+        wedge.resize(vcount);
+        next_wedge.resize(vcount, -1);
+        for (int v = 0; v < vcount; ++v)
+            wedge[v] = v;
+
+        float const epsilon = lol::max(TestEpsilon::Get(), 1e-7f);
+        float const cell_size = 16.f * epsilon;
+
+        int bucket_count = 64;
+        while (bucket_count < vcount - m_vstart)
+            bucket_count *= 2;
+
+        //The bucket of the cell of each vertex, and whether the vertex is
+        //less than epsilon away from one of its faces, which most of the
+        //time it is not
+        array<int> home;
+        array<bool> near;
+        home.resize(vcount);
+        near.resize(vcount);
+        parallel_for(vcount - m_vstart, SIMPLIFY_THREAD_MIN_GROUPS,
+                     [&](int start, int end)
+        {
+            for (int v = m_vstart + start; v < m_vstart + end; ++v)
+            {
+                ivec3 side;
+                ivec3 cell = WeldCell(vert[v].m_coord, cell_size, side);
+                home[v] = Bucket(cell, bucket_count);
+                near[v] = side != ivec3(0);
+            }
+        });
+
+        //Buckets chain entries, newest first. A group is also entered in
+        //the cells it is close to, so that a vertex only ever looks in its
+        //own cell, and the oldest match there wins.
+        struct WeldEntry
+        {
+            vec3 m_coord;
+            int m_group, m_next;
+        };
+        array<int> buckets, master;
+        array<WeldEntry> entries;
+        buckets.resize(bucket_count, -1);
+
+        for (int v = m_vstart; v < vcount; ++v)
+        {
+            vec3 const &coord = vert[v].m_coord;
+
+            int match = -1;
+            for (int e = buckets[home[v]]; e >= 0; e = entries[e].m_next)
+            {
+                vec3 const &p = entries[e].m_coord;
+                if (lol::abs(p.x - coord.x) <= epsilon
+                     && lol::abs(p.y - coord.y) <= epsilon
+                     && lol::abs(p.z - coord.z) <= epsilon)
+                    match = entries[e].m_group;
+            }
+
+            if (match < 0)
+            {
+                group[v] = master.count();
+                master << v;
+
+                ivec3 cell(0), side(0);
+                if (near[v])
+                    cell = WeldCell(coord, cell_size, side);
+                for (int n = 0; n < 8; ++n)
+                {
+                    if (((n & 1) && !side.x) || ((n & 2) && !side.y) || ((n & 4) && !side.z))
+                        continue;
+                    int b = n ? Bucket(cell + ivec3(n & 1 ? side.x : 0,
+                                                    n & 2 ? side.y : 0,
+                                                    n & 4 ? side.z : 0), bucket_count)
+                              : home[v];
+                    entries.push(WeldEntry { coord, group[v], buckets[b] });
+                    buckets[b] = entries.count() - 1;
+                }
+                continue;
+            }
+
+            group[v] = match;
+
+            //The group master heads the list of wedges
+            int const head = master[match];
+            int w = head;
+            for (; w >= 0; w = next_wedge[w])
+                if (SameAttributes(vert[w], vert[v]))
+                    break;
+            if (w >= 0)
+            {
+                wedge[v] = w;
+            }
+            else
+            {
+                next_wedge[v] = next_wedge[head];
+                next_wedge[head] = v;
+            }
+        }
+
+        m_range_groups = master.count();
+        m_pos.reserve(m_range_groups);
+        for (int g = 0; g < m_range_groups; ++g)
+            m_pos << dvec3(vert[master[g]].m_coord);
+
+        //Triangles now use wedges, and degenerate ones are dropped
+        array<uint32_t> const &indices = m_mesh.m_indices;
+        m_tris.reserve(indices.count() - m_istart);
+        m_corner_group.reserve(indices.count() - m_istart);
+        for (int i = m_istart; i + 2 < indices.count(); i += 3)
+        {
+            int g[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                int v = indices[i + k];
+                if (group[v] < 0)
+                {
+                    group[v] = m_pos.count();
+                    m_pos << dvec3(vert[v].m_coord);
+                }
+                g[k] = group[v];
+            }
+            if (g[0] == g[1] || g[1] == g[2] || g[2] == g[0])
+                continue;
+            for (int k = 0; k < 3; ++k)
+            {
+                m_tris << wedge[indices[i + k]];
+                m_corner_group << g[k];
+            }
+        }
+
+        int const gcount = m_pos.count();
+        m_live = m_tris.count() / 3;
+        m_tri_dead.resize(m_live, false);
+        m_dead.resize(gcount, false);
+        m_dirty.resize(gcount, false);
+        m_mark.resize(gcount, 0);
+    }
+
+    //The cell of a position, and whether it is within 1/16th of the cell
+    //size, that is epsilon, of the previous (-1) or next (1) cell on each
+    //axis
+    static ivec3 WeldCell(vec3 const &coord, float cell_size, ivec3 &side)
+    {
+        ivec3 cell;
+        for (int i = 0; i < 3; ++i)
+        {
+            float c = lol::clamp(coord[i] / cell_size, -1e9f, 1e9f);
+            cell[i] = (int)lol::floor(c);
+            float f = c - (float)cell[i];
+            side[i] = f <= 1.f / 16 ? -1 : f >= 15.f / 16 ? 1 : 0;
+        }
+        return cell;
+    }
+
+    static int Bucket(ivec3 const &cell, int bucket_count)
+    {
+        uint32_t h = (uint32_t)cell.x * 73856093u
+                   ^ (uint32_t)cell.y * 19349663u
+                   ^ (uint32_t)cell.z * 83492791u;
+        return (int)(h & (uint32_t)(bucket_count - 1));
+    }
+
+    static bool SameAttributes(VertexData const &a, VertexData const &b)
+    {
+        float const e = SIMPLIFY_ATTRIBUTE_EPSILON;
+        for (int i = 0; i < 4; ++i)
+            if (lol::abs(a.m_color[i] - b.m_color[i]) > e
+                 || lol::abs(a.m_texcoord[i] - b.m_texcoord[i]) > e
+                 || lol::abs(a.m_bone_weight[i] - b.m_bone_weight[i]) > e
+                 || a.m_bone_id[i] != b.m_bone_id[i])
+                return false;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    //Group -> triangles, first in CSR layout. A collapsed group is chained
+    //to the group it went to, which then owns the triangles of the whole
+    //chain until its ring gets stored again in one piece.
+    void BuildAdjacency()
+    {
+        int const gcount = m_pos.count();
+        m_adj_begin.resize(gcount, 0);
+        m_adj_end.resize(gcount, 0);
+        for (int i = 0; i < m_corner_group.count(); ++i)
+            m_adj_end[m_corner_group[i]]++;
+        for (int g = 0, offset = 0; g < gcount; ++g)
+        {
+            m_adj_begin[g] = offset;
+            offset += m_adj_end[g];
+            m_adj_end[g] = m_adj_begin[g];
+        }
+
+        m_adj.resize(m_corner_group.count());
+        for (int i = 0; i < m_corner_group.count(); ++i)
+            m_adj[m_adj_end[m_corner_group[i]]++] = i / 3;
+
+        m_chain_next.resize(gcount, -1);
+        m_chain_last.resize(gcount);
+        for (int g = 0; g < gcount; ++g)
+            m_chain_last[g] = g;
+    }
+
+    //Wedge and group of a triangle corner, kept up to date by collapses
+    int Corner(int t, int k) const { return m_tris[3 * t + k]; }
+    int CornerGroup(int t, int k) const { return m_corner_group[3 * t + k]; }
+
+    dvec3 const &Position(int g) const { return m_pos[g]; }
+
+    //Live triangles around a group. Only modifies the adjacency for groups
+    //that absorbed others, so the parallel passes compact those first.
+    void GatherRing(int g, array<int> &ring)
+    {
+        int count = 0;
+        for (int s = g; s >= 0; s = m_chain_next[s])
+            count += m_adj_end[s] - m_adj_begin[s];
+        ring.resize(count);
+
+        int const *adj = m_adj.data();
+        bool const *tri_dead = m_tri_dead.data();
+        int *dst = ring.data();
+        count = 0;
+        for (int s = g; s >= 0; s = m_chain_next[s])
+            for (int i = m_adj_begin[s]; i < m_adj_end[s]; ++i)
+                if (!tri_dead[adj[i]])
+                    dst[count++] = adj[i];
+        ring.resize(count);
+
+        if (m_chain_next[g] >= 0)
+        {
+            m_adj_begin[g] = m_adj.count();
+            for (int i = 0; i < count; ++i)
+                m_adj << dst[i];
+            m_adj_end[g] = m_adj.count();
+            m_chain_next[g] = -1;
+            m_chain_last[g] = g;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    //Find the kind, the quadric and the first best collapse of every
+    //group, the groups outside of the brace staying locked
+    void Classify()
+    {
+        int const gcount = m_pos.count();
+        m_kind.resize(gcount, Locked);
+        m_quadric.resize(gcount);
+        m_best.resize(m_range_groups);
+
+        parallel_for(m_range_groups, SIMPLIFY_THREAD_MIN_GROUPS,
+                     [&](int start, int end)
+        {
+            array<int> ring;
+            array<RingCorner> corners;
+            for (int g = start; g < end; ++g)
+            {
+                ClassifyGroup(g, ring, corners);
+                if (!FindCollapse(g, ring, m_best[g]))
+                    m_best[g].m_from = -1;
+            }
+        });
+    }
+
+    //The corner of a ring triangle that belongs to the group, as wedges
+    //and groups, with the next and previous corners
+    struct RingCorner
+    {
+        int m_w, m_wn, m_wp, m_gn, m_gp;
+    };
+
+    void ClassifyGroup(int g, array<int> &ring, array<RingCorner> &corners)
+    {
+        GatherRing(g, ring);
+
+        corners.resize(ring.count());
+        for (int i = 0; i < ring.count(); ++i)
+        {
+            int const *tg = m_corner_group.data() + 3 * ring[i];
+            int const *tw = m_tris.data() + 3 * ring[i];
+            int k = 0;
+            while (tg[k] != g)
+                ++k;
+            corners[i].m_w = tw[k];
+            corners[i].m_wn = tw[(k + 1) % 3];
+            corners[i].m_wp = tw[(k + 2) % 3];
+            corners[i].m_gn = tg[(k + 1) % 3];
+            corners[i].m_gp = tg[(k + 2) % 3];
+        }
+
+        int wedges = 0, open_out = 0, open_in = 0;
+        int wedge_open[2] = { 0, 0 }, wedge_id[2] = { -1, -1 };
+        bool complex = false;
+
+        dvec3 const p0 = Position(g);
+        for (int i = 0; i < corners.count(); ++i)
+        {
+            int w = corners[i].m_w;
+            int wn = corners[i].m_wn, gn = corners[i].m_gn;
+            int wp = corners[i].m_wp, gp = corners[i].m_gp;
+
+            dvec3 n = cross(Position(gn) - p0, Position(gp) - p0);
+            double area2 = length(n);
+            if (area2 > 0.0)
+            {
+                n /= area2;
+                m_quadric[g].AddPlane(n, -dot(n, p0), 0.5 * area2);
+            }
+
+            int slot = w == wedge_id[0] ? 0 : w == wedge_id[1] ? 1 : -1;
+            if (slot < 0)
+            {
+                if (wedges == 2)
+                    complex = true;
+                else
+                    wedge_id[slot = wedges++] = w;
+            }
+
+            //Look for the opposite of both edges of the triangle
+            int out_count = 0, out_match = 0, in_count = 0, in_match = 0;
+            for (int j = 0; j < corners.count(); ++j)
+            {
+                RingCorner const &u = corners[j];
+                if (j != i && u.m_gn == gn)
+                    complex = true;
+                if (u.m_gp == gn)
+                {
+                    out_count++;
+                    out_match += (u.m_wp == wn && u.m_w == w);
+                }
+                if (u.m_gn == gp)
+                {
+                    in_count++;
+                    in_match += (u.m_wn == wp && u.m_w == w);
+                }
+            }
+
+            if (out_count > 1 || in_count > 1)
+                complex = true;
+            if (slot >= 0)
+                wedge_open[slot] += !out_match + !in_match;
+            open_out += !out_count;
+            open_in += !in_count;
+
+            //Both ends of an open edge get the plane that holds it in place
+            if (!out_count)
+                AddBorderPlane(g, p0, Position(gn), Position(gp));
+            if (!in_count)
+                AddBorderPlane(g, Position(gp), p0, Position(gn));
+        }
+
+        if (complex)
+            m_kind[g] = Locked;
+        else if (wedges == 1 && !open_out && !open_in && !wedge_open[0])
+            m_kind[g] = Manifold;
+        else if (wedges == 1 && open_out == 1 && open_in == 1 && wedge_open[0] == 2)
+            m_kind[g] = Border;
+        else if (wedges == 2 && !open_out && !open_in
+                  && wedge_open[0] == 2 && wedge_open[1] == 2)
+            m_kind[g] = Seam;
+        else
+            m_kind[g] = Locked;
+    }
+
+    //Plane through the edge p0 -> p1, orthogonal to its face p0 p1 p2
+    void AddBorderPlane(int g, dvec3 const &p0, dvec3 const &p1, dvec3 const &p2)
+    {
+        dvec3 e = p1 - p0;
+        dvec3 n = cross(e, cross(e, p2 - p0));
+        double len = length(n);
+        if (len > 0.0)
+        {
+            n /= len;
+            m_quadric[g].AddPlane(n, -dot(n, p0), SIMPLIFY_BORDER_WEIGHT * sqlength(e));
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    bool FindCollapse(int a, array<int> &ring, Collapse &best)
+    {
+        if (m_dead[a] || m_kind[a] == Locked)
+            return false;
+
+        GatherRing(a, ring);
+
+        //Around a manifold group, each neighbour follows it once
+        SimplifyQuadric const &quadric = m_quadric[a];
+        int const steps = m_kind[a] == Manifold ? 2 : 3;
+
+        best.m_from = a;
+        best.m_cost = -1.f;
+        for (int i = 0; i < ring.count(); ++i)
+        {
+            int const *tg = m_corner_group.data() + 3 * ring[i];
+            int k = 0;
+            while (tg[k] != a)
+                ++k;
+
+            for (int n = 1; n < steps; ++n)
+            {
+                int b = tg[(k + n) % 3];
+                if (!CanCollapse(a, b, ring))
+                    continue;
+
+                float cost = (float)quadric.Error(Position(b));
+                if (best.m_cost < 0.f || cost < best.m_cost)
+                {
+                    best.m_cost = cost;
+                    best.m_to = b;
+                }
+            }
+        }
+
+        return best.m_cost >= 0.f;
+    }
+
+    //Whether the kinds allow a -> b, ring being the ring of a
+    bool CanCollapse(int a, int b, array<int> const &ring) const
+    {
+        if (m_kind[a] == Manifold)
+            return true;
+
+        //Border groups only follow open edges, seam groups only follow
+        //edges that have different wedges on each side
+        int count = 0, wa[2] = { -1, -1 }, wb[2] = { -1, -1 };
+        for (int i = 0; i < ring.count(); ++i)
+        {
+            int t = ring[i];
+            for (int k = 0; k < 3; ++k)
+            {
+                if (CornerGroup(t, k) != b)
+                    continue;
+                if (count < 2)
+                {
+                    int ka = CornerGroup(t, (k + 1) % 3) == a ? (k + 1) % 3 : (k + 2) % 3;
+                    wa[count] = Corner(t, ka);
+                    wb[count] = Corner(t, k);
+                }
+                ++count;
+            }
+        }
+
+        if (m_kind[a] == Border)
+            return count == 1;
+        return count == 2 && wa[0] != wa[1] && wb[0] != wb[1];
+    }
+
+    //-------------------------------------------------------------------------
+    //Move a onto b if it keeps the mesh valid. m_neighbours then holds
+    //the groups whose ring changed, b included.
+    bool TryCollapse(int a, int b)
+    {
+        int *tris = m_tris.data(), *corner_group = m_corner_group.data();
+        int *mark = m_mark.data();
+
+        GatherRing(a, m_ring);
+
+        //Every wedge of a goes to the wedge of b it shares a triangle with
+        int pair_count = 0, pairs[4][2];
+        int edge_count = 0;
+        for (int i = 0; i < m_ring.count(); ++i)
+        {
+            int const t3 = 3 * m_ring[i];
+            int ka = -1, kb = -1;
+            for (int k = 0; k < 3; ++k)
+            {
+                int g = corner_group[t3 + k];
+                if (g == a) ka = k;
+                if (g == b) kb = k;
+            }
+            if (ka < 0 || kb < 0)
+                continue;
+
+            ++edge_count;
+            int wa = tris[t3 + ka], wb = tris[t3 + kb], j = 0;
+            while (j < pair_count && pairs[j][0] != wa)
+                ++j;
+            if (j == pair_count)
+            {
+                if (pair_count == 4)
+                    return false;
+                pairs[pair_count][0] = wa;
+                pairs[pair_count++][1] = wb;
+            }
+            else if (pairs[j][1] != wb)
+                return false;
+        }
+
+        dvec3 const pa = Position(a), pb = Position(b);
+        int const seen_a = ++m_mark_stamp, seen_b = ++m_mark_stamp;
+        m_neighbours.empty();
+
+        for (int i = 0; i < m_ring.count(); ++i)
+        {
+            int const t3 = 3 * m_ring[i];
+            int const *g = corner_group + t3;
+            int ka = -1;
+            for (int k = 0; k < 3; ++k)
+            {
+                if (g[k] == a) ka = k;
+                else if (mark[g[k]] != seen_a)
+                {
+                    mark[g[k]] = seen_a;
+                    m_neighbours << g[k];
+                }
+            }
+            if (g[0] == b || g[1] == b || g[2] == b)
+                continue;
+
+            //Unmapped wedges would lose their attributes
+            int wa = tris[t3 + ka], j = 0;
+            while (j < pair_count && pairs[j][0] != wa)
+                ++j;
+            if (j == pair_count)
+                return false;
+
+            //Moving a onto b must not flip the triangle
+            dvec3 const &p1 = Position(g[(ka + 1) % 3]);
+            dvec3 const e = Position(g[(ka + 2) % 3]) - p1;
+            if (dot(cross(p1 - pa, e), cross(p1 - pb, e)) <= 0.0)
+                return false;
+        }
+
+        //Link condition: a and b may only share the apexes of the
+        //triangles on their edge, or the surface would pinch
+        GatherRing(b, m_ring_b);
+        int shared = 0;
+        for (int i = 0; i < m_ring_b.count(); ++i)
+        {
+            int const *g = corner_group + 3 * m_ring_b[i];
+            for (int k = 0; k < 3; ++k)
+            {
+                if (g[k] == a || g[k] == b || mark[g[k]] == seen_b)
+                    continue;
+                shared += mark[g[k]] == seen_a;
+                mark[g[k]] = seen_b;
+            }
+        }
+        if (shared > edge_count)
+            return false;
+
+        //Apply: the edge triangles vanish, the others now use b
+        for (int i = 0; i < m_ring.count(); ++i)
+        {
+            int const t3 = 3 * m_ring[i];
+            int ka = 0;
+            while (corner_group[t3 + ka] != a)
+                ++ka;
+            if (corner_group[t3 + (ka + 1) % 3] == b || corner_group[t3 + (ka + 2) % 3] == b)
+            {
+                m_tri_dead[m_ring[i]] = true;
+                --m_live;
+                continue;
+            }
+
+            int j = 0;
+            while (pairs[j][0] != tris[t3 + ka])
+                ++j;
+            tris[t3 + ka] = pairs[j][1];
+            corner_group[t3 + ka] = b;
+        }
+
+        m_quadric[b].Add(m_quadric[a]);
+        m_dead[a] = true;
+        m_chain_next[m_chain_last[b]] = a;
+        m_chain_last[b] = m_chain_last[a];
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    void Snapshot(array<uint32_t> &indices)
+    {
+        indices.empty();
+        indices.reserve(3 * m_live);
+        for (int t = 0; t < m_tri_dead.count(); ++t)
+            if (!m_tri_dead[t])
+                indices << (uint32_t)Corner(t, 0) << (uint32_t)Corner(t, 1)
+                        << (uint32_t)Corner(t, 2);
+    }
+
+    EasyMesh &m_mesh;
+    int m_vstart, m_istart, m_range_groups, m_live, m_mark_stamp, m_round_stamp;
+
+    //Per group; the groups of vertices outside of the brace are locked
+    array<dvec3> m_pos;
+    array<int> m_adj_begin, m_adj_end, m_chain_next, m_chain_last;
+    array<int> m_mark, m_round;
+    array<bool> m_dead, m_dirty;
+    array<uint8_t> m_kind;
+    array<SimplifyQuadric> m_quadric;
+
+    //Triangles as wedges and groups, and group -> triangles
+    array<int> m_tris, m_corner_group, m_adj;
+    array<bool> m_tri_dead;
+
+    //Best collapse of each group, m_from being -1 if there is none
+    array<Collapse> m_best, m_order;
+    array<int> m_todo, m_bins, m_ring, m_ring_b, m_neighbours;
+};
+
+//-----------------------------------------------------------------------------
+void EasyMesh::Simplify(float ratio)
+{
+    if (BD()->IsEnabled(MeshBuildOperation::CommandRecording))
+    {
+        BD()->CmdStack().AddCmd(EasyMeshCmdType::Simplify);
+        BD()->CmdStack() << ratio;
+        return;
+    }
+
+    MeshSimplifier simplifier(*this);
+    array<int> targets;
+    targets << (int)(lol::clamp(ratio, 0.f, 1.f) * simplifier.TriangleCount());
+    array< array<uint32_t> > levels;
+    simplifier.Run(targets, levels);
+    ReplaceBraceTriangles(levels[0]);
+}
+
+//-----------------------------------------------------------------------------
+void EasyMesh::BuildLods(array<EasyMesh> &lods, int count, float ratio)
+{
+    MeshSimplifier simplifier(*this);
+    array<int> targets;
+    float keep = 1.f;
+    for (int i = 0; i < count; ++i)
+    {
+        keep *= lol::clamp(ratio, 0.f, 1.f);
+        targets << (int)(keep * simplifier.TriangleCount());
+    }
+
+    array< array<uint32_t> > levels;
+    simplifier.Run(targets, levels);
+
+    lods.empty();
+    for (int i = 0; i < count; ++i)
+    {
+        lods.push(EasyMesh(*this));
+        lods.last().ReplaceBraceTriangles(levels[i]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void EasyMesh::ReplaceBraceTriangles(array<uint32_t> const &indices)
+{
+    int const vstart = m_cursors.last().m1;
+    int const istart = m_cursors.last().m2;
+
+    //Keep the brace vertices that are still used, in their current order
+    array<int> vert_ids;
+    vert_ids.resize(m_vert.count(), -1);
+    for (int i = 0; i < indices.count(); ++i)
+        vert_ids[indices[i]] = 0;
+
+    int vcount = vstart;
+    for (int v = vstart; v < m_vert.count(); ++v)
+    {
+        if (vert_ids[v] < 0)
+            continue;
+        vert_ids[v] = vcount;
+        m_vert[vcount++] = m_vert[v];
+    }
+    m_vert.resize(vcount);
+
+    m_indices.resize(istart);
+    m_indices.reserve(istart + indices.count());
+    for (int i = 0; i < indices.count(); ++i)
+        m_indices << (indices[i] < (uint32_t)vstart ? indices[i]
+                                                     : (uint32_t)vert_ids[indices[i]]);
+
+    m_state = MeshRender::NeedConvert;
+    ComputeNormals(istart, m_indices.count() - istart);
+}
+
+} /* namespace lol */
+
@@ -19,6 +19,9 @@
 namespace lol
 {
 
+/* Meshes with fewer vertices than this are deformed on a single thread */
+static int const TRANSFORM_THREAD_MIN_VERTICES = 8192;
+
 //-----------------------------------------------------------------------------
 void EasyMesh::TranslateX(float t) { Translate(vec3(t, 0.f, 0.f)); }
 void EasyMesh::TranslateY(float t) { Translate(vec3(0.f, t, 0.f)); }
@@ -34,8 +37,14 @@ void EasyMesh::Translate(vec3 const &v)
         return;
     }
 
-    for (int i = m_cursors.last().m1; i < m_vert.count(); i++)
-        m_vert[i].m_coord += v;
+    int const start = m_cursors.last().m1;
+    if (start >= m_vert.count())
+        return;
+
+    soa_array<vec3> coords;
+    coords.load(&m_vert[start].m_coord, m_vert.count() - start, sizeof(VertexData));
+    translate_points(v, coords, coords);
+    coords.store(&m_vert[start].m_coord, sizeof(VertexData));
 }
 
 //-----------------------------------------------------------------------------
@@ -53,12 +62,18 @@ void EasyMesh::Rotate(float degrees, vec3 const &axis)
         return;
     }
 
+    int const start = m_cursors.last().m1;
+    if (start >= m_vert.count())
+        return;
+
     mat3 m = mat3::rotate(radians(degrees), axis);
-    for (int i = m_cursors.last().m1; i < m_vert.count(); i++)
-    {
-        m_vert[i].m_coord  = m * m_vert[i].m_coord;
-        m_vert[i].m_normal = m * m_vert[i].m_normal;
-    }
+    soa_array<vec3> coords, normals;
+    coords.load(&m_vert[start].m_coord, m_vert.count() - start, sizeof(VertexData));
+    normals.load(&m_vert[start].m_normal, m_vert.count() - start, sizeof(VertexData));
+    transform_vectors(m, coords, coords);
+    transform_vectors(m, normals, normals);
+    coords.store(&m_vert[start].m_coord, sizeof(VertexData));
+    normals.store(&m_vert[start].m_normal, sizeof(VertexData));
 }
 
 //-----------------------------------------------------------------------------
@@ -71,15 +86,51 @@ void EasyMesh::RadialJitter(float r)
         return;
     }
 
+    /* Vertices closer than 0.1 on every axis to an earlier unwelded vertex
+     * are welded to the first such vertex. Unwelded vertices are kept in a
+     * hash grid of 0.2 wide cells, so only the 27 cells around a vertex
+     * need to be searched. */
+    int const start = m_cursors.last().m1;
+    int const count = max(m_vert.count() - start, 0);
+
+    int bucket_count = 1;
+    while (bucket_count < count)
+        bucket_count *= 2;
+    array<int> buckets, next;
+    buckets.resize(bucket_count, -1);
+    next.resize(count, -1);
+
+    auto cell_of = [](vec3 const &coord)
+    {
+        vec3 c = clamp(coord / 0.2f, -1e9f, 1e9f);
+        return ivec3((int)floor(c.x), (int)floor(c.y), (int)floor(c.z));
+    };
+    auto bucket_of = [bucket_count](ivec3 const &cell)
+    {
+        uint32_t h = (uint32_t)cell.x * 73856093u
+                   ^ (uint32_t)cell.y * 19349663u
+                   ^ (uint32_t)cell.z * 83492791u;
+        return (int)(h & (uint32_t)(bucket_count - 1));
+    };
+
     array<int> welded;
-    welded.push(-1);
-    for (int i = m_cursors.last().m1 + 1; i < m_vert.count(); i++)
+    welded.resize(count, -1);
+    for (int k = 0; k < count; k++)
     {
-        int j, k;
-        for (j = m_cursors.last().m1, k = 0; j < i; j++, k++)
+        int i = start + k;
+        ivec3 cell = cell_of(m_vert[i].m_coord);
+
+        int best = i;
+        for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
         {
-            if(welded[k] < 0)
+            for (int l = buckets[bucket_of(cell + ivec3(dx, dy, dz))]; l >= 0; l = next[l])
             {
+                int j = start + l;
+                if (j >= best)
+                    continue;
+
                 vec3 diff = m_vert[i].m_coord - m_vert[j].m_coord;
 
                 if(diff.x > 0.1f || diff.x < -0.1f)
@@ -91,11 +142,20 @@ void EasyMesh::RadialJitter(float r)
                 if(diff.z > 0.1f || diff.z < -0.1f)
                     continue;
 
-                break;
+                best = j;
             }
         }
 
-        welded.push(j != i ? j : -1);
+        if (best != i)
+        {
+            welded[k] = best;
+        }
+        else
+        {
+            int b = bucket_of(cell);
+            next[k] = buckets[b];
+            buckets[b] = k;
+        }
     }
 
     int i, j;
@@ -148,47 +208,54 @@ void EasyMesh::DoMeshTransform(MeshTransform ct, Axis axis0, Axis axis1, float n
         return;
     }
 
-    for (int i = m_cursors.last().m1; i < m_vert.count(); i++)
+    int const start = m_cursors.last().m1;
+    int const a0 = axis0.ToScalar();
+    int const a1 = (a0 + 1) % 3;
+    int const a2 = (a0 + 2) % 3;
+
+    /* Twist rotates around axis0, bend around axis1 */
+    int const r0 = ct == MeshTransform::Bend ? axis1.ToScalar() : a0;
+    vec3 rotaxis = vec3(1.f); rotaxis[(r0 + 1) % 3] = .0f; rotaxis[(r0 + 2) % 3] = .0f;
+
+    /* Every vertex is independent, so large meshes are split across
+     * threads; each vertex still goes through the exact same math. */
+    VertexData *vert = m_vert.data();
+    parallel_for(max(m_vert.count() - start, 0), TRANSFORM_THREAD_MIN_VERTICES,
+                 [&](int begin, int end)
     {
         switch (ct.ToScalar())
         {
             case MeshTransform::Taper:
-            {
-                float value = m_vert[i].m_coord[axis0.ToScalar()];
-                if (absolute) value = abs(value);
-                m_vert[i].m_coord[(axis0.ToScalar() + 1) % 3] *= max(0.f, 1.f + (n0 * value + noff));
-                m_vert[i].m_coord[(axis0.ToScalar() + 2) % 3] *= max(0.f, 1.f + (n1 * value + noff));
-                break;
-            }
-            case MeshTransform::Twist:
-            {
-                vec3 rotaxis = vec3(1.f); rotaxis[(axis0.ToScalar() + 1) % 3] = .0f; rotaxis[(axis0.ToScalar() + 2) % 3] = .0f;
-                m_vert[i].m_coord = mat3::rotate(radians(m_vert[i].m_coord[axis0.ToScalar()] * n0 + noff), rotaxis) * m_vert[i].m_coord;
+                for (int i = start + begin; i < start + end; i++)
+                {
+                    float value = vert[i].m_coord[a0];
+                    if (absolute) value = abs(value);
+                    vert[i].m_coord[a1] *= max(0.f, 1.f + (n0 * value + noff));
+                    vert[i].m_coord[a2] *= max(0.f, 1.f + (n1 * value + noff));
+                }
                 break;
-            }
             case MeshTransform::Shear:
-            {
-                float value = m_vert[i].m_coord[axis0.ToScalar()];
-                if (absolute) value = abs(value);
-                m_vert[i].m_coord[(axis0.ToScalar() + 1) % 3] += (n0 * value + noff);
-                m_vert[i].m_coord[(axis0.ToScalar() + 2) % 3] += (n1 * value + noff);
+                for (int i = start + begin; i < start + end; i++)
+                {
+                    float value = vert[i].m_coord[a0];
+                    if (absolute) value = abs(value);
+                    vert[i].m_coord[a1] += (n0 * value + noff);
+                    vert[i].m_coord[a2] += (n1 * value + noff);
+                }
                 break;
-            }
             case MeshTransform::Stretch:
-            {
                 //float value = abs(m_vert[i].m1[axis0.ToScalar()]);
                 //m_vert[i].m1[(axis0.ToScalar() + 1) % 3] += (lol::pow(value, n0) + noff);
                 //m_vert[i].m1[(axis0.ToScalar() + 2) % 3] += (lol::pow(value, n1) + noff);
                 break;
-            }
+            case MeshTransform::Twist:
             case MeshTransform::Bend:
-            {
-                vec3 rotaxis = vec3(1.f); rotaxis[(axis1.ToScalar() + 1) % 3] = .0f; rotaxis[(axis1.ToScalar() + 2) % 3] = .0f;
-                m_vert[i].m_coord = mat3::rotate(radians(m_vert[i].m_coord[axis0.ToScalar()] * n0 + noff), rotaxis) * m_vert[i].m_coord;
+                for (int i = start + begin; i < start + end; i++)
+                    vert[i].m_coord = mat3::rotate(radians(vert[i].m_coord[a0] * n0 + noff), rotaxis) * vert[i].m_coord;
                 break;
-            }
         }
-    }
+    });
+
     ComputeNormals(m_cursors.last().m2, m_indices.count() - m_cursors.last().m2);
 }
 
@@ -206,12 +273,19 @@ void EasyMesh::Scale(vec3 const &s)
         return;
     }
 
-    vec3 const invs = vec3(1) / s;
-
-    for (int i = m_cursors.last().m1; i < m_vert.count(); i++)
+    int const start = m_cursors.last().m1;
+    if (start < m_vert.count())
     {
-        m_vert[i].m_coord *= s;
-        m_vert[i].m_normal = normalize(m_vert[i].m_normal * invs);
+        vec3 const invs = vec3(1) / s;
+
+        soa_array<vec3> coords, normals;
+        coords.load(&m_vert[start].m_coord, m_vert.count() - start, sizeof(VertexData));
+        normals.load(&m_vert[start].m_normal, m_vert.count() - start, sizeof(VertexData));
+        transform_vectors(mat3::scale(s), coords, coords);
+        transform_vectors(mat3::scale(invs), normals, normals);
+        normalize_all(normals, normals);
+        coords.store(&m_vert[start].m_coord, sizeof(VertexData));
+        normals.store(&m_vert[start].m_normal, sizeof(VertexData));
     }
 
     /* Flip winding if the scaling involves mirroring */
@@ -219,7 +293,7 @@ void EasyMesh::Scale(vec3 const &s)
     {
         for (int i = m_cursors.last().m2; i < m_indices.count(); i += 3)
         {
-            uint16_t tmp = m_indices[i + 0];
+            uint32_t tmp = m_indices[i + 0];
             m_indices[i + 0] = m_indices[i + 1];
             m_indices[i + 1] = tmp;
         }
@@ -24,9 +24,16 @@ Image Image::DitherRandom() const
     float *pixels = dst.Lock<PixelFormat::Y_F32>();
     int count = GetSize().x * GetSize().y;
 
-    for (int n = 0; n < count; ++n)
+    /* Generate thresholds in [0,0.5) by blocks */
+    float thresholds[256];
+
+    for (int n = 0; n < count; n += 256)
     {
-        pixels[n] = (pixels[n] > lol::rand(0.5f)) ? 1.f : 0.f;
+        int todo = min(count - n, 256);
+        rng::get().fill(thresholds, todo);
+
+        for (int i = 0; i < todo; ++i)
+            pixels[n + i] = (pixels[n + i] > 0.5f * thresholds[i]) ? 1.f : 0.f;
     }
 
     dst.Unlock(pixels);
@@ -12,27 +12,401 @@
 
 #include <lol/engine-internal.h>
 
+#include <atomic>
+#include <cstring>
+
 #if LOL_USE_FFMPEG
 extern "C"
 {
 #   include <libavformat/avformat.h>
+#   include <libavcodec/avcodec.h>
+#   include <libswscale/swscale.h>
 }
 #endif
 
 namespace lol
 {
 
+/*
+ * Movie codecs: they run on the encoder thread and only ever see
+ * complete RGBA frames of the movie size.
+ */
+
+class MovieCodec
+{
+public:
+    virtual ~MovieCodec() {}
+
+    virtual bool Open(String const &name, ivec2 size, float fps) = 0;
+    virtual bool Encode(u8vec4 const *pixels) = 0;
+    virtual void Close() = 0;
+};
+
+/* Raw RGBA frames, one after the other */
+class RawMovieCodec : public MovieCodec
+{
+public:
+    virtual bool Open(String const &name, ivec2 size, float fps)
+    {
+        UNUSED(fps);
+        m_size = size;
+        m_file.Open(name, FileAccess::Write, true);
+        return m_file.IsValid();
+    }
+
+    virtual bool Encode(u8vec4 const *pixels)
+    {
+        int bytes = m_size.x * m_size.y * (int)sizeof(u8vec4);
+        return m_file.Write((uint8_t const *)pixels, bytes) == bytes;
+    }
+
+    virtual void Close()
+    {
+        m_file.Close();
+    }
+
+private:
+    File m_file;
+    ivec2 m_size;
+};
+
+/* YUV4MPEG2 stream, planar YCbCr 4:4:4 using the BT.601 matrix */
+class Y4mMovieCodec : public MovieCodec
+{
+public:
+    virtual bool Open(String const &name, ivec2 size, float fps)
+    {
+        m_size = size;
+        m_planes.resize(3 * size.x * size.y);
+
+        m_file.Open(name, FileAccess::Write, true);
+        if (!m_file.IsValid())
+            return false;
+
+        /* Express the frame rate as a fraction, exact for integer rates */
+        int num = (int)(fps * 1000.f + 0.5f), den = 1000;
+        while (num % 10 == 0 && den % 10 == 0)
+        {
+            num /= 10;
+            den /= 10;
+        }
+
+        String header = String::format("YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C444\n",
+                                       size.x, size.y, num, den);
+        return m_file.WriteString(header) == header.count();
+    }
+
+    virtual bool Encode(u8vec4 const *pixels)
+    {
+        int const count = m_size.x * m_size.y;
+        uint8_t *y = m_planes.data();
+        uint8_t *u = y + count;
+        uint8_t *v = u + count;
+
+        for (int n = 0; n < count; ++n)
+        {
+            int r = pixels[n].r, g = pixels[n].g, b = pixels[n].b;
+            y[n] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            u[n] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v[n] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+
+        static char const frame[] = "FRAME\n";
+        if (m_file.Write((uint8_t const *)frame, sizeof(frame) - 1)
+                != (int)sizeof(frame) - 1)
+            return false;
+        return m_file.Write(m_planes.data(), m_planes.count())
+                == m_planes.count();
+    }
+
+    virtual void Close()
+    {
+        m_file.Close();
+    }
+
+private:
+    File m_file;
+    ivec2 m_size;
+    array<uint8_t> m_planes;
+};
+
 #if LOL_USE_FFMPEG
 static bool g_ready = false;
+
+/* Anything libavformat can guess from the file name */
+class FfmpegMovieCodec : public MovieCodec
+{
+public:
+    virtual bool Open(String const &name, ivec2 size, float fps)
+    {
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+        if (!g_ready)
+        {
+            g_ready = true;
+            av_register_all();
+        }
 #endif
 
+        avformat_alloc_output_context2(&m_fmt_ctx, nullptr, nullptr, name.C());
+        if (!m_fmt_ctx)
+            avformat_alloc_output_context2(&m_fmt_ctx, nullptr, "mpeg", name.C());
+        if (!m_fmt_ctx)
+            return false;
+
+        AVCodec const *codec = avcodec_find_encoder(m_fmt_ctx->oformat->video_codec);
+        if (!codec)
+            return false;
+
+        m_stream = avformat_new_stream(m_fmt_ctx, nullptr);
+        m_cod_ctx = avcodec_alloc_context3(codec);
+        if (!m_stream || !m_cod_ctx)
+            return false;
+
+        /* Most codecs require even dimensions for 4:2:0 chroma */
+        m_size = size;
+        m_cod_ctx->width = size.x & ~1;
+        m_cod_ctx->height = size.y & ~1;
+        m_cod_ctx->time_base.num = 1000;
+        m_cod_ctx->time_base.den = (int)(fps * 1000.f + 0.5f);
+        m_cod_ctx->gop_size = 12;
+        m_cod_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+        if (m_fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+            m_cod_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        m_stream->time_base = m_cod_ctx->time_base;
+
+        if (avcodec_open2(m_cod_ctx, codec, nullptr) < 0)
+            return false;
+        if (avcodec_parameters_from_context(m_stream->codecpar, m_cod_ctx) < 0)
+            return false;
+
+        m_frame = av_frame_alloc();
+        m_packet = av_packet_alloc();
+        if (!m_frame || !m_packet)
+            return false;
+        m_frame->format = m_cod_ctx->pix_fmt;
+        m_frame->width = m_cod_ctx->width;
+        m_frame->height = m_cod_ctx->height;
+        if (av_frame_get_buffer(m_frame, 0) < 0)
+            return false;
+
+        m_sws_ctx = sws_getContext(size.x, size.y, AV_PIX_FMT_RGBA,
+                                   m_cod_ctx->width, m_cod_ctx->height,
+                                   m_cod_ctx->pix_fmt, SWS_BICUBIC,
+                                   nullptr, nullptr, nullptr);
+        if (!m_sws_ctx)
+            return false;
+
+        if (!(m_fmt_ctx->oformat->flags & AVFMT_NOFILE))
+            if (avio_open(&m_fmt_ctx->pb, name.C(), AVIO_FLAG_WRITE) < 0)
+                return false;
+
+        if (avformat_write_header(m_fmt_ctx, nullptr) < 0)
+            return false;
+
+        m_header_written = true;
+        return true;
+    }
+
+    virtual bool Encode(u8vec4 const *pixels)
+    {
+        if (av_frame_make_writable(m_frame) < 0)
+            return false;
+
+        uint8_t const *src[1] = { (uint8_t const *)pixels };
+        int const pitch[1] = { m_size.x * (int)sizeof(u8vec4) };
+        sws_scale(m_sws_ctx, src, pitch, 0, m_size.y,
+                  m_frame->data, m_frame->linesize);
+        m_frame->pts = m_pts++;
+
+        return Send(m_frame);
+    }
+
+    virtual void Close()
+    {
+        if (m_header_written)
+        {
+            Send(nullptr); /* Flush delayed frames */
+            av_write_trailer(m_fmt_ctx);
+        }
+
+        if (m_sws_ctx)
+            sws_freeContext(m_sws_ctx);
+        av_packet_free(&m_packet);
+        av_frame_free(&m_frame);
+        avcodec_free_context(&m_cod_ctx);
+
+        if (m_fmt_ctx)
+        {
+            if (!(m_fmt_ctx->oformat->flags & AVFMT_NOFILE) && m_fmt_ctx->pb)
+                avio_closep(&m_fmt_ctx->pb);
+            avformat_free_context(m_fmt_ctx);
+        }
+
+        m_sws_ctx = nullptr;
+        m_fmt_ctx = nullptr;
+        m_stream = nullptr;
+        m_header_written = false;
+    }
+
+private:
+    bool Send(AVFrame *frame)
+    {
+        if (avcodec_send_frame(m_cod_ctx, frame) < 0)
+            return false;
+
+        while (avcodec_receive_packet(m_cod_ctx, m_packet) == 0)
+        {
+            av_packet_rescale_ts(m_packet, m_cod_ctx->time_base,
+                                 m_stream->time_base);
+            m_packet->stream_index = m_stream->index;
+            if (av_interleaved_write_frame(m_fmt_ctx, m_packet) < 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    AVFormatContext *m_fmt_ctx = nullptr;
+    AVStream *m_stream = nullptr;
+    AVCodecContext *m_cod_ctx = nullptr;
+    AVFrame *m_frame = nullptr;
+    AVPacket *m_packet = nullptr;
+    SwsContext *m_sws_ctx = nullptr;
+    ivec2 m_size;
+    int64_t m_pts = 0;
+    bool m_header_written = false;
+};
+#endif
+
+/*
+ * Movie implementation class
+ */
+
 class MovieData
 {
+    friend class Movie;
+
+    /* Number of frames that can wait for the encoder before we drop */
+    static int const RING_SIZE = 8;
+
+    MovieData(String const &name, ivec2 size, float fps)
+      : m_size(size),
+        m_pending(0),
+        m_write(0),
+        m_frames(0),
+        m_dropped(0),
+        m_locked(false)
+    {
+        String ext = name.sub(name.last_index_of('.') + 1);
+        ext.to_lower();
+
+        if (ext == "raw")
+            m_codec = new RawMovieCodec();
+        else if (ext == "y4m")
+            m_codec = new Y4mMovieCodec();
+        else
 #if LOL_USE_FFMPEG
+            m_codec = new FfmpegMovieCodec();
+#else
+            m_codec = new Y4mMovieCodec();
+#endif
+
+        m_valid = size.x > 0 && size.y > 0 && m_codec->Open(name, size, fps);
+        if (!m_valid)
+        {
+            msg::error("could not open movie “%s” for writing\n", name.C());
+            m_codec->Close();
+            return;
+        }
+
+        /* Allocate all frame buffers once and for all */
+        for (auto &frame : m_ring)
+            frame.resize(size.x * size.y);
 
+#if LOL_FEATURE_THREADS
+        m_thread = new thread(std::bind(&MovieData::EncoderThread,
+                                        this, std::placeholders::_1));
 #endif
+    }
 
-    friend class Movie;
+    ~MovieData()
+    {
+        if (m_valid)
+        {
+#if LOL_FEATURE_THREADS
+            /* Let the encoder drain the ring, then wait for it */
+            m_queue.push(-1);
+            delete m_thread;
+#endif
+            m_codec->Close();
+        }
+
+        delete m_codec;
+    }
+
+    u8vec4 *Lock()
+    {
+        ASSERT(!m_locked, "movie frame is already locked");
+
+        if (!m_valid || m_pending.load() >= RING_SIZE)
+        {
+            ++m_dropped;
+            return nullptr;
+        }
+
+        m_locked = true;
+        return m_ring[m_write].data();
+    }
+
+    void Unlock(u8vec4 const *pixels)
+    {
+        ASSERT(m_locked, "movie frame was not locked");
+        ASSERT(pixels == m_ring[m_write].data());
+        UNUSED(pixels);
+
+        int slot = m_write;
+        m_write = (m_write + 1) % RING_SIZE;
+        m_locked = false;
+        ++m_frames;
+
+#if LOL_FEATURE_THREADS
+        /* The queue never fills up because at most RING_SIZE frames are
+         * pending, so this only contends briefly with the encoder. */
+        ++m_pending;
+        m_queue.push(slot);
+#else
+        m_codec->Encode(m_ring[slot].data());
+#endif
+    }
+
+#if LOL_FEATURE_THREADS
+    void EncoderThread(thread *inst)
+    {
+        UNUSED(inst);
+
+        /* Frames arrive in ring order, so the slot index is all we need */
+        for (int slot = m_queue.pop(); slot >= 0; slot = m_queue.pop())
+        {
+            m_codec->Encode(m_ring[slot].data());
+            --m_pending;
+        }
+    }
+#endif
+
+private:
+    ivec2 m_size;
+    MovieCodec *m_codec;
+    bool m_valid;
+
+    array<u8vec4> m_ring[RING_SIZE];
+    std::atomic<int> m_pending;
+    int m_write, m_frames, m_dropped;
+    bool m_locked;
+
+#if LOL_FEATURE_THREADS
+    queue<int, RING_SIZE + 1> m_queue;
+    thread *m_thread;
+#endif
 };
 
 /*
@@ -40,31 +414,68 @@ class MovieData
  */
 
 Movie::Movie(String const &name, ivec2 size, float fps)
-  : m_data(new MovieData())
+  : m_data(new MovieData(name, size, fps))
 {
-#if LOL_USE_FFMPEG
-    if (!g_ready)
-    {
-        g_ready = true;
-        av_register_all();
-    }
-#endif
 }
 
 Movie::~Movie()
 {
-#if LOL_USE_FFMPEG
+    delete m_data;
+}
 
-#endif
+bool Movie::Feed(Image const &image)
+{
+    ivec2 const size = image.GetSize();
+    u8vec4 *dst = Lock();
+    if (!dst)
+        return false;
 
-    delete m_data;
+    /* XXX: Lock() is not const because it may convert the pixel format,
+     * but it does not change the image contents. */
+    Image &src = const_cast<Image &>(image);
+    u8vec4 const *pixels = src.Lock<PixelFormat::RGBA_8>();
+
+    /* Copy the overlapping area and clear the rest */
+    ivec2 const common = min(size, m_data->m_size);
+    if (common != m_data->m_size)
+        memset((void *)dst, 0, m_data->m_size.x * m_data->m_size.y * sizeof(u8vec4));
+    for (int j = 0; j < common.y; ++j)
+        memcpy((void *)(dst + j * m_data->m_size.x), pixels + j * size.x,
+               common.x * sizeof(u8vec4));
+
+    src.Unlock(pixels);
+    Unlock(dst);
+    return true;
 }
 
-void Movie::Feed(Image const &image)
+u8vec4 *Movie::Lock()
 {
-#if LOL_USE_FFMPEG
+    return m_data->Lock();
+}
 
-#endif
+void Movie::Unlock(u8vec4 const *pixels)
+{
+    m_data->Unlock(pixels);
+}
+
+ivec2 Movie::GetSize() const
+{
+    return m_data->m_size;
+}
+
+bool Movie::IsValid() const
+{
+    return m_data->m_valid;
+}
+
+int Movie::GetFrameCount() const
+{
+    return m_data->m_frames;
+}
+
+int Movie::GetDroppedCount() const
+{
+    return m_data->m_dropped;
 }
 
 } /* namespace lol */
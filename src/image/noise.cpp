@@ -22,11 +22,12 @@ bool Image::RenderRandom(ivec2 size)
     SetSize(size);
     vec4 *pixels = Lock<PixelFormat::RGBA_F32>();
 
-    for (int n = 0; n < size.x * size.y; ++n)
-        pixels[n] = vec4(lol::rand(1.f),
-                         lol::rand(1.f),
-                         lol::rand(1.f),
-                         1.f);
+    int count = size.x * size.y;
+
+    /* Fill all four channels at once, then reset alpha */
+    rng::get().fill(&pixels[0].r, 4 * (size_t)count);
+    for (int n = 0; n < count; ++n)
+        pixels[n].a = 1.f;
 
     Unlock(pixels);
 
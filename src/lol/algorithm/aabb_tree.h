@@ -14,8 +14,10 @@
 #pragma once
 
 #include <lol/base/array.h>
+#include <lol/base/map.h>
 #include <lol/debug/lines.h>
 #include <lol/image/color.h>
+#include <lol/math/raybatch.h>
 
 namespace lol
 {
@@ -24,6 +26,7 @@ namespace lol
 template <typename TE, typename TV, typename TB, size_t child_nb> class AABBTree;
 template <typename TE> class Quadtree;
 template <typename TE> class Octree;
+template <typename TE, typename TV, typename TB> class DynamicAABBTree;
 
 //--
 namespace Debug {
@@ -158,6 +161,8 @@ class AABBTree
     {
         TE*             m_element;
         array<int>      m_leaves;
+        //Last query that returned this element
+        uint32_t        m_stamp;
 
         inline bool operator==(const TE*& element) { return m_element == element; }
     };
@@ -167,6 +172,7 @@ public:
     {
         m_max_depth = 1;
         m_max_element = 1;
+        m_query_stamp = 0;
         AddLeaf(0);
     }
     ~AABBTree()
@@ -212,17 +218,20 @@ private:
     //--
     void RemoveElement(TE* element)
     {
-        int idx = INDEX_NONE;
-        for (int i = 0; i < m_elements.count(); ++i)
-            if (m_elements[i].m_element == element)
-                idx = i;
-
-        if (idx == INDEX_NONE)
+        int64_t key = (int64_t)(intptr_t)element;
+        if (!m_element_ids.has_key(key))
             return;
+        int idx = m_element_ids[key];
 
         //Remove item from tree leaves
         for (int i = 0; i < m_elements[idx].m_leaves.count(); i++)
-            m_tree[m_elements[idx].m_leaves[i]].m_elements.removeItem(idx);
+            m_tree[m_elements[idx].m_leaves[i]].m_elements.remove_item(idx);
+        m_elements[idx].m_leaves.empty();
+        m_elements[idx].m_element = nullptr;
+        //The other ids must remain valid, so the slot is only recycled by
+        //the next element added
+        m_free_elements << idx;
+        m_element_ids.remove(key);
 
         //Try leaves cleanup
         CleanupEmptyLeaves();
@@ -230,15 +239,25 @@ private:
     //--
     int AddElement(TE* element)
     {
-        for (int i = 0; i < m_elements.count(); ++i)
-            if (m_elements[i].m_element == element)
-                return i;
+        int64_t key = (int64_t)(intptr_t)element;
+        if (m_element_ids.has_key(key))
+            return m_element_ids[key];
 
         TreeElement new_element;
         new_element.m_element = element;
         new_element.m_leaves = array<int>();
-        m_elements << new_element;
-        return m_elements.count() - 1;
+        new_element.m_stamp = 0;
+
+        int idx = m_elements.count();
+        if (m_free_elements.count())
+        {
+            idx = m_free_elements.pop();
+            m_elements[idx] = new_element;
+        }
+        else
+            m_elements << new_element;
+        m_element_ids[key] = idx;
+        return idx;
     }
     //--
     int AddLeaf(int parent)
@@ -255,25 +274,59 @@ private:
     }
 
     //--
+    //Not reentrant: the traversal stack and the element stamps belong to
+    //the tree, so two threads must not query the same tree at once
     bool TestLeaf(int leaf, const TB& leaf_bb, const TB& test_bb, array<TE*>& elements)
     {
+        //Elements can be in several leaves: the ones already returned by
+        //this query, or already in the list, carry the current stamp
+        if (++m_query_stamp == 0)
+        {
+            for (int i = 0; i < m_elements.count(); ++i)
+                m_elements[i].m_stamp = 0;
+            m_query_stamp = 1;
+        }
+        for (int i = 0; i < elements.count(); ++i)
+        {
+            int64_t key = (int64_t)(intptr_t)elements[i];
+            if (m_element_ids.has_key(key))
+                m_elements[m_element_ids[key]].m_stamp = m_query_stamp;
+        }
+
         bool result = false;
-        if (TestAABBVsAABB(leaf_bb, test_bb))
+        m_stack.empty();
+        m_stack.push(leaf, leaf_bb);
+        while (m_stack.count())
         {
-            NodeLeaf& node = m_tree[leaf];
-            for (size_t i = 0; i < child_nb; ++i)
+            int node_id = m_stack.last().m1;
+            TB node_bb = m_stack.last().m2;
+            m_stack.remove(m_stack.count() - 1);
+
+            if (!TestAABBVsAABB(node_bb, test_bb))
+                continue;
+
+            //Children go on the stack last first, to be visited in order
+            NodeLeaf& node = m_tree[node_id];
+            bool has_empty_child = false;
+            for (int i = (int)child_nb; i--; )
             {
                 if (node.m_children[i] != 0)
-                {
-                    TB sub_aabb = GetSubAABB(leaf_bb, (int)i);
-                    result = result | TestLeaf(node.m_children[i], sub_aabb, test_bb, elements);
-                }
+                    m_stack.push(node.m_children[i], GetSubAABB(node_bb, i));
                 else
+                    has_empty_child = true;
+            }
+
+            if (has_empty_child)
+            {
+                for (int j = 0; j < node.m_elements.count(); j++)
                 {
-                    for (int j = 0; j < node.m_elements.count(); j++)
-                        elements.push_unique(m_elements[node.m_elements[j]].m_element);
-                    result = true;
+                    TreeElement& element = m_elements[node.m_elements[j]];
+                    if (element.m_stamp == m_query_stamp)
+                        continue;
+                    element.m_stamp = m_query_stamp;
+                    elements.push(element.m_element);
                 }
+                result = true;
             }
         }
         return result;
@@ -328,11 +381,14 @@ private:
 public:
     void                RegisterElement(TE* element)                        { RegisterElement(element, 0, GetAABB(), 0); }
     void                UnregisterElement(TE* element)                      { RemoveElement(element); }
+    //Queries modify the tree's query state, see TestLeaf()
     bool                FindElements(const TB& bbox, array<TE*>& elements)  { return TestLeaf(0, GetAABB(), bbox, elements); }
     void                Clear()
     {
         m_tree.empty();
         m_elements.empty();
+        m_free_elements.empty();
+        m_element_ids.empty();
     }
 
     //--
@@ -368,6 +424,10 @@ protected:
     array<NodeLeaf>     m_tree;         //actual tree
     array<TreeElement>  m_elements;     //elements to leaves
     array<int>          m_free_leaves;  //leaves removed from tree
+    array<int>          m_free_elements; //m_elements slots of removed elements
+    map<int64_t, int>   m_element_ids;  //element pointer to m_elements index
+    array<int, TB>      m_stack;        //query traversal stack
+    uint32_t            m_query_stamp;  //current query, for deduplication
     TV                  m_size;         //Main tree size
     int                 m_max_depth;    //Maximum depth possible
     int                 m_max_element;  //Maximum element per leaf
@@ -398,5 +458,555 @@ protected:
     virtual vec3        GetSubOffset(int sub) { return vec3(ivec3(sub % 2, sub / 4, (sub % 4) / 2)); }
 };
 
-} /* namespace lol */
+//--
+//Surface area heuristic cost of a box: its perimeter in 2D, half its area
+//in 3D. Only ratios between boxes matter.
+static inline float AABBCost(box2 const &bbox)
+{
+    vec2 e = bbox.extent();
+    return e.x + e.y;
+}
+
+static inline float AABBCost(box3 const &bbox)
+{
+    vec3 e = bbox.extent();
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+template <typename TB>
+static inline TB AABBUnion(TB const &b1, TB const &b2)
+{
+    return TB(min(b1.aa, b2.aa), max(b1.bb, b2.bb));
+}
+
+template <typename TB>
+static inline bool AABBContains(TB const &outer, TB const &inner)
+{
+    return outer.aa == min(outer.aa, inner.aa) && outer.bb == max(outer.bb, inner.bb);
+}
+
+//--
+//Bounding volume hierarchy for moving elements. Each element gets its own
+//leaf, whose "fat" box is larger than the element so that small moves do
+//not touch the tree, and the tree stays balanced through local rotations
+//as leaves come and go. Build() creates a whole tree with the surface area
+//heuristic, which gives better trees than one insertion per element.
+//Leaves are identified by the proxy returned when adding the element.
+template <typename TE, typename TV, typename TB>
+class DynamicAABBTree
+{
+    struct Node
+    {
+        TB              m_aabb;
+        //Actual box of the element, for leaves
+        TB              m_tight;
+        TE*             m_element;
+        //Parent node, or next free node
+        int             m_parent;
+        int             m_children[2];
+        //Leaves are at height 0, free nodes at -1
+        int             m_height;
+
+        bool IsLeaf() const { return m_children[0] < 0; }
+    };
+
+public:
+    DynamicAABBTree()
+    {
+        m_root = -1;
+        m_free = -1;
+        m_count = 0;
+        m_margin = .1f;
+    }
+
+    //--
+    int Insert(TE* element, TB const& bbox)
+    {
+        int proxy = AllocateLeaf(element, bbox);
+        InsertLeaf(proxy);
+        return proxy;
+    }
+
+    void Remove(int proxy)
+    {
+        ASSERT(proxy >= 0 && proxy < m_nodes.count() && m_nodes[proxy].m_height == 0,
+               "invalid proxy %d", proxy);
+        RemoveLeaf(proxy);
+        FreeNode(proxy);
+        --m_count;
+    }
+
+    //Update the box of an element. The tree only changes when the new box
+    //leaves the fat one, in which case the new fat box also extends in
+    //the direction of the expected displacement. Returns true if the tree
+    //changed.
+    bool Move(int proxy, TB const& bbox, TV const& displacement = TV(0.f))
+    {
+        Node& leaf = m_nodes[proxy];
+        leaf.m_tight = bbox;
+        if (AABBContains(leaf.m_aabb, bbox))
+            return false;
+
+        RemoveLeaf(proxy);
+        TB fat(bbox.aa - TV(m_margin), bbox.bb + TV(m_margin));
+        fat.aa += min(displacement, TV(0.f));
+        fat.bb += max(displacement, TV(0.f));
+        m_nodes[proxy].m_aabb = fat;
+        InsertLeaf(proxy);
+        return true;
+    }
+
+    //Replace the whole tree with one built from the given elements, the
+    //proxy of each one going to proxies
+    void Build(array<TE*, TB> const& elements, array<int>& proxies)
+    {
+        Clear();
+        proxies.resize(elements.count());
+        for (int i = 0; i < elements.count(); ++i)
+            proxies[i] = AllocateLeaf(elements[i].m1, elements[i].m2);
+        if (!elements.count())
+            return;
+
+        array<int> leaves = proxies;
+        array<TV> centers;
+        centers.resize(m_nodes.count());
+        for (int i = 0; i < leaves.count(); ++i)
+            centers[leaves[i]] = m_nodes[leaves[i]].m_aabb.center();
+
+        m_root = BuildRange(leaves.data(), leaves.count(), centers);
+        m_nodes[m_root].m_parent = -1;
+    }
+
+    void Clear()
+    {
+        m_nodes.empty();
+        m_root = -1;
+        m_free = -1;
+        m_count = 0;
+    }
+
+    //--
+    bool FindElements(TB const& bbox, array<TE*>& elements) const
+    {
+        int found = 0;
+        Traverse(bbox, [&](int proxy)
+        {
+            elements.push(m_nodes[proxy].m_element);
+            ++found;
+        });
+        return found > 0;
+    }
+
+    bool FindProxies(TB const& bbox, array<int>& proxies) const
+    {
+        int found = 0;
+        Traverse(bbox, [&](int proxy)
+        {
+            proxies.push(proxy);
+            ++found;
+        });
+        return found > 0;
+    }
+
+    //Cast the rays of a batch through the elements: test(element, origin,
+    //dir, tmax) returns the distance along dir where the ray hits the
+    //element, or a negative value, and may be called from several threads.
+    //The hits of the batch are proxies.
+    template<typename F>
+    void CastRays(RayBatch& rays, RayQuery query, F const& test) const
+    {
+        struct Context
+        {
+            DynamicAABBTree const* m_tree;
+            F const* m_test;
+        } ctx = { this, &test };
+
+        array<RayBatchNode> nodes;
+        Flatten(nodes);
+        rays.Intersect(nodes, query, [](void const* data, int proxy,
+                                        vec3 const& origin, vec3 const& dir, float tmax) -> float
+        {
+            Context const* context = static_cast<Context const*>(data);
+            return (*context->m_test)(context->m_tree->m_nodes[proxy].m_element, origin, dir, tmax);
+        }, &ctx);
+    }
+
+    //Copy the tree to the layout RayBatch uses, each leaf holding its
+    //proxy and tight box
+    void Flatten(array<RayBatchNode>& nodes) const
+    {
+        nodes.empty();
+        if (m_root < 0)
+            return;
+
+        //Pairs of source node and destination index
+        array<int> stack;
+        nodes.reserve(2 * m_count - 1);
+        nodes.push(RayBatchNode());
+        stack << m_root << 0;
+        while (stack.count())
+        {
+            int dst = stack.pop();
+            Node const& node = m_nodes[stack.pop()];
+            if (node.IsLeaf())
+            {
+                RayBatchNode leaf = { node.m_tight.aa, (int32_t)(&node - m_nodes.data()), node.m_tight.bb, 1 };
+                nodes[dst] = leaf;
+                continue;
+            }
+
+            int first = nodes.count();
+            RayBatchNode inner = { node.m_aabb.aa, first, node.m_aabb.bb, 0 };
+            nodes[dst] = inner;
+            nodes.resize(first + 2);
+            stack << node.m_children[0] << first << node.m_children[1] << first + 1;
+        }
+    }
+
+    //--
+    TE*                 GetElement(int proxy) const     { return m_nodes[proxy].m_element; }
+    TB const&           GetAABB(int proxy) const        { return m_nodes[proxy].m_tight; }
+    TB const&           GetFatAABB(int proxy) const     { return m_nodes[proxy].m_aabb; }
+    int                 GetCount() const                { return m_count; }
+    int                 GetHeight() const               { return m_root < 0 ? 0 : m_nodes[m_root].m_height; }
+    float               GetMargin() const               { return m_margin; }
+    void                SetMargin(float margin)         { m_margin = margin; }
+
+    //Sum of the costs of the inner nodes, relative to the root: the
+    //expected number of nodes a query visits, up to a constant
+    float GetCost() const
+    {
+        if (m_root < 0 || m_nodes[m_root].IsLeaf())
+            return 0.f;
+
+        float cost = 0.f;
+        for (int i = 0; i < m_nodes.count(); ++i)
+            if (m_nodes[i].m_height > 0)
+                cost += AABBCost(m_nodes[i].m_aabb);
+        return cost / AABBCost(m_nodes[m_root].m_aabb);
+    }
+
+private:
+    //--
+    int AllocateNode()
+    {
+        int idx = m_free;
+        if (idx >= 0)
+            m_free = m_nodes[idx].m_parent;
+        else
+        {
+            idx = m_nodes.count();
+            m_nodes.push(Node());
+        }
+
+        Node& node = m_nodes[idx];
+        node.m_element = nullptr;
+        node.m_parent = -1;
+        node.m_children[0] = node.m_children[1] = -1;
+        node.m_height = 0;
+        return idx;
+    }
+
+    void FreeNode(int idx)
+    {
+        m_nodes[idx].m_parent = m_free;
+        m_nodes[idx].m_height = -1;
+        m_free = idx;
+    }
 
+    int AllocateLeaf(TE* element, TB const& bbox)
+    {
+        int idx = AllocateNode();
+        Node& leaf = m_nodes[idx];
+        leaf.m_element = element;
+        leaf.m_tight = bbox;
+        leaf.m_aabb = TB(bbox.aa - TV(m_margin), bbox.bb + TV(m_margin));
+        ++m_count;
+        return idx;
+    }
+
+    //--
+    //Walk down to the sibling that grows the tree cost the least, as in
+    //Box2D, then refit and rotate on the way back up
+    void InsertLeaf(int leaf)
+    {
+        if (m_root < 0)
+        {
+            m_root = leaf;
+            m_nodes[leaf].m_parent = -1;
+            return;
+        }
+
+        TB const leaf_bb = m_nodes[leaf].m_aabb;
+        int sibling = m_root;
+        while (!m_nodes[sibling].IsLeaf())
+        {
+            Node const& node = m_nodes[sibling];
+            float area = AABBCost(node.m_aabb);
+            float combined = AABBCost(AABBUnion(node.m_aabb, leaf_bb));
+
+            //Making a new parent here, or pushing the leaf further down
+            //and growing this node anyway
+            float cost = 2.f * combined;
+            float inherited = 2.f * (combined - area);
+
+            float child_cost[2];
+            for (int i = 0; i < 2; ++i)
+            {
+                Node const& child = m_nodes[node.m_children[i]];
+                float grown = AABBCost(AABBUnion(child.m_aabb, leaf_bb));
+                child_cost[i] = inherited + (child.IsLeaf() ? grown : grown - AABBCost(child.m_aabb));
+            }
+
+            if (cost < child_cost[0] && cost < child_cost[1])
+                break;
+            sibling = node.m_children[child_cost[0] < child_cost[1] ? 0 : 1];
+        }
+
+        int old_parent = m_nodes[sibling].m_parent;
+        int new_parent = AllocateNode();
+        m_nodes[new_parent].m_parent = old_parent;
+        m_nodes[new_parent].m_children[0] = sibling;
+        m_nodes[new_parent].m_children[1] = leaf;
+        m_nodes[sibling].m_parent = new_parent;
+        m_nodes[leaf].m_parent = new_parent;
+
+        if (old_parent < 0)
+            m_root = new_parent;
+        else
+            m_nodes[old_parent].m_children[m_nodes[old_parent].m_children[0] == sibling ? 0 : 1] = new_parent;
+
+        Refit(new_parent);
+    }
+
+    void RemoveLeaf(int leaf)
+    {
+        if (leaf == m_root)
+        {
+            m_root = -1;
+            return;
+        }
+
+        int parent = m_nodes[leaf].m_parent;
+        int grand_parent = m_nodes[parent].m_parent;
+        int sibling = m_nodes[parent].m_children[m_nodes[parent].m_children[0] == leaf ? 1 : 0];
+
+        m_nodes[sibling].m_parent = grand_parent;
+        FreeNode(parent);
+        if (grand_parent < 0)
+        {
+            m_root = sibling;
+            return;
+        }
+
+        m_nodes[grand_parent].m_children[m_nodes[grand_parent].m_children[0] == parent ? 0 : 1] = sibling;
+        Refit(grand_parent);
+    }
+
+    //Fix boxes and heights from a node up to the root
+    void Refit(int idx)
+    {
+        for (; idx >= 0; idx = m_nodes[idx].m_parent)
+        {
+            UpdateNode(idx);
+            Rotate(idx);
+        }
+    }
+
+    void UpdateNode(int idx)
+    {
+        Node& node = m_nodes[idx];
+        Node const& c0 = m_nodes[node.m_children[0]];
+        Node const& c1 = m_nodes[node.m_children[1]];
+        node.m_aabb = AABBUnion(c0.m_aabb, c1.m_aabb);
+        node.m_height = 1 + lol::max(c0.m_height, c1.m_height);
+    }
+
+    //Swap a child of the node with a grandchild on the other side, if that
+    //makes the other child smaller
+    void Rotate(int idx)
+    {
+        Node const& node = m_nodes[idx];
+        if (node.m_height < 2)
+            return;
+
+        float best_gain = 0.f;
+        int best_side = -1, best_grandchild = -1;
+        for (int side = 0; side < 2; ++side)
+        {
+            //The child that moves down, and the one it moves into
+            Node const& moving = m_nodes[node.m_children[side]];
+            Node const& other = m_nodes[node.m_children[1 - side]];
+            if (other.IsLeaf())
+                continue;
+
+            float area = AABBCost(other.m_aabb);
+            for (int g = 0; g < 2; ++g)
+            {
+                //The grandchild g comes up, its sibling stays with moving
+                TB stays = m_nodes[other.m_children[1 - g]].m_aabb;
+                float gain = area - AABBCost(AABBUnion(moving.m_aabb, stays));
+                if (gain > best_gain)
+                {
+                    best_gain = gain;
+                    best_side = side;
+                    best_grandchild = g;
+                }
+            }
+        }
+
+        if (best_side < 0)
+            return;
+
+        int moving = node.m_children[best_side];
+        int other = node.m_children[1 - best_side];
+        int grandchild = m_nodes[other].m_children[best_grandchild];
+
+        m_nodes[idx].m_children[best_side] = grandchild;
+        m_nodes[grandchild].m_parent = idx;
+        m_nodes[other].m_children[best_grandchild] = moving;
+        m_nodes[moving].m_parent = other;
+
+        UpdateNode(other);
+        UpdateNode(idx);
+    }
+
+    //--
+    //Top-down build with binned SAH splits along every axis
+    int BuildRange(int* leaves, int count, array<TV> const& centers)
+    {
+        if (count == 1)
+            return leaves[0];
+
+        static int const BIN_COUNT = 16;
+        static int const DIMS = (int)(sizeof(TV) / sizeof(float));
+
+        TB center_bb(centers[leaves[0]], centers[leaves[0]]);
+        for (int i = 1; i < count; ++i)
+            center_bb = AABBUnion(center_bb, TB(centers[leaves[i]], centers[leaves[i]]));
+        TV const extent = center_bb.extent();
+
+        float best_cost = 0.f;
+        int best_axis = -1, best_split = 0;
+        for (int axis = 0; axis < DIMS; ++axis)
+        {
+            if (!(extent[axis] > 0.f))
+                continue;
+
+            TB bin_bb[BIN_COUNT];
+            int bin_count[BIN_COUNT] = { 0 };
+            float const scale = BIN_COUNT / extent[axis];
+            for (int i = 0; i < count; ++i)
+            {
+                int bin = lol::min((int)((centers[leaves[i]][axis] - center_bb.aa[axis]) * scale), BIN_COUNT - 1);
+                TB const& bbox = m_nodes[leaves[i]].m_aabb;
+                bin_bb[bin] = bin_count[bin]++ ? AABBUnion(bin_bb[bin], bbox) : bbox;
+            }
+
+            //Cost of the right side of each split, then sweep from the left
+            float right_cost[BIN_COUNT];
+            TB side_bb;
+            int side_count = 0;
+            for (int b = BIN_COUNT - 1; b > 0; --b)
+            {
+                if (bin_count[b])
+                    side_bb = side_count ? AABBUnion(side_bb, bin_bb[b]) : bin_bb[b];
+                side_count += bin_count[b];
+                right_cost[b] = side_count ? side_count * AABBCost(side_bb) : 0.f;
+            }
+
+            side_count = 0;
+            for (int b = 0; b < BIN_COUNT - 1; ++b)
+            {
+                if (bin_count[b])
+                    side_bb = side_count ? AABBUnion(side_bb, bin_bb[b]) : bin_bb[b];
+                side_count += bin_count[b];
+                if (!side_count || side_count == count)
+                    continue;
+
+                float cost = side_count * AABBCost(side_bb) + right_cost[b + 1];
+                if (best_axis < 0 || cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b + 1;
+                }
+            }
+        }
+
+        //All the centres are in the same place: any split will do
+        int middle = count / 2;
+        if (best_axis >= 0)
+        {
+            float const scale = BIN_COUNT / extent[best_axis];
+            float const origin = center_bb.aa[best_axis];
+            int* split = std::partition(leaves, leaves + count, [&](int leaf)
+            {
+                int bin = lol::min((int)((centers[leaf][best_axis] - origin) * scale), BIN_COUNT - 1);
+                return bin < best_split;
+            });
+            middle = (int)(split - leaves);
+        }
+
+        int left = BuildRange(leaves, middle, centers);
+        int right = BuildRange(leaves + middle, count - middle, centers);
+
+        int idx = AllocateNode();
+        m_nodes[idx].m_children[0] = left;
+        m_nodes[idx].m_children[1] = right;
+        m_nodes[left].m_parent = idx;
+        m_nodes[right].m_parent = idx;
+        UpdateNode(idx);
+        return idx;
+    }
+
+    //--
+    //Depth-first traversal calling fn on each leaf whose element box
+    //overlaps bbox. The stack never holds more than height + 1 nodes.
+    template <typename F>
+    void Traverse(TB const& bbox, F const& fn) const
+    {
+        if (m_root < 0)
+            return;
+
+        int fixed_stack[64];
+        array<int> large_stack;
+        int* stack = fixed_stack;
+        if (m_nodes[m_root].m_height + 1 > 64)
+        {
+            large_stack.resize(m_nodes[m_root].m_height + 1);
+            stack = large_stack.data();
+        }
+
+        int size = 0;
+        stack[size++] = m_root;
+        while (size)
+        {
+            int idx = stack[--size];
+            Node const& node = m_nodes[idx];
+            if (!TestAABBVsAABB(node.m_aabb, bbox))
+                continue;
+
+            if (node.IsLeaf())
+            {
+                if (TestAABBVsAABB(node.m_tight, bbox))
+                    fn(idx);
+                continue;
+            }
+
+            stack[size++] = node.m_children[1];
+            stack[size++] = node.m_children[0];
+        }
+    }
+
+    array<Node>         m_nodes;        //leaves, inner and free nodes
+    int                 m_root;         //root node, or -1
+    int                 m_free;         //first free node, or -1
+    int                 m_count;        //element count
+    float               m_margin;       //fat box margin
+};
+
+template <typename TE> using DynamicAABBTree2 = DynamicAABBTree<TE, vec2, box2>;
+template <typename TE> using DynamicAABBTree3 = DynamicAABBTree<TE, vec3, box3>;
+
+} /* namespace lol */
@@ -16,8 +16,18 @@
 // The Movie class
 // ---------------
 //
+// Frames are copied into a small ring of preallocated buffers and encoded
+// by a background thread, so feeding a frame never waits for the encoder.
+// If the encoder falls behind and the ring is full, the frame is dropped.
+//
+// The output format is chosen from the file name extension:
+//  - “.y4m” is a YUV4MPEG2 stream (YCbCr 4:4:4), always available
+//  - “.raw” is a headerless dump of the RGBA pixels, always available
+//  - anything else goes through libavformat when built with FFmpeg,
+//    and falls back to YUV4MPEG2 otherwise
+//
 
-#include <lol/image/movie.h>
+#include <lol/image/image.h>
 
 namespace lol
 {
@@ -34,7 +44,21 @@ public:
 #endif
     ~Movie();
 
-    void Feed(Image const &image);
+    /* Copy an image into the next frame; returns false if it was dropped */
+    bool Feed(Image const &image);
+
+    /* Low level access: get the next free frame buffer (top-down RGBA
+     * rows of GetSize().x pixels) or nullptr if the frame has to be
+     * dropped, then hand it to the encoder using Unlock(). */
+    u8vec4 *Lock();
+    void Unlock(u8vec4 const *pixels);
+
+    ivec2 GetSize() const;
+    bool IsValid() const;
+
+    /* Statistics */
+    int GetFrameCount() const;
+    int GetDroppedCount() const;
 
 private:
     class MovieData *m_data;
@@ -19,8 +19,10 @@
 #include <lol/math/vector.h>
 #include <lol/math/matrix.h>
 #include <lol/math/transform.h>
+#include <lol/math/soa.h>
 #include <lol/math/arraynd.h>
 #include <lol/math/geometry.h>
+#include <lol/math/raybatch.h>
 #include <lol/math/interp.h>
 #include <lol/math/rand.h>
 #include <lol/math/polynomial.h>
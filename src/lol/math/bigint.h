@@ -21,6 +21,7 @@
 
 #include <array>
 #include <cstdint>
+#include <type_traits>
 
 namespace lol
 {
@@ -33,58 +34,90 @@ namespace lol
 #undef log2
 
 /*
- * A bigint stores its digits in an array of integers. The MSB of the
- * integers are unused. The highest used bit is the sign bit.
+ * A bigint stores its digits in an array of unsigned integers and uses
+ * all of their bits. Negative numbers are stored in two’s complement, so
+ * the highest bit of the last digit is the sign bit.
  *
  * Digits are stored in little endian mode.
+ *
+ * Products and divisions need an integer type twice as wide as a digit;
+ * 64-bit digits are only available if the compiler has __int128.
  */
 
+template<typename T> struct bigint_wide {};
+template<> struct bigint_wide<uint8_t>  { typedef uint16_t type; };
+template<> struct bigint_wide<uint16_t> { typedef uint32_t type; };
+template<> struct bigint_wide<uint32_t> { typedef uint64_t type; };
+#if defined __SIZEOF_INT128__
+template<> struct bigint_wide<uint64_t> { typedef unsigned __int128 type; };
+#endif
+
 template<unsigned int N = 16, typename T = uint32_t>
 class bigint
 {
-    static int const bits_per_digit = sizeof(T) * 8 - 1;
-    static T const digit_mask = ~((T)1 << bits_per_digit);
+    static_assert(std::is_unsigned<T>::value, "bigint digits must be unsigned");
+
+    typedef typename bigint_wide<T>::type wide_t;
+
+    static int const bits_per_digit = sizeof(T) * 8;
+    static T const digit_max = T(~T(0));
+
+    /* Below this many digits, Karatsuba is slower than Comba */
+    static int const karatsuba_threshold = 32;
 
 public:
     inline bigint()
     {
     }
 
-    explicit bigint(int32_t x)
+    explicit inline bigint(int32_t x)
+      : bigint((int64_t)x)
     {
-        /* FIXME: doesn’t work if sizeof(T) < sizeof(int32_t) */
-        for (auto &digit : m_digits)
-            digit = x >= 0 ? (T)0 : digit_mask;
-        if (N > 0)
-            m_digits[0] = x & digit_mask;
     }
 
-    explicit bigint(uint32_t x)
+    explicit inline bigint(uint32_t x)
+      : bigint((uint64_t)x)
     {
-        /* FIXME: doesn’t work if sizeof(T) > sizeof(uint32_t) */
-        for (auto &digit : m_digits)
-            digit = (T)0;
-        if (N > 0)
-            m_digits[0] = x & digit_mask;
-        if (N > 1)
-            m_digits[1] = x >> bits_per_digit;
     }
 
-    explicit inline operator uint32_t() const
+    explicit bigint(int64_t x)
     {
-        /* FIXME: doesn’t work if sizeof(T) != sizeof(int32_t) */
-        if (N < 1)
-            return 0;
-        if (N < 2)
-            return (uint32_t)(m_digits[0]
-                               | ((m_digits[0] << 1) & ~digit_mask));
+        set((uint64_t)x, x < 0 ? digit_max : T(0));
+    }
+
+    explicit bigint(uint64_t x)
+    {
+        set(x, T(0));
+    }
+
+    /*
+     * Casts to native integers keep the lowest bits, which is also
+     * correct for negative numbers since they are in two’s complement.
+     */
+    explicit operator uint64_t() const
+    {
+        uint64_t ret = 0;
+        unsigned int bit = 0;
+        for (unsigned int i = 0; i < N && bit < 64; ++i, bit += bits_per_digit)
+            ret |= (uint64_t)m_digits[i] << bit;
+        if (bit < 64 && is_negative())
+            ret |= ~(uint64_t)0 << bit;
+        return ret;
+    }
+
+    explicit inline operator int64_t() const
+    {
+        return (int64_t)(uint64_t)*this;
+    }
 
-        return (uint32_t)(m_digits[0] | (m_digits[1] << bits_per_digit));
+    explicit inline operator uint32_t() const
+    {
+        return (uint32_t)(uint64_t)*this;
     }
 
     inline operator int32_t() const
     {
-        return (int32_t)(uint32_t)*this;
+        return (int32_t)(uint32_t)(uint64_t)*this;
     }
 
     /*
@@ -92,28 +125,25 @@ public:
      * pad the rest (if applicable) with zeroes or ones to extend the
      * sign bit.
      */
-    template<int M>
+    template<unsigned int M>
     explicit bigint(bigint<M,T> const &x)
     {
-        for (unsigned int i = 0; i < (N < M) ? N : M; ++i)
+        for (unsigned int i = 0; i < ((N < M) ? N : M); ++i)
             m_digits[i] = x.m_digits[i];
 
-        if (N > M)
-        {
-            T padding = x.is_negative() ? digit_mask : (T)0;
-            for (unsigned int i = M; i < N; ++i)
-                m_digits[i] = padding;
-        }
+        T padding = x.is_negative() ? digit_max : T(0);
+        for (unsigned int i = M; i < N; ++i)
+            m_digits[i] = padding;
     }
 
     /*
-     * bigint bitwise NOT: we just flip all bits except the unused ones.
+     * bigint bitwise NOT: we just flip all bits.
      */
     bigint<N,T> operator ~() const
     {
         bigint<N,T> ret;
         for (unsigned int i = 0; i < N; ++i)
-            ret.m_digits[i] = m_digits[i] ^ digit_mask;
+            ret.m_digits[i] = T(~m_digits[i]);
         return ret;
     }
 
@@ -162,6 +192,41 @@ public:
         return bigint<N,T>(*this) ^= x;
     }
 
+    /*
+     * bigint shifts: left shifts insert zeroes, right shifts extend
+     * the sign bit.
+     */
+    bigint<N,T> operator <<(int s) const
+    {
+        bigint<N,T> ret;
+        unsigned int const d = (unsigned int)s / bits_per_digit;
+        unsigned int const b = (unsigned int)s % bits_per_digit;
+        for (unsigned int i = 0; i < N; ++i)
+        {
+            T lo = i >= d ? m_digits[i - d] : T(0);
+            T lo2 = i >= d + 1 ? m_digits[i - d - 1] : T(0);
+            ret.m_digits[i] = b ? T((lo << b) | (lo2 >> (bits_per_digit - b)))
+                                : lo;
+        }
+        return ret;
+    }
+
+    bigint<N,T> operator >>(int s) const
+    {
+        bigint<N,T> ret;
+        T padding = is_negative() ? digit_max : T(0);
+        unsigned int const d = (unsigned int)s / bits_per_digit;
+        unsigned int const b = (unsigned int)s % bits_per_digit;
+        for (unsigned int i = 0; i < N; ++i)
+        {
+            T hi = i + d < N ? m_digits[i + d] : padding;
+            T hi2 = i + d + 1 < N ? m_digits[i + d + 1] : padding;
+            ret.m_digits[i] = b ? T((hi >> b) | (hi2 << (bits_per_digit - b)))
+                                : hi;
+        }
+        return ret;
+    }
+
     /*
      * bigint unary plus: a no-op
      */
@@ -179,9 +244,8 @@ public:
         T carry(1);
         for (unsigned int i = 0; i < N; ++i)
         {
-            T digit = (m_digits[i] ^ digit_mask) + carry;
-            ret.m_digits[i] = digit & digit_mask;
-            carry = (digit & ~digit_mask) ? T(1) : T(0);
+            ret.m_digits[i] = T(T(~m_digits[i]) + carry);
+            carry = carry && ret.m_digits[i] == 0 ? T(1) : T(0);
         }
         return ret;
     }
@@ -191,54 +255,71 @@ public:
      * and pad missing digits if one of the two operands is shorter.
      */
     template<unsigned int M>
-    bigint<((N > M) ? N : M), T> operator +(bigint<M,T> const &x) const
+    inline bigint<((N > M) ? N : M), T> operator +(bigint<M,T> const &x) const
     {
-        bigint<((N > M) ? N : M), T> ret;
-        T padding = is_negative() ? digit_mask : (T)0;
-        T x_padding = x.is_negative() ? digit_mask : (T)0;
-        T carry(0);
-        for (unsigned int i = 0; i < ((N > M) ? N : M); ++i)
-        {
-            T digit = (i < N ? m_digits[i] : padding)
-                    + (i < M ? x.m_digits[i] : x_padding)
-                    + carry;
-            ret.m_digits[i] = digit & digit_mask;
-            carry = (digit & ~digit_mask) ? T(1) : T(0);
-        }
-        return ret;
+        return add(x, false);
     }
 
     /*
-     * bigint subtraction: a combination of addition and unary minus;
-     * we add the result of flipping digits and adding one.
-     * FIXME: this could be factored with operator+().
+     * bigint subtraction: we add the result of flipping the digits of
+     * the second operand and adding one.
      */
     template<unsigned int M>
-    bigint<((N > M) ? N : M), T> operator -(bigint<M,T> const &x) const
+    inline bigint<((N > M) ? N : M), T> operator -(bigint<M,T> const &x) const
     {
-        bigint<(N > M) ? N : M, T> ret;
-        T padding = is_negative() ? digit_mask : (T)0;
-        T x_padding = x.is_negative() ? digit_mask : (T)0;
-        T carry(1);
-        for (unsigned int i = 0; i < ((N > M) ? N : M); ++i)
+        return add(x, true);
+    }
+
+    /*
+     * bigint multiplication: the resulting integer has as many digits
+     * as the sum of the two operands. We compute the unsigned product
+     * then fix it for negative operands, since with a two’s complement
+     * a = a’ - 2ⁿ we have a.b = a’.b - b.2ⁿ.
+     */
+    template<unsigned int M>
+    bigint<N + M, T> operator *(bigint<M,T> const &x) const
+    {
+        bigint<N + M, T> ret;
+        T *dst = ret.m_digits.data();
+
+        if (N == M && N >= karatsuba_threshold && N % 2 == 0)
         {
-            T digit = (i < N ? m_digits[i] : padding)
-                    + ((i < M ? x.m_digits[i] : x_padding) ^ digit_mask)
-                    + carry;
-            ret.m_digits[i] = digit & digit_mask;
-            carry = (digit & ~digit_mask) ? T(1) : T(0);
+            std::array<T, 8 * N> scratch;
+            mul_karatsuba(dst, m_digits.data(), x.m_digits.data(), N,
+                          scratch.data());
         }
+        else
+            mul_comba(dst, m_digits.data(), N, x.m_digits.data(), M);
+
+        if (is_negative())
+            sub_digits(dst + N, dst + N, x.m_digits.data(), M);
+        if (x.is_negative())
+            sub_digits(dst + M, dst + M, m_digits.data(), N);
+
         return ret;
     }
 
     /*
-     * bigint multiplication: the resulting integer has as many digits
-     * as the sum of the two operands.
+     * bigint division and modulo: same semantics as C integers, ie. the
+     * quotient is truncated towards zero and the remainder has the sign
+     * of the dividend.
      */
     template<unsigned int M>
-    bigint<N + M, T> operator *(bigint<M,T> const &x) const
+    inline bigint<N,T> operator /(bigint<M,T> const &x) const
+    {
+        bigint<N,T> q;
+        bigint<M,T> r;
+        divmod(x, q, r);
+        return q;
+    }
+
+    template<unsigned int M>
+    inline bigint<M,T> operator %(bigint<M,T> const &x) const
     {
-        return multiply(x);
+        bigint<N,T> q;
+        bigint<M,T> r;
+        divmod(x, q, r);
+        return r;
     }
 
     /*
@@ -257,13 +338,14 @@ public:
 
     /*
      * bigint comparison operators: take a quick decision if signs
-     * differ. Otherwise, compare all digits.
+     * differ. Otherwise, compare all digits starting with the most
+     * significant one.
      */
     bool operator >(bigint<N,T> const &x) const
     {
         if (is_negative() ^ x.is_negative())
             return x.is_negative();
-        for (unsigned int i = 0; i < N; ++i)
+        for (unsigned int i = N; i--; )
             if (m_digits[i] != x.m_digits[i])
                 return m_digits[i] > x.m_digits[i];
         return false;
@@ -273,7 +355,7 @@ public:
     {
         if (is_negative() ^ x.is_negative())
             return is_negative();
-        for (unsigned int i = 0; i < N; ++i)
+        for (unsigned int i = N; i--; )
             if (m_digits[i] != x.m_digits[i])
                 return m_digits[i] < x.m_digits[i];
         return false;
@@ -294,7 +376,7 @@ public:
         printf("0x");
 
         int n = (bits_per_digit * N + 31) / 32;
-        while (n > 1 && get_uint32(n) == 0)
+        while (n > 1 && get_uint32(n - 1) == 0)
             --n;
 
         if (n > 0)
@@ -328,81 +410,267 @@ private:
         return (m_digits[N - 1] >> (bits_per_digit - 1)) != 0;
     }
 
+    void set(uint64_t x, T padding)
+    {
+        unsigned int bit = 0;
+        for (unsigned int i = 0; i < N; ++i, bit += bits_per_digit)
+            m_digits[i] = bit < 64 ? T(x >> bit) : padding;
+    }
+
     template<unsigned int M>
-    typename std::enable_if<(N != M || (N > 1 && N < 64)), bigint<N + M, T>>
-    ::type inline multiply(bigint<M,T> const &b) const
+    bigint<((N > M) ? N : M), T> add(bigint<M,T> const &x, bool negate) const
     {
-        /* FIXME: other digit sizes are not supported */
-        static_assert(sizeof(T) <= sizeof(uint32_t), "ensure T is uint32_t");
+        bigint<((N > M) ? N : M), T> ret;
+        T padding = is_negative() ? digit_max : T(0);
+        T x_padding = x.is_negative() ? digit_max : T(0);
+        T flip = negate ? digit_max : T(0);
+        T carry = negate ? T(1) : T(0);
+        for (unsigned int i = 0; i < ((N > M) ? N : M); ++i)
+        {
+            T a = i < N ? m_digits[i] : padding;
+            T b = T((i < M ? x.m_digits[i] : x_padding) ^ flip);
+            T sum = T(a + b);
+            T digit = T(sum + carry);
+            ret.m_digits[i] = digit;
+            carry = (sum < a || digit < sum) ? T(1) : T(0);
+        }
+        return ret;
+    }
 
-        bigint<N + M> ret(0);
-        for (unsigned int i = 0; i < N; ++i)
+    /*
+     * Unsigned helpers working on raw digit arrays
+     */
+
+    static T add_digits(T *dst, T const *a, T const *b, int n)
+    {
+        T carry(0);
+        for (int i = 0; i < n; ++i)
         {
-            T carry(0);
-            for (unsigned int j = 0; j < M; ++j)
-            {
-                uint64_t digit = ret.m_digits[i + j]
-                               + (uint64_t)m_digits[i] * b.m_digits[j]
-                               + carry;
-                ret.m_digits[i + j] = (T)digit & digit_mask;
-                carry = (digit >> bits_per_digit) & digit_mask;
-            }
+            T sum = T(a[i] + b[i]);
+            T digit = T(sum + carry);
+            carry = (sum < a[i] || digit < sum) ? T(1) : T(0);
+            dst[i] = digit;
+        }
+        return carry;
+    }
+
+    static T sub_digits(T *dst, T const *a, T const *b, int n)
+    {
+        T borrow(0);
+        for (int i = 0; i < n; ++i)
+        {
+            T diff = T(a[i] - b[i]);
+            T digit = T(diff - borrow);
+            borrow = (a[i] < b[i] || diff < borrow) ? T(1) : T(0);
+            dst[i] = digit;
+        }
+        return borrow;
+    }
+
+    /* Compute |a - b| and return whether a < b */
+    static bool abs_diff_digits(T *dst, T const *a, T const *b, int n)
+    {
+        int i = n;
+        while (i-- && a[i] == b[i])
+            ;
+        bool less = i >= 0 && a[i] < b[i];
+        sub_digits(dst, less ? b : a, less ? a : b, n);
+        return less;
+    }
+
+    /* Column-wise (Comba) multiplication: each column of partial
+     * products is summed in a three-digit accumulator before a single
+     * store. */
+    static void mul_comba(T *dst, T const *a, int n, T const *b, int m)
+    {
+        if (!n || !m)
+        {
+            for (int k = 0; k < n + m; ++k)
+                dst[k] = T(0);
+            return;
+        }
 
-            for (unsigned int j = M; i + j < M + N && carry != 0; ++i)
+        wide_t acc(0);
+        for (int k = 0; k < n + m - 1; ++k)
+        {
+            T hi(0);
+            for (int i = k < m ? 0 : k - m + 1; i <= k && i < n; ++i)
             {
-                T digit = ret.m_digits[i + j] + carry;
-                ret.m_digits[i + j] = (T)digit & digit_mask;
-                carry = (digit & ~digit_mask) ? T(1) : T(0);
+                wide_t p = (wide_t)a[i] * b[k - i];
+                acc = wide_t(acc + p);
+                hi += acc < p;
             }
+            dst[k] = T(acc);
+            acc = wide_t((acc >> bits_per_digit) | ((wide_t)hi << bits_per_digit));
         }
+        dst[n + m - 1] = T(acc);
+    }
 
-        return ret;
+    /* Karatsuba multiplication of two n-digit numbers, using the
+     * subtractive variant so that the middle product does not need an
+     * extra carry digit. The scratch area must hold 8n digits. */
+    static void mul_karatsuba(T *dst, T const *a, T const *b, int n,
+                              T *scratch)
+    {
+        if (n < karatsuba_threshold || (n & 1))
+        {
+            mul_comba(dst, a, n, b, n);
+            return;
+        }
+
+        /* a = a1.B + a0 and b = b1.B + b0, with B = 2^(h.bits) */
+        int const h = n / 2;
+        T const *a0 = a, *a1 = a + h, *b0 = b, *b1 = b + h;
+        T *da = scratch, *db = da + h, *p = db + h, *t = p + n;
+
+        mul_karatsuba(dst, a0, b0, h, t + n);
+        mul_karatsuba(dst + n, a1, b1, h, t + n);
+
+        /* a0.b1 + a1.b0 = a0.b0 + a1.b1 + (a0 - a1)(b1 - b0) */
+        bool negative = abs_diff_digits(da, a0, a1, h)
+                         != abs_diff_digits(db, b1, b0, h);
+        mul_karatsuba(p, da, db, h, t + n);
+
+        T carry = add_digits(t, dst, dst + n, n);
+        if (negative)
+            carry = T(carry - sub_digits(t, t, p, n));
+        else
+            carry = T(carry + add_digits(t, t, p, n));
+
+        carry = T(carry + add_digits(dst + h, dst + h, t, n));
+        for (int i = n + h; carry && i < 2 * n; ++i)
+        {
+            dst[i] = T(dst[i] + carry);
+            carry = dst[i] < carry ? T(1) : T(0);
+        }
     }
 
+    /* Division of magnitudes using Knuth’s Algorithm D (TAOCP vol. 2,
+     * section 4.3.1), then sign fixing. */
     template<unsigned int M>
-    typename std::enable_if<(N == M) && (N >= 64), bigint<N + M, T>>
-    ::type inline multiply(bigint<M,T> const &b) const
-    {
-        bigint<2 * N, T> ret, tmp(0);
-
-        bigint<N / 2, T> const &a0 = slice<0, N / 2>();
-        bigint<N / 2, T> const &a1 = slice<N / 2, N>();
-        bigint<N / 2, T> const &b0 = b.template slice<0, N / 2>();
-        bigint<N / 2, T> const &b1 = b.template slice<N / 2, N>();
-        bigint<N, T> &r0 = ret.template slice<0, N>();
-        bigint<N, T> &r1 = ret.template slice<N / 2, N + N / 2>();
-        bigint<N, T> &r2 = ret.template slice<N, 2 * N>();
-        r0 = a0 * b0;
-        r2 = a1 * b1;
-        /* FIXME: check for overflows here */
-        r1 = (a0 + a1) * (b0 + b1) - r0 - r2;
-
-        return ret + tmp;
-    }
-
-    template<unsigned int M, int = 0>
-    typename std::enable_if<(N == M) && (N == 1), bigint<N + M, T>>
-    ::type inline multiply(bigint<M,T> const &b) const
-    {
-        bigint<2, T> ret;
-        uint64_t digit = (uint64_t)m_digits[0] * b.m_digits[0];
-        ret.m_digits[0] = (T)(digit) & ret.digit_mask;
-        ret.m_digits[1] = (T)(digit >> ret.bits_per_digit) & ret.digit_mask;
-        return ret;
+    void divmod(bigint<M,T> const &x, bigint<N,T> &q, bigint<M,T> &r) const
+    {
+        bigint<N,T> const u = is_negative() ? -*this : *this;
+        bigint<M,T> const v = x.is_negative() ? -x : x;
+
+        for (auto &digit : q.m_digits)
+            digit = T(0);
+        for (auto &digit : r.m_digits)
+            digit = T(0);
+
+        /* Ignore leading zero digits */
+        int n = N, m = M;
+        while (n > 0 && u.m_digits[n - 1] == 0)
+            --n;
+        while (m > 0 && v.m_digits[m - 1] == 0)
+            --m;
+        ASSERT(m > 0, "bigint division by zero");
+
+        if (n < m)
+        {
+            for (int i = 0; i < n; ++i)
+                r.m_digits[i] = u.m_digits[i];
+        }
+        else if (m == 1)
+        {
+            /* Short division */
+            wide_t rem(0);
+            for (int j = n; j--; )
+            {
+                wide_t cur = wide_t((rem << bits_per_digit) | u.m_digits[j]);
+                q.m_digits[j] = T(cur / v.m_digits[0]);
+                rem = wide_t(cur % v.m_digits[0]);
+            }
+            r.m_digits[0] = T(rem);
+        }
+        else
+        {
+            /* Normalise so that the top bit of the divisor is set */
+            int s = 0;
+            for (T top = v.m_digits[m - 1]; !(top >> (bits_per_digit - 1)); )
+                top = T(top << 1), ++s;
+
+            std::array<T, M> vn;
+            std::array<T, N + 1> un;
+            for (int i = m; i--; )
+                vn[i] = T((v.m_digits[i] << s) | (s && i ? v.m_digits[i - 1]
+                                            >> (bits_per_digit - s) : 0));
+            un[n] = s ? T(u.m_digits[n - 1] >> (bits_per_digit - s)) : T(0);
+            for (int i = n; i--; )
+                un[i] = T((u.m_digits[i] << s) | (s && i ? u.m_digits[i - 1]
+                                            >> (bits_per_digit - s) : 0));
+
+            for (int j = n - m; j >= 0; --j)
+            {
+                /* Estimate the quotient digit from the top two digits
+                 * and fix it using the next one; it is now either
+                 * exact or one too large. */
+                wide_t num = wide_t(((wide_t)un[j + m] << bits_per_digit)
+                                     | un[j + m - 1]);
+                wide_t qhat = wide_t(num / vn[m - 1]);
+                wide_t rhat = wide_t(num % vn[m - 1]);
+                while ((qhat >> bits_per_digit)
+                        || wide_t(qhat * vn[m - 2])
+                            > wide_t((rhat << bits_per_digit) | un[j + m - 2]))
+                {
+                    --qhat;
+                    rhat = wide_t(rhat + vn[m - 1]);
+                    if (rhat >> bits_per_digit)
+                        break;
+                }
+
+                /* Multiply and subtract */
+                T borrow(0), carry(0);
+                for (int i = 0; i < m; ++i)
+                {
+                    wide_t p = wide_t(qhat * vn[i] + carry);
+                    T lo = T(p), d = un[i + j];
+                    carry = T(p >> bits_per_digit);
+                    un[i + j] = T(d - lo - borrow);
+                    borrow = (d < lo || (d == lo && borrow)) ? T(1) : T(0);
+                }
+                T d = un[j + m];
+                un[j + m] = T(d - carry - borrow);
+                borrow = (d < carry || (d == carry && borrow)) ? T(1) : T(0);
+
+                q.m_digits[j] = T(qhat);
+
+                /* Add back if we subtracted one time too many */
+                if (borrow)
+                {
+                    --q.m_digits[j];
+                    T c = add_digits(&un[j], &un[j], vn.data(), m);
+                    un[j + m] = T(un[j + m] + c);
+                }
+            }
+
+            /* Unnormalise the remainder */
+            for (int i = 0; i < m; ++i)
+                r.m_digits[i] = T((un[i] >> s) | (s ? un[i + 1]
+                                            << (bits_per_digit - s) : 0));
+        }
+
+        if (is_negative() != x.is_negative())
+            q = -q;
+        if (is_negative())
+            r = -r;
     }
 
     inline uint32_t get_uint32(int offset) const
     {
-        unsigned int bit = offset * 32;
-        unsigned int digit_index = bit / bits_per_digit;
-        unsigned int bit_index = bit % bits_per_digit;
+        uint32_t ret = 0;
+        for (int shift = 0; shift < 32; )
+        {
+            unsigned int bit = offset * 32 + shift;
+            unsigned int digit_index = bit / bits_per_digit;
+            unsigned int bit_index = bit % bits_per_digit;
 
-        if (digit_index >= N)
-            return 0;
+            if (digit_index >= N)
+                break;
 
-        uint32_t ret = m_digits[digit_index] >> bit_index;
-        if (bits_per_digit - bit_index < 32 && digit_index < N - 1)
-            ret |= m_digits[digit_index + 1] << (bits_per_digit - bit_index);
+            ret |= (uint32_t)(m_digits[digit_index] >> bit_index) << shift;
+            shift += bits_per_digit - bit_index;
+        }
         return ret;
     }
 
@@ -414,10 +682,19 @@ private:
  * Some convenience typedefs
  */
 
-typedef bigint<8,  uint32_t>  int248_t;
-typedef bigint<16, uint32_t>  int496_t;
-typedef bigint<32, uint32_t>  int992_t;
-typedef bigint<64, uint32_t> int1984_t;
+#if defined __SIZEOF_INT128__
+typedef bigint<4,  uint64_t>  int256_t;
+typedef bigint<8,  uint64_t>  int512_t;
+typedef bigint<16, uint64_t> int1024_t;
+typedef bigint<32, uint64_t> int2048_t;
+typedef bigint<64, uint64_t> int4096_t;
+#else
+typedef bigint<8,   uint32_t>  int256_t;
+typedef bigint<16,  uint32_t>  int512_t;
+typedef bigint<32,  uint32_t> int1024_t;
+typedef bigint<64,  uint32_t> int2048_t;
+typedef bigint<128, uint32_t> int4096_t;
+#endif
 
 } /* namespace lol */
 
@@ -183,6 +183,19 @@ double lol_acos(double);
 double lol_atan(double);
 double lol_atan2(double, double);
 
+/* Batch versions of lol_sin() and friends, processing 4 or 8 values at
+ * a time with SSE2 or AVX2 when available. The output arrays may be the
+ * same as the input array. Arguments beyond ±2³¹π go through the scalar
+ * functions instead, one at a time. */
+void lol_sin(float const *x, float *sinx, size_t count);
+void lol_cos(float const *x, float *cosx, size_t count);
+void lol_tan(float const *x, float *tanx, size_t count);
+void lol_sincos(float const *x, float *sinx, float *cosx, size_t count);
+void lol_sin(double const *x, double *sinx, size_t count);
+void lol_cos(double const *x, double *cosx, size_t count);
+void lol_tan(double const *x, double *tanx, size_t count);
+void lol_sincos(double const *x, double *sinx, double *cosx, size_t count);
+
 /* C++ doesn't define abs() and fmod() for all types; we add these for
  * convenience to avoid adding complexity to vector.h. */
 static inline int8_t abs(int8_t x) { return std::abs(x); }
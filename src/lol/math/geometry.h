@@ -246,6 +246,12 @@ bool TestRayVsTriangle(vec3 const &ray_point, vec3 const &ray_dir,
                       vec3 const &tri_p0, vec3 const &tri_p1, vec3 const &tri_p2,
                       vec3 &vi);
 
+//Orientation of d relative to the plane of (a, b, c) : positive when d is on
+//the side cross(b - a, c - a) points to, negative on the other side, zero when
+//the four points are coplanar. The value is the determinant, or an
+//approximation of it, but its sign is always exact.
+double Orient3D(vec3 const &a, vec3 const &b, vec3 const &c, vec3 const &d);
+
 //RayIntersect ----------------------------------------------------------------
 struct RayIntersectBase : public StructSafeEnum
 {
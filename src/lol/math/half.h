@@ -80,10 +80,27 @@ public:
     inline operator double() const { return (float)(*this); }
     inline operator ldouble() const { return (float)(*this); }
 
-    /* Array conversions */
-    static size_t convert(half *dst, float const *src, size_t nelem);
+    /* Array conversions. Float values are truncated like makefast()
+     * does, or rounded to nearest even if “round” is true. F16C or SSE2
+     * instructions are used when available. */
+    static size_t convert(half *dst, float const *src, size_t nelem,
+                          bool round = false);
     static size_t convert(float *dst, half const *src, size_t nelem);
 
+    /* Force the method used by the array conversions, mostly useful for
+     * tests and benchmarks. Returns false if it is not supported on this
+     * machine. This is a global setting that is not synchronised: do not
+     * change it while other threads may be converting arrays. */
+    enum class conversion
+    {
+        automatic,
+        table,
+        sse2,
+        f16c,
+    };
+
+    static bool set_conversion(conversion c);
+
     /* Operations */
     bool operator ==(half x) const { return (float)*this == (float)x; }
     bool operator !=(half x) const { return (float)*this != (float)x; }
@@ -545,21 +545,43 @@ void lu_decomposition(mat_t<T, N, N> const &m, mat_t<T, N, N> & L, mat_t<T, N, N
 }
 
 /*
- * Compute square matrix determinant, with a specialisation for 1×1 matrices
+ * Compute square matrix determinant, using Gaussian elimination with
+ * partial pivoting in O(N³). Small matrices have closed-form versions.
  */
 
 template<typename T, int N>
 T determinant(mat_t<T, N, N> const &m)
 {
-    mat_t<T, N, N> L, U;
-    vec_t<int, N> P = p_vector(m);
-    lu_decomposition(permute_rows(m, P), L, U);
+    /* The determinant of the transpose is the same, so eliminate using
+     * whole columns: they are the matrix’s contiguous vectors. */
+    mat_t<T, N, N> a = m;
+    T det = T(1);
 
-    T det = 1;
-    for (int i = 0 ; i < N ; ++i)
-        det *= U[i][i];
+    for (int k = 0; k < N; ++k)
+    {
+        int pivot = k;
+        for (int i = k + 1; i < N; ++i)
+            if (abs(a[i][k]) > abs(a[pivot][k]))
+                pivot = i;
+
+        if (a[pivot][k] == T(0))
+            return T(0);
+
+        if (pivot != k)
+        {
+            vec_t<T, N> tmp = a[k];
+            a[k] = a[pivot];
+            a[pivot] = tmp;
+            det = -det;
+        }
 
-    return permutation_det(P) * det;
+        det *= a[k][k];
+
+        for (int i = k + 1; i < N; ++i)
+            a[i] -= (a[i][k] / a[k][k]) * a[k];
+    }
+
+    return det;
 }
 
 template<typename T>
@@ -568,6 +590,40 @@ T const & determinant(mat_t<T, 1, 1> const &m)
     return m[0][0];
 }
 
+template<typename T>
+T determinant(mat_t<T, 2, 2> const &m)
+{
+    return m[0][0] * m[1][1] - m[0][1] * m[1][0];
+}
+
+template<typename T>
+T determinant(mat_t<T, 3, 3> const &m)
+{
+    return dot(m[0], cross(m[1], m[2]));
+}
+
+template<typename T>
+T determinant(mat_t<T, 4, 4> const &m)
+{
+    /* Laplace expansion along the first two columns, using the
+     * 2×2 subdeterminants of the top and bottom halves. */
+    T const s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    T const s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    T const s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    T const s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    T const s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    T const s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+    T const c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    T const c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    T const c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    T const c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    T const c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    T const c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+    return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
 /*
  * Compute permutation vector of a square matrix
  */
@@ -725,18 +781,117 @@ mat_t<T, N, N> u_inverse(mat_t<T, N, N> const & U)
 }
 
 /*
- * Compute square matrix inverse
+ * Compute square matrix inverse, using Gauss-Jordan elimination with
+ * partial pivoting in O(N³). Small matrices have closed-form versions.
+ * Singular matrices give non-finite results.
  */
 
 template<typename T, int N>
 mat_t<T, N, N> inverse(mat_t<T, N, N> const &m)
 {
-    mat_t<T, N, N> L, U;
-    vec_t<int, N> P = p_vector(m);
+    /* Work on columns, i.e. invert the transpose: the transpose of its
+     * inverse is the inverse we want, and since the operations are
+     * mirrored on the result, it comes out already transposed back. */
+    mat_t<T, N, N> a = m;
+    mat_t<T, N, N> ret(T(1));
 
-    lu_decomposition(permute_rows(m, P), L, U);
+    for (int k = 0; k < N; ++k)
+    {
+        int pivot = k;
+        for (int i = k + 1; i < N; ++i)
+            if (abs(a[i][k]) > abs(a[pivot][k]))
+                pivot = i;
 
-    mat_t<T, N, N> ret = permute_cols(u_inverse(U) * l_inverse(L), p_transpose(P));
+        if (pivot != k)
+        {
+            vec_t<T, N> tmp = a[k];
+            a[k] = a[pivot];
+            a[pivot] = tmp;
+            tmp = ret[k];
+            ret[k] = ret[pivot];
+            ret[pivot] = tmp;
+        }
+
+        T const inv = T(1) / a[k][k];
+        a[k] *= inv;
+        ret[k] *= inv;
+
+        for (int i = 0; i < N; ++i)
+        {
+            if (i == k)
+                continue;
+            T const f = a[i][k];
+            a[i] -= f * a[k];
+            ret[i] -= f * ret[k];
+        }
+    }
+
+    return ret;
+}
+
+template<typename T>
+mat_t<T, 2, 2> inverse(mat_t<T, 2, 2> const &m)
+{
+    T const inv = T(1) / determinant(m);
+
+    return mat_t<T, 2, 2>(vec_t<T, 2>( m[1][1], -m[0][1]) * inv,
+                          vec_t<T, 2>(-m[1][0],  m[0][0]) * inv);
+}
+
+template<typename T>
+mat_t<T, 3, 3> inverse(mat_t<T, 3, 3> const &m)
+{
+    /* The rows of the inverse are the cross products of the columns */
+    vec_t<T, 3> const c0 = cross(m[1], m[2]);
+    vec_t<T, 3> const c1 = cross(m[2], m[0]);
+    vec_t<T, 3> const c2 = cross(m[0], m[1]);
+    T const inv = T(1) / dot(m[0], c0);
+
+    return transpose(mat_t<T, 3, 3>(c0 * inv, c1 * inv, c2 * inv));
+}
+
+template<typename T>
+mat_t<T, 4, 4> inverse(mat_t<T, 4, 4> const &m)
+{
+    /* Same 2×2 subdeterminants as in determinant(); the cofactors
+     * are then linear combinations of them. */
+    T const s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    T const s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    T const s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    T const s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    T const s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    T const s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+    T const c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    T const c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    T const c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    T const c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    T const c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    T const c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+    T const inv = T(1) / (s0 * c5 - s1 * c4 + s2 * c3
+                        + s3 * c2 - s4 * c1 + s5 * c0);
+
+    mat_t<T, 4, 4> ret;
+    ret[0] = vec_t<T, 4>( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3,
+                         -m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3,
+                          m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3,
+                         -m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3);
+    ret[1] = vec_t<T, 4>(-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1,
+                          m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1,
+                         -m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1,
+                          m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1);
+    ret[2] = vec_t<T, 4>( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0,
+                         -m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0,
+                          m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0,
+                         -m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0);
+    ret[3] = vec_t<T, 4>(-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0,
+                          m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0,
+                         -m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0,
+                          m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0);
+
+    for (int i = 0; i < 4; ++i)
+        ret[i] *= inv;
 
     return ret;
 }
@@ -0,0 +1,196 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+#include <lol/math/noise/gradient.h>
+#include <lol/sys/thread.h>
+
+#include <functional>
+#include <type_traits>
+
+namespace lol
+{
+
+/*
+ * Batch evaluation of noise functions
+ * -----------------------------------
+ *
+ *  Noise classes inherit from this helper to get eval_points() and
+ * eval_grid(). They only need to provide eval_batch<L>(), which evaluates
+ * noise at L points at once with the same sequence of float operations
+ * as eval(). The kernels are compiled in src/math/noise.cpp for 2 to 8
+ * dimensions, and use 8 lanes if the CPU supports AVX2, 4 otherwise.
+ * Other dimensions evaluate the points one by one.
+ *
+ *  Results match eval() to the last bit as long as the compiler does not
+ * reorder float operations. With -ffast-math, as Lol Engine is built,
+ * positions may round differently in both versions, and results stay
+ * within 1e-4 of eval() for coordinates up to 100.
+ *
+ *  Fractal sums (fBm) of several octaves are computed in the same pass:
+ *
+ *    fbm(p) = Σ gain^k · eval(lacunarity^k · p)   for k in [0, octaves[
+ *
+ * and eval_fbm() is the scalar reference for that sum.
+ */
+
+template<int N, typename T>
+class noise_batch
+{
+public:
+    /* Number of points handled together by eval_fbm_batch() */
+    static int const batch_size = 8;
+
+    /* Scalar fractal sum of several octaves of noise */
+    float eval_fbm(vec_t<float, N> position, int octaves,
+                   float lacunarity = 2.f, float gain = 0.5f) const
+    {
+        float ret = 0.f, amplitude = 1.f, frequency = 1.f;
+        for (int k = 0; k < octaves; ++k)
+        {
+            ret += amplitude * self().eval(frequency * position);
+            amplitude *= gain;
+            frequency *= lacunarity;
+        }
+        return ret;
+    }
+
+    /* Evaluate noise at “count” arbitrary points */
+    void eval_points(vec_t<float, N> const *points, float *out,
+                     size_t count, int octaves = 1,
+                     float lacunarity = 2.f, float gain = 0.5f) const
+    {
+        split_batches(count, [&](size_t begin, size_t end)
+        {
+            vec_t<float, N> batch[batch_size];
+
+            for (size_t n = begin; n < end; n += batch_size)
+            {
+                size_t todo = min(end - n, (size_t)batch_size);
+                if (todo == batch_size)
+                {
+                    eval_fbm_batch(points + n, out + n, todo,
+                                   octaves, lacunarity, gain);
+                    continue;
+                }
+
+                /* Pad the last batch with copies of the last point */
+                for (size_t l = 0; l < batch_size; ++l)
+                    batch[l] = points[n + min(l, todo - 1)];
+
+                eval_fbm_batch(batch, out + n, todo,
+                               octaves, lacunarity, gain);
+            }
+        });
+    }
+
+    /* Evaluate noise on a regular grid of dims[0] × dims[1] × … points;
+     * point [i0, i1, …] is at origin + step * vec(i0, i1, …) and its
+     * value is stored at out[i0 + dims[0] * (i1 + dims[1] * (…))]. */
+    void eval_grid(vec_t<float, N> const &origin,
+                   vec_t<float, N> const &step,
+                   vec_t<int, N> const &dims, float *out, int octaves = 1,
+                   float lacunarity = 2.f, float gain = 0.5f) const
+    {
+        size_t count = 1;
+        for (int i = 0; i < N; ++i)
+            count *= (size_t)max(dims[i], 0);
+
+        if (!count)
+            return;
+
+        split_batches(count, [&](size_t begin, size_t end)
+        {
+            /* Coordinates of the first point of this chunk */
+            vec_t<int, N> index;
+            size_t tmp = begin;
+            for (int i = 0; i < N; ++i)
+            {
+                index[i] = (int)(tmp % (size_t)dims[i]);
+                tmp /= (size_t)dims[i];
+            }
+
+            vec_t<float, N> batch[batch_size];
+
+            for (size_t n = begin; n < end; n += batch_size)
+            {
+                size_t todo = min(end - n, (size_t)batch_size);
+
+                for (size_t l = 0; l < todo; ++l)
+                {
+                    batch[l] = origin + step * (vec_t<float, N>)index;
+                    for (int i = 0; i < N && ++index[i] == dims[i]; ++i)
+                        index[i] = 0;
+                }
+
+                /* Pad the last batch with copies of the last point */
+                for (size_t l = todo; l < batch_size; ++l)
+                    batch[l] = batch[todo - 1];
+
+                eval_fbm_batch(batch, out + n, todo,
+                               octaves, lacunarity, gain);
+            }
+        });
+    }
+
+private:
+    inline T const &self() const
+    {
+        return *static_cast<T const *>(this);
+    }
+
+    inline void eval_fbm_batch(vec_t<float, N> const *batch, float *out,
+                               size_t todo, int octaves,
+                               float lacunarity, float gain) const
+    {
+        eval_fbm_batch(batch, out, todo, octaves, lacunarity, gain,
+                       std::integral_constant<bool, N >= 2 && N <= 8>());
+    }
+
+    /* Pick the kernel for the current CPU and run it on one batch */
+    void eval_fbm_batch(vec_t<float, N> const *batch, float *out,
+                        size_t todo, int octaves, float lacunarity,
+                        float gain, std::true_type) const;
+
+    void eval_fbm_batch(vec_t<float, N> const *batch, float *out,
+                        size_t todo, int octaves, float lacunarity,
+                        float gain, std::false_type) const
+    {
+        for (size_t l = 0; l < todo; ++l)
+            out[l] = eval_fbm(batch[l], octaves, lacunarity, gain);
+    }
+
+    template<int L>
+    void eval_fbm_lanes(vec_t<float, N> const *batch, float *out,
+                        size_t todo, int octaves,
+                        float lacunarity, float gain) const;
+
+    /* Split [0, count[ into chunks of whole batches and process them
+     * on all available cores if there is enough work. */
+    static void split_batches(size_t count,
+                              std::function<void(size_t, size_t)> const &fn)
+    {
+        /* Below this number of points, threads cost more than they save */
+        int const min_batches_per_thread = 16384 / batch_size;
+
+        int const batches = (int)((count + batch_size - 1) / batch_size);
+        parallel_for(batches, min_batches_per_thread, [&](int begin, int end)
+        {
+            fn((size_t)begin * batch_size,
+               min((size_t)end * batch_size, count));
+        });
+    }
+};
+
+}
+
@@ -22,12 +22,40 @@ class gradient_provider
 {
 public:
     gradient_provider(int seed = 0)
-      : m_seed(seed)
+      : m_seed(seed),
+        m_gradients(gradient_table().data())
     {
     }
 
 protected:
+    /* Generate 2^(N+2) random vectors, but at least 2^5 (32) and not
+     * more than 2^20 (~ 1 million). */
+    static int const gradient_count = 1 << (N + 2 < 5 ? 5
+                                          : N + 2 > 20 ? 20 : N + 2);
+
     vec_t<float, N> get_gradient(vec_t<int, N> origin) const
+    {
+        int idx = m_seed;
+        for (int i = 0; i < N; ++i)
+            idx = hash(idx, origin[i]);
+
+        idx &= (gradient_count - 1);
+#if 0
+        // DEBUG: only output a few gradients
+        if (idx > 2)
+            return vec_t<float, N>(0);
+#endif
+        return m_gradients[idx];
+    }
+
+    /* Same as get_gradient(), but for L origins at once. Coordinates
+     * and gradients are stored as one lane vector per axis. Only used by
+     * the batch kernels, in src/math/noise.cpp. */
+    template<int L, typename VI, typename VF>
+    void get_gradients(VI const *origin, VF *gradient) const;
+
+private:
+    static inline int hash(int idx, int coord)
     {
         /* Quick shuffle table:
          * strings /dev/urandom | grep . -nm256 | sort -k2 -t: | sed 's|:.*|,|'
@@ -54,11 +82,15 @@ protected:
             137, 29, 23, 223, 108, 102, 86, 198, 227, 35, 229, 76, 168, 132,
         };
 
-        /* Generate 2^(N+2) random vectors, but at least 2^5 (32) and not
-         * more than 2^20 (~ 1 million). */
-        int const gradient_count = 1 << min(max(N + 2, 5), 20);
+        return idx ^ shuffle[(idx + coord) & 255];
+    }
 
-        static auto build_gradients = [&]()
+    /* The gradient table is shared by all instances; it is built once,
+     * when the first object is created, instead of going through the
+     * static initialisation guard on every lookup. */
+    static array<vec_t<float, N>> const &gradient_table()
+    {
+        static auto build_gradients = []()
         {
             array<vec_t<float, N>> ret;
             for (int k = 0; k < gradient_count; ++k)
@@ -72,23 +104,14 @@ protected:
         };
 
         static array<vec_t<float, N>> const gradients = build_gradients();
-
-        int idx = m_seed;
-        for (int i = 0; i < N; ++i)
-            idx ^= shuffle[(idx + origin[i]) & 255];
-
-        idx &= (gradient_count - 1);
-#if 0
-        // DEBUG: only output a few gradients
-        if (idx > 2)
-            return vec_t<float, N>(0);
-#endif
-        return gradients[idx];
+        return gradients;
     }
 
-private:
     /* A user-provided random seed. Defaults to zero. */
     int m_seed;
+
+    /* Pointer to the shared gradient table */
+    vec_t<float, N> const *m_gradients;
 };
 
 }
@@ -13,14 +13,20 @@
 #pragma once
 
 #include <lol/math/noise/gradient.h>
+#include <lol/math/noise/batch.h>
 
 namespace lol
 {
 
 template<int N>
-class perlin_noise : public gradient_provider<N>
+class perlin_noise : public gradient_provider<N>,
+                     public noise_batch<N, perlin_noise<N>>
 {
+    friend class noise_batch<N, perlin_noise<N>>;
+
 public:
+    using noise_batch<N, perlin_noise<N>>::batch_size;
+
     perlin_noise()
       : gradient_provider<N>()
     {
@@ -70,6 +76,10 @@ public:
             /* Accumulate Perlin noise */
             ret += multiplier * dot(delta, this->get_gradient(origin));
 
+            /* The last corner has no successor */
+            if (i + 1 == (1 << N))
+                break;
+
             /* Don’t use the binary pattern for “i” but use its Gray code
              * “j” instead, so we know we only have one component to alter
              * in “origin” and in “delta”. We know which bit was flipped by
@@ -88,6 +98,14 @@ public:
 
         return sqrt(2.f) * ret;
     }
+
+protected:
+    /* Evaluate noise at L points. The hypercube corners are
+     * visited in the same order for every point, so this is the same
+     * algorithm as eval() with each step applied to all points at once.
+     * Defined with the other batch kernels in src/math/noise.cpp. */
+    template<int L>
+    void eval_batch(vec_t<float, N> const *position, float *out) const;
 };
 
 }
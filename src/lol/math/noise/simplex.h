@@ -15,6 +15,7 @@
 #pragma once
 
 #include <lol/math/noise/gradient.h>
+#include <lol/math/noise/batch.h>
 
 namespace lol
 {
@@ -41,9 +42,14 @@ namespace lol
  */
 
 template<int N>
-class simplex_noise : public gradient_provider<N>
+class simplex_noise : public gradient_provider<N>,
+                      public noise_batch<N, simplex_noise<N>>
 {
+    friend class noise_batch<N, simplex_noise<N>>;
+
 public:
+    using noise_batch<N, simplex_noise<N>>::batch_size;
+
     simplex_noise()
       : gradient_provider<N>()
     {
@@ -80,6 +86,13 @@ public:
     }
 
 protected:
+    /* Evaluate noise at L points. This is the same algorithm as
+     * eval() and get_noise(), with each step applied to all points at
+     * once and without any data-dependent branches. Defined with the
+     * other batch kernels in src/math/noise.cpp. */
+    template<int L>
+    void eval_batch(vec_t<float, N> const *position, float *out) const;
+
     inline float get_noise(vec_t<int, N> origin,
                            vec_t<float, N> const & pos) const
     {
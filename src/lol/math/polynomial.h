@@ -19,11 +19,31 @@
 //
 
 #include <functional>
-
+#include <type_traits>
 
 namespace lol
 {
 
+/* Evaluate the polynomial with coefficients c[0] … c[degree] at “count”
+ * values. The float and double versions use SIMD code when available. */
+void polynomial_eval(float const *c, int degree,
+                     float const *x, float *out, size_t count);
+void polynomial_eval(double const *c, int degree,
+                     double const *x, double *out, size_t count);
+
+template<typename T, typename U>
+void polynomial_eval(T const *c, int degree,
+                     U const *x, U *out, size_t count)
+{
+    for (size_t n = 0; n < count; ++n)
+    {
+        U ret(degree >= 0 ? c[degree] : T(0));
+        for (int i = degree - 1; i >= 0; --i)
+            ret = ret * x[n] + U(c[i]);
+        out[n] = ret;
+    }
+}
+
 template<typename T>
 struct polynomial
 {
@@ -49,19 +69,26 @@ struct polynomial
     /* Factory for Chebyshev polynomials */
     static polynomial<T> chebyshev(int n)
     {
-        /* Use T0(x) = 1, T1(x) = x, Tn(x) = 2 x Tn-1(x) - Tn-2(x) */
-        std::function<int64_t (int, int)> coeff = [&](int i, int j)
+        /* Use T0(x) = 1, T1(x) = x, Tn(x) = 2 x Tn-1(x) - Tn-2(x), keeping
+         * only the last two rows of integer coefficients. */
+        array<int64_t> prev, cur;
+        prev.resize(n + 1);
+        cur.resize(n + 1);
+        for (int k = 0; k <= n; ++k)
+            prev[k] = cur[k] = 0;
+        cur[0] = 1;
+
+        for (int j = 1; j <= n; ++j)
         {
-            if (i > j || i < 0 || ((j ^ i) & 1))
-                return (int64_t)0;
-            if (j < 2)
-                return (int64_t)1;
-            return 2 * coeff(i - 1, j - 1) - coeff(i, j - 2);
-        };
+            /* Compute Tj in place of Tj-2, then swap */
+            for (int k = 0; k <= j; ++k)
+                prev[k] = (k ? (j > 1 ? 2 : 1) * cur[k - 1] : 0) - prev[k];
+            std::swap(prev, cur);
+        }
 
         polynomial<T> ret;
         for (int k = 0; k <= n; ++k)
-            ret.m_coefficients.push(T(coeff(k, n)));
+            ret.m_coefficients.push(T(cur[k]));
         return ret;
     }
 
@@ -98,6 +125,42 @@ struct polynomial
         return ret;
     }
 
+    /* Evaluate polynomial at a given value using Estrin’s scheme, which
+     * has shorter dependency chains than Horner’s method and is usually
+     * faster for single scalar values of degree 8 or more. The rounding
+     * errors are slightly different. */
+    template<typename U> U eval_estrin(U x) const
+    {
+        int n = degree() + 1;
+        if (!std::is_arithmetic<U>::value || n > 32)
+            return eval(x);
+
+        /* First pair the coefficients as c[2i] + c[2i+1] x, then pair
+         * the results using x², x⁴… until only one is left. */
+        U b[16];
+        int m = (n + 1) / 2;
+        for (int i = 0; i < m; ++i)
+            b[i] = 2 * i + 1 < n ? U(m_coefficients[2 * i])
+                                 + U(m_coefficients[2 * i + 1]) * x
+                                 : U(m_coefficients[2 * i]);
+
+        for (U p = x * x; m > 1; p *= p)
+        {
+            int k = (m + 1) / 2;
+            for (int i = 0; i < k; ++i)
+                b[i] = 2 * i + 1 < m ? b[2 * i] + b[2 * i + 1] * p : b[2 * i];
+            m = k;
+        }
+
+        return n ? b[0] : U(0);
+    }
+
+    /* Evaluate polynomial at “count” values at once */
+    template<typename U> void eval(U const *x, U *out, size_t count) const
+    {
+        polynomial_eval(m_coefficients.data(), degree(), x, out, count);
+    }
+
     polynomial<T> derive() const
     {
         /* No need to reduce the degree after deriving. */
@@ -107,12 +170,16 @@ struct polynomial
         return ret;
     }
 
+    /* Return the real roots of the polynomial. Degrees up to 3 are
+     * solved directly; higher degrees use the Aberth method. */
     array<T> roots() const
     {
-        /* For now we can only solve polynomials of degrees 0, 1, 2 or 3. */
-        ASSERT(degree() >= 0 && degree() <= 3,
+        ASSERT(degree() >= 0,
                "roots() called on polynomial of degree %d", degree());
 
+        if (degree() > 3)
+            return aberth_roots();
+
         if (degree() == 0)
         {
             /* p(x) = a > 0 */
@@ -225,9 +292,10 @@ struct polynomial
                 solutions[i] = u_norm * cos(u_angle) + v_norm * cos(v_angle);
             }
 
-            if (a == d && b == c && b == T(3)*a) // triple solution
+            /* p(x) = a(x - r)³ iff b = -3ar, c = 3ar² and d = -ar³ */
+            if (b * b == T(3) * a * c && c * c == T(3) * b * d) // triple solution
             {
-                return array<T> { solutions[0] - k };
+                return array<T> { -k };
             }
 
             // if root of the derivative is also root of the current polynomial, we have a double root.
@@ -256,6 +324,100 @@ struct polynomial
         return array<T> {};
     }
 
+    /* Return all the complex roots of the polynomial, using the Aberth
+     * method: starting from points on a circle that contains all roots,
+     * Newton steps are corrected so that the approximations repel each
+     * other, which gives cubic convergence towards simple roots. */
+    array<T, T> complex_roots() const
+    {
+        int const n = degree();
+        array<T, T> z;
+
+        if (n < 1)
+            return z;
+
+        /* All roots lie within 1 + max|c[i] / c[n]| of the origin */
+        T radius(0);
+        for (int i = 0; i < n; ++i)
+            radius = max(radius, abs(m_coefficients[i] / leading()));
+        radius = radius + T(1);
+
+        /* Start from points on the circle, with an offset to avoid being
+         * symmetric to the real axis */
+        static T const pi = acos(T(-1));
+        for (int k = 0; k < n; ++k)
+        {
+            T angle = T(2) * pi * T(k) / T(n) + T(0.4);
+            z.push(radius * cos(angle), radius * sin(angle));
+        }
+
+        T const eps = epsilon();
+
+        for (int iter = 0; iter < 500; ++iter)
+        {
+            bool done = true;
+
+            for (int k = 0; k < n; ++k)
+            {
+                T const &x = z[k].m1, &y = z[k].m2;
+
+                /* Evaluate p(z) and p'(z) together with Horner’s method */
+                T pr = leading(), pi_ = T(0), dr = T(0), di = T(0);
+                for (int i = n - 1; i >= 0; --i)
+                {
+                    T tr = dr * x - di * y + pr;
+                    di = dr * y + di * x + pi_;
+                    dr = tr;
+                    tr = pr * x - pi_ * y + m_coefficients[i];
+                    pi_ = pr * y + pi_ * x;
+                    pr = tr;
+                }
+
+                if (pr == T(0) && pi_ == T(0))
+                    continue;
+
+                /* w = p(z) / p'(z) */
+                T d2 = dr * dr + di * di;
+                if (d2 == T(0))
+                    continue;
+                T wr = (pr * dr + pi_ * di) / d2;
+                T wi = (pi_ * dr - pr * di) / d2;
+
+                /* s = Σ 1 / (z - z[j]) for all j ≠ k */
+                T sr(0), si(0);
+                for (int j = 0; j < n; ++j)
+                {
+                    if (j == k)
+                        continue;
+                    T ar = x - z[j].m1, ai = y - z[j].m2;
+                    T a2 = ar * ar + ai * ai;
+                    sr += ar / a2;
+                    si -= ai / a2;
+                }
+
+                /* step = w / (1 - w s) */
+                T qr = T(1) - (wr * sr - wi * si);
+                T qi = -(wr * si + wi * sr);
+                T q2 = qr * qr + qi * qi;
+                T stepr = (wr * qr + wi * qi) / q2;
+                T stepi = (wi * qr - wr * qi) / q2;
+
+                z[k].m1 -= stepr;
+                z[k].m2 -= stepi;
+
+                T step2 = stepr * stepr + stepi * stepi;
+                T z2 = z[k].m1 * z[k].m1 + z[k].m2 * z[k].m2;
+                if (step2 > T(16) * eps * eps * max(z2, T(1)))
+                    done = false;
+            }
+
+            if (done)
+                break;
+        }
+
+        return z;
+    }
+
     /* Access individual coefficients. This is read-only and returns a
      * copy because we cannot let the user mess with the integrity of
      * the structure (i.e. the guarantee that the leading coefficient
@@ -362,9 +524,9 @@ struct polynomial
             for (int i = 0; i <= n; ++i)
                 ret.m_coefficients.push(T(0));
 
-            for (int i = 0; i <= p.degree(); ++i)
-                for (int j = 0; j <= q.degree(); ++j)
-                    ret.m_coefficients[i + j] += p[i] * q[j];
+            multiply(p.m_coefficients.data(), p.degree() + 1,
+                     q.m_coefficients.data(), q.degree() + 1,
+                     ret.m_coefficients.data());
 
             ret.reduce_degree();
         }
@@ -397,6 +559,196 @@ struct polynomial
     }
 
 private:
+    /* Add the product of a[0…na-1] and b[0…nb-1] to out[0…na+nb-2].
+     * Large products use Karatsuba’s method, which needs three half-size
+     * products instead of four and gives O(n^1.58) complexity. */
+    static void multiply(T const *a, int na, T const *b, int nb, T *out)
+    {
+        /* Below this size the schoolbook method is faster */
+        int const threshold = 32;
+
+        if (na < threshold || nb < threshold)
+        {
+            for (int i = 0; i < na; ++i)
+                for (int j = 0; j < nb; ++j)
+                    out[i + j] += a[i] * b[j];
+            return;
+        }
+
+        /* Split a = a0 + x^m a1 and b = b0 + x^m b1, then use
+         * a b = a0 b0 + x^m ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1)
+         *             + x^2m a1 b1 */
+        int const m = lol::min(na, nb) / 2;
+        int const na1 = na - m, nb1 = nb - m;
+
+        array<T> z0, z1, z2, sa, sb;
+        z0.resize(2 * m - 1);
+        z2.resize(na1 + nb1 - 1);
+        for (auto &x : z0) x = T(0);
+        for (auto &x : z2) x = T(0);
+
+        multiply(a, m, b, m, z0.data());
+        multiply(a + m, na1, b + m, nb1, z2.data());
+
+        sa.resize(na1);
+        sb.resize(nb1);
+        for (int i = 0; i < na1; ++i)
+            sa[i] = i < m ? a[i] + a[m + i] : a[m + i];
+        for (int i = 0; i < nb1; ++i)
+            sb[i] = i < m ? b[i] + b[m + i] : b[m + i];
+
+        z1.resize(na1 + nb1 - 1);
+        for (auto &x : z1) x = T(0);
+        multiply(sa.data(), na1, sb.data(), nb1, z1.data());
+
+        for (int i = 0; i < z0.count(); ++i)
+        {
+            out[i] += z0[i];
+            z1[i] -= z0[i];
+        }
+        for (int i = 0; i < z2.count(); ++i)
+        {
+            out[2 * m + i] += z2[i];
+            z1[i] -= z2[i];
+        }
+        for (int i = 0; i < z1.count(); ++i)
+            out[m + i] += z1[i];
+    }
+
+    /* The smallest power of two e such that 1 + e != 1 */
+    static T epsilon()
+    {
+        static T const ret = []()
+        {
+            T e(1);
+            while (T(1) + e / T(2) != T(1))
+                e /= T(2);
+            return e;
+        }();
+        return ret;
+    }
+
+    /* Sum of |c[i]| |x|ⁱ, which bounds the rounding error of eval(x)
+     * once multiplied by ε */
+    T eval_bound(T x) const
+    {
+        T ret(0);
+        for (int i = degree(); i >= 0; --i)
+            ret = ret * abs(x) + abs(m_coefficients[i]);
+        return ret;
+    }
+
+    array<T> aberth_roots() const
+    {
+        /* An m-fold root only converges to ε^(1/m) precision: Aberth
+         * leaves m approximations spread around it. Group each cluster
+         * whose spread fits that tolerance, from the largest multiplicity
+         * down, and keep it only if p and its first m-1 derivatives do
+         * vanish at its centre; two close simple roots fail that test. */
+        T const eps = epsilon();
+        array<T, T> z = complex_roots();
+        int const n = z.count();
+
+        array<polynomial<T>> derivatives;
+        derivatives.push(*this);
+        for (int k = 1; k <= n; ++k)
+            derivatives.push(derivatives.last().derive());
+
+        array<bool> used;
+        for (int i = 0; i < n; ++i)
+            used.push(false);
+
+        auto dist = [&](int j, T const &re, T const &im)
+        {
+            return (z[j].m1 - re) * (z[j].m1 - re)
+                 + (z[j].m2 - im) * (z[j].m2 - im);
+        };
+
+        array<T> ret;
+        for (int i = 0; i < n; ++i)
+        {
+            if (used[i])
+                continue;
+
+            /* The other free approximations, nearest first */
+            array<int> near;
+            near.push(i);
+            for (int j = 0; j < n; ++j)
+                if (!used[j] && j != i)
+                    near.push(j);
+            for (int j = 2; j < near.count(); ++j)
+                for (int k = j; k > 1 && dist(near[k], z[i].m1, z[i].m2)
+                                    < dist(near[k - 1], z[i].m1, z[i].m2); --k)
+                    near.swap(k, k - 1);
+
+            int m = near.count();
+            T re(0), im(0), tol(0);
+            for (; m > 0; --m)
+            {
+                re = im = T(0);
+                for (int k = 0; k < m; ++k)
+                {
+                    re += z[near[k]].m1;
+                    im += z[near[k]].m2;
+                }
+                re /= T(m);
+                im /= T(m);
+
+                T const scale = max(abs(re), T(1));
+                tol = T(16) * pow(eps, T(1) / T(m)) * scale;
+                if (m == 1)
+                    break;
+
+                bool ok = true;
+                for (int k = 0; ok && k < m; ++k)
+                    ok = dist(near[k], re, im) <= tol * tol;
+                for (int k = 0; ok && k < m; ++k)
+                    ok = abs(derivatives[k].eval(re))
+                          <= derivatives[k].eval_bound(re)
+                              * pow(T(16) * eps, T(m - k) / T(m));
+                if (ok)
+                    break;
+            }
+
+            for (int k = 0; k < m; ++k)
+                used[near[k]] = true;
+
+            /* Keep the roots whose imaginary part is negligible; simple
+             * roots of ill-conditioned polynomials are only accurate to
+             * about √ε, so never be stricter than that. */
+            if (m == 1)
+                tol = T(16) * sqrt(eps) * max(abs(re), T(1));
+            if (abs(im) > tol)
+                continue;
+
+            /* An m-fold root of p is a simple root of its (m-1)-th
+             * derivative: polish it there with a few Newton steps, as
+             * long as they bring the value closer to zero */
+            polynomial<T> const &q = derivatives[m - 1];
+            polynomial<T> const &dq = derivatives[m];
+            T x = re;
+            for (int k = 0; k < 3; ++k)
+            {
+                T dx = dq.eval(x);
+                if (dx == T(0))
+                    break;
+                T y = x - q.eval(x) / dx;
+                if (!(abs(q.eval(y)) < abs(q.eval(x))))
+                    break;
+                x = y;
+            }
+
+            ret.push(x);
+        }
+
+        /* Sort the roots */
+        for (int i = 1; i < ret.count(); ++i)
+            for (int j = i; j > 0 && ret[j] < ret[j - 1]; --j)
+                ret.swap(j, j - 1);
+
+        return ret;
+    }
+
     /* Enforce the non-zero leading coefficient rule. */
     void reduce_degree()
     {
@@ -415,5 +767,74 @@ polynomial<T> operator *(T const &k, polynomial<T> const &p)
     return p * k;
 }
 
+#if !LOL_FEATURE_CXX11_CONSTEXPR
+#   define constexpr /* */
+#endif
+
+/*
+ * A polynomial with a fixed number of coefficients, known at compile
+ * time, such as a minimax approximation generated by lolremez. Evaluation
+ * is fully unrolled and can happen at compile time:
+ *
+ *   constexpr fixed_polynomial<double, 3> p(1.0, -2.0, 0.5);
+ *   double y = p.eval(x);
+ */
+
+template<typename T, int N>
+struct fixed_polynomial
+{
+    static_assert(N > 0, "fixed_polynomial needs at least one coefficient");
+
+    /* Create a polynomial from N coefficients, lowest degree first */
+    template<typename... ARGS>
+    explicit inline constexpr fixed_polynomial(ARGS... args)
+      : m_coefficients { T(args)... }
+    {
+        static_assert(sizeof...(ARGS) == N, "wrong coefficient count");
+    }
+
+    inline constexpr int degree() const { return N - 1; }
+
+    inline constexpr T const &operator[](int n) const
+    {
+        return m_coefficients[n];
+    }
+
+    /* Evaluate the polynomial using Horner’s method */
+    template<typename U> inline constexpr U eval(U x) const
+    {
+        return horner(x, std::integral_constant<int, 0>());
+    }
+
+    /* Convert to a dynamic polynomial */
+    polynomial<T> to_polynomial() const
+    {
+        polynomial<T> ret;
+        for (int i = 0; i < N; ++i)
+            ret.set(i, m_coefficients[i]);
+        return ret;
+    }
+
+private:
+    template<typename U, int K>
+    inline constexpr U horner(U x, std::integral_constant<int, K>) const
+    {
+        return U(m_coefficients[K])
+             + x * horner(x, std::integral_constant<int, K + 1>());
+    }
+
+    template<typename U>
+    inline constexpr U horner(U, std::integral_constant<int, N - 1>) const
+    {
+        return U(m_coefficients[N - 1]);
+    }
+
+    T m_coefficients[N];
+};
+
+#if !LOL_FEATURE_CXX11_CONSTEXPR
+#   undef constexpr
+#endif
+
 } /* namespace lol */
 
@@ -15,12 +15,99 @@
 // ----------------------------
 //
 
+#include <cstddef>
 #include <cstdlib>
 #include <stdint.h>
 
 namespace lol
 {
 
+/*
+ * A fast pseudo-random number generator: xoshiro256** by David Blackman
+ * and Sebastiano Vigna. It has a period of 2^256-1 and all 64 output bits
+ * are usable.
+ *
+ * Every thread has its own default generator, returned by rng::get(),
+ * which all the rand() functions below use. Each thread’s generator
+ * starts one jump() further than the previous thread’s, so that the
+ * sequences never overlap and single-threaded programs are reproducible.
+ */
+
+class rng
+{
+public:
+    rng(uint64_t seed = 0)
+    {
+        this->seed(seed);
+    }
+
+    /* Reset the generator state from a 64-bit seed */
+    void seed(uint64_t seed);
+
+    /* Return 64 random bits */
+    inline uint64_t next()
+    {
+        uint64_t const ret = rotl(m_state[1] * 5, 7) * 9;
+        uint64_t const t = m_state[1] << 17;
+
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotl(m_state[3], 45);
+
+        return ret;
+    }
+
+    /* Advance the generator by 2^128 steps. Use this to create up to
+     * 2^64 non-overlapping sequences for parallel computations. */
+    void jump();
+
+    /* Advance the generator by 2^192 steps */
+    void long_jump();
+
+    /* Fill an array with random 32-bit integers, or with floats in the
+     * [0,1) range. Large arrays are filled from four interleaved streams
+     * at once: the generator itself and three copies of it that are 1,
+     * 2 and 3 long_jump() ahead, so it is best not to call long_jump()
+     * on a generator that is also used for filling arrays. */
+    void fill(uint32_t *out, size_t count);
+    void fill(float *out, size_t count);
+
+    /* Return the current thread’s default generator */
+    static rng &get();
+
+private:
+    static inline uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    /* Return the next thread’s default generator */
+    static rng thread_default();
+
+    void jump(uint64_t const *poly);
+    void init_lanes();
+    template<int OP, typename T> void fill(T *out, size_t count);
+
+    uint64_t m_state[4];
+
+    /* The extra streams used by fill(), initialised on first use */
+    uint64_t m_lanes[4][3];
+    bool m_lanes_ready;
+};
+
+inline rng &rng::get()
+{
+#if LOL_FEATURE_THREADS
+    static thread_local rng instance = thread_default();
+#else
+    static rng instance = thread_default();
+#endif
+    return instance;
+}
+
 /* Random number generators */
 template<typename T> static inline T rand();
 template<typename T> static inline T rand(T a);
@@ -32,27 +119,30 @@ template<typename T> static inline T rand(T a)
     return a ? rand<T>() % a : T(0);
 }
 
+/* Floating point values use as many random bits as their mantissa
+ * can hold, giving uniformly distributed results in [0,1). */
 template<> inline half rand<half>(half a)
 {
-    float f = (float)std::rand() / (float)RAND_MAX;
+    float f = (float)(rng::get().next() >> 40) * (1.f / 16777216.f);
     return (half)(a * f);
 }
 
 template<> inline float rand<float>(float a)
 {
-    float f = (float)std::rand() / (float)RAND_MAX;
+    float f = (float)(rng::get().next() >> 40) * (1.f / 16777216.f);
     return a * f;
 }
 
 template<> inline double rand<double>(double a)
 {
-    double f = (double)std::rand() / (double)RAND_MAX;
+    double f = (double)(rng::get().next() >> 11) * (1.0 / 9007199254740992.0);
     return a * f;
 }
 
 template<> inline ldouble rand<ldouble>(ldouble a)
 {
-    ldouble f = (ldouble)std::rand() / (ldouble)RAND_MAX;
+    ldouble f = (ldouble)rng::get().next()
+              * ((ldouble)1.0 / (ldouble)18446744073709551616.0);
     return a * f;
 }
 
@@ -62,54 +152,17 @@ template<typename T> static inline T rand(T a, T b)
     return a + rand<T>(b - a);
 }
 
-/* Default random number generator */
+/* Default random number generator: use the top bits of the generator
+ * output, leaving the sign bit clear. */
 template<typename T> static inline T rand()
 {
     switch (sizeof(T))
     {
     case 1:
-        return static_cast<T>(std::rand() & 0x7f);
     case 2:
-    {
-        uint16_t ret = std::rand();
-        if (RAND_MAX < 0x7fff)
-            ret = (ret << 7) ^ std::rand();
-        return static_cast<T>(ret & 0x7fffu);
-    }
     case 4:
-    {
-        uint32_t ret = std::rand();
-        if (RAND_MAX >= 0xffff)
-            ret = (ret << 16) ^ std::rand();
-        else
-        {
-            ret = (ret << 8) ^ std::rand();
-            ret = (ret << 8) ^ std::rand();
-            ret = (ret << 8) ^ std::rand();
-        }
-        return static_cast<T>(ret & 0x7fffffffu);
-    }
     case 8:
-    {
-        uint64_t ret = std::rand();
-        if (RAND_MAX >= 0xffff)
-        {
-            ret = (ret << 16) ^ std::rand();
-            ret = (ret << 16) ^ std::rand();
-            ret = (ret << 16) ^ std::rand();
-        }
-        else
-        {
-            ret = (ret << 8) ^ std::rand();
-            ret = (ret << 8) ^ std::rand();
-            ret = (ret << 8) ^ std::rand();
-            ret = (ret << 8) ^ std::rand();
-            ret = (ret << 8) ^ std::rand();
-            ret = (ret << 8) ^ std::rand();
-            ret = (ret << 8) ^ std::rand();
-        }
-        return static_cast<T>(ret & (~(uint64_t)0 >> 1));
-    }
+        return static_cast<T>(rng::get().next() >> (65 - 8 * sizeof(T)));
     default:
         ASSERT(false, "rand() doesn’t support types of size %d\n",
                (int)sizeof(T));
@@ -0,0 +1,154 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// Batch ray casting
+// -----------------
+//
+//  A RayBatch holds many rays and intersects all of them at once with a
+// RayMesh, or with any bounding volume hierarchy flattened to RayBatchNode
+// (see DynamicAABBTree::CastRays). Consecutive rays go through the tree
+// in packets of 4 or 8 with SSE2 or AVX2 when available, so batches are
+// faster when neighbouring rays are alike (e.g. the rays of a screen
+// tile). Large batches are split across threads.
+//
+
+#include <lol/math/vector.h>
+#include <lol/math/geometry.h>
+#include <lol/math/soa.h>
+
+#include <cfloat>
+
+namespace lol
+{
+
+//RayQuery --------------------------------------------------------------------
+struct RayQueryBase : public StructSafeEnum
+{
+    enum Type
+    {
+        //The nearest intersection of each ray
+        ClosestHit,
+        //Any intersection, e.g. for shadows or line of sight
+        AnyHit,
+    };
+protected:
+    virtual bool BuildEnumMap(map<int64_t, String>& enum_map)
+    {
+        enum_map[ClosestHit] = "ClosestHit";
+        enum_map[AnyHit] = "AnyHit";
+        return true;
+    }
+};
+typedef SafeEnum<RayQueryBase> RayQuery;
+
+//RayBatchNode ----------------------------------------------------------------
+//Node of a flattened bounding volume hierarchy, the root being the first
+//one. Inner nodes have their children at m_index and m_index + 1, leaves
+//hold the primitives m_index to m_index + m_count - 1.
+struct RayBatchNode
+{
+    vec3                m_aa;
+    int32_t             m_index;
+    vec3                m_bb;
+    int32_t             m_count;
+};
+
+//Intersection of a ray with a primitive: the distance along dir of the
+//intersection, or a negative value when there is none before tmax
+typedef float (*RayBatchTest)(void const *data, int primitive,
+                              vec3 const &origin, vec3 const &dir,
+                              float tmax);
+
+//RayMesh ---------------------------------------------------------------------
+//Triangles sorted along their bounding volume hierarchy, built with the
+//surface area heuristic
+class RayMesh
+{
+public:
+    RayMesh() {}
+
+    //Build from count indices, three per triangle, into vertices located
+    //stride bytes apart, such as the coordinates of EasyMesh vertices
+    void Build(vec3 const *vertices, uint32_t const *indices, int count,
+               ptrdiff_t stride = sizeof(vec3));
+    void Build(array<vec3> const &vertices, array<uint32_t> const &indices)
+    {
+        Build(vertices.data(), indices.data(), indices.count());
+    }
+
+    void                Empty();
+    int                 GetTriangleCount() const    { return m_ids.count(); }
+    array<RayBatchNode> const &GetNodes() const     { return m_nodes; }
+
+private:
+    friend class RayBatch;
+
+    array<RayBatchNode> m_nodes;
+    //First vertex and two edges of each triangle, in tree order
+    array<vec3>         m_triangles;
+    //Triangle index in the original mesh
+    array<int>          m_ids;
+};
+
+//RayBatch --------------------------------------------------------------------
+class RayBatch
+{
+public:
+    RayBatch() {}
+
+    void Reserve(int count);
+    void Empty();
+
+    //Add a ray going from origin along dir, up to origin + tmax * dir, and
+    //return its index. dir does not need to be normalised.
+    int Push(vec3 const &origin, vec3 const &dir, float tmax = FLT_MAX);
+
+    int                 GetCount() const            { return m_tmax.count(); }
+    vec3                GetOrigin(int ray) const    { return m_origin.get(ray); }
+    vec3                GetDir(int ray) const       { return m_dir.get(ray); }
+
+    //Results of the last query: the primitive each ray hit, or -1, the
+    //distance along dir (tmax for misses) and, for triangles, the
+    //barycentric coordinates of the hit along the second and third vertices
+    bool                IsHit(int ray) const        { return m_hit[ray] >= 0; }
+    int                 GetHit(int ray) const       { return m_hit[ray]; }
+    float               GetDistance(int ray) const  { return m_dist[ray]; }
+    vec2                GetBarycentric(int ray) const { return vec2(m_u[ray], m_v[ray]); }
+    vec3                GetHitPoint(int ray) const  { return GetOrigin(ray) + m_dist[ray] * GetDir(ray); }
+    int                 GetHitCount() const;
+
+    //Every ray against every triangle, for small meshes
+    void IntersectTriangles(vec3 const *vertices, uint32_t const *indices,
+                            int count, RayQuery query,
+                            ptrdiff_t stride = sizeof(vec3));
+    //Triangles of a RayMesh, hits being the original triangle indices
+    void Intersect(RayMesh const &mesh, RayQuery query);
+    //Any hierarchy, test() being called from several threads for the
+    //primitives of the leaves the rays go through
+    void Intersect(array<RayBatchNode> const &nodes, RayQuery query,
+                   RayBatchTest test, void const *data);
+
+private:
+    void Trace(RayBatchNode const *nodes, RayQuery query,
+               RayMesh const *mesh, RayBatchTest test, void const *data);
+
+    soa_array<vec3>     m_origin, m_dir;
+    array<float>        m_tmax;
+
+    array<int>          m_hit;
+    array<float>        m_dist, m_u, m_v;
+};
+
+} /* namespace lol */
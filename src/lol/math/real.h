@@ -39,9 +39,14 @@ template<int N> class Real
 {
 public:
     Real();
-    Real(Real<N> const &x);
-    Real const &operator =(Real<N> const &x);
-    ~Real();
+
+    /* The mantissa is stored inline, so copying and moving are plain
+     * member-wise copies and no real ever touches the heap. */
+    Real(Real<N> const &x) = default;
+    Real(Real<N> &&x) = default;
+    Real<N> &operator =(Real<N> const &x) = default;
+    Real<N> &operator =(Real<N> &&x) = default;
+    ~Real() = default;
 
     Real(float f);
     Real(double f);
@@ -200,14 +205,17 @@ public:
     static Real<N> const& R_SQRT3();
     static Real<N> const& R_SQRT1_2();
 
-    /* XXX: changing this requires tuning real::fres (the number of
-     * Newton-Raphson iterations) and real::print (the number of printed
-     * digits) */
+    /* XXX: changing this requires tuning real::print (the number of
+     * printed digits) */
     static int const BIGITS = N;
     static int const BIGIT_BITS = 32;
 
 private:
-    uint32_t *m_mantissa;
+    /* Multiply using only the first “bigits” bigits of each mantissa,
+     * for Newton iterations that do not need full precision yet. */
+    Real<N> mul(Real<N> const &x, int bigits) const;
+
+    uint32_t m_mantissa[N];
     uint32_t m_signexp;
 };
 
@@ -215,9 +223,6 @@ private:
  * Mandatory forward declarations of template specialisations
  */
 template<> real::Real();
-template<> real::Real(real const &x);
-template<> real const &real::operator =(real const &x);
-template<> real::~Real();
 template<> real::Real(float f);
 template<> real::Real(double f);
 template<> real::Real(long double f);
@@ -238,6 +243,7 @@ template<> real real::operator +(real const &x) const;
 template<> real real::operator -(real const &x) const;
 template<> real real::operator *(real const &x) const;
 template<> real real::operator /(real const &x) const;
+template<> real real::mul(real const &x, int bigits) const;
 template<> real const &real::operator +=(real const &x);
 template<> real const &real::operator -=(real const &x);
 template<> real const &real::operator *=(real const &x);
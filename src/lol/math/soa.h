@@ -0,0 +1,163 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// Structure-of-arrays vector containers
+// -------------------------------------
+//
+//  A soa_array<vec3> stores its x, y and z components in three separate
+// arrays, so that bulk operations such as transform_points() can process
+// 4 or 8 vectors at a time with SSE2 or AVX2 when available.
+//
+
+#include <lol/math/vector.h>
+#include <lol/math/matrix.h>
+
+namespace lol
+{
+
+template<typename T> class soa_array;
+
+template<int N>
+class soa_array<vec_t<float, N>>
+{
+public:
+    typedef vec_t<float, N> element_t;
+
+    inline soa_array() {}
+
+    explicit inline soa_array(ptrdiff_t count)
+    {
+        resize(count);
+    }
+
+    inline int count() const { return m_data[0].count(); }
+
+    void resize(ptrdiff_t count)
+    {
+        for (int k = 0; k < N; ++k)
+            m_data[k].resize(count);
+    }
+
+    void reserve(ptrdiff_t count)
+    {
+        for (int k = 0; k < N; ++k)
+            m_data[k].reserve(count);
+    }
+
+    inline void empty()
+    {
+        for (int k = 0; k < N; ++k)
+            m_data[k].empty();
+    }
+
+    void push(element_t const &v)
+    {
+        for (int k = 0; k < N; ++k)
+            m_data[k].push(v[k]);
+    }
+
+    inline soa_array &operator <<(element_t const &v)
+    {
+        push(v);
+        return *this;
+    }
+
+    element_t get(ptrdiff_t n) const
+    {
+        element_t ret;
+        for (int k = 0; k < N; ++k)
+            ret[k] = m_data[k][n];
+        return ret;
+    }
+
+    void set(ptrdiff_t n, element_t const &v)
+    {
+        for (int k = 0; k < N; ++k)
+            m_data[k][n] = v[k];
+    }
+
+    /* Contiguous storage for one component (0 for x, 1 for y…) */
+    inline float *data(int k) { return m_data[k].data(); }
+    inline float const *data(int k) const { return m_data[k].data(); }
+
+    /* Gather “count” vectors located “stride” bytes apart, such as the
+     * coordinates of an array of vertex structures. */
+    void load(element_t const *src, ptrdiff_t count,
+              ptrdiff_t stride = sizeof(element_t))
+    {
+        resize(count);
+        uint8_t const *p = reinterpret_cast<uint8_t const *>(src);
+        for (ptrdiff_t n = 0; n < count; ++n, p += stride)
+        {
+            element_t const &v = *reinterpret_cast<element_t const *>(p);
+            for (int k = 0; k < N; ++k)
+                m_data[k][n] = v[k];
+        }
+    }
+
+    /* Scatter all vectors back, “stride” bytes apart */
+    void store(element_t *dst, ptrdiff_t stride = sizeof(element_t)) const
+    {
+        uint8_t *p = reinterpret_cast<uint8_t *>(dst);
+        for (ptrdiff_t n = 0; n < count(); ++n, p += stride)
+        {
+            element_t &v = *reinterpret_cast<element_t *>(p);
+            for (int k = 0; k < N; ++k)
+                v[k] = m_data[k][n];
+        }
+    }
+
+private:
+    array<float> m_data[N];
+};
+
+/*
+ * Bulk operations. The output array may be the same as one of the inputs,
+ * and is resized as needed.
+ */
+
+/* p = (m * vec4(p, 1)).xyz for all points, without perspective divide */
+void transform_points(mat4 const &m, soa_array<vec3> const &p,
+                      soa_array<vec3> &out);
+
+/* p = p + v for all points; cheaper and more exact than a translation
+ * matrix, which also turns infinite coordinates into NaNs */
+void translate_points(vec3 const &v, soa_array<vec3> const &p,
+                      soa_array<vec3> &out);
+
+/* v = m * v for all vectors */
+void transform_vectors(mat3 const &m, soa_array<vec3> const &v,
+                       soa_array<vec3> &out);
+void transform_vectors(mat4 const &m, soa_array<vec4> const &v,
+                       soa_array<vec4> &out);
+
+/* out[i] = normalize(v[i]); zero vectors stay zero */
+void normalize_all(soa_array<vec3> const &v, soa_array<vec3> &out);
+void normalize_all(soa_array<vec4> const &v, soa_array<vec4> &out);
+
+/* out[i] = dot(a[i], b[i]); “out” must hold a.count() floats */
+void dot_all(soa_array<vec3> const &a, soa_array<vec3> const &b,
+             float *out);
+void dot_all(soa_array<vec4> const &a, soa_array<vec4> const &b,
+             float *out);
+
+/* out[i] = mix(a[i], b[i], t) */
+void lerp_all(soa_array<vec3> const &a, soa_array<vec3> const &b,
+              float t, soa_array<vec3> &out);
+void lerp_all(soa_array<vec4> const &a, soa_array<vec4> const &b,
+              float t, soa_array<vec4> &out);
+
+} /* namespace lol */
+
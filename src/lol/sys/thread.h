@@ -19,6 +19,7 @@
 //
 
 #include "engine/entity.h"
+#include <lol/sys/timer.h>
 
 #include <functional>
 
@@ -264,6 +265,14 @@ private:
     std::function<void(thread*)> m_function;
 };
 
+// Split [0, count[ into contiguous slices and call fn(begin, end) on each
+// of them in parallel, with at most one thread per core and per min_count
+// items. The calling thread handles the first slice, and the function
+// returns when all slices are done. The other slices go to a pool of
+// worker threads that is shared by all calls and kept until exit.
+void parallel_for(int count, int min_count,
+                  std::function<void(int, int)> const &fn);
+
 //ThreadStatus ----------------------------------------------------------------
 struct ThreadStatusBase : public StructSafeEnum
 {
@@ -13,13 +13,20 @@
 
 #pragma once
 
-#include <chrono>
-#include <thread>
+#include <stdint.h>
 
 //
 // The Timer class
 // ---------------
 //
+//  Times are measured with a monotonic clock with nanosecond resolution.
+// On x86 CPUs with an invariant timestamp counter, it is read directly
+// with rdtsc after a short calibration; otherwise the OS clock is used
+// (CLOCK_MONOTONIC_RAW where available).
+//  The calibration busy-waits for 10 ms. sys::init() runs it at startup;
+// otherwise it happens the first time a Timer is created or Now() is
+// called.
+//
 
 namespace lol
 {
@@ -28,46 +35,64 @@ class Timer
 {
 public:
     Timer()
+      : m_oversleep(DEFAULT_OVERSLEEP)
     {
-        (void)get_seconds(true);
+        Reset();
     }
 
+    /* The current value of the monotonic clock, in nanoseconds since an
+     * unspecified origin. It never goes backwards within a thread. */
+    static int64_t Now();
+
+    /* Whether Now() uses the timestamp counter */
+    static bool HasTsc();
+
     void Reset()
     {
-        (void)get_seconds(true);
+        m_ns = Now();
+    }
+
+    /* Time elapsed since the last Reset() or Get(), then reset */
+    int64_t GetNs()
+    {
+        int64_t const t = Now(), ret = t - m_ns;
+        m_ns = t;
+        return ret;
+    }
+
+    /* Time elapsed since the last Reset() or Get() */
+    int64_t PollNs() const
+    {
+        return Now() - m_ns;
     }
 
+    /* Same as above, in seconds */
     float Get()
     {
-        return get_seconds(true);
+        return (float)((double)GetNs() * 1e-9);
     }
 
-    float Poll()
+    float Poll() const
     {
-        return get_seconds(false);
+        return (float)((double)PollNs() * 1e-9);
     }
 
+    /* Wait until the given time has elapsed since the last Reset() or
+     * Get(). The thread sleeps for most of the time, then spins for the
+     * last part, whose length is adjusted to how much the OS oversleeps. */
+    void WaitNs(int64_t ns);
+
     void Wait(float seconds)
     {
         if (seconds > 0.0f)
-        {
-            float secs_elapsed = get_seconds(false);
-            std::this_thread::sleep_for(std::chrono::duration<float>(seconds - secs_elapsed));
-        }
+            WaitNs((int64_t)((double)seconds * 1e9));
     }
 
 private:
-    std::chrono::steady_clock::time_point m_tp;
+    static int64_t const DEFAULT_OVERSLEEP = 1000000;
 
-    float get_seconds(bool reset)
-    {
-        auto tp = std::chrono::steady_clock::now(), tp0 = m_tp;
-
-        if (reset)
-            m_tp = tp;
-
-        return std::chrono::duration_cast<std::chrono::duration<float>>(tp - tp0).count();
-    }
+    int64_t m_ns;
+    int64_t m_oversleep;
 };
 
 } /* namespace lol */
@@ -11,6 +11,7 @@
 
 #include <lol/engine-internal.h>
 
+#include <cfloat> /* DBL_EPSILON */
 #include <cstdlib> /* free() */
 #include <cstring> /* strdup() */
 
@@ -255,6 +256,184 @@ namespace lol
         return true;
     }
 
+    //Adaptive orientation predicate ------------------------------------------
+    //Based on Shewchuk's "Adaptive Precision Floating-Point Arithmetic and Fast
+    //Robust Geometric Predicates": the determinant is first evaluated with
+    //doubles, and only recomputed with exact expansion arithmetic when it is
+    //too close to zero for its sign to be trusted.
+    //Expansions are arrays of non-overlapping doubles sorted by increasing
+    //magnitude, whose exact sum is the represented value.
+    //All of this relies on every operation being rounded exactly as written,
+    //but the devel and release builds use -ffast-math, which may fold the
+    //error terms to zero, and FMA contraction breaks Dekker's split. Both are
+    //disabled for these functions.
+#if defined _MSC_VER || defined __clang__
+#   pragma float_control(precise, on, push)
+#   if defined __clang__
+#       pragma clang fp contract(off)
+#   else
+#       pragma fp_contract(off)
+#   endif
+#   define LOL_EXACT_FP
+#elif defined __GNUC__
+#   define LOL_EXACT_FP __attribute__((optimize("no-fast-math", "fp-contract=off")))
+#else
+#   define LOL_EXACT_FP
+#endif
+
+    //x + y == a + b, exactly
+    LOL_EXACT_FP static inline void ExactSum(double a, double b, double &x, double &y)
+    {
+        x = a + b;
+        double b_virt = x - a;
+        double a_virt = x - b_virt;
+        y = (a - a_virt) + (b - b_virt);
+    }
+
+    //x + y == a * b, exactly, using Dekker's split
+    LOL_EXACT_FP static inline void ExactProduct(double a, double b, double &x, double &y)
+    {
+        double const splitter = 134217729.0; /* 2^27 + 1 */
+        x = a * b;
+
+        double c = splitter * a, a_hi = c - (c - a), a_lo = a - a_hi;
+        double d = splitter * b, b_hi = d - (d - b), b_lo = b - b_hi;
+        y = a_lo * b_lo - (((x - a_hi * b_hi) - a_lo * b_hi) - a_hi * b_lo);
+    }
+
+    //h = e + b, zero components are dropped. h may be e.
+    LOL_EXACT_FP static int ExpansionGrow(int elen, double const *e, double b, double *h)
+    {
+        int hlen = 0;
+        for (int i = 0; i < elen; i++)
+        {
+            double tail;
+            ExactSum(b, e[i], b, tail);
+            if (tail != 0.0)
+                h[hlen++] = tail;
+        }
+        if (b != 0.0 || hlen == 0)
+            h[hlen++] = b;
+        return hlen;
+    }
+
+    //h = e + f, h must not be f.
+    LOL_EXACT_FP static int ExpansionSum(int elen, double const *e, int flen, double const *f, double *h)
+    {
+        int hlen = elen;
+        for (int i = 0; i < elen; i++)
+            h[i] = e[i];
+        for (int i = 0; i < flen; i++)
+            hlen = ExpansionGrow(hlen, h, f[i], h);
+        return hlen;
+    }
+
+    //h = e * b, zero components are dropped.
+    LOL_EXACT_FP static int ExpansionScale(int elen, double const *e, double b, double *h)
+    {
+        int hlen = 0;
+        double q, tail;
+        ExactProduct(e[0], b, q, tail);
+        if (tail != 0.0)
+            h[hlen++] = tail;
+        for (int i = 1; i < elen; i++)
+        {
+            double p1, p0, sum;
+            ExactProduct(e[i], b, p1, p0);
+            ExactSum(q, p0, sum, tail);
+            if (tail != 0.0)
+                h[hlen++] = tail;
+            ExactSum(p1, sum, q, tail);
+            if (tail != 0.0)
+                h[hlen++] = tail;
+        }
+        if (q != 0.0 || hlen == 0)
+            h[hlen++] = q;
+        return hlen;
+    }
+
+    //Exact 2x2 minor p.x * q.y - q.x * p.y, products of floats are exact doubles.
+    LOL_EXACT_FP static int ExactMinor(vec3 const &p, vec3 const &q, double *h)
+    {
+        double x, y;
+        ExactSum((double)p.x * q.y, -((double)q.x * p.y), x, y);
+        int len = 0;
+        if (y != 0.0)
+            h[len++] = y;
+        if (x != 0.0 || len == 0)
+            h[len++] = x;
+        return len;
+    }
+
+    LOL_EXACT_FP static double Orient3DExact(vec3 const &a, vec3 const &b, vec3 const &c, vec3 const &d)
+    {
+        double ab[2], bc[2], cd[2], da[2], ac[2], bd[2];
+        int ab_len = ExactMinor(a, b, ab), bc_len = ExactMinor(b, c, bc);
+        int cd_len = ExactMinor(c, d, cd), da_len = ExactMinor(d, a, da);
+        int ac_len = ExactMinor(a, c, ac), bd_len = ExactMinor(b, d, bd);
+
+        double tmp[4], abc[6], bcd[6], cda[6], dab[6];
+        int tmp_len, abc_len, bcd_len, cda_len, dab_len;
+        tmp_len = ExpansionSum(cd_len, cd, da_len, da, tmp);
+        cda_len = ExpansionSum(tmp_len, tmp, ac_len, ac, cda);
+        tmp_len = ExpansionSum(da_len, da, ab_len, ab, tmp);
+        dab_len = ExpansionSum(tmp_len, tmp, bd_len, bd, dab);
+        for (int i = 0; i < 2; i++)
+        {
+            ac[i] = -ac[i];
+            bd[i] = -bd[i];
+        }
+        tmp_len = ExpansionSum(ab_len, ab, bc_len, bc, tmp);
+        abc_len = ExpansionSum(tmp_len, tmp, ac_len, ac, abc);
+        tmp_len = ExpansionSum(bc_len, bc, cd_len, cd, tmp);
+        bcd_len = ExpansionSum(tmp_len, tmp, bd_len, bd, bcd);
+
+        double adet[12], bdet[12], cdet[12], ddet[12];
+        int alen = ExpansionScale(bcd_len, bcd, a.z, adet);
+        int blen = ExpansionScale(cda_len, cda, -b.z, bdet);
+        int clen = ExpansionScale(dab_len, dab, c.z, cdet);
+        int dlen = ExpansionScale(abc_len, abc, -d.z, ddet);
+
+        double abdet[24], cddet[24], det[48];
+        int ablen = ExpansionSum(alen, adet, blen, bdet, abdet);
+        int cdlen = ExpansionSum(clen, cdet, dlen, ddet, cddet);
+        int len = ExpansionSum(ablen, abdet, cdlen, cddet, det);
+
+        return det[len - 1];
+    }
+
+    LOL_EXACT_FP double Orient3D(vec3 const &a, vec3 const &b, vec3 const &c, vec3 const &d)
+    {
+        //Error bound for the double evaluation, see Shewchuk's orient3d()
+        double const eps = DBL_EPSILON * 0.5;
+        double const err_bound = (7.0 + 56.0 * eps) * eps;
+
+        double adx = (double)a.x - d.x, bdx = (double)b.x - d.x, cdx = (double)c.x - d.x;
+        double ady = (double)a.y - d.y, bdy = (double)b.y - d.y, cdy = (double)c.y - d.y;
+        double adz = (double)a.z - d.z, bdz = (double)b.z - d.z, cdz = (double)c.z - d.z;
+
+        double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+        double cdxady = cdx * ady, adxcdy = adx * cdy;
+        double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+        double det = adz * (bdxcdy - cdxbdy)
+                   + bdz * (cdxady - adxcdy)
+                   + cdz * (adxbdy - bdxady);
+        double permanent = (lol::abs(bdxcdy) + lol::abs(cdxbdy)) * lol::abs(adz)
+                         + (lol::abs(cdxady) + lol::abs(adxcdy)) * lol::abs(bdz)
+                         + (lol::abs(adxbdy) + lol::abs(bdxady)) * lol::abs(cdz);
+
+        //This determinant is positive when d is below the plane, flip it.
+        if (det > err_bound * permanent || -det > err_bound * permanent)
+            return -det;
+        return -Orient3DExact(a, b, c, d);
+    }
+
+#undef LOL_EXACT_FP
+#if defined _MSC_VER || defined __clang__
+#   pragma float_control(pop)
+#endif
+
     //--
     bool TestPointVsFrustum(const vec3& point, const mat4& frustum, vec3* result_point)
     {
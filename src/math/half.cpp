@@ -10,6 +10,10 @@
 
 #include <lol/engine-internal.h>
 
+#include "simd-private.h"
+
+#include <cstring>
+
 namespace lol
 {
 
@@ -97,6 +101,34 @@ static inline uint16_t float_to_half_branch(uint32_t x)
     return bits;
 }
 
+/* Round to nearest even, with the same results as the F16C instruction
+ * set: values too large for a half become Inf, and NaN values keep the
+ * top bits of their payload and become quiet NaNs. Half denormals are
+ * rounded by the FPU: adding 0.5 aligns the mantissa so that the lowest
+ * bit of the float has the weight of the lowest bit of the half. */
+static inline uint16_t float_to_half_rounded(uint32_t x)
+{
+    uint16_t bits = (x >> 16) & 0x8000u;
+    uint32_t a = x & 0x7fffffffu;
+
+    if (a >= 0x47800000u)
+        return bits | (a > 0x7f800000u ? 0x7e00u | ((a & 0x7fffffu) >> 13)
+                                       : 0x7c00u);
+
+    if (a < 0x38800000u)
+    {
+        union { float f; uint32_t x; } u;
+        u.x = a;
+        u.f += 0.5f;
+        return bits | (u.x - 0x3f000000u);
+    }
+
+    /* Add half an ulp minus one, plus one if the result is odd. A carry
+     * into the exponent is correct, even when it overflows to Inf. */
+    a += 0xc8000fffu + ((a >> 13) & 1);
+    return bits | (a >> 13);
+}
+
 /* We use this magic table, inspired by De Bruijn sequences, to compute a
  * branchless integer log2. The actual value fetched is 24-log2(x+1) for x
  * in 1, 3, 7, f, 1f, 3f, 7f, ff, 1fe, 1ff, 3fc, 3fd, 3fe, 3ff. See
@@ -219,13 +251,233 @@ half::operator float() const
     return u.f;
 }
 
-size_t half::convert(half *dst, float const *src, size_t nelem)
+/*
+ * Array conversions. Without F16C, SSE2 vector code gives exactly the
+ * same results as the scalar functions above, four values at a time.
+ */
+
+#if LOL_SIMD_VECTORS
+typedef uint16_t v4u16 __attribute__((vector_size(8)));
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+typedef int32_t  v4i32 __attribute__((vector_size(16)));
+typedef float    v4f   __attribute__((vector_size(16)));
+
+/* Same as float_to_half_nobranch(). Half denormals are the float value
+ * scaled by 2^24 and truncated to an integer. */
+static inline v4u32 float_to_half_vector(v4u32 x) INLINEATTR;
+
+static inline v4u32 float_to_half_vector(v4u32 x)
+{
+    v4i32 const e = (v4i32)((x >> 23) & 0xffu);
+    v4u32 const m = x & 0x007fffffu;
+
+    v4u32 const normal = ((v4u32)(e - 112) << 10) | (m >> 13);
+    v4u32 const denormal = (v4u32)__builtin_convertvector(
+                         (v4f)(x & 0x7fffffffu) * 16777216.f, v4i32);
+    v4u32 const big = 0x7c00u | ((m >> 13) & (v4u32)(e == 255));
+
+    v4u32 const is_denormal = (v4u32)(e < 113);
+    v4u32 const is_big = (v4u32)(e > 142);
+    v4u32 const is_normal = ~(is_denormal | is_big);
+
+    return ((x >> 16) & 0x8000u) | (normal & is_normal)
+         | (denormal & is_denormal) | (big & is_big);
+}
+
+/* Same as float_to_half_rounded() */
+static inline v4u32 float_to_half_rounded_vector(v4u32 x) INLINEATTR;
+
+static inline v4u32 float_to_half_rounded_vector(v4u32 x)
+{
+    v4u32 const a = x & 0x7fffffffu;
+
+    v4u32 const normal = (a + 0xc8000fffu + ((a >> 13) & 1u)) >> 13;
+    v4u32 const denormal = (v4u32)((v4f)a + 0.5f) - 0x3f000000u;
+    v4u32 const big = 0x7c00u | ((0x0200u | ((a & 0x7fffffu) >> 13))
+                                  & (v4u32)((v4i32)a > 0x7f800000));
+
+    v4u32 const is_denormal = (v4u32)((v4i32)a < 0x38800000);
+    v4u32 const is_big = (v4u32)((v4i32)a >= 0x47800000);
+    v4u32 const is_normal = ~(is_denormal | is_big);
+
+    return ((x >> 16) & 0x8000u) | (normal & is_normal)
+         | (denormal & is_denormal) | (big & is_big);
+}
+
+/* Same as half_to_float_nobranch(). Half denormals are renormalised by
+ * the FPU: the mantissa bits are put in a float of exponent -14, from
+ * which 2^-14 is subtracted. */
+static inline v4u32 half_to_float_vector(v4u32 x) INLINEATTR;
+
+static inline v4u32 half_to_float_vector(v4u32 x)
+{
+    v4u32 const shifted = (x & 0x7fffu) << 13;
+    v4u32 const e = shifted & 0x0f800000u;
+
+    v4u32 ret = shifted + (112u << 23);
+    ret += (v4u32)(e == 0x0f800000u) & (112u << 23);
+
+    v4u32 const denormal = (v4u32)((v4f)(ret + (1u << 23))
+                                    - 6.103515625e-5f);
+    v4u32 const is_denormal = (v4u32)(e == 0u);
+    ret = (ret & ~is_denormal) | (denormal & is_denormal);
+
+    return ret | ((x & 0x8000u) << 16);
+}
+
+template<bool ROUND>
+static size_t float_to_half_sse2(uint16_t *dst, float const *src, size_t n)
+{
+    size_t i = 0;
+    for ( ; i + 4 <= n; i += 4)
+    {
+        v4u32 x;
+        memcpy(&x, src + i, sizeof(x));
+        x = ROUND ? float_to_half_rounded_vector(x) : float_to_half_vector(x);
+        v4u16 h = __builtin_convertvector(x, v4u16);
+        memcpy(dst + i, &h, sizeof(h));
+    }
+    return i;
+}
+
+static size_t half_to_float_sse2(float *dst, uint16_t const *src, size_t n)
 {
-    for (size_t i = 0; i < nelem; i++)
+    size_t i = 0;
+    for ( ; i + 4 <= n; i += 4)
+    {
+        v4u16 h;
+        memcpy(&h, src + i, sizeof(h));
+        v4u32 x = half_to_float_vector(__builtin_convertvector(h, v4u32));
+        memcpy(dst + i, &x, sizeof(x));
+    }
+    return i;
+}
+
+typedef int16_t v8i16 __attribute__((vector_size(16)));
+typedef float   v8f   __attribute__((vector_size(32)));
+
+/* The F16C instructions round to nearest even (imm8 = 0) or toward zero
+ * (imm8 = 3). Rounding toward zero gives the same results as makefast(),
+ * except for values too large for a half, which become 65504 instead of
+ * Inf, and for NaNs, which become quiet; blocks of eight floats with any
+ * such value are converted with the table instead. F16C also turns
+ * signaling NaNs into quiet NaNs when converting to float, which the
+ * other methods do not. */
+template<bool ROUND>
+__attribute__((target("avx,f16c")))
+static size_t float_to_half_f16c(uint16_t *dst, float const *src, size_t n)
+{
+    size_t i = 0;
+    for ( ; i + 8 <= n; i += 8)
+    {
+        v8f x;
+        memcpy(&x, src + i, sizeof(x));
+
+        if (!ROUND)
+        {
+            /* Both comparisons are false for NaNs */
+            v8f const small = (v8f)((x < 65536.f) & (x > -65536.f));
+            if (__builtin_ia32_movmskps256(small) != 0xff)
+            {
+                for (int k = 0; k < 8; ++k)
+                {
+                    union { float f; uint32_t x; } u = { src[i + k] };
+                    dst[i + k] = float_to_half_nobranch(u.x);
+                }
+                continue;
+            }
+        }
+
+        v8i16 h = __builtin_ia32_vcvtps2ph256(x, ROUND ? 0 : 3);
+        memcpy(dst + i, &h, sizeof(h));
+    }
+    return i;
+}
+
+__attribute__((target("avx,f16c")))
+static size_t half_to_float_f16c(float *dst, uint16_t const *src, size_t n)
+{
+    size_t i = 0;
+    for ( ; i + 8 <= n; i += 8)
+    {
+        v8i16 h;
+        memcpy(&h, src + i, sizeof(h));
+        v8f x = __builtin_ia32_vcvtph2ps256(h);
+        memcpy(dst + i, &x, sizeof(x));
+    }
+    return i;
+}
+#endif
+
+static half::conversion g_conversion = half::conversion::automatic;
+
+bool half::set_conversion(conversion c)
+{
+    switch (c)
+    {
+#if !LOL_SIMD_VECTORS
+    case conversion::sse2:
+        return false;
+#endif
+    case conversion::f16c:
+#if LOL_SIMD_VECTORS
+        if (!has_f16c())
+#endif
+            return false;
+        break;
+    default:
+        break;
+    }
+
+    g_conversion = c;
+    return true;
+}
+
+/* The method actually used */
+static half::conversion get_conversion()
+{
+    half::conversion ret = g_conversion;
+
+    if (ret == half::conversion::automatic)
+    {
+#if LOL_SIMD_VECTORS
+        ret = has_f16c() ? half::conversion::f16c
+                         : half::conversion::sse2;
+#else
+        ret = half::conversion::table;
+#endif
+    }
+
+    return ret;
+}
+
+size_t half::convert(half *dst, float const *src, size_t nelem, bool round)
+{
+    uint16_t *out = reinterpret_cast<uint16_t *>(dst);
+    size_t i = 0;
+
+    switch (get_conversion())
+    {
+#if LOL_SIMD_VECTORS
+    case conversion::f16c:
+        i = round ? float_to_half_f16c<true>(out, src, nelem)
+                  : float_to_half_f16c<false>(out, src, nelem);
+        break;
+    case conversion::sse2:
+        i = round ? float_to_half_sse2<true>(out, src, nelem)
+                  : float_to_half_sse2<false>(out, src, nelem);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    for ( ; i < nelem; i++)
     {
         union { float f; uint32_t x; } u;
-        u.f = *src++;
-        *dst++ = makebits(float_to_half_nobranch(u.x));
+        u.f = src[i];
+        out[i] = round ? float_to_half_rounded(u.x)
+                       : float_to_half_nobranch(u.x);
     }
 
     return nelem;
@@ -233,18 +485,34 @@ size_t half::convert(half *dst, float const *src, size_t nelem)
 
 size_t half::convert(float *dst, half const *src, size_t nelem)
 {
-    for (size_t i = 0; i < nelem; i++)
+    uint16_t const *in = reinterpret_cast<uint16_t const *>(src);
+    size_t i = 0;
+
+    switch (get_conversion())
+    {
+#if LOL_SIMD_VECTORS
+    case conversion::f16c:
+        i = half_to_float_f16c(dst, in, nelem);
+        break;
+    case conversion::sse2:
+        i = half_to_float_sse2(dst, in, nelem);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    for ( ; i < nelem; i++)
     {
         union { float f; uint32_t x; } u;
 
         /* This code is really too slow on the PS3, even with the denormal
          * handling stripped off. */
-        u.x = half_to_float_nobranch((*src++).bits);
-        *dst++ = u.f;
+        u.x = half_to_float_nobranch(in[i]);
+        dst[i] = u.f;
     }
 
     return nelem;
 }
 
 } /* namespace lol */
-
@@ -0,0 +1,337 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include "simd-private.h"
+
+namespace lol
+{
+
+/*
+ * Batch kernels for the noise classes
+ * -----------------------------------
+ *
+ *  They are compiled here rather than in the public headers, so that the
+ * lane count does not depend on the flags of the code using them. Each
+ * kernel evaluates L points at once, using GCC vectors of floats and ints
+ * with one lane per point. Other compilers evaluate the points one by one.
+ */
+
+#if LOL_SIMD_VECTORS
+/* Vectors of L floats or ints, and a function to build a float vector
+ * from the values returned by fn(0), fn(1), … */
+template<int L> struct noise_lanes;
+
+template<> struct noise_lanes<4>
+{
+    typedef float f __attribute__((vector_size(4 * sizeof(float))));
+    typedef int32_t i __attribute__((vector_size(4 * sizeof(int32_t))));
+
+    template<typename F>
+    static inline f gather(F const &fn)
+    {
+        return f { fn(0), fn(1), fn(2), fn(3) };
+    }
+};
+
+template<> struct noise_lanes<8>
+{
+    typedef float f __attribute__((vector_size(8 * sizeof(float))));
+    typedef int32_t i __attribute__((vector_size(8 * sizeof(int32_t))));
+
+    template<typename F>
+    static inline f gather(F const &fn)
+    {
+        return f { fn(0), fn(1), fn(2), fn(3), fn(4), fn(5), fn(6), fn(7) };
+    }
+};
+
+template<int N>
+template<int L, typename VI, typename VF>
+void gradient_provider<N>::get_gradients(VI const *origin,
+                                         VF *gradient) const
+{
+    vec_t<float, N> const *g[L];
+    for (int l = 0; l < L; ++l)
+    {
+        int idx = m_seed;
+        for (int i = 0; i < N; ++i)
+            idx = hash(idx, origin[i][l]);
+        g[l] = &m_gradients[idx & (gradient_count - 1)];
+    }
+
+    for (int i = 0; i < N; ++i)
+        gradient[i] = noise_lanes<L>::gather([&](int l)
+        {
+            return (*g[l])[i];
+        });
+}
+
+template<int N>
+template<int L>
+void perlin_noise<N>::eval_batch(vec_t<float, N> const *position,
+                                float *out) const
+{
+    typedef typename noise_lanes<L>::f vf;
+    typedef typename noise_lanes<L>::i vi;
+
+    vi origin[N];
+    vf delta[N], u[N], v[N], multiplier = vf{} + 1.f;
+
+    for (int i = 0; i < N; ++i)
+    {
+        vf x = noise_lanes<L>::gather([&](int l)
+        {
+            return position[l][i];
+        });
+
+        /* “x < 0” is -1 for true lanes */
+        origin[i] = __builtin_convertvector(x, vi) + (x < 0.f);
+        delta[i] = x - __builtin_convertvector(origin[i], vf);
+
+        vf t = delta[i];
+        t = ((6.f * t - 15.f) * t + 10.f) * (t * t * t);
+
+        /* Same as clamp(t, 0.001f, 0.999f) */
+        vf f = t < 0.001f ? vf{} + 0.001f : t;
+        f = 0.999f < f ? vf{} + 0.999f : f;
+
+        multiplier *= (1.f - f);
+        u[i] = (1.f - f) / f;
+        v[i] = f / (1.f - f);
+    }
+
+    vf ret = vf{};
+
+    for (int i = 0; i < (1 << N); ++i)
+    {
+        vf gradient[N], dp = vf{};
+
+        this->template get_gradients<L>(origin, gradient);
+
+        for (int k = 0; k < N; ++k)
+            dp += delta[k] * gradient[k];
+        ret += multiplier * dp;
+
+        if (i + 1 == (1 << N))
+            break;
+
+        int j = i ^ (i >> 1);
+        int k = (i + 1) ^ ((i + 1) >> 1);
+
+        int bit = 0;
+        while ((j ^ k) > (1 << bit))
+            ++bit;
+
+        origin[bit] += j > k ? -1 : 1;
+        delta[bit] += j > k ? 1.f : -1.f;
+        multiplier *= (j > k ? u : v)[bit];
+    }
+
+    ret *= sqrt(2.f);
+    for (int l = 0; l < L; ++l)
+        out[l] = ret[l];
+}
+
+template<int N>
+template<int L>
+void simplex_noise<N>::eval_batch(vec_t<float, N> const *position,
+                                 float *out) const
+{
+    typedef typename noise_lanes<L>::f vf;
+    typedef typename noise_lanes<L>::i vi;
+
+    float const f = sqrt(1.f + N);
+
+    /* The unskewed axis vectors used to walk along simplex edges */
+    float const edge = 1.f * (1 / f - 1) / N;
+    vf const edge_on = vf{} + (1.f + edge), edge_off = vf{} + edge;
+
+    /* Same as skew() then get_origin() */
+    vf pos[N], sum = vf{};
+    vi origin[N];
+    for (int i = 0; i < N; ++i)
+        pos[i] = noise_lanes<L>::gather([&](int l)
+        {
+            return position[l][i];
+        });
+    for (int i = 0; i < N; ++i)
+        sum += pos[i] * 1.f;
+    for (int i = 0; i < N; ++i)
+    {
+        vf x = pos[i] + sum * (f - 1) / (float)N;
+        /* “x < 0” is -1 for true lanes */
+        origin[i] = __builtin_convertvector(x, vi) + (x < 0);
+        pos[i] = x - __builtin_convertvector(origin[i], vf);
+    }
+
+    /* Same bubble sort as get_noise(), with the sorted values stored
+     * alongside the traversal order. */
+    vf key[N];
+    vi order[N];
+    for (int i = 0; i < N; ++i)
+    {
+        key[i] = pos[i];
+        order[i] = vi{} + i;
+    }
+
+    for (int i = 0; i < N; ++i)
+        for (int j = i + 1; j < N; ++j)
+        {
+            vi swap = key[i] < key[j];
+            vf ki = key[i];
+            vi mask = (order[i] ^ order[j]) & swap;
+            key[i] = swap ? key[j] : ki;
+            key[j] = swap ? ki : key[j];
+            order[i] ^= mask;
+            order[j] ^= mask;
+        }
+
+    /* Same as unskew() */
+    vf world_pos[N], world_corner[N];
+    sum = vf{};
+    for (int i = 0; i < N; ++i)
+        sum += pos[i] * 1.f;
+    for (int i = 0; i < N; ++i)
+    {
+        world_pos[i] = pos[i] + sum * (1 / f - 1) / (float)N;
+        world_corner[i] = vf{};
+    }
+
+    vf result = vf{};
+
+    for (int k = 0; k < N + 1; ++k)
+    {
+        vf gradient[N], d = vf{}, dp = vf{};
+
+        this->template get_gradients<L>(origin, gradient);
+
+        for (int i = 0; i < N; ++i)
+        {
+            vf delta = world_pos[i] - world_corner[i];
+            d += delta * delta;
+            dp += gradient[i] * delta;
+        }
+
+        /* Clamping to zero gives a null contribution, which is the
+         * same as skipping the vertex like get_noise() does. */
+        vf t = 1.0f - 2.f * d;
+        t = t > 0.f ? t : vf{};
+        result += t * t * t * t * dp;
+
+        if (k < N)
+        {
+            for (int i = 0; i < N; ++i)
+            {
+                vi on = order[k] == i;
+                world_corner[i] += on ? edge_on : edge_off;
+                origin[i] -= on;
+            }
+        }
+    }
+
+    result *= get_scale();
+    for (int l = 0; l < L; ++l)
+        out[l] = result[l];
+}
+
+template<int N, typename T>
+template<int L>
+void noise_batch<N, T>::eval_fbm_lanes(vec_t<float, N> const *batch,
+                                       float *out, size_t todo, int octaves,
+                                       float lacunarity, float gain) const
+{
+    float ret[batch_size], values[batch_size];
+
+    /* The first octave needs no scaling */
+    for (int l = 0; l < batch_size; l += L)
+        self().template eval_batch<L>(batch + l, ret + l);
+
+    vec_t<float, N> scaled[batch_size];
+    float amplitude = 1.f, frequency = 1.f;
+
+    for (int k = 1; k < octaves; ++k)
+    {
+        amplitude *= gain;
+        frequency *= lacunarity;
+
+        for (int l = 0; l < batch_size; ++l)
+            scaled[l] = frequency * batch[l];
+
+        for (int l = 0; l < batch_size; l += L)
+            self().template eval_batch<L>(scaled + l, values + l);
+
+        for (int l = 0; l < batch_size; ++l)
+            ret[l] += amplitude * values[l];
+    }
+
+    for (size_t l = 0; l < todo; ++l)
+        out[l] = ret[l];
+}
+
+#if LOL_SIMD_AVX2_DISPATCH
+/* Flattening inlines the whole kernel here, so it uses AVX2 too */
+template<typename F>
+__attribute__((target("avx2"), flatten))
+static void noise_avx2(F const &fn)
+{
+    fn();
+}
+#endif
+#endif
+
+template<int N, typename T>
+void noise_batch<N, T>::eval_fbm_batch(vec_t<float, N> const *batch,
+                                       float *out, size_t todo, int octaves,
+                                       float lacunarity, float gain,
+                                       std::true_type) const
+{
+#if LOL_SIMD_AVX2_DISPATCH
+    if (has_avx2())
+    {
+        noise_avx2([&]()
+        {
+            eval_fbm_lanes<8>(batch, out, todo, octaves, lacunarity, gain);
+        });
+        return;
+    }
+#endif
+#if LOL_SIMD_VECTORS && defined __AVX2__
+    eval_fbm_lanes<8>(batch, out, todo, octaves, lacunarity, gain);
+#elif LOL_SIMD_VECTORS
+    eval_fbm_lanes<4>(batch, out, todo, octaves, lacunarity, gain);
+#else
+    eval_fbm_batch(batch, out, todo, octaves, lacunarity, gain,
+                   std::false_type());
+#endif
+}
+
+/* Dimensions 2 to 8, as promised in <lol/math/noise/batch.h> */
+#define LOL_NOISE_BATCH(N, NOISE) \
+    template void noise_batch<N, NOISE<N>>::eval_fbm_batch( \
+        vec_t<float, N> const *, float *, size_t, int, float, float, \
+        std::true_type) const;
+
+#define LOL_NOISE_BATCHES(N) \
+    LOL_NOISE_BATCH(N, perlin_noise) \
+    LOL_NOISE_BATCH(N, simplex_noise)
+
+LOL_NOISE_BATCHES(2)
+LOL_NOISE_BATCHES(3)
+LOL_NOISE_BATCHES(4)
+LOL_NOISE_BATCHES(5)
+LOL_NOISE_BATCHES(6)
+LOL_NOISE_BATCHES(7)
+LOL_NOISE_BATCHES(8)
+
+} /* namespace lol */
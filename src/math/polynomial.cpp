@@ -0,0 +1,162 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include "simd-private.h"
+
+#include <cstring>
+
+namespace lol
+{
+
+/*
+ * Batch polynomial evaluation: Horner’s method is a long chain of
+ * dependent multiply-adds, so several vectors of values are evaluated
+ * side by side to keep the FPU pipelines busy.
+ */
+
+/* Number of independent vectors evaluated at the same time */
+static int const POLY_CHAINS = 4;
+
+#if LOL_SIMD_VECTORS
+typedef float  v4f __attribute__((vector_size(16)));
+typedef float  v8f __attribute__((vector_size(32)));
+typedef double v2d __attribute__((vector_size(16)));
+typedef double v4d __attribute__((vector_size(32)));
+#endif
+
+template<typename V, typename T>
+static inline V poly_load(T const *p) INLINEATTR;
+
+template<typename V, typename T>
+static inline V poly_load(T const *p)
+{
+    V ret;
+    memcpy(&ret, p, sizeof(V));
+    return ret;
+}
+
+template<typename V, typename T>
+static inline void poly_store(T *p, V const &v) INLINEATTR;
+
+template<typename V, typename T>
+static inline void poly_store(T *p, V const &v)
+{
+    memcpy(p, &v, sizeof(V));
+}
+
+/* Evaluate POLY_CHAINS vectors of values starting at x[0] */
+template<typename V, typename T>
+static inline void poly_chains(T const *c, int degree,
+                               T const *x, T *out) INLINEATTR;
+
+template<typename V, typename T>
+static inline void poly_chains(T const *c, int degree,
+                               T const *x, T *out)
+{
+    size_t const lanes = sizeof(V) / sizeof(T);
+
+    V vx[POLY_CHAINS], r[POLY_CHAINS];
+    for (int k = 0; k < POLY_CHAINS; ++k)
+    {
+        vx[k] = poly_load<V>(x + k * lanes);
+        r[k] = vx[k] * c[degree] + c[degree - 1];
+    }
+
+    for (int i = degree - 2; i >= 0; --i)
+        for (int k = 0; k < POLY_CHAINS; ++k)
+            r[k] = r[k] * vx[k] + c[i];
+
+    for (int k = 0; k < POLY_CHAINS; ++k)
+        poly_store(out + k * lanes, r[k]);
+}
+
+template<typename V, typename T>
+static inline void poly_batch(T const *c, int degree, T const *x,
+                              T *out, size_t count) INLINEATTR;
+
+template<typename V, typename T>
+static inline void poly_batch(T const *c, int degree, T const *x,
+                              T *out, size_t count)
+{
+    size_t const step = POLY_CHAINS * sizeof(V) / sizeof(T);
+
+    size_t i = 0;
+    for ( ; i + step <= count; i += step)
+        poly_chains<V>(c, degree, x + i, out + i);
+
+    if (i == count)
+        return;
+
+    /* Copy the last few values to a zero-padded buffer */
+    size_t const n = count - i;
+    T tmp[2][step];
+    memset(tmp, 0, sizeof(tmp));
+    memcpy(tmp[0], x + i, n * sizeof(T));
+    poly_chains<V>(c, degree, tmp[0], tmp[1]);
+    memcpy(out + i, tmp[1], n * sizeof(T));
+}
+
+#if LOL_SIMD_AVX2_DISPATCH
+template<typename V, typename T>
+__attribute__((target("avx2,fma")))
+static void poly_batch_avx2(T const *c, int degree, T const *x,
+                            T *out, size_t count)
+{
+    poly_batch<V>(c, degree, x, out, count);
+}
+#endif
+
+template<typename T>
+static void poly_eval(T const *c, int degree, T const *x, T *out,
+                      size_t count)
+{
+    /* Constant polynomials need no multiplication at all */
+    if (degree < 1)
+    {
+        for (size_t n = 0; n < count; ++n)
+            out[n] = degree < 0 ? T(0) : c[0];
+        return;
+    }
+
+#if LOL_SIMD_VECTORS
+    typedef typename std::conditional<sizeof(T) == 4, v8f, v4d>::type wide_t;
+    typedef typename std::conditional<sizeof(T) == 4, v4f, v2d>::type narrow_t;
+#   if LOL_SIMD_AVX2_DISPATCH
+    if (has_avx2() && has_fma())
+        return poly_batch_avx2<wide_t>(c, degree, x, out, count);
+#   endif
+#   if defined __AVX2__
+    poly_batch<wide_t>(c, degree, x, out, count);
+#   else
+    poly_batch<narrow_t>(c, degree, x, out, count);
+#   endif
+#else
+    poly_batch<T>(c, degree, x, out, count);
+#endif
+}
+
+void polynomial_eval(float const *c, int degree,
+                     float const *x, float *out, size_t count)
+{
+    poly_eval(c, degree, x, out, count);
+}
+
+void polynomial_eval(double const *c, int degree,
+                     double const *x, double *out, size_t count)
+{
+    poly_eval(c, degree, x, out, count);
+}
+
+} /* namespace lol */
+
@@ -0,0 +1,272 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include "simd-private.h"
+
+#include <cstring>
+
+namespace lol
+{
+
+/*
+ * Seeding and jumping
+ */
+
+void rng::seed(uint64_t seed)
+{
+    /* Expand the seed with splitmix64, as recommended by the authors of
+     * xoshiro, so that similar seeds give unrelated states. */
+    for (int i = 0; i < 4; ++i)
+    {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        m_state[i] = z ^ (z >> 31);
+    }
+
+    m_lanes_ready = false;
+}
+
+void rng::jump(uint64_t const *poly)
+{
+    uint64_t s[4] = { 0, 0, 0, 0 };
+
+    for (int i = 0; i < 4; ++i)
+        for (int b = 0; b < 64; ++b)
+        {
+            if (poly[i] & ((uint64_t)1 << b))
+                for (int k = 0; k < 4; ++k)
+                    s[k] ^= m_state[k];
+            next();
+        }
+
+    memcpy(m_state, s, sizeof(s));
+
+    /* The extra streams must follow the new state */
+    m_lanes_ready = false;
+}
+
+void rng::jump()
+{
+    static uint64_t const poly[4] =
+    {
+        0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull,
+        0xa9582618e03fc9aaull, 0x39abdc4529b1661cull,
+    };
+
+    jump(poly);
+}
+
+void rng::long_jump()
+{
+    static uint64_t const poly[4] =
+    {
+        0x76e15d3efefdcbbfull, 0xc5004e441c522fb3ull,
+        0x77710069854ee241ull, 0x39109bb02acbe635ull,
+    };
+
+    jump(poly);
+}
+
+rng rng::thread_default()
+{
+    /* The generator for the next thread to ask for one */
+    static rng next_thread(0);
+    static mutex lock;
+
+    lock.lock();
+    rng ret = next_thread;
+    next_thread.jump();
+    lock.unlock();
+
+    return ret;
+}
+
+/*
+ * Bulk generation: run the generator and its three extra streams side by
+ * side, one per 64-bit vector lane. Each step yields 256 random bits that
+ * become eight 32-bit integers or floats.
+ */
+
+enum
+{
+    RNG_UINT32,
+    RNG_FLOAT,
+};
+
+#if LOL_SIMD_VECTORS
+typedef uint64_t v4u64 __attribute__((vector_size(32)));
+typedef uint32_t v8u32 __attribute__((vector_size(32)));
+typedef int32_t  v8i32 __attribute__((vector_size(32)));
+typedef float    v8f   __attribute__((vector_size(32)));
+
+template<int OP>
+static inline void rng_fill_steps(uint64_t state[4][4], void *out,
+                                  size_t steps)
+{
+    v4u64 s[4];
+    for (int i = 0; i < 4; ++i)
+        memcpy(&s[i], state[i], sizeof(s[i]));
+
+    for (size_t n = 0; n < steps; ++n)
+    {
+        /* x * 5 and x * 9 as shifts, for targets without vector
+         * 64-bit multiplies */
+        v4u64 x = (s[1] << 2) + s[1];
+        x = (x << 7) | (x >> 57);
+        x = (x << 3) + x;
+
+        v4u64 const t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = (s[3] << 45) | (s[3] >> 19);
+
+        if (OP == RNG_UINT32)
+        {
+            memcpy((uint32_t *)out + 8 * n, &x, sizeof(x));
+        }
+        else
+        {
+            v8i32 bits = (v8i32)((v8u32)x >> 8);
+            v8f f = __builtin_convertvector(bits, v8f) * (1.f / 16777216.f);
+            memcpy((float *)out + 8 * n, &f, sizeof(f));
+        }
+    }
+
+    for (int i = 0; i < 4; ++i)
+        memcpy(state[i], &s[i], sizeof(s[i]));
+}
+
+#if LOL_SIMD_AVX2_DISPATCH
+template<int OP>
+__attribute__((target("avx2")))
+static void rng_fill_steps_avx2(uint64_t state[4][4], void *out,
+                                size_t steps)
+{
+    rng_fill_steps<OP>(state, out, steps);
+}
+#endif
+#else
+template<int OP>
+static inline void rng_fill_steps(uint64_t state[4][4], void *out,
+                                  size_t steps)
+{
+    for (size_t n = 0; n < steps; ++n)
+        for (int l = 0; l < 4; ++l)
+        {
+            uint64_t x = state[1][l] * 5;
+            x = ((x << 7) | (x >> 57)) * 9;
+
+            uint64_t const t = state[1][l] << 17;
+            state[2][l] ^= state[0][l];
+            state[3][l] ^= state[1][l];
+            state[1][l] ^= state[2][l];
+            state[0][l] ^= state[3][l];
+            state[2][l] ^= t;
+            state[3][l] = (state[3][l] << 45) | (state[3][l] >> 19);
+
+            /* Same memory layout as the vector version on little-endian
+             * machines: lower half first. */
+            uint32_t bits[2] = { (uint32_t)x, (uint32_t)(x >> 32) };
+            for (int k = 0; k < 2; ++k)
+            {
+                if (OP == RNG_UINT32)
+                    ((uint32_t *)out)[8 * n + 2 * l + k] = bits[k];
+                else
+                    ((float *)out)[8 * n + 2 * l + k]
+                        = (float)(int32_t)(bits[k] >> 8) * (1.f / 16777216.f);
+            }
+        }
+}
+#endif
+
+void rng::init_lanes()
+{
+    /* The extra streams start 1, 2 and 3 long jumps ahead */
+    rng tmp = *this;
+    for (int l = 0; l < 3; ++l)
+    {
+        tmp.long_jump();
+        for (int i = 0; i < 4; ++i)
+            m_lanes[i][l] = tmp.m_state[i];
+    }
+
+    m_lanes_ready = true;
+}
+
+template<int OP, typename T>
+void rng::fill(T *out, size_t count)
+{
+    size_t const steps = count / 8;
+
+    if (steps)
+    {
+        if (!m_lanes_ready)
+            init_lanes();
+
+        /* One row per state word, one column per stream */
+        uint64_t state[4][4];
+        for (int i = 0; i < 4; ++i)
+        {
+            state[i][0] = m_state[i];
+            for (int l = 0; l < 3; ++l)
+                state[i][l + 1] = m_lanes[i][l];
+        }
+
+#if LOL_SIMD_AVX2_DISPATCH
+        if (has_avx2())
+            rng_fill_steps_avx2<OP>(state, out, steps);
+        else
+#endif
+        rng_fill_steps<OP>(state, out, steps);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            m_state[i] = state[i][0];
+            for (int l = 0; l < 3; ++l)
+                m_lanes[i][l] = state[i][l + 1];
+        }
+    }
+
+    /* The remaining values come from the main stream */
+    for (size_t n = steps * 8; n < count; n += 2)
+    {
+        uint64_t x = next();
+        uint32_t bits[2] = { (uint32_t)x, (uint32_t)(x >> 32) };
+        for (size_t k = 0; k < 2 && n + k < count; ++k)
+        {
+            if (OP == RNG_UINT32)
+                ((uint32_t *)out)[n + k] = bits[k];
+            else
+                ((float *)out)[n + k] = (float)(int32_t)(bits[k] >> 8)
+                                      * (1.f / 16777216.f);
+        }
+    }
+}
+
+void rng::fill(uint32_t *out, size_t count)
+{
+    fill<RNG_UINT32>(out, count);
+}
+
+void rng::fill(float *out, size_t count)
+{
+    fill<RNG_FLOAT>(out, count);
+}
+
+} /* namespace lol */
+
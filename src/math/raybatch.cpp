@@ -0,0 +1,800 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include "simd-private.h"
+
+#include <algorithm> /* std::partition, std::nth_element */
+#include <cstring>
+#include <functional>
+
+namespace lol
+{
+
+/* Below this many rays per thread, threads cost more than they save */
+static int const RAYBATCH_THREAD_MIN_RAYS = 512;
+
+/* Threads get whole packets, whatever the packet size */
+static int const RAYBATCH_MAX_LANES = 8;
+
+/* RayMesh leaves hold at most this many triangles, and the SAH build tries
+ * this many split positions along each axis */
+static int const RAYMESH_LEAF_SIZE = 4;
+static int const RAYMESH_BINS = 16;
+
+/*
+ * Kernels trace packets of “lanes” consecutive rays, using GCC vectors of
+ * floats when available and plain floats otherwise, like the soa_array
+ * functions. A packet visits every node that any of its rays goes through.
+ */
+
+template<typename V> struct ray_lanes
+{
+    typedef bool mask;
+    typedef int32_t index;
+    static int const count = 1;
+};
+
+static inline float ray_select(bool m, float a, float b) { return m ? a : b; }
+static inline int32_t ray_select(bool m, int32_t a, int32_t b) { return m ? a : b; }
+static inline int ray_bits(bool m) { return m ? 1 : 0; }
+static inline float ray_lane(float v, int) { return v; }
+static inline void ray_set_lane(float &v, int, float x) { v = x; }
+static inline void ray_set_lane(int32_t &v, int, int32_t x) { v = x; }
+
+#if LOL_SIMD_VECTORS
+typedef float   v4f __attribute__((vector_size(16)));
+typedef int32_t v4i __attribute__((vector_size(16)));
+typedef float   v8f __attribute__((vector_size(32)));
+typedef int32_t v8i __attribute__((vector_size(32)));
+
+template<> struct ray_lanes<v4f>
+{
+    typedef v4i mask;
+    typedef v4i index;
+    static int const count = 4;
+};
+
+template<> struct ray_lanes<v8f>
+{
+    typedef v8i mask;
+    typedef v8i index;
+    static int const count = 8;
+};
+
+/* Comparisons give lanes of all ones or all zeros */
+template<typename V, typename M>
+static inline V ray_select(M m, V a, V b) INLINEATTR;
+
+template<typename V, typename M>
+static inline V ray_select(M m, V a, V b)
+{
+    return (V)(((M)a & m) | ((M)b & ~m));
+}
+
+/* One bit per lane, using the SSE sign mask instruction that every
+ * target with vectors has */
+static inline int ray_bits(v4i m) INLINEATTR;
+static inline int ray_bits(v8i m) INLINEATTR;
+
+static inline int ray_bits(v4i m)
+{
+    return __builtin_ia32_movmskps((v4f)m);
+}
+
+static inline int ray_bits(v8i m)
+{
+    v4i half[2];
+    memcpy(half, &m, sizeof(m));
+    return ray_bits(half[0]) | ray_bits(half[1]) << 4;
+}
+
+template<typename V>
+static inline float ray_lane(V const &v, int l) INLINEATTR;
+
+template<typename V>
+static inline float ray_lane(V const &v, int l)
+{
+    return v[l];
+}
+
+template<typename V, typename T>
+static inline void ray_set_lane(V &v, int l, T x) INLINEATTR;
+
+template<typename V, typename T>
+static inline void ray_set_lane(V &v, int l, T x)
+{
+    v[l] = x;
+}
+#endif
+
+template<typename V, typename T>
+static inline V ray_splat(T x) INLINEATTR;
+
+template<typename V, typename T>
+static inline V ray_splat(T x)
+{
+    V ret = {};
+    return ret + x;
+}
+
+template<typename V>
+static inline V ray_min(V a, V b) INLINEATTR;
+
+template<typename V>
+static inline V ray_min(V a, V b)
+{
+    return a < b ? a : b;
+}
+
+template<typename V>
+static inline V ray_max(V a, V b) INLINEATTR;
+
+template<typename V>
+static inline V ray_max(V a, V b)
+{
+    return a > b ? a : b;
+}
+
+struct ray_args
+{
+    float const *origin[3], *dir[3], *tmax;
+    int32_t *hit;
+    float *dist, *u, *v;
+    int count;
+    bool any_hit;
+};
+
+template<typename V>
+struct ray_packet
+{
+    typedef typename ray_lanes<V>::index I;
+
+    V org[3], dir[3], inv[3];
+    /* The distance rays still need to look at: the closest hit so far,
+     * or -1 once any hit will do and one was found */
+    V tmax;
+    V dist, u, v;
+    I hit;
+};
+
+/* Full packets are copied directly, the last one goes through a padded
+ * buffer where extra rays have a negative tmax and never hit anything */
+template<typename V>
+static inline void ray_load(ray_packet<V> &p, ray_args const &args,
+                            int i) INLINEATTR;
+
+template<typename V>
+static inline void ray_load(ray_packet<V> &p, ray_args const &args, int i)
+{
+    int const lanes = ray_lanes<V>::count;
+    int const n = lol::min(lanes, args.count - i);
+
+    float tmp[7][lanes];
+    float const *src[7] = { args.origin[0], args.origin[1], args.origin[2],
+                            args.dir[0], args.dir[1], args.dir[2],
+                            args.tmax };
+    for (int k = 0; k < 7; ++k)
+        src[k] += i;
+
+    if (n < lanes)
+    {
+        for (int k = 0; k < 7; ++k)
+        {
+            memcpy(tmp[k], src[k], n * sizeof(float));
+            for (int l = n; l < lanes; ++l)
+                tmp[k][l] = k < 6 ? 1.f : -1.f;
+            src[k] = tmp[k];
+        }
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+        memcpy(&p.org[k], src[k], sizeof(V));
+        memcpy(&p.dir[k], src[k + 3], sizeof(V));
+        /* Zero components give infinities, which the slab test handles */
+        p.inv[k] = 1.f / p.dir[k];
+    }
+    memcpy(&p.tmax, src[6], sizeof(V));
+
+    p.dist = p.tmax;
+    p.u = p.v = ray_splat<V>(0.f);
+    p.hit = ray_splat<typename ray_packet<V>::I>(-1);
+}
+
+template<typename V>
+static inline void ray_store(ray_packet<V> const &p, ray_args const &args,
+                             int i) INLINEATTR;
+
+template<typename V>
+static inline void ray_store(ray_packet<V> const &p, ray_args const &args, int i)
+{
+    int const lanes = ray_lanes<V>::count;
+    int const n = lol::min(lanes, args.count - i);
+
+    if (n == lanes)
+    {
+        memcpy(args.dist + i, &p.dist, sizeof(V));
+        memcpy(args.u + i, &p.u, sizeof(V));
+        memcpy(args.v + i, &p.v, sizeof(V));
+        memcpy(args.hit + i, &p.hit, sizeof(p.hit));
+        return;
+    }
+
+    float tmp[3][lanes];
+    int32_t hit[lanes];
+    memcpy(tmp[0], &p.dist, sizeof(V));
+    memcpy(tmp[1], &p.u, sizeof(V));
+    memcpy(tmp[2], &p.v, sizeof(V));
+    memcpy(hit, &p.hit, sizeof(hit));
+
+    memcpy(args.dist + i, tmp[0], n * sizeof(float));
+    memcpy(args.u + i, tmp[1], n * sizeof(float));
+    memcpy(args.v + i, tmp[2], n * sizeof(float));
+    memcpy(args.hit + i, hit, n * sizeof(int32_t));
+}
+
+/* Slab test of all rays against a box; tnear is where they enter it */
+template<typename V>
+static inline typename ray_lanes<V>::mask
+ray_slab(ray_packet<V> const &p, RayBatchNode const &node, V &tnear) INLINEATTR;
+
+template<typename V>
+static inline typename ray_lanes<V>::mask
+ray_slab(ray_packet<V> const &p, RayBatchNode const &node, V &tnear)
+{
+    V t0 = (node.m_aa.x - p.org[0]) * p.inv[0];
+    V t1 = (node.m_bb.x - p.org[0]) * p.inv[0];
+    V tmin = ray_min(t0, t1), tmax = ray_max(t0, t1);
+
+    for (int k = 1; k < 3; ++k)
+    {
+        t0 = (node.m_aa[k] - p.org[k]) * p.inv[k];
+        t1 = (node.m_bb[k] - p.org[k]) * p.inv[k];
+        tmin = ray_max(tmin, ray_min(t0, t1));
+        tmax = ray_min(tmax, ray_max(t0, t1));
+    }
+
+    tnear = ray_max(tmin, ray_splat<V>(0.f));
+    return tnear <= ray_min(tmax, p.tmax);
+}
+
+/* Möller–Trumbore, one triangle against all rays of a packet */
+struct ray_mesh_leaf
+{
+    vec3 const *triangles;
+    bool any_hit;
+
+    template<typename V>
+    INLINEATTR inline void operator()(ray_packet<V> &p,
+                                      RayBatchNode const &node, int) const
+    {
+        typedef typename ray_lanes<V>::mask M;
+        typedef typename ray_packet<V>::I I;
+
+        for (int i = node.m_index; i < node.m_index + node.m_count; ++i)
+        {
+            vec3 const &v0 = triangles[3 * i];
+            vec3 const &e1 = triangles[3 * i + 1];
+            vec3 const &e2 = triangles[3 * i + 2];
+
+            V px = p.dir[1] * e2.z - p.dir[2] * e2.y;
+            V py = p.dir[2] * e2.x - p.dir[0] * e2.z;
+            V pz = p.dir[0] * e2.y - p.dir[1] * e2.x;
+            V inv_det = 1.f / (px * e1.x + py * e1.y + pz * e1.z);
+
+            V tx = p.org[0] - v0.x, ty = p.org[1] - v0.y, tz = p.org[2] - v0.z;
+            V u = (tx * px + ty * py + tz * pz) * inv_det;
+
+            V qx = ty * e1.z - tz * e1.y;
+            V qy = tz * e1.x - tx * e1.z;
+            V qz = tx * e1.y - ty * e1.x;
+            V v = (p.dir[0] * qx + p.dir[1] * qy + p.dir[2] * qz) * inv_det;
+            V t = (e2.x * qx + e2.y * qy + e2.z * qz) * inv_det;
+
+            /* Rays parallel to the triangle get NaNs, and fail all tests */
+            M m = (u >= 0.f) & (v >= 0.f) & (u + v <= 1.f)
+                & (t > 0.f) & (t < p.tmax);
+            if (!ray_bits(m))
+                continue;
+
+            p.dist = ray_select(m, t, p.dist);
+            p.u = ray_select(m, u, p.u);
+            p.v = ray_select(m, v, p.v);
+            p.hit = ray_select(m, ray_splat<I>(i), p.hit);
+            p.tmax = ray_select(m, any_hit ? ray_splat<V>(-1.f) : t, p.tmax);
+        }
+    }
+};
+
+/* User primitives, one ray at a time */
+struct ray_test_leaf
+{
+    RayBatchTest test;
+    void const *data;
+    bool any_hit;
+
+    template<typename V>
+    INLINEATTR inline void operator()(ray_packet<V> &p,
+                                      RayBatchNode const &node, int bits) const
+    {
+        for (int l = 0; l < ray_lanes<V>::count; ++l)
+        {
+            if (!(bits & (1 << l)))
+                continue;
+
+            vec3 origin(ray_lane(p.org[0], l), ray_lane(p.org[1], l),
+                        ray_lane(p.org[2], l));
+            vec3 dir(ray_lane(p.dir[0], l), ray_lane(p.dir[1], l),
+                     ray_lane(p.dir[2], l));
+
+            for (int i = node.m_index; i < node.m_index + node.m_count; ++i)
+            {
+                float tmax = ray_lane(p.tmax, l);
+                if (tmax < 0.f)
+                    break;
+
+                float t = test(data, i, origin, dir, tmax);
+                if (t < 0.f || t >= tmax)
+                    continue;
+
+                ray_set_lane(p.dist, l, t);
+                ray_set_lane(p.hit, l, (int32_t)i);
+                ray_set_lane(p.tmax, l, any_hit ? -1.f : t);
+            }
+        }
+    }
+};
+
+/* Depth-first traversal, nearest child first. The stack is kept across
+ * packets to avoid allocations. */
+template<typename V, typename LEAF>
+static inline void ray_trace(ray_packet<V> &p, RayBatchNode const *nodes,
+                             array<int> &stack, LEAF const &leaf) INLINEATTR;
+
+template<typename V, typename LEAF>
+static inline void ray_trace(ray_packet<V> &p, RayBatchNode const *nodes,
+                             array<int> &stack, LEAF const &leaf)
+{
+    V near0, near1;
+    int *buf = stack.data();
+    int node = 0, size = 0;
+    int bits = ray_bits(ray_slab(p, nodes[0], near0));
+
+    while (bits)
+    {
+        RayBatchNode const &n = nodes[node];
+        if (n.m_count)
+        {
+            leaf(p, n, bits);
+            /* Rays that found any hit are done */
+            if (!ray_bits(p.tmax >= 0.f))
+                return;
+            bits = 0;
+        }
+        else
+        {
+            int bits0 = ray_bits(ray_slab(p, nodes[n.m_index], near0));
+            int bits1 = ray_bits(ray_slab(p, nodes[n.m_index + 1], near1));
+            if (bits0 && bits1)
+            {
+                /* Judge distances on the first ray that enters both */
+                int both = bits0 & bits1, l = 0;
+                while (both && !(both & (1 << l)))
+                    ++l;
+                bool swap = both && ray_lane(near1, l) < ray_lane(near0, l);
+
+                if (size == stack.count())
+                {
+                    stack.resize(2 * size);
+                    buf = stack.data();
+                }
+                buf[size++] = n.m_index + (swap ? 0 : 1);
+                node = n.m_index + (swap ? 1 : 0);
+                bits = swap ? bits1 : bits0;
+                continue;
+            }
+
+            node = n.m_index + (bits0 ? 0 : 1);
+            bits = bits0 | bits1;
+        }
+
+        /* Test popped nodes again: closer hits may have been found since
+         * they were pushed */
+        while (!bits && size)
+        {
+            node = buf[--size];
+            bits = ray_bits(ray_slab(p, nodes[node], near0));
+        }
+    }
+}
+
+template<typename V, typename LEAF>
+static inline void ray_batch(ray_args const &args, RayBatchNode const *nodes,
+                             LEAF const &leaf, int begin, int end) INLINEATTR;
+
+template<typename V, typename LEAF>
+static inline void ray_batch(ray_args const &args, RayBatchNode const *nodes,
+                             LEAF const &leaf, int begin, int end)
+{
+    array<int> stack;
+    stack.resize(64);
+
+    for (int i = begin; i < end; i += ray_lanes<V>::count)
+    {
+        ray_packet<V> p;
+        ray_load(p, args, i);
+        ray_trace(p, nodes, stack, leaf);
+        ray_store(p, args, i);
+    }
+}
+
+#if LOL_SIMD_AVX2_DISPATCH
+template<typename LEAF>
+__attribute__((target("avx2")))
+static void ray_batch_avx2(ray_args const &args, RayBatchNode const *nodes,
+                           LEAF const &leaf, int begin, int end)
+{
+    ray_batch<v8f>(args, nodes, leaf, begin, end);
+}
+#endif
+
+template<typename LEAF>
+static void ray_batch(ray_args const &args, RayBatchNode const *nodes,
+                      LEAF const &leaf, int begin, int end)
+{
+#if LOL_SIMD_VECTORS
+#   if LOL_SIMD_AVX2_DISPATCH
+    if (has_avx2())
+        return ray_batch_avx2(args, nodes, leaf, begin, end);
+#   endif
+#   if defined __AVX2__
+    ray_batch<v8f>(args, nodes, leaf, begin, end);
+#   else
+    ray_batch<v4f>(args, nodes, leaf, begin, end);
+#   endif
+#else
+    ray_batch<float>(args, nodes, leaf, begin, end);
+#endif
+}
+
+/* Split [0, count[ into chunks of whole packets and trace them on all
+ * available cores if there are enough rays */
+static void ray_parallel(int count, std::function<void(int, int)> const &fn)
+{
+    int const packets = (count + RAYBATCH_MAX_LANES - 1) / RAYBATCH_MAX_LANES;
+
+    parallel_for(packets, RAYBATCH_THREAD_MIN_RAYS / RAYBATCH_MAX_LANES,
+                 [&](int p0, int p1)
+    {
+        fn(p0 * RAYBATCH_MAX_LANES, lol::min(p1 * RAYBATCH_MAX_LANES, count));
+    });
+}
+
+//-----------------------------------------------------------------------------
+static inline float ray_half_area(vec3 const &extent)
+{
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+void RayMesh::Build(vec3 const *vertices, uint32_t const *indices, int count,
+                    ptrdiff_t stride)
+{
+    Empty();
+
+    int const tcount = count / 3;
+    if (!tcount)
+        return;
+
+    uint8_t const *base = reinterpret_cast<uint8_t const *>(vertices);
+    auto vertex = [&](int i) -> vec3 const &
+    {
+        return *reinterpret_cast<vec3 const *>(base + indices[i] * stride);
+    };
+
+    array<box3> boxes;
+    array<vec3> centers;
+    array<int> order;
+    boxes.resize(tcount);
+    centers.resize(tcount);
+    order.resize(tcount);
+    for (int t = 0; t < tcount; ++t)
+    {
+        vec3 const &p0 = vertex(3 * t), &p1 = vertex(3 * t + 1), &p2 = vertex(3 * t + 2);
+        boxes[t] = box3(min(min(p0, p1), p2), max(max(p0, p1), p2));
+        centers[t] = boxes[t].center();
+        order[t] = t;
+    }
+
+    //Each task is a node and the range of triangles below it
+    array<ivec3> tasks;
+    m_nodes.push(RayBatchNode());
+    tasks << ivec3(0, 0, tcount);
+
+    while (tasks.count())
+    {
+        ivec3 task = tasks.pop();
+        int const node = task.x, begin = task.y, end = task.z;
+
+        box3 bounds = boxes[order[begin]];
+        box3 cbounds(centers[order[begin]], centers[order[begin]]);
+        for (int i = begin + 1; i < end; ++i)
+        {
+            bounds.aa = min(bounds.aa, boxes[order[i]].aa);
+            bounds.bb = max(bounds.bb, boxes[order[i]].bb);
+            cbounds.aa = min(cbounds.aa, centers[order[i]]);
+            cbounds.bb = max(cbounds.bb, centers[order[i]]);
+        }
+        m_nodes[node].m_aa = bounds.aa;
+        m_nodes[node].m_bb = bounds.bb;
+
+        if (end - begin <= RAYMESH_LEAF_SIZE)
+        {
+            m_nodes[node].m_index = begin;
+            m_nodes[node].m_count = end - begin;
+            continue;
+        }
+
+        //Binned SAH: the split that minimises the sum of the child areas
+        //times their triangle counts
+        int best_axis = -1, best_bin = 0;
+        float best_cost = FLT_MAX;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float const lo = cbounds.aa[axis], hi = cbounds.bb[axis];
+            if (!(hi > lo))
+                continue;
+
+            float const scale = RAYMESH_BINS / (hi - lo);
+            int bin_count[RAYMESH_BINS] = { 0 };
+            box3 bin_box[RAYMESH_BINS];
+            for (int i = begin; i < end; ++i)
+            {
+                int t = order[i];
+                int b = lol::min((int)((centers[t][axis] - lo) * scale), RAYMESH_BINS - 1);
+                bin_box[b] = bin_count[b]++ ? box3(min(bin_box[b].aa, boxes[t].aa),
+                                                   max(bin_box[b].bb, boxes[t].bb))
+                                            : boxes[t];
+            }
+
+            //Areas and counts on the right of each split, then sweep left
+            float right_cost[RAYMESH_BINS];
+            box3 acc;
+            int n = 0;
+            for (int b = RAYMESH_BINS - 1; b > 0; --b)
+            {
+                if (bin_count[b])
+                {
+                    acc = n ? box3(min(acc.aa, bin_box[b].aa), max(acc.bb, bin_box[b].bb))
+                            : bin_box[b];
+                    n += bin_count[b];
+                }
+                right_cost[b] = n ? n * ray_half_area(acc.extent()) : 0.f;
+            }
+
+            n = 0;
+            for (int b = 0; b < RAYMESH_BINS - 1; ++b)
+            {
+                if (bin_count[b])
+                {
+                    acc = n ? box3(min(acc.aa, bin_box[b].aa), max(acc.bb, bin_box[b].bb))
+                            : bin_box[b];
+                    n += bin_count[b];
+                }
+                if (!n || n == end - begin)
+                    continue;
+
+                float cost = n * ray_half_area(acc.extent()) + right_cost[b + 1];
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = b;
+                }
+            }
+        }
+
+        int *first = order.data() + begin, *last = order.data() + end;
+        int *middle = first;
+        if (best_axis >= 0)
+        {
+            float const lo = cbounds.aa[best_axis];
+            float const scale = RAYMESH_BINS / (cbounds.bb[best_axis] - lo);
+            middle = std::partition(first, last, [&](int t)
+            {
+                int b = lol::min((int)((centers[t][best_axis] - lo) * scale), RAYMESH_BINS - 1);
+                return b <= best_bin;
+            });
+        }
+
+        //Identical centres: split in the middle of the range
+        if (middle == first || middle == last)
+        {
+            middle = first + (end - begin) / 2;
+            int axis = 0;
+            vec3 extent = cbounds.extent();
+            if (extent[1] > extent[axis]) axis = 1;
+            if (extent[2] > extent[axis]) axis = 2;
+            std::nth_element(first, middle, last, [&](int a, int b)
+            {
+                return centers[a][axis] < centers[b][axis];
+            });
+        }
+
+        int const child = m_nodes.count();
+        m_nodes << RayBatchNode() << RayBatchNode();
+        m_nodes[node].m_index = child;
+        m_nodes[node].m_count = 0;
+
+        int const split = begin + (int)(middle - first);
+        tasks << ivec3(child, begin, split) << ivec3(child + 1, split, end);
+    }
+
+    //Store the triangles in tree order, as their first vertex and edges
+    m_triangles.resize(3 * tcount);
+    m_ids.resize(tcount);
+    for (int i = 0; i < tcount; ++i)
+    {
+        int t = order[i];
+        vec3 const &p0 = vertex(3 * t);
+        m_triangles[3 * i] = p0;
+        m_triangles[3 * i + 1] = vertex(3 * t + 1) - p0;
+        m_triangles[3 * i + 2] = vertex(3 * t + 2) - p0;
+        m_ids[i] = t;
+    }
+}
+
+void RayMesh::Empty()
+{
+    m_nodes.empty();
+    m_triangles.empty();
+    m_ids.empty();
+}
+
+//-----------------------------------------------------------------------------
+void RayBatch::Reserve(int count)
+{
+    m_origin.reserve(count);
+    m_dir.reserve(count);
+    m_tmax.reserve(count);
+}
+
+void RayBatch::Empty()
+{
+    m_origin.empty();
+    m_dir.empty();
+    m_tmax.empty();
+    m_hit.empty();
+    m_dist.empty();
+    m_u.empty();
+    m_v.empty();
+}
+
+int RayBatch::Push(vec3 const &origin, vec3 const &dir, float tmax)
+{
+    m_origin << origin;
+    m_dir << dir;
+    m_tmax << tmax;
+    return m_tmax.count() - 1;
+}
+
+int RayBatch::GetHitCount() const
+{
+    int ret = 0;
+    for (int i = 0; i < m_hit.count(); ++i)
+        ret += m_hit[i] >= 0;
+    return ret;
+}
+
+void RayBatch::IntersectTriangles(vec3 const *vertices, uint32_t const *indices,
+                                  int count, RayQuery query, ptrdiff_t stride)
+{
+    //A single leaf holding all the triangles in their original order
+    RayMesh mesh;
+    int const tcount = count / 3;
+    uint8_t const *base = reinterpret_cast<uint8_t const *>(vertices);
+    RayBatchNode root = { vec3(FLT_MAX), 0, vec3(-FLT_MAX), tcount };
+
+    mesh.m_triangles.resize(3 * tcount);
+    mesh.m_ids.resize(tcount);
+    for (int t = 0; t < tcount; ++t)
+    {
+        vec3 p[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            p[k] = *reinterpret_cast<vec3 const *>(base + indices[3 * t + k] * stride);
+            root.m_aa = min(root.m_aa, p[k]);
+            root.m_bb = max(root.m_bb, p[k]);
+        }
+        mesh.m_triangles[3 * t] = p[0];
+        mesh.m_triangles[3 * t + 1] = p[1] - p[0];
+        mesh.m_triangles[3 * t + 2] = p[2] - p[0];
+        mesh.m_ids[t] = t;
+    }
+    if (tcount)
+        mesh.m_nodes.push(root);
+
+    Intersect(mesh, query);
+}
+
+void RayBatch::Intersect(RayMesh const &mesh, RayQuery query)
+{
+    Trace(mesh.m_nodes.count() ? mesh.m_nodes.data() : nullptr, query,
+          &mesh, nullptr, nullptr);
+
+    //Report the triangles by their index in the original mesh
+    for (int i = 0; i < m_hit.count(); ++i)
+        if (m_hit[i] >= 0)
+            m_hit[i] = mesh.m_ids[m_hit[i]];
+}
+
+void RayBatch::Intersect(array<RayBatchNode> const &nodes, RayQuery query,
+                         RayBatchTest test, void const *data)
+{
+    Trace(nodes.count() ? nodes.data() : nullptr, query, nullptr, test, data);
+}
+
+void RayBatch::Trace(RayBatchNode const *nodes, RayQuery query,
+                     RayMesh const *mesh, RayBatchTest test, void const *data)
+{
+    int const count = GetCount();
+    m_hit.resize(count);
+    m_dist.resize(count);
+    m_u.resize(count);
+    m_v.resize(count);
+
+    //Empty trees: nothing is hit
+    if (!nodes)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            m_hit[i] = -1;
+            m_dist[i] = m_tmax[i];
+            m_u[i] = m_v[i] = 0.f;
+        }
+        return;
+    }
+
+    ray_args args;
+    for (int k = 0; k < 3; ++k)
+    {
+        args.origin[k] = m_origin.data(k);
+        args.dir[k] = m_dir.data(k);
+    }
+    args.tmax = m_tmax.data();
+    args.hit = m_hit.data();
+    args.dist = m_dist.data();
+    args.u = m_u.data();
+    args.v = m_v.data();
+    args.count = count;
+    args.any_hit = query == RayQuery::AnyHit;
+
+    if (mesh)
+    {
+        ray_mesh_leaf leaf = { mesh->m_triangles.data(), args.any_hit };
+        ray_parallel(count, [&](int begin, int end)
+        {
+            ray_batch(args, nodes, leaf, begin, end);
+        });
+    }
+    else
+    {
+        ray_test_leaf leaf = { test, data, args.any_hit };
+        ray_parallel(count, [&](int begin, int end)
+        {
+            ray_batch(args, nodes, leaf, begin, end);
+        });
+    }
+}
+
+} /* namespace lol */
@@ -0,0 +1,31 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// Internals of the real class
+// ---------------------------
+//
+
+namespace lol
+{
+
+/* The full 2n-bigit product of two n-bigit mantissas, most significant
+ * bigit first, as used by real multiplication. It switches to Karatsuba
+ * above sizes that real itself never reaches, so the unit tests call it
+ * directly. */
+void real_mantissa_mul(uint32_t *dst, uint32_t const *a,
+                       uint32_t const *b, int n);
+
+} /* namespace lol */
+
@@ -12,6 +12,8 @@
 
 #include <lol/engine-internal.h>
 
+#include "real-private.h"
+
 #include <new>
 #include <cstring>
 #include <cstdio>
@@ -73,34 +75,10 @@ LOL_CONSTANT_GETTER(R_SQRT1_2,  R_SQRT2() / 2);
 
 template<> real::Real()
 {
-    m_mantissa = new uint32_t[BIGITS];
     memset(m_mantissa, 0, BIGITS * sizeof(uint32_t));
     m_signexp = 0;
 }
 
-template<> real::Real(real const &x)
-{
-    m_mantissa = new uint32_t[BIGITS];
-    memcpy(m_mantissa, x.m_mantissa, BIGITS * sizeof(uint32_t));
-    m_signexp = x.m_signexp;
-}
-
-template<> real const &real::operator =(real const &x)
-{
-    if (&x != this)
-    {
-        memcpy(m_mantissa, x.m_mantissa, BIGITS * sizeof(uint32_t));
-        m_signexp = x.m_signexp;
-    }
-
-    return *this;
-}
-
-template<> real::~Real()
-{
-    delete[] m_mantissa;
-}
-
 /* FIXME: 64-bit integer loading is incorrect,we lose precision. */
 template<> real::Real(int32_t i) { new(this) real((double)i); }
 template<> real::Real(uint32_t i) { new(this) real((double)i); }
@@ -432,69 +410,204 @@ template<> real real::operator -(real const &x) const
     return ret;
 }
 
-template<> real real::operator *(real const &x) const
+/*
+ * Mantissa arithmetic helpers. Mantissas are arrays of bigits, most
+ * significant first, and the multiplication helpers compute the full
+ * 2n-bigit product of two n-bigit mantissas.
+ */
+
+/* Above this many bigits, Karatsuba beats the column-wise multiply */
+static int const KARATSUBA_THRESHOLD = 32;
+
+static uint32_t mantissa_add(uint32_t *dst, uint32_t const *a,
+                             uint32_t const *b, int n)
 {
-    real ret;
+    uint64_t carry = 0;
+    for (int i = n; i--; )
+    {
+        carry += (uint64_t)a[i] + b[i];
+        dst[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    return (uint32_t)carry;
+}
 
-    if (m_signexp << 1 == 0 || x.m_signexp << 1 == 0)
+static uint32_t mantissa_sub(uint32_t *dst, uint32_t const *a,
+                             uint32_t const *b, int n)
+{
+    int64_t carry = 0;
+    for (int i = n; i--; )
     {
-        ret = (m_signexp << 1 == 0) ? *this : x;
-        ret.m_signexp ^= x.m_signexp & 0x80000000u;
-        return ret;
+        carry += (int64_t)a[i] - b[i];
+        dst[i] = (uint32_t)carry;
+        carry = carry < 0 ? -1 : 0;
     }
+    return (uint32_t)-carry;
+}
 
-    ret.m_signexp = (m_signexp ^ x.m_signexp) & 0x80000000u;
-    int e = (m_signexp & 0x7fffffffu) - (1 << 30) + 1
-          + (x.m_signexp & 0x7fffffffu) - (1 << 30) + 1;
+static int mantissa_cmp(uint32_t const *a, uint32_t const *b, int n)
+{
+    for (int i = 0; i < n; ++i)
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    return 0;
+}
 
-    /* Accumulate low order product; no need to store it, we just
-     * want the carry value */
-    uint64_t carry = 0, hicarry = 0, prev;
-    for (int i = 0; i < BIGITS; i++)
+/* Column-wise (Comba) multiplication: each column of partial products
+ * is summed in a wide accumulator before a single store. */
+static void mantissa_mul_comba(uint32_t *dst, uint32_t const *a,
+                               uint32_t const *b, int n)
+{
+#if defined __SIZEOF_INT128__
+    if (!(n & 1))
     {
-        for (int j = 0; j < i + 1; j++)
+        /* Work on 64-bit limbs, numbered from the least significant */
+        typedef unsigned __int128 uint128_t;
+        int const m = n / 2;
+        auto limb = [m](uint32_t const *p, int i) -> uint64_t
         {
-            prev = carry;
-            carry += (uint64_t)m_mantissa[BIGITS - 1 - j]
-                   * (uint64_t)x.m_mantissa[BIGITS - 1 + j - i];
-            if (carry < prev)
-                hicarry++;
+            return ((uint64_t)p[2 * (m - 1 - i)] << 32) | p[2 * (m - 1 - i) + 1];
+        };
+
+        uint128_t acc = 0;
+        for (int k = 0; k < 2 * m - 1; ++k)
+        {
+            uint64_t hi = 0;
+            for (int i = k < m ? 0 : k - m + 1; i <= k && i < m; ++i)
+            {
+                uint128_t p = (uint128_t)limb(a, i) * limb(b, k - i);
+                acc += p;
+                hi += acc < p;
+            }
+            dst[2 * (2 * m - 1 - k)] = (uint32_t)(acc >> 32);
+            dst[2 * (2 * m - 1 - k) + 1] = (uint32_t)acc;
+            acc = (acc >> 64) | ((uint128_t)hi << 64);
         }
-        carry >>= BIGIT_BITS;
-        carry |= hicarry << BIGIT_BITS;
-        hicarry >>= BIGIT_BITS;
+        dst[0] = (uint32_t)(acc >> 32);
+        dst[1] = (uint32_t)acc;
+        return;
     }
+#endif
 
-    for (int i = 0; i < BIGITS; i++)
+    uint64_t acc = 0;
+    for (int k = 0; k < 2 * n - 1; ++k)
     {
-        for (int j = i + 1; j < BIGITS; j++)
+        uint32_t hi = 0;
+        for (int i = k < n ? 0 : k - n + 1; i <= k && i < n; ++i)
         {
-            prev = carry;
-            carry += (uint64_t)m_mantissa[BIGITS - 1 - j]
-                   * (uint64_t)x.m_mantissa[j - 1 - i];
-            if (carry < prev)
-                hicarry++;
+            uint64_t p = (uint64_t)a[n - 1 - i] * b[n - 1 - k + i];
+            acc += p;
+            hi += acc < p;
         }
-        prev = carry;
-        carry += m_mantissa[BIGITS - 1 - i];
-        carry += x.m_mantissa[BIGITS - 1 - i];
-        if (carry < prev)
-            hicarry++;
-        ret.m_mantissa[BIGITS - 1 - i] = carry & 0xffffffffu;
-        carry >>= BIGIT_BITS;
-        carry |= hicarry << BIGIT_BITS;
-        hicarry >>= BIGIT_BITS;
+        dst[2 * n - 1 - k] = (uint32_t)acc;
+        acc = (acc >> 32) | ((uint64_t)hi << 32);
+    }
+    dst[0] = (uint32_t)acc;
+}
+
+/* Karatsuba multiplication, using the subtractive variant so that the
+ * middle product does not need an extra carry bigit. The scratch area
+ * must hold 8n bigits. */
+static void mantissa_mul(uint32_t *dst, uint32_t const *a,
+                         uint32_t const *b, int n, uint32_t *scratch)
+{
+    if (n < KARATSUBA_THRESHOLD || (n & 1))
+    {
+        mantissa_mul_comba(dst, a, b, n);
+        return;
+    }
+
+    /* a = ah.B + al and b = bh.B + bl, with B = 2^(32h) */
+    int const h = n / 2;
+    uint32_t const *ah = a, *al = a + h, *bh = b, *bl = b + h;
+    uint32_t *da = scratch, *db = da + h, *p = db + h, *t = p + n;
+
+    mantissa_mul(dst, ah, bh, h, t);
+    mantissa_mul(dst + n, al, bl, h, t);
+
+    /* p = |ah - al|.|bh - bl|, with its sign in “negative” */
+    bool negative = false;
+    if (mantissa_cmp(ah, al, h) >= 0)
+        mantissa_sub(da, ah, al, h);
+    else
+    {
+        mantissa_sub(da, al, ah, h);
+        negative = !negative;
+    }
+    if (mantissa_cmp(bh, bl, h) >= 0)
+        mantissa_sub(db, bh, bl, h);
+    else
+    {
+        mantissa_sub(db, bl, bh, h);
+        negative = !negative;
+    }
+    mantissa_mul(p, da, db, h, t);
+
+    /* t = ah.bh + al.bl ∓ p, stored on n + 1 bigits */
+    t[0] = mantissa_add(t + 1, dst, dst + n, n);
+    if (negative)
+        t[0] += mantissa_add(t + 1, t + 1, p, n);
+    else
+        t[0] -= mantissa_sub(t + 1, t + 1, p, n);
+
+    /* Add t.B to the result; the final carry cannot overflow */
+    uint64_t carry = 0;
+    for (int i = n + 1; i--; )
+    {
+        carry += (uint64_t)dst[h - 1 + i] + t[i];
+        dst[h - 1 + i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    for (int i = h - 1; carry && i--; )
+    {
+        carry += dst[i];
+        dst[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+}
+
+void real_mantissa_mul(uint32_t *dst, uint32_t const *a,
+                       uint32_t const *b, int n)
+{
+    array<uint32_t> scratch;
+    scratch.resize(8 * n);
+    mantissa_mul(dst, a, b, n, scratch.data());
+}
+
+template<> real real::mul(real const &x, int bigits) const
+{
+    real ret;
+
+    if (m_signexp << 1 == 0 || x.m_signexp << 1 == 0)
+    {
+        ret = (m_signexp << 1 == 0) ? *this : x;
+        ret.m_signexp ^= x.m_signexp & 0x80000000u;
+        return ret;
     }
 
+    ret.m_signexp = (m_signexp ^ x.m_signexp) & 0x80000000u;
+    int e = (m_signexp & 0x7fffffffu) - (1 << 30) + 1
+          + (x.m_signexp & 0x7fffffffu) - (1 << 30) + 1;
+
+    /* With a and b the mantissas and W = 2^(32n), the product of the
+     * two numbers is (W + a)(W + b) / W² = 1 + (a + b + a.b / W) / W.
+     * We truncate the result by only keeping the high half of a.b. */
+    uint32_t product[2 * BIGITS], scratch[8 * BIGITS];
+    mantissa_mul(product, m_mantissa, x.m_mantissa, bigits, scratch);
+
+    uint32_t carry = mantissa_add(ret.m_mantissa, product,
+                                  m_mantissa, bigits);
+    carry += mantissa_add(ret.m_mantissa, ret.m_mantissa,
+                          x.m_mantissa, bigits);
+
     /* Renormalise in case we overflowed the mantissa */
     if (carry)
     {
         carry--;
-        for (int i = 0; i < BIGITS; i++)
+        for (int i = 0; i < bigits; i++)
         {
-            uint32_t tmp = (uint32_t)ret.m_mantissa[i];
-            ret.m_mantissa[i] = ((uint32_t)carry << (BIGIT_BITS - 1))
-                              | (tmp >> 1);
+            uint32_t tmp = ret.m_mantissa[i];
+            ret.m_mantissa[i] = (carry << (BIGIT_BITS - 1)) | (tmp >> 1);
             carry = tmp & 1u;
         }
         e++;
@@ -505,9 +618,25 @@ template<> real real::operator *(real const &x) const
     return ret;
 }
 
+template<> real real::operator *(real const &x) const
+{
+    return mul(x, BIGITS);
+}
+
 template<> real real::operator /(real const &x) const
 {
-    return *this * inverse(x);
+    /* Zeroes and non-finite values are handled by inverse() */
+    uint32_t const e1 = m_signexp << 1, e2 = x.m_signexp << 1;
+    if (!e1 || !e2 || !~(e1 | 1) || !~(e2 | 1))
+        return *this * inverse(x);
+
+    /* Multiply by the reciprocal, then refine the quotient with one
+     * correction step q' = q + r(a - qx). The remainder is tiny, so
+     * half precision is enough for the last product. */
+    real r = inverse(x);
+    real q = *this * r;
+    real rem = *this - q * x;
+    return q + r.mul(rem, BIGITS / 2 + 1);
 }
 
 template<> real const &real::operator +=(real const &x)
@@ -628,6 +757,29 @@ template<> real clamp(real const &x, real const &a, real const &b)
     return (x < a) ? a : (x > b) ? b : x;
 }
 
+/* Number of bits of the initial approximations in inverse() and sqrt(),
+ * with a safety margin over the 53 bits of a double. */
+static int const NEWTON_SEED_BITS = 50;
+
+/* Fill “steps” with the working precisions (in bigits) of successive
+ * Newton-Raphson iterations: each iteration doubles the number of correct
+ * bits, so only the last one needs to run at full precision. */
+static int newton_schedule(int *steps)
+{
+    int count = 0;
+    for (int bits = real::BIGITS * real::BIGIT_BITS; ; bits = bits / 2 + 2)
+    {
+        steps[count++] = min(real::BIGITS, bits / real::BIGIT_BITS + 2);
+        if (bits / 2 + 2 <= NEWTON_SEED_BITS)
+            break;
+    }
+
+    /* Reverse the list so that it starts with the lowest precision */
+    for (int i = 0; i < count / 2; ++i)
+        std::swap(steps[i], steps[count - 1 - i]);
+    return count;
+}
+
 template<> real inverse(real const &x)
 {
     if (!(x.m_signexp << 1))
@@ -638,27 +790,64 @@ template<> real inverse(real const &x)
         return ret;
     }
 
-    /* Use the system's float inversion to approximate 1/x */
-    union { float f; uint32_t x; } u = { 1.0f }, v = { 1.0f };
-    v.x |= x.m_mantissa[0] >> 9;
-    v.f = 1.0f / v.f;
+    /* Use the system's double inversion to approximate 1/x, using the
+     * mantissa of x in the [1..2[ range and fixing the exponent later. */
+    int exponent = (x.m_signexp & 0x7fffffffu) - (1 << 30) + 1;
+    real m = x;
+    m.m_signexp = (1 << 30) - 1;
 
-    real ret;
-    ret.m_mantissa[0] = v.x << 9;
+    real ret = 1.0 / (double)m;
+    ret.m_signexp -= exponent;
+    ret.m_signexp |= x.m_signexp & 0x80000000u;
 
-    uint32_t sign = x.m_signexp & 0x80000000u;
-    ret.m_signexp = sign;
+    /* Newton-Raphson iterations r' = r + r(1 - xr) with doubling
+     * precision; 1 - xr is tiny, so r(1 - xr) only needs half of it. */
+    int steps[32];
+    for (int i = 0, count = newton_schedule(steps); i < count; ++i)
+    {
+        real err = real::R_1() - x.mul(ret, steps[i]);
+        ret += ret.mul(err, steps[i] / 2 + 1);
+    }
 
-    int exponent = (x.m_signexp & 0x7fffffffu) + 1;
-    exponent = -exponent + (v.x >> 23) - (u.x >> 23);
-    ret.m_signexp |= (exponent - 1) & 0x7fffffffu;
+    return ret;
+}
 
-    /* FIXME: 1+log2(BIGITS) steps of Newton-Raphson seems to be enough for
-     * convergence, but this hasn't been checked seriously. */
-    for (int i = 1; i <= real::BIGITS; i *= 2)
-        ret = ret * (real::R_2() - ret * x);
+/* Compare s² with x exactly, assuming both are finite and positive and
+ * their mantissas have n bigits, up to one more than a real has */
+static int compare_square(uint32_t const *s, int es,
+                          uint32_t const *x, int ex, int n)
+{
+    int const m = real::BIGITS + 1;
+    int d = ex - 2 * es;
+    if (d < 0)
+        return 1;
+    if (d > 1)
+        return -1;
 
-    return ret;
+    /* With W = 2^(32n), compare (W + s)² with (W + x).W.2^d */
+    uint32_t lhs[2 * m + 1], rhs[2 * m + 1], scratch[8 * m];
+    lhs[0] = 1;
+    mantissa_mul(lhs + 1, s, s, n, scratch);
+    lhs[0] += mantissa_add(lhs + 1, lhs + 1, s, n);
+    lhs[0] += mantissa_add(lhs + 1, lhs + 1, s, n);
+
+    memset(rhs, 0, sizeof(rhs));
+    rhs[0] = 1;
+    memcpy(rhs + 1, x, n * sizeof(uint32_t));
+    if (d)
+        rhs[0] += mantissa_add(rhs + 1, rhs + 1, x, n) + 1;
+
+    return mantissa_cmp(lhs, rhs, 2 * n + 1);
+}
+
+/* Add one ulp to a finite positive real */
+static void mantissa_increment(uint32_t *mantissa, uint32_t *signexp)
+{
+    uint32_t carry = 1;
+    for (int i = real::BIGITS; carry && i--; )
+        carry = ++mantissa[i] == 0;
+    if (carry)
+        ++*signexp;
 }
 
 template<> real sqrt(real const &x)
@@ -676,36 +865,71 @@ template<> real sqrt(real const &x)
         return ret;
     }
 
-    /* Use the system's float inversion to approximate 1/sqrt(x). First
-     * we construct a float in the [1..4[ range that has roughly the same
-     * mantissa as our real. Its exponent is 0 or 1, depending on the
-     * partity of x. The final exponent is 0, -1 or -2. We use the final
-     * exponent and final mantissa to pre-fill the result. */
-    union { float f; uint32_t x; } u = { 1.0f }, v = { 2.0f };
-    v.x -= ((x.m_signexp & 1) << 23);
-    v.x |= x.m_mantissa[0] >> 9;
-    v.f = 1.0f / sqrtf(v.f);
+    /* Use the system's double sqrt to approximate 1/sqrt(x), using the
+     * mantissa of x in the [1..4[ range so that the exponent of x is
+     * even, and fixing the exponent later. */
+    int exponent = (x.m_signexp & 0x7fffffffu) - (1 << 30) + 1;
+    real m = x;
+    m.m_signexp = (1 << 30) - 1 + (exponent & 1);
 
-    real ret;
-    ret.m_mantissa[0] = v.x << 9;
+    real y = 1.0 / std::sqrt((double)m);
+    y.m_signexp -= (exponent - (exponent & 1)) / 2;
 
-    uint32_t sign = x.m_signexp & 0x80000000u;
-    ret.m_signexp = sign;
+    /* Newton-Raphson iterations y' = y + y(1 - xy²)/2 with doubling
+     * precision, converging to 1/sqrt(x). */
+    int steps[32];
+    for (int i = 0, count = newton_schedule(steps); i < count; ++i)
+    {
+        real err = real::R_1() - x.mul(y.mul(y, steps[i]), steps[i]);
+        y += ldexp(y.mul(err, steps[i] / 2 + 1), -1);
+    }
 
-    uint32_t exponent = (x.m_signexp & 0x7fffffffu);
-    exponent = ((1 << 30) + (1 << 29) - 1) - (exponent + 1) / 2;
-    exponent = exponent + (v.x >> 23) - (u.x >> 23);
-    ret.m_signexp |= exponent & 0x7fffffffu;
+    /* Get sqrt(x) = x/sqrt(x) and refine it with s' = s + y(x - s²)/2 */
+    real ret = x * y;
+    ret += ldexp(y.mul(x - ret * ret, real::BIGITS / 2 + 1), -1);
 
-    /* FIXME: 1+log2(BIGITS) steps of Newton-Raphson seems to be enough for
-     * convergence, but this hasn't been checked seriously. */
-    for (int i = 1; i <= real::BIGITS; i *= 2)
+    /* We are now within one ulp of the exact result: first adjust the
+     * last bit to get the largest s such that s² <= x. */
+    int const n = real::BIGITS;
+    for (;;)
     {
-        ret = ret * (real::R_3() - ret * ret * x);
-        ret.m_signexp--;
+        int es = (ret.m_signexp & 0x7fffffffu) - (1 << 30) + 1;
+        if (compare_square(ret.m_mantissa, es, x.m_mantissa, exponent, n) <= 0)
+            break;
+
+        /* Decrement the mantissa */
+        uint32_t borrow = 1;
+        for (int i = n; borrow && i--; )
+            borrow = ret.m_mantissa[i]-- == 0;
+        if (borrow)
+            ret.m_signexp--;
     }
 
-    return ret * x;
+    for (;;)
+    {
+        real next = ret;
+        mantissa_increment(next.m_mantissa, &next.m_signexp);
+
+        int es = (next.m_signexp & 0x7fffffffu) - (1 << 30) + 1;
+        if (compare_square(next.m_mantissa, es, x.m_mantissa, exponent, n) > 0)
+            break;
+        ret = next;
+    }
+
+    /* Then round to nearest: the exact root lies above s + ½ulp if and
+     * only if (s + ½ulp)² < x. That square needs one more bit than x has,
+     * so the two can never be equal and there is no tie to break. */
+    uint32_t half[n + 1], xext[n + 1];
+    memcpy(half, ret.m_mantissa, sizeof(ret.m_mantissa));
+    half[n] = 0x80000000u;
+    memcpy(xext, x.m_mantissa, sizeof(x.m_mantissa));
+    xext[n] = 0;
+
+    int es = (ret.m_signexp & 0x7fffffffu) - (1 << 30) + 1;
+    if (compare_square(half, es, xext, exponent, n + 1) < 0)
+        mantissa_increment(ret.m_mantissa, &ret.m_signexp);
+
+    return ret;
 }
 
 template<> real cbrt(real const &x)
@@ -0,0 +1,76 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// SIMD helpers for the batch kernels
+// ----------------------------------
+//
+//  Batch kernels use GCC vector types when the compiler has them. On
+// x86_64 builds that do not target AVX2 already, the kernels are also
+// compiled for AVX2 and picked at runtime, with has_avx2(). F16C code is
+// always picked at runtime, with has_f16c().
+//
+
+/* Kernel helpers must be inlined into their vector-typed callers */
+#if defined __GNUC__
+#   define INLINEATTR __attribute__((always_inline))
+#else
+#   define INLINEATTR
+#endif
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __SSE2__) \
+     && (__GNUC__ >= 9 || defined __clang__)
+#   define LOL_SIMD_VECTORS 1
+#   if defined __x86_64__ && !defined __AVX2__
+#       define LOL_SIMD_AVX2_DISPATCH 1
+#   endif
+#   include <cpuid.h>
+#endif
+
+namespace lol
+{
+
+#if LOL_SIMD_AVX2_DISPATCH
+/* The CPU is only queried once */
+inline bool has_avx2()
+{
+    static bool const ret = __builtin_cpu_supports("avx2");
+    return ret;
+}
+
+inline bool has_fma()
+{
+    static bool const ret = __builtin_cpu_supports("fma");
+    return ret;
+}
+#endif
+
+#if LOL_SIMD_VECTORS
+inline bool has_f16c()
+{
+    /* __builtin_cpu_supports("avx") also checks that the OS saves the
+     * AVX registers, which F16C needs too. */
+    static bool const ret = []()
+    {
+        unsigned int eax, ebx, ecx, edx;
+        return __builtin_cpu_supports("avx")
+                && __get_cpuid(1, &eax, &ebx, &ecx, &edx)
+                && (ecx & bit_F16C);
+    }();
+    return ret;
+}
+#endif
+
+} /* namespace lol */
+
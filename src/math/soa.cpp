@@ -0,0 +1,358 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include "simd-private.h"
+
+#include <cmath>
+#include <cstring>
+
+#if LOL_SIMD_VECTORS
+#   include <immintrin.h>
+#endif
+
+namespace lol
+{
+
+/*
+ * All kernels work on “lanes” consecutive vectors at a time, using GCC
+ * vectors of floats when available and plain floats otherwise. The same
+ * code is compiled for both.
+ */
+
+enum
+{
+    SOA_TRANSFORM_POINTS,
+    SOA_TRANSFORM_VECTORS,
+    SOA_TRANSLATE,
+    SOA_NORMALIZE,
+    SOA_DOT,
+    SOA_LERP,
+};
+
+struct soa_args
+{
+    float const *a[4], *b[4];
+    float *out[4];
+    float m[4][4];
+    float v[4];
+    float t;
+};
+
+/* Normalisation divides by the square root of the squared length, like
+ * normalize() does, so that results do not depend on the position of
+ * a vector in the array. Zero lengths give zero. */
+static inline float soa_sqrt(float x)
+{
+    return std::sqrt(x);
+}
+
+static inline float soa_div_nonzero(float a, float len)
+{
+    return len > 0.f ? a / len : 0.f;
+}
+
+#if LOL_SIMD_VECTORS
+typedef float   v4f __attribute__((vector_size(16)));
+typedef float   v8f __attribute__((vector_size(32)));
+
+static inline v4f soa_sqrt(v4f x) INLINEATTR;
+
+static inline v4f soa_sqrt(v4f x)
+{
+    return (v4f)_mm_sqrt_ps((__m128)x);
+}
+
+/* Two SSE square roots: the AVX one would need a target attribute that
+ * prevents inlining in the generic kernels */
+static inline v8f soa_sqrt(v8f x) INLINEATTR;
+
+static inline v8f soa_sqrt(v8f x)
+{
+    __m128 half[2];
+    memcpy(half, &x, sizeof(x));
+    half[0] = _mm_sqrt_ps(half[0]);
+    half[1] = _mm_sqrt_ps(half[1]);
+    memcpy(&x, half, sizeof(x));
+    return x;
+}
+
+template<typename V>
+static inline V soa_div_nonzero(V a, V len) INLINEATTR;
+
+template<typename V>
+static inline V soa_div_nonzero(V a, V len)
+{
+    return len > 0.f ? a / len : V{};
+}
+#endif
+
+template<typename V>
+static inline V soa_load(float const *p) INLINEATTR;
+
+template<typename V>
+static inline V soa_load(float const *p)
+{
+    V ret;
+    memcpy(&ret, p, sizeof(V));
+    return ret;
+}
+
+template<typename V>
+static inline void soa_store(float *p, V const &v) INLINEATTR;
+
+template<typename V>
+static inline void soa_store(float *p, V const &v)
+{
+    memcpy(p, &v, sizeof(V));
+}
+
+template<int OP, int N, typename V>
+static inline void soa_lanes(soa_args const &args, size_t i) INLINEATTR;
+
+template<int OP, int N, typename V>
+static inline void soa_lanes(soa_args const &args, size_t i)
+{
+    V a[4], b[4];
+
+    for (int k = 0; k < N; ++k)
+        a[k] = soa_load<V>(args.a[k] + i);
+
+    if (OP == SOA_DOT || OP == SOA_LERP)
+        for (int k = 0; k < N; ++k)
+            b[k] = soa_load<V>(args.b[k] + i);
+
+    /* Results are stored as soon as they are known, so that the output
+     * may be the same as the input. */
+    switch (OP)
+    {
+    case SOA_TRANSFORM_POINTS:
+    case SOA_TRANSFORM_VECTORS:
+        for (int j = 0; j < N; ++j)
+        {
+            V r = a[0] * args.m[0][j];
+            for (int k = 1; k < N; ++k)
+                r += a[k] * args.m[k][j];
+            if (OP == SOA_TRANSFORM_POINTS)
+                r += args.m[3][j];
+            soa_store<V>(args.out[j] + i, r);
+        }
+        break;
+    case SOA_TRANSLATE:
+        for (int k = 0; k < N; ++k)
+            soa_store<V>(args.out[k] + i, a[k] + args.v[k]);
+        break;
+    case SOA_NORMALIZE:
+    {
+        V len2 = a[0] * a[0];
+        for (int k = 1; k < N; ++k)
+            len2 += a[k] * a[k];
+        V len = soa_sqrt(len2);
+        for (int k = 0; k < N; ++k)
+            soa_store<V>(args.out[k] + i, soa_div_nonzero(a[k], len));
+        break;
+    }
+    case SOA_DOT:
+    {
+        V r = a[0] * b[0];
+        for (int k = 1; k < N; ++k)
+            r += a[k] * b[k];
+        soa_store<V>(args.out[0] + i, r);
+        break;
+    }
+    case SOA_LERP:
+        for (int k = 0; k < N; ++k)
+            soa_store<V>(args.out[k] + i, a[k] + (b[k] - a[k]) * args.t);
+        break;
+    }
+}
+
+template<int OP, int N, typename V>
+static inline void soa_batch(soa_args const &args, size_t count) INLINEATTR;
+
+template<int OP, int N, typename V>
+static inline void soa_batch(soa_args const &args, size_t count)
+{
+    size_t const lanes = sizeof(V) / sizeof(float);
+
+    size_t i = 0;
+    for ( ; i + lanes <= count; i += lanes)
+        soa_lanes<OP, N, V>(args, i);
+
+    if (i == count)
+        return;
+
+    /* Copy the last few values to zero-padded buffers */
+    size_t const n = count - i;
+    float tmp[3][4][lanes];
+    memset(tmp, 0, sizeof(tmp));
+
+    soa_args tail = args;
+    for (int k = 0; k < N; ++k)
+    {
+        memcpy(tmp[0][k], args.a[k] + i, n * sizeof(float));
+        tail.a[k] = tmp[0][k];
+        if (OP == SOA_DOT || OP == SOA_LERP)
+        {
+            memcpy(tmp[1][k], args.b[k] + i, n * sizeof(float));
+            tail.b[k] = tmp[1][k];
+        }
+        tail.out[k] = tmp[2][k];
+    }
+
+    soa_lanes<OP, N, V>(tail, 0);
+
+    int const outputs = OP == SOA_DOT ? 1 : N;
+    for (int k = 0; k < outputs; ++k)
+        memcpy(args.out[k] + i, tmp[2][k], n * sizeof(float));
+}
+
+#if LOL_SIMD_AVX2_DISPATCH
+template<int OP, int N>
+__attribute__((target("avx2")))
+static void soa_batch_avx2(soa_args const &args, size_t count)
+{
+    soa_batch<OP, N, v8f>(args, count);
+}
+#endif
+
+template<int OP, int N>
+static void soa_batch(soa_args const &args, size_t count)
+{
+#if LOL_SIMD_VECTORS
+#   if LOL_SIMD_AVX2_DISPATCH
+    if (has_avx2())
+        return soa_batch_avx2<OP, N>(args, count);
+#   endif
+#   if defined __AVX2__
+    soa_batch<OP, N, v8f>(args, count);
+#   else
+    soa_batch<OP, N, v4f>(args, count);
+#   endif
+#else
+    soa_batch<OP, N, float>(args, count);
+#endif
+}
+
+/*
+ * Public functions: set up the arguments and resize the output
+ */
+
+template<int OP, int N>
+static void soa_run(soa_array<vec_t<float, N>> const &a,
+                    soa_array<vec_t<float, N>> const *b,
+                    soa_array<vec_t<float, N>> *out, float *dot_out,
+                    soa_args &args)
+{
+    int const count = a.count();
+    ASSERT(!b || b->count() == count,
+           "soa arrays have different sizes (%d and %d)\n",
+           count, b->count());
+
+    if (out)
+        out->resize(count);
+
+    for (int k = 0; k < N; ++k)
+    {
+        args.a[k] = a.data(k);
+        args.b[k] = b ? b->data(k) : nullptr;
+        args.out[k] = out ? out->data(k) : dot_out;
+    }
+
+    soa_batch<OP, N>(args, (size_t)count);
+}
+
+template<int N>
+static void soa_matrix(soa_args &args, mat_t<float, N, N> const &m)
+{
+    memset(args.m, 0, sizeof(args.m));
+    for (int i = 0; i < N; ++i)
+        for (int j = 0; j < N; ++j)
+            args.m[i][j] = m[i][j];
+}
+
+void transform_points(mat4 const &m, soa_array<vec3> const &p,
+                      soa_array<vec3> &out)
+{
+    soa_args args;
+    soa_matrix(args, m);
+    soa_run<SOA_TRANSFORM_POINTS, 3>(p, nullptr, &out, nullptr, args);
+}
+
+void translate_points(vec3 const &v, soa_array<vec3> const &p,
+                      soa_array<vec3> &out)
+{
+    soa_args args;
+    for (int k = 0; k < 3; ++k)
+        args.v[k] = v[k];
+    soa_run<SOA_TRANSLATE, 3>(p, nullptr, &out, nullptr, args);
+}
+
+void transform_vectors(mat3 const &m, soa_array<vec3> const &v,
+                       soa_array<vec3> &out)
+{
+    soa_args args;
+    soa_matrix(args, m);
+    soa_run<SOA_TRANSFORM_VECTORS, 3>(v, nullptr, &out, nullptr, args);
+}
+
+void transform_vectors(mat4 const &m, soa_array<vec4> const &v,
+                       soa_array<vec4> &out)
+{
+    soa_args args;
+    soa_matrix(args, m);
+    soa_run<SOA_TRANSFORM_VECTORS, 4>(v, nullptr, &out, nullptr, args);
+}
+
+void normalize_all(soa_array<vec3> const &v, soa_array<vec3> &out)
+{
+    soa_args args;
+    soa_run<SOA_NORMALIZE, 3>(v, nullptr, &out, nullptr, args);
+}
+
+void normalize_all(soa_array<vec4> const &v, soa_array<vec4> &out)
+{
+    soa_args args;
+    soa_run<SOA_NORMALIZE, 4>(v, nullptr, &out, nullptr, args);
+}
+
+void dot_all(soa_array<vec3> const &a, soa_array<vec3> const &b, float *out)
+{
+    soa_args args;
+    soa_run<SOA_DOT, 3>(a, &b, nullptr, out, args);
+}
+
+void dot_all(soa_array<vec4> const &a, soa_array<vec4> const &b, float *out)
+{
+    soa_args args;
+    soa_run<SOA_DOT, 4>(a, &b, nullptr, out, args);
+}
+
+void lerp_all(soa_array<vec3> const &a, soa_array<vec3> const &b,
+              float t, soa_array<vec3> &out)
+{
+    soa_args args;
+    args.t = t;
+    soa_run<SOA_LERP, 3>(a, &b, &out, nullptr, args);
+}
+
+void lerp_all(soa_array<vec4> const &a, soa_array<vec4> const &b,
+              float t, soa_array<vec4> &out)
+{
+    soa_args args;
+    args.t = t;
+    soa_run<SOA_LERP, 4>(a, &b, &out, nullptr, args);
+}
+
+} /* namespace lol */
+
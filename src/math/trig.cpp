@@ -10,6 +10,10 @@
 
 #include <lol/engine-internal.h>
 
+#include "simd-private.h"
+
+#include <cstring>
+
 #if defined HAVE_FASTMATH_H
 #   include <fastmath.h>
 #endif
@@ -18,7 +22,6 @@
 #if defined __GNUC__
 #   define __likely(x)   __builtin_expect(!!(x), 1)
 #   define __unlikely(x) __builtin_expect(!!(x), 0)
-#   define INLINEATTR __attribute__((always_inline))
 #   if defined __x86_64__
 #      define FP_USE(x) __asm__("" : "+x" (x))
 #   elif defined __i386__ /* FIXME: this isn't good */
@@ -29,7 +32,6 @@
 #else
 #   define __likely(x)   x
 #   define __unlikely(x) x
-#   define INLINEATTR
 #   define FP_USE(x) (void)(x)
 #endif
 
@@ -383,5 +385,251 @@ double lol_tan(double x)
     return sinx / cosx;
 }
 
+/*
+ * Batch versions. The same Taylor series as above are evaluated on GCC
+ * vectors of doubles, but without the small argument shortcuts: every
+ * lane goes through the range reduction and the full degree series, as
+ * is done in the scalar versions for |x| > π/4. Using integer conversions
+ * for the range reduction instead of the 2^52 trick is immune to fast
+ * math optimisations, at the cost of a ±2^31π argument range: values
+ * outside of it go through the scalar versions instead.
+ */
+
+enum
+{
+    TRIG_SIN,
+    TRIG_COS,
+    TRIG_TAN,
+    TRIG_SINCOS,
+};
+
+template<int OP, typename T>
+static inline void trig_scalar(T x, T *out, T *cosx)
+{
+    switch (OP)
+    {
+    case TRIG_SIN: *out = (T)lol_sin((double)x); break;
+    case TRIG_COS: *out = (T)lol_cos((double)x); break;
+    case TRIG_TAN: *out = (T)lol_tan((double)x); break;
+    case TRIG_SINCOS: lol_sincos(x, out, cosx); break;
+    }
+}
+
+#if LOL_SIMD_VECTORS
+/* Four lanes fit in two SSE2 registers, eight lanes in two AVX ones. */
+typedef float   v4f __attribute__((vector_size(16)));
+typedef double  v4d __attribute__((vector_size(32)));
+typedef int32_t v4i __attribute__((vector_size(16)));
+typedef int64_t v4l __attribute__((vector_size(32)));
+
+typedef float   v8f __attribute__((vector_size(32)));
+typedef double  v8d __attribute__((vector_size(64)));
+typedef int32_t v8i __attribute__((vector_size(32)));
+typedef int64_t v8l __attribute__((vector_size(64)));
+
+/* Bound on |x| for the vector range reduction: the number of cycles
+ * fits in an int32_t below 2^31π, and 3·2^31 is exact in floats too */
+static const double TRIG_VECTOR_RANGE = 6442450944.0;
+
+template<typename VD, typename VL, typename VI>
+static inline void sincos_vector(VD const &x, VD *sinx, VD *cosx) INLINEATTR;
+
+template<typename VD, typename VL, typename VI>
+static inline void sincos_vector(VD const &x, VD *sinx, VD *cosx)
+{
+    VL const sign_mask = VL{} + INT64_MIN;
+    VL const sign = (VL)x & sign_mask;
+    VD absx = (VD)((VL)x ^ sign) * INV_PI;
+
+    /* Wrap |x| to the range [-1, 1] and change the sign of the result
+     * if the number of cycles is odd. */
+    VI num_cycles = __builtin_convertvector(absx + HALF, VI);
+    VD parity = ONE - TWO * __builtin_convertvector(num_cycles & 1, VD);
+    absx -= __builtin_convertvector(num_cycles, VD);
+
+    VD x2 = absx * absx;
+    VD x4 = x2 * x2;
+    VD subs1 = (((SC[7] * x4 + SC[5]) * x4 + SC[3]) * x4 + SC[1]) * x4 + ONE;
+    VD subs2 = ((SC[6] * x4 + SC[4]) * x4 + SC[2]) * x4 + SC[0];
+    VD subc1 = (((CC[7] * x4 + CC[5]) * x4 + CC[3]) * x4 + CC[1]) * x4 + ONE;
+    VD subc2 = (((CC[8] * x4 + CC[6]) * x4 + CC[4]) * x4 + CC[2]) * x4 + CC[0];
+
+    VD taylors = absx * (subs2 * x2 + subs1) * (parity * D_PI);
+    *sinx = (VD)((VL)taylors ^ sign);
+    *cosx = (subc2 * x2 + subc1) * parity;
+}
+
+/* Returns whether some lanes were out of range */
+template<int OP, typename T, typename VT, typename VD, typename VL, typename VI>
+static inline bool trig_vector(T const *x, VD *out, VD *cosx) INLINEATTR;
+
+template<int OP, typename T, typename VT, typename VD, typename VL, typename VI>
+static inline bool trig_vector(T const *x, VD *out, VD *cosx)
+{
+    VT in;
+    memcpy(&in, x, sizeof(in));
+
+    VD sinx, dx = __builtin_convertvector(in, VD);
+    sincos_vector<VD, VL, VI>(dx, &sinx, cosx);
+
+    /* Check on the input type, since wider vectors are split */
+    T const range = (T)TRIG_VECTOR_RANGE;
+    auto wide = (in >= range) | (in <= -range);
+    int64_t lanes[sizeof(wide) / sizeof(int64_t)];
+    memcpy(lanes, &wide, sizeof(wide));
+    int64_t any = 0;
+    for (size_t l = 0; l < sizeof(wide) / sizeof(int64_t); ++l)
+        any |= lanes[l];
+
+    if (OP == TRIG_TAN)
+    {
+        /* Ensure cosx isn't zero, like the scalar version. */
+        VL const abs_mask = VL{} + INT64_MAX;
+        VL tiny = (VD)((VL)*cosx & abs_mask) < VERY_SMALL_NUMBER;
+        *cosx = (VD)(((VL)*cosx & ~tiny)
+                      | ((VL)(VD{} + VERY_SMALL_NUMBER) & tiny));
+        sinx /= *cosx;
+    }
+
+    *out = OP == TRIG_COS ? *cosx : sinx;
+    return any != 0;
+}
+
+template<int OP, typename T, typename VT, typename VD, typename VL, typename VI>
+static inline void trig_batch(T const *x, T *out, T *cosx, size_t count) INLINEATTR;
+
+template<int OP, typename T, typename VT, typename VD, typename VL, typename VI>
+static inline void trig_batch(T const *x, T *out, T *cosx, size_t count)
+{
+    size_t const lanes = sizeof(VT) / sizeof(T);
+
+    for (size_t i = 0; i < count; i += lanes)
+    {
+        /* Copy the last few values to a zero-padded buffer */
+        T const *src = x + i;
+        T tmp[lanes] = { 0 };
+        size_t n = count - i < lanes ? count - i : lanes;
+        if (n < lanes)
+            src = (T const *)memcpy(tmp, src, n * sizeof(T));
+
+        VD ret, c;
+        bool const wide = trig_vector<OP, T, VT, VD, VL, VI>(src, &ret, &c);
+
+        /* Keep the values out of range aside, since the output may
+         * overwrite them */
+        T wide_x[lanes];
+        if (__unlikely(wide))
+            memcpy(wide_x, src, n * sizeof(T));
+
+        VT r1 = __builtin_convertvector(ret, VT);
+        VT r2 = __builtin_convertvector(c, VT);
+
+        if (n == lanes)
+        {
+            memcpy(out + i, &r1, sizeof(r1));
+            if (OP == TRIG_SINCOS)
+                memcpy(cosx + i, &r2, sizeof(r2));
+        }
+        else
+        {
+            memcpy(out + i, &r1, n * sizeof(T));
+            if (OP == TRIG_SINCOS)
+                memcpy(cosx + i, &r2, n * sizeof(T));
+        }
+
+        if (__unlikely(wide))
+            for (size_t l = 0; l < n; ++l)
+                if (lol_fabs((double)wide_x[l]) >= TRIG_VECTOR_RANGE)
+                    trig_scalar<OP>(wide_x[l], out + i + l,
+                                    OP == TRIG_SINCOS ? cosx + i + l : nullptr);
+    }
+}
+
+template<typename T> struct trig_types;
+
+template<> struct trig_types<float>
+{
+    typedef v4f v4t;
+    typedef v8f v8t;
+};
+
+template<> struct trig_types<double>
+{
+    typedef v4d v4t;
+    typedef v8d v8t;
+};
+
+#if LOL_SIMD_AVX2_DISPATCH
+template<int OP, typename T>
+__attribute__((target("avx2")))
+static void trig_batch_avx2(T const *x, T *out, T *cosx, size_t count)
+{
+    typedef typename trig_types<T>::v8t v8t;
+    trig_batch<OP, T, v8t, v8d, v8l, v8i>(x, out, cosx, count);
+}
+#endif
+#endif
+
+template<int OP, typename T>
+static void trig_batch(T const *x, T *out, T *cosx, size_t count)
+{
+#if LOL_SIMD_VECTORS
+#   if LOL_SIMD_AVX2_DISPATCH
+    if (has_avx2())
+        return trig_batch_avx2<OP, T>(x, out, cosx, count);
+#   endif
+#   if defined __AVX2__
+    typedef typename trig_types<T>::v8t v8t;
+    trig_batch<OP, T, v8t, v8d, v8l, v8i>(x, out, cosx, count);
+#   else
+    typedef typename trig_types<T>::v4t v4t;
+    trig_batch<OP, T, v4t, v4d, v4l, v4i>(x, out, cosx, count);
+#   endif
+#else
+    for (size_t i = 0; i < count; ++i)
+        trig_scalar<OP>(x[i], out + i, OP == TRIG_SINCOS ? cosx + i : nullptr);
+#endif
+}
+
+void lol_sin(float const *x, float *sinx, size_t count)
+{
+    trig_batch<TRIG_SIN>(x, sinx, (float *)nullptr, count);
+}
+
+void lol_cos(float const *x, float *cosx, size_t count)
+{
+    trig_batch<TRIG_COS>(x, cosx, (float *)nullptr, count);
+}
+
+void lol_tan(float const *x, float *tanx, size_t count)
+{
+    trig_batch<TRIG_TAN>(x, tanx, (float *)nullptr, count);
+}
+
+void lol_sincos(float const *x, float *sinx, float *cosx, size_t count)
+{
+    trig_batch<TRIG_SINCOS>(x, sinx, cosx, count);
+}
+
+void lol_sin(double const *x, double *sinx, size_t count)
+{
+    trig_batch<TRIG_SIN>(x, sinx, (double *)nullptr, count);
+}
+
+void lol_cos(double const *x, double *cosx, size_t count)
+{
+    trig_batch<TRIG_COS>(x, cosx, (double *)nullptr, count);
+}
+
+void lol_tan(double const *x, double *tanx, size_t count)
+{
+    trig_batch<TRIG_TAN>(x, tanx, (double *)nullptr, count);
+}
+
+void lol_sincos(double const *x, double *sinx, double *cosx, size_t count)
+{
+    trig_batch<TRIG_SINCOS>(x, sinx, cosx, count);
+}
+
 } /* namespace lol */
 
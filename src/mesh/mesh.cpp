@@ -58,7 +58,9 @@ void Mesh::SetMaterial(Shader *shader)
 SubMesh::SubMesh(Shader *shader, VertexDeclaration *vdecl)
   : m_mesh_prim(MeshPrimitive::Triangles),
     m_shader(shader),
-    m_vdecl(vdecl)
+    m_vdecl(vdecl),
+    m_ibo(nullptr),
+    m_index_size(sizeof(uint16_t))
 {
     Ticker::Ref(m_shader);
 }
@@ -99,9 +101,10 @@ void SubMesh::SetVertexBuffer(int index, VertexBuffer* vbo)
     m_vbos[index] = vbo;
 }
 
-void SubMesh::SetIndexBuffer(IndexBuffer* ibo)
+void SubMesh::SetIndexBuffer(IndexBuffer* ibo, int index_size)
 {
     m_ibo = ibo;
+    m_index_size = index_size;
 }
 
 void SubMesh::AddTexture(const char* name, Texture* texture)
@@ -146,7 +149,8 @@ void SubMesh::Render()
 
     m_ibo->Bind();
     m_vdecl->Bind();
-    m_vdecl->DrawIndexedElements(MeshPrimitive::Triangles, m_ibo->GetSize() / sizeof(uint16_t));
+    m_vdecl->DrawIndexedElements(MeshPrimitive::Triangles, (int)(m_ibo->GetSize() / m_index_size),
+                                 nullptr, (short)m_index_size);
     m_vdecl->Unbind();
     m_ibo->Unbind();
 }
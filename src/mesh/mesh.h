@@ -93,7 +93,8 @@ public:
     Shader *GetShader();
     void SetVertexDeclaration(VertexDeclaration *vdecl);
     void SetVertexBuffer(int index, VertexBuffer* vbo);
-    void SetIndexBuffer(IndexBuffer* ibo);
+    /* index_size is the size in bytes of each index, 2 or 4 */
+    void SetIndexBuffer(IndexBuffer* ibo, int index_size = sizeof(uint16_t));
     void AddTexture(const char* name, Texture* texture);
 
 protected:
@@ -104,6 +105,7 @@ protected:
     VertexDeclaration* m_vdecl;
     array<VertexBuffer *> m_vbos;
     IndexBuffer *m_ibo;
+    int m_index_size;
 
     array<String, Texture*> m_textures;
 };
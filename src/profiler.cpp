@@ -30,14 +30,14 @@ public:
     ProfilerData()
     {
         for (int i = 0; i < HISTORY; i++)
-            history[i] = 0.0f;
-        avg = max = 0.0f;
+            history[i] = 0;
+        start = last = avg = max = 0;
     }
 
 private:
-    float history[HISTORY];
-    Timer timer;
-    float avg, max;
+    /* All durations are in nanoseconds */
+    int64_t history[HISTORY];
+    int64_t start, last, avg, max;
 }
 data[Profiler::STAT_COUNT];
 
@@ -47,16 +47,17 @@ data[Profiler::STAT_COUNT];
 
 void Profiler::Start(int id)
 {
-    data[id].timer.Get();
+    data[id].start = Timer::Now();
 }
 
 void Profiler::Stop(int id)
 {
-    float seconds = data[id].timer.Get();
+    int64_t ns = Timer::Now() - data[id].start;
 
-    data[id].history[Ticker::GetFrameNum() % ProfilerData::HISTORY] = seconds;
-    data[id].avg = 0.0f;
-    data[id].max = 0.0f;
+    data[id].last = ns;
+    data[id].history[Ticker::GetFrameNum() % ProfilerData::HISTORY] = ns;
+    data[id].avg = 0;
+    data[id].max = 0;
 
     for (int i = 0; i < ProfilerData::HISTORY; i++)
     {
@@ -69,13 +70,28 @@ void Profiler::Stop(int id)
 
 float Profiler::GetAvg(int id)
 {
-    return data[id].avg;
+    return (float)((double)data[id].avg * 1e-9);
 }
 
 float Profiler::GetMax(int id)
+{
+    return (float)((double)data[id].max * 1e-9);
+}
+
+int64_t Profiler::GetAvgNs(int id)
+{
+    return data[id].avg;
+}
+
+int64_t Profiler::GetMaxNs(int id)
 {
     return data[id].max;
 }
 
+int64_t Profiler::GetLastNs(int id)
+{
+    return data[id].last;
+}
+
 } /* namespace lol */
 
@@ -45,9 +45,16 @@ public:
 
     static void Start(int id);
     static void Stop(int id);
+
+    /* Average and maximum over the last frames, in seconds */
     static float GetAvg(int id);
     static float GetMax(int id);
 
+    /* Same as above, and the last measured value, in nanoseconds */
+    static int64_t GetAvgNs(int id);
+    static int64_t GetMaxNs(int id);
+    static int64_t GetLastNs(int id);
+
 private:
     Profiler() {}
 };
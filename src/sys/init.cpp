@@ -49,6 +49,9 @@ void init(int argc, char *argv[],
     msg::debug("solution dir: “%s”\n", solutiondir.C());
     msg::debug("source subdir: “%s”\n", sourcesubdir.C());
 
+    /* Calibrate the clock now rather than in the first Timer */
+    msg::debug("timestamp counter: %s\n", Timer::HasTsc() ? "yes" : "no");
+
     /*
      * Retrieve binary directory, defaulting to no directory on Android
      * and emscripten, and the current directory on other platforms.
@@ -16,6 +16,128 @@
 namespace lol
 {
 
+//parallel_for ----------------------------------------------------------------
+#if LOL_FEATURE_THREADS
+//One slice of a parallel_for() call, and the call's count of slices left
+struct parallel_slice
+{
+    std::function<void(int, int)> const *m_fn;
+    int m_begin, m_end;
+    int *m_remaining;
+};
+
+//Worker threads shared by all parallel_for() calls. They are started on
+//first use and live until exit, so a call only costs a few lock round trips
+class parallel_pool
+{
+public:
+    parallel_pool(int thread_count)
+      : m_stop(false)
+    {
+        for (int k = 0; k < thread_count; ++k)
+            m_workers << new thread([this](thread *) { work(); });
+    }
+
+    ~parallel_pool()
+    {
+        m_mutex.lock();
+        m_stop = true;
+        m_mutex.unlock();
+        m_cond.notify_all();
+
+        //Deleting a thread waits for it
+        for (thread *worker : m_workers)
+            delete worker;
+    }
+
+    void run(int count, int slice_count, std::function<void(int, int)> const &fn)
+    {
+        auto slice_start = [count, slice_count](int k)
+        {
+            return (int)((int64_t)count * k / slice_count);
+        };
+
+        //Only touched with the lock held
+        int remaining = slice_count - 1;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (int k = 1; k < slice_count; ++k)
+            m_slices.push(parallel_slice { &fn, slice_start(k), slice_start(k + 1), &remaining });
+        lock.unlock();
+        m_cond.notify_all();
+
+        fn(0, slice_start(1));
+
+        //Run queued slices instead of sleeping: when fn() calls parallel_for()
+        //itself, the workers may all be waiting for slices nobody else runs
+        lock.lock();
+        while (remaining > 0)
+        {
+            if (m_slices.count())
+                run_one(lock);
+            else
+                m_cond.wait(lock);
+        }
+    }
+
+private:
+    void run_one(std::unique_lock<std::mutex> &lock)
+    {
+        //Latest first, so that nested calls complete before their callers
+        parallel_slice slice = m_slices.pop();
+        lock.unlock();
+        (*slice.m_fn)(slice.m_begin, slice.m_end);
+        lock.lock();
+        if (--*slice.m_remaining == 0)
+            m_cond.notify_all();
+    }
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop)
+        {
+            if (m_slices.count())
+                run_one(lock);
+            else
+                m_cond.wait(lock);
+        }
+    }
+
+    array<thread *> m_workers;
+    array<parallel_slice> m_slices;
+    std::mutex m_mutex;
+    //Signalled when slices are queued, when a call's last slice is done,
+    //and when stopping
+    std::condition_variable m_cond;
+    bool m_stop;
+};
+#endif //LOL_FEATURE_THREADS
+
+void parallel_for(int count, int min_count,
+                  std::function<void(int, int)> const &fn)
+{
+    int thread_count = 1;
+#if LOL_FEATURE_THREADS
+    if (std::thread::hardware_concurrency() > 0)
+        thread_count = lol::min((int)std::thread::hardware_concurrency(), 64);
+#endif
+    thread_count = lol::min(thread_count, count / lol::max(min_count, 1));
+
+    if (thread_count <= 1)
+    {
+        if (count > 0)
+            fn(0, count);
+        return;
+    }
+
+#if LOL_FEATURE_THREADS
+    //The calling thread handles a slice too, so one core needs no worker
+    static parallel_pool pool(lol::min((int)std::thread::hardware_concurrency(), 64) - 1);
+    pool.run(count, thread_count, fn);
+#endif
+}
+
 //BaseThreadManager -----------------------------------------------------------
 BaseThreadManager::BaseThreadManager(int thread_max) : BaseThreadManager(thread_max, thread_max)
 { }
@@ -0,0 +1,187 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <chrono>
+#include <thread>
+#include <time.h>
+
+#if defined _MSC_VER && (defined _M_IX86 || defined _M_X64)
+#   include <intrin.h>
+#   define LOL_TIMER_TSC 1
+#elif defined __GNUC__ && (defined __i386__ || defined __x86_64__) \
+       && !defined __native_client__ && !defined EMSCRIPTEN
+#   include <cpuid.h>
+#   include <x86intrin.h>
+#   define LOL_TIMER_TSC 1
+#endif
+
+namespace lol
+{
+
+/* The OS clock; CLOCK_MONOTONIC_RAW is not affected by NTP adjustments */
+static int64_t os_now()
+{
+#if defined CLOCK_MONOTONIC_RAW
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;
+#else
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+               steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+#if LOL_TIMER_TSC
+/* An invariant TSC runs at a constant rate in all power states, which
+ * is advertised by bit 8 of EDX in CPUID leaf 0x80000007. */
+static bool has_invariant_tsc()
+{
+#if defined _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0x80000000);
+    if ((unsigned)regs[0] < 0x80000007u)
+        return false;
+    __cpuid(regs, 0x80000007);
+    return ((unsigned)regs[3] >> 8) & 1;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx)
+         || eax < 0x80000007u)
+        return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx >> 8) & 1;
+#endif
+}
+
+struct tsc_clock
+{
+    tsc_clock()
+      : m_enabled(false)
+    {
+        if (!has_invariant_tsc())
+            return;
+
+        /* Calibrate against the OS clock for 10 ms; the conversion
+         * factor is stored as a 32.32 fixed point number. */
+        int64_t const t0 = os_now();
+        uint64_t const c0 = __rdtsc();
+        int64_t t1;
+        do
+            t1 = os_now();
+        while (t1 - t0 < 10000000);
+        uint64_t const c1 = __rdtsc();
+
+        if (c1 <= c0)
+            return;
+
+        double const ns_per_tick = (double)(t1 - t0) / (double)(c1 - c0);
+        m_mult = (uint64_t)(ns_per_tick * 4294967296.0 + 0.5);
+        m_base_tsc = c1;
+        m_base_ns = t1;
+        m_enabled = true;
+    }
+
+    inline int64_t now() const
+    {
+        /* (delta * m_mult) >> 32 without 128-bit arithmetic. Both operands
+         * are split into 32-bit halves, since m_mult is above 2^32 when
+         * the TSC runs below 1 GHz. */
+        uint64_t const delta = __rdtsc() - m_base_tsc;
+        uint64_t const d_hi = delta >> 32, d_lo = delta & 0xffffffffu;
+        uint64_t const m_hi = m_mult >> 32, m_lo = m_mult & 0xffffffffu;
+        uint64_t const ns = ((d_hi * m_hi) << 32) + d_hi * m_lo
+                          + d_lo * m_hi + ((d_lo * m_lo) >> 32);
+        return m_base_ns + (int64_t)ns;
+    }
+
+    bool m_enabled;
+    uint64_t m_mult, m_base_tsc;
+    int64_t m_base_ns;
+};
+
+/* Calibrate on first use, since timers may be used by static objects */
+static tsc_clock const &tsc()
+{
+    static tsc_clock const instance;
+    return instance;
+}
+#endif
+
+int64_t Timer::Now()
+{
+#if LOL_TIMER_TSC
+    tsc_clock const &clock = tsc();
+    int64_t ret = clock.m_enabled ? clock.now() : os_now();
+#else
+    int64_t ret = os_now();
+#endif
+
+    /* Counters on different cores may be slightly out of sync, so never
+     * return a value lower than the previous one for this thread. */
+#if LOL_FEATURE_THREADS
+    static thread_local int64_t last = 0;
+#else
+    static int64_t last = 0;
+#endif
+    if (ret < last)
+        ret = last;
+    last = ret;
+
+    return ret;
+}
+
+bool Timer::HasTsc()
+{
+#if LOL_TIMER_TSC
+    return tsc().m_enabled;
+#else
+    return false;
+#endif
+}
+
+void Timer::WaitNs(int64_t ns)
+{
+    int64_t const deadline = m_ns + ns;
+
+    for (;;)
+    {
+        int64_t const now = Now(), remaining = deadline - now;
+        if (remaining <= 0)
+            break;
+
+        /* Sleep as long as the OS is unlikely to overshoot the deadline,
+         * and keep track of how late it wakes us up. */
+        int64_t const margin = 2 * m_oversleep;
+        if (remaining > margin)
+        {
+            int64_t const request = remaining - margin;
+            std::this_thread::sleep_for(std::chrono::nanoseconds(request));
+            int64_t const late = Now() - now - request;
+            m_oversleep = (7 * m_oversleep + lol::max(late, (int64_t)0)) / 8;
+            m_oversleep = lol::max(m_oversleep, (int64_t)50000);
+            continue;
+        }
+
+        /* Spin for the last part */
+#if LOL_TIMER_TSC
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+}
+
+} /* namespace lol */
+
@@ -0,0 +1,483 @@
+//
+//  Lol Engine — Unit tests for the EasyMesh class
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(easymesh_test)
+{
+    /* Signed volume of a closed mesh */
+    double mesh_volume(EasyMesh &mesh)
+    {
+        double ret = 0.0;
+        for (int i = 0; i < mesh.m_indices.count(); i += 3)
+        {
+            dvec3 a(mesh.m_vert[mesh.m_indices[i]].m_coord);
+            dvec3 b(mesh.m_vert[mesh.m_indices[i + 1]].m_coord);
+            dvec3 c(mesh.m_vert[mesh.m_indices[i + 2]].m_coord);
+            ret += dot(a, cross(b, c)) / 6.0;
+        }
+        return ret;
+    }
+
+    /* Union, difference or intersection of the last two braces */
+    void apply_csg(EasyMesh &mesh, int csg)
+    {
+        if (csg == 0)
+            mesh.CsgUnion();
+        else if (csg == 1)
+            mesh.CsgSub();
+        else
+            mesh.CsgAnd();
+    }
+
+    /* A box, or a sphere, combined with a smaller rotated box */
+    double csg_volume(int csg, int sphere_divisions)
+    {
+        EasyMesh mesh;
+        mesh.OpenBrace();
+        if (sphere_divisions)
+            mesh.AppendSphere(sphere_divisions, 2.f);
+        else
+            mesh.AppendBox(vec3(2.f));
+        mesh.OpenBrace();
+        mesh.AppendBox(vec3(1.5f));
+        mesh.RotateY(30.f);
+        mesh.RotateX(20.f);
+        mesh.Translate(vec3(.7f, .5f, .3f));
+        apply_csg(mesh, csg);
+        mesh.CloseBrace();
+        mesh.CloseBrace();
+        return mesh_volume(mesh);
+    }
+
+    /* Record a small script, only its last command depends on offset */
+    void record_script(EasyMesh &mesh, float offset)
+    {
+        mesh.BD()->Enable(MeshBuildOperation::CommandRecording);
+        mesh.OpenBrace();
+        mesh.AppendBox(vec3(2.f));
+        mesh.OpenBrace();
+        mesh.AppendCylinder(12, 3.f, 1.f, 1.f, false, false, true);
+        mesh.LoopStart(3);
+        mesh.RotateY(20.f);
+        mesh.Translate(vec3(.1f, 0.f, 0.f));
+        mesh.LoopEnd();
+        mesh.CsgSub();
+        mesh.CloseBrace();
+        mesh.CloseBrace();
+        mesh.SplitTriangles(1);
+        mesh.Translate(vec3(offset, 0.f, 0.f));
+        mesh.BD()->Disable(MeshBuildOperation::CommandRecording);
+    }
+
+    /* The same kind of script without loops, which only work when
+     * recorded, so that it can also be called directly */
+    void call_script(EasyMesh &mesh, float offset)
+    {
+        mesh.OpenBrace();
+        mesh.AppendBox(vec3(2.f));
+        mesh.OpenBrace();
+        mesh.AppendCylinder(12, 3.f, 1.f, 1.f, false, false, true);
+        mesh.RotateY(20.f);
+        mesh.CsgSub();
+        mesh.CloseBrace();
+        mesh.CloseBrace();
+        mesh.SplitTriangles(1);
+        mesh.VerticesCleanup();
+        mesh.Translate(vec3(offset, 0.f, 0.f));
+    }
+
+    void check_same_mesh(EasyMesh &a, EasyMesh &b)
+    {
+        lolunit_assert_equal(a.m_vert.count(), b.m_vert.count());
+        lolunit_assert_equal(a.m_indices.count(), b.m_indices.count());
+        for (int i = 0; i < a.m_indices.count(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_equal(a.m_indices[i], b.m_indices[i]);
+        }
+        for (int i = 0; i < a.m_vert.count(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_equal(a.m_vert[i].m_coord.x, b.m_vert[i].m_coord.x);
+            lolunit_assert_equal(a.m_vert[i].m_coord.y, b.m_vert[i].m_coord.y);
+            lolunit_assert_equal(a.m_vert[i].m_coord.z, b.m_vert[i].m_coord.z);
+        }
+    }
+
+    /* Check that the GPU-ready copy of the indices matches the mesh */
+    void check_gpu_indices(EasyMesh &mesh, int index_size)
+    {
+        lolunit_assert_equal(index_size, mesh.GetIndexSize());
+
+        array<uint8_t> buffer;
+        buffer.resize(mesh.m_indices.count() * index_size);
+        mesh.CopyIndices(buffer.data());
+
+        for (int i = 0; i < mesh.m_indices.count(); ++i)
+        {
+            uint32_t index;
+            if (index_size == 2)
+            {
+                uint16_t tmp;
+                memcpy(&tmp, buffer.data() + 2 * i, 2);
+                index = tmp;
+            }
+            else
+                memcpy(&index, buffer.data() + 4 * i, 4);
+
+            lolunit_set_context(i);
+            lolunit_assert_equal(mesh.m_indices[i], index);
+        }
+    }
+
+    lolunit_declare_test(small_mesh_index16)
+    {
+        EasyMesh mesh;
+        mesh.AppendBox(vec3(1.f));
+
+        lolunit_assert_less(mesh.GetVertexCount(), 65536);
+        check_gpu_indices(mesh, 2);
+
+        mesh.SetIndex32(true);
+        check_gpu_indices(mesh, 4);
+    }
+
+    lolunit_declare_test(large_mesh_index32)
+    {
+        /* One triangle split 10 times gives 4^10 triangles */
+        EasyMesh mesh;
+        mesh.AppendSimpleTriangle(100.f);
+        mesh.SplitTriangles(10);
+
+        lolunit_assert_equal(3 << 20, mesh.m_indices.count());
+        lolunit_assert_less(65536, mesh.GetVertexCount());
+
+        /* Merging the shared vertices leaves a triangular grid of
+         * (2^10 + 1) * (2^10 + 2) / 2 points, still above 16 bits */
+        mesh.VerticesMerge();
+        lolunit_assert_equal(1025 * 1026 / 2, mesh.GetVertexCount());
+        lolunit_assert_equal(3 << 20, mesh.m_indices.count());
+
+        for (int i = 0; i < mesh.m_indices.count(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_less(mesh.m_indices[i], (uint32_t)mesh.GetVertexCount());
+        }
+
+        check_gpu_indices(mesh, 4);
+    }
+
+    lolunit_declare_test(cmd_cache_replay)
+    {
+        /* Reference results, without the cache */
+        EasyMesh::SetCmdCache(0);
+        EasyMesh ref0, ref1;
+        record_script(ref0, 0.f);
+        ref0.ExecuteCmdStack();
+        record_script(ref1, 1.f);
+        ref1.ExecuteCmdStack();
+        lolunit_assert_less(0, ref0.m_indices.count());
+
+        EasyMesh::SetCmdCache(16 << 20);
+        EasyMesh::ClearCmdCache();
+
+        /* Filling the cache, then reading everything back from it */
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            EasyMesh mesh;
+            record_script(mesh, 0.f);
+            mesh.ExecuteCmdStack();
+            check_same_mesh(ref0, mesh);
+        }
+
+        /* Only the last command changes, everything else is reused */
+        EasyMesh mesh;
+        record_script(mesh, 1.f);
+        mesh.ExecuteCmdStack();
+        check_same_mesh(ref1, mesh);
+
+        EasyMesh::SetCmdCache(0);
+        EasyMesh::ClearCmdCache();
+    }
+
+    lolunit_declare_test(cmd_cache_recorded_calls)
+    {
+        /* Calls recorded like the Lua bindings do, then run through the
+         * cache, must build the same mesh as direct calls */
+        EasyMesh::SetCmdCache(16 << 20);
+        EasyMesh::ClearCmdCache();
+
+        for (int pass = 0; pass < 3; ++pass)
+        {
+            float offset = pass < 2 ? 0.f : 1.f;
+            EasyMesh ref;
+            call_script(ref, offset);
+            lolunit_assert_less(0, ref.m_indices.count());
+
+            EasyMesh mesh;
+            mesh.BD()->Enable(MeshBuildOperation::CommandRecording);
+            call_script(mesh, offset);
+            lolunit_assert_equal(0, mesh.m_indices.count());
+            mesh.BD()->Disable(MeshBuildOperation::CommandRecording);
+            mesh.ExecuteRecordedCmds();
+
+            lolunit_set_context(pass);
+            check_same_mesh(ref, mesh);
+            lolunit_unset_context(pass);
+        }
+
+        EasyMesh::SetCmdCache(0);
+    }
+
+    lolunit_declare_test(radial_jitter_welds)
+    {
+        /* Every torus quad has its own vertices, the shared corners must
+         * move together or the surface would crack */
+        EasyMesh mesh;
+        mesh.AppendTorus(16, 2.f, 3.f);
+        array<vec3> before;
+        for (int i = 0; i < mesh.m_vert.count(); ++i)
+            before << mesh.m_vert[i].m_coord;
+
+        mesh.RadialJitter(.2f);
+
+        int moved = 0;
+        for (int i = 0; i < before.count(); ++i)
+        {
+            moved += before[i] != mesh.m_vert[i].m_coord;
+            for (int j = 0; j < i; ++j)
+            {
+                if (before[i] != before[j])
+                    continue;
+                lolunit_set_context(i);
+                lolunit_assert_equal(mesh.m_vert[i].m_coord.x, mesh.m_vert[j].m_coord.x);
+                lolunit_assert_equal(mesh.m_vert[i].m_coord.y, mesh.m_vert[j].m_coord.y);
+                lolunit_assert_equal(mesh.m_vert[i].m_coord.z, mesh.m_vert[j].m_coord.z);
+            }
+        }
+        lolunit_assert_less(0, moved);
+    }
+
+    lolunit_declare_test(simplify_sphere)
+    {
+        EasyMesh mesh;
+        mesh.SetCurColor(vec4(1.f, .5f, 0.f, 1.f));
+        mesh.AppendSphere(8, 2.f);
+        int const before = mesh.m_indices.count() / 3;
+        double const volume = mesh_volume(mesh);
+
+        mesh.Simplify(.25f);
+
+        /* The surface stays closed and roughly the same shape */
+        int const after = mesh.m_indices.count() / 3;
+        lolunit_assert_lequal(after, before / 4);
+        lolunit_assert_greater(after, before / 8);
+        lolunit_assert_doubles_equal(volume, mesh_volume(mesh), .1 * volume);
+
+        /* Collapses only move vertices onto existing ones */
+        for (int i = 0; i < mesh.m_vert.count(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_equal(.5f, mesh.m_vert[i].m_color.y);
+            lolunit_assert_doubles_equal(1.0, length(mesh.m_vert[i].m_coord), 1e-4);
+        }
+        for (int i = 0; i < mesh.m_indices.count(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_less(mesh.m_indices[i], (uint32_t)mesh.m_vert.count());
+        }
+    }
+
+    lolunit_declare_test(simplify_lods)
+    {
+        EasyMesh mesh;
+        mesh.AppendSphere(8, 2.f);
+        int const before = mesh.m_indices.count() / 3;
+
+        array<EasyMesh> lods;
+        mesh.BuildLods(lods, 3, .5f);
+        lolunit_assert_equal(3, lods.count());
+        lolunit_assert_equal(before, mesh.m_indices.count() / 3);
+
+        int previous = before;
+        for (int i = 0; i < lods.count(); ++i)
+        {
+            int count = lods[i].m_indices.count() / 3;
+            lolunit_set_context(i);
+            lolunit_assert_less(count, previous);
+            lolunit_assert_greater(count, previous / 3);
+            previous = count;
+        }
+    }
+
+    lolunit_declare_test(vertex_cache_order)
+    {
+        for (int overdraw = 0; overdraw < 2; ++overdraw)
+        {
+            EasyMesh mesh;
+            mesh.BD()->Enable(MeshBuildOperation::CommandRecording);
+            mesh.AppendSphere(16, 2.f);
+            mesh.VerticesMerge();
+            mesh.BD()->Disable(MeshBuildOperation::CommandRecording);
+            mesh.ExecuteCmdStack();
+
+            int const vcount = mesh.m_vert.count();
+            int const icount = mesh.m_indices.count();
+            double const volume = mesh_volume(mesh);
+            vec2 const before = mesh.GetVertexCacheStats();
+
+            /* The same build, optimised at the end */
+            EasyMesh opt;
+            opt.BD()->Enable(MeshBuildOperation::CommandRecording);
+            opt.SetGpuOptimize(true, overdraw != 0);
+            opt.AppendSphere(16, 2.f);
+            opt.VerticesMerge();
+            opt.BD()->Disable(MeshBuildOperation::CommandRecording);
+            opt.ExecuteCmdStack();
+
+            lolunit_set_context(overdraw);
+            lolunit_assert_equal(vcount, opt.m_vert.count());
+            lolunit_assert_equal(icount, opt.m_indices.count());
+            lolunit_assert_doubles_equal(volume, mesh_volume(opt), 1e-5);
+
+            vec2 const after = opt.GetVertexCacheStats();
+            lolunit_assert_less(after.x, .8f);
+            lolunit_assert_less(after.x, before.x);
+            lolunit_assert_less(after.y, before.y);
+
+            /* Vertices are numbered by first use */
+            uint32_t next = 0;
+            for (int i = 0; i < opt.m_indices.count(); ++i)
+            {
+                lolunit_set_context(i);
+                lolunit_assert_lequal(opt.m_indices[i], next);
+                next += opt.m_indices[i] == next;
+            }
+        }
+    }
+
+    lolunit_declare_test(normal_weighting)
+    {
+        for (int mode = 0; mode < 3; ++mode)
+        {
+            EasyMesh mesh;
+            mesh.SetNormalWeighting(mode);
+            mesh.AppendSphere(16, 2.f);
+            mesh.VerticesMerge();
+            mesh.ComputeNormals(0, mesh.m_indices.count());
+
+            /* Whatever the weighting, sphere normals point outwards */
+            for (int i = 0; i < mesh.m_vert.count(); ++i)
+            {
+                VertexData const &v = mesh.m_vert[i];
+                lolunit_set_context(mode);
+                lolunit_set_context(i);
+                lolunit_assert_greater(dot(v.m_normal, normalize(v.m_coord)), .99f);
+            }
+        }
+    }
+
+    lolunit_declare_test(cleanup_keeps_winding)
+    {
+        EasyMesh mesh;
+        mesh.AppendSphere(8, 2.f);
+        int const icount = mesh.m_indices.count();
+        double const volume = mesh_volume(mesh);
+
+        /* Degenerate triangles first, so that the others have to move */
+        array<uint32_t> indices;
+        for (int i = 0; i < 4; ++i)
+            indices << 0 << 0 << 1;
+        indices += mesh.m_indices;
+        mesh.m_indices = indices;
+        mesh.m_vert << VertexData(vec3(5.f));
+
+        mesh.VerticesCleanup();
+        lolunit_assert_equal(icount, mesh.m_indices.count());
+        lolunit_assert_doubles_equal(volume, mesh_volume(mesh), 1e-6);
+        for (int i = 0; i < mesh.m_vert.count(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_less(mesh.m_vert[i].m_coord.x, 5.f);
+        }
+    }
+
+    lolunit_declare_test(cleanup_marks_dirty)
+    {
+        EasyMesh mesh;
+        mesh.AppendSphere(8, 2.f);
+
+        /* Only a degenerate triangle goes away, every vertex stays */
+        int const vcount = mesh.m_vert.count();
+        mesh.m_indices << 0 << 0 << 1;
+        mesh.m_state = MeshRender::CanRender;
+
+        mesh.VerticesCleanup();
+        lolunit_assert_equal(vcount, mesh.m_vert.count());
+        lolunit_assert(mesh.GetMeshState() == MeshRender::NeedConvert);
+    }
+
+    lolunit_declare_test(csg_box_volume)
+    {
+        for (int csg = 0; csg < 3; ++csg)
+        {
+            EasyMesh mesh;
+            mesh.OpenBrace();
+            mesh.AppendBox(vec3(2.f));
+            mesh.OpenBrace();
+            mesh.AppendBox(vec3(2.f));
+            mesh.Translate(vec3(1.f));
+            apply_csg(mesh, csg);
+            mesh.CloseBrace();
+            mesh.CloseBrace();
+
+            /* The boxes overlap on a unit cube */
+            lolunit_set_context(csg);
+            lolunit_assert_doubles_equal(csg == 0 ? 15.0 : csg == 1 ? 7.0 : 1.0,
+                                         mesh_volume(mesh), 1e-4);
+        }
+    }
+
+    lolunit_declare_test(csg_sphere_volume)
+    {
+        double box = 1.5 * 1.5 * 1.5;
+
+        for (int divisions = 0; divisions < 12; divisions += 4)
+        {
+            EasyMesh tmp;
+            if (divisions)
+                tmp.AppendSphere(divisions, 2.f);
+            else
+                tmp.AppendBox(vec3(2.f));
+            double base = mesh_volume(tmp);
+
+            double volume_or = csg_volume(0, divisions);
+            double volume_sub = csg_volume(1, divisions);
+            double volume_and = csg_volume(2, divisions);
+
+            /* No geometry may leak out of the split meshes */
+            lolunit_set_context(divisions);
+            lolunit_assert_greater(volume_and, 0.1);
+            lolunit_assert_doubles_equal(base + box, volume_or + volume_and, 1e-3);
+            lolunit_assert_doubles_equal(base, volume_sub + volume_and, 1e-3);
+        }
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,114 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <cstdio>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(movie_test)
+{
+    static long int file_size(char const *path)
+    {
+        File f;
+        f.Open(path, FileAccess::Read, true);
+        long int ret = f.IsValid() ? f.GetSize() : -1;
+        f.Close();
+        return ret;
+    }
+
+    lolunit_declare_test(feed_y4m)
+    {
+        char const *path = "movie-test.y4m";
+        ivec2 const size(160, 120);
+        int const frames = 1000;
+        int written = 0, dropped = 0;
+        float draw_time = 0.f;
+
+        Image image(size);
+        u8vec4 *pixels = image.Lock<PixelFormat::RGBA_8>();
+        image.Unlock(pixels);
+
+        {
+            Movie movie(path, size, 60.f);
+            lolunit_assert(movie.IsValid());
+
+            for (int n = 0; n < frames; ++n)
+            {
+                /* Generate a scrolling gradient outside the timed section */
+                pixels = image.Lock<PixelFormat::RGBA_8>();
+                for (int j = 0; j < size.y; ++j)
+                    for (int i = 0; i < size.x; ++i)
+                        pixels[j * size.x + i] = u8vec4(i + n, j, n, 255);
+                image.Unlock(pixels);
+
+                Timer t;
+                movie.Feed(image);
+                draw_time += t.Get();
+            }
+
+            written = movie.GetFrameCount();
+            dropped = movie.GetDroppedCount();
+        }
+
+        msg::info("%d frames fed, %d dropped, %.2f µs per frame\n",
+                  frames, dropped, 1e6f * draw_time / frames);
+
+        lolunit_assert_equal(frames, written + dropped);
+        lolunit_assert(written > 0);
+
+        /* The movie is flushed once destroyed */
+        long int header = String("YUV4MPEG2 W160 H120 F60:1 Ip A1:1 C444\n").count();
+        long int frame = 6 + 3 * size.x * size.y;
+        lolunit_assert_equal(header + written * frame, file_size(path));
+
+        remove(path);
+    }
+
+    lolunit_declare_test(lock_raw)
+    {
+        char const *path = "movie-test.raw";
+        ivec2 const size(64, 48);
+        int written = 0;
+
+        {
+            Movie movie(path, size, 30.f);
+            lolunit_assert(movie.IsValid());
+            lolunit_assert_equal(size.x, movie.GetSize().x);
+            lolunit_assert_equal(size.y, movie.GetSize().y);
+
+            for (int n = 0; n < 100; ++n)
+            {
+                u8vec4 *pixels = movie.Lock();
+                if (!pixels)
+                    continue;
+                for (int i = 0; i < size.x * size.y; ++i)
+                    pixels[i] = u8vec4(n);
+                movie.Unlock(pixels);
+            }
+
+            written = movie.GetFrameCount();
+            lolunit_assert_equal(100, written + movie.GetDroppedCount());
+        }
+
+        lolunit_assert_equal(written * size.x * size.y * 4, file_size(path));
+
+        remove(path);
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,219 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+struct TreeTestElement
+{
+    box3 m_box;
+    box3 const &GetAABB() const { return m_box; }
+};
+
+lolunit_declare_fixture(aabb_tree_test)
+{
+    box3 random_box(float range, float size)
+    {
+        vec3 p(rand(-range, range), rand(-range, range), rand(-range, range));
+        vec3 s(rand(0.f, size), rand(0.f, size), rand(0.f, size));
+        return box3(p, p + s);
+    }
+
+    /* Elements whose box overlaps query, the slow way */
+    int count_overlaps(array<TreeTestElement> const &elements,
+                       array<bool> const &alive, box3 const &query)
+    {
+        int ret = 0;
+        for (int i = 0; i < elements.count(); ++i)
+            ret += alive[i] && TestAABBVsAABB(elements[i].m_box, query);
+        return ret;
+    }
+
+    template<typename T>
+    void check_queries(T &tree, array<TreeTestElement> const &elements,
+                       array<bool> const &alive)
+    {
+        for (int n = 0; n < 50; ++n)
+        {
+            box3 query = random_box(10.f, 4.f);
+            array<TreeTestElement *> found;
+            tree.FindElements(query, found);
+
+            lolunit_set_context(n);
+            lolunit_assert_equal(count_overlaps(elements, alive, query), found.count());
+            for (int i = 0; i < found.count(); ++i)
+            {
+                lolunit_assert(TestAABBVsAABB(found[i]->m_box, query));
+                for (int j = 0; j < i; ++j)
+                    lolunit_assert(found[i] != found[j]);
+            }
+        }
+    }
+
+    lolunit_declare_test(octree_unique_results)
+    {
+        array<TreeTestElement> elements;
+        array<bool> alive;
+        elements.resize(300);
+        alive.resize(300, true);
+        for (int i = 0; i < elements.count(); ++i)
+            elements[i].m_box = random_box(9.f, 2.f);
+
+        Octree<TreeTestElement> tree;
+        tree.SetSize(vec3(20.f));
+        tree.SetMaxDepth(4);
+        tree.SetMaxElement(8);
+        for (int i = 0; i < elements.count(); ++i)
+            tree.RegisterElement(&elements[i]);
+
+        /* Elements spanning several leaves are only returned once */
+        for (int n = 0; n < 50; ++n)
+        {
+            box3 query = random_box(10.f, 4.f);
+            array<TreeTestElement *> found;
+            tree.FindElements(query, found);
+
+            lolunit_set_context(n);
+            for (int i = 0; i < found.count(); ++i)
+                for (int j = 0; j < i; ++j)
+                    lolunit_assert(found[i] != found[j]);
+
+            /* The tree may return more, but never misses one */
+            for (int i = 0; i < elements.count(); ++i)
+            {
+                if (!TestAABBVsAABB(elements[i].m_box, query))
+                    continue;
+                lolunit_set_context(i);
+                lolunit_assert(found.find(&elements[i]) != INDEX_NONE);
+            }
+        }
+
+        /* Removed elements are not returned anymore */
+        for (int i = 0; i < elements.count(); i += 2)
+            tree.UnregisterElement(&elements[i]);
+        array<TreeTestElement *> found;
+        tree.FindElements(box3(vec3(-10.f), vec3(10.f)), found);
+        lolunit_assert_equal(elements.count() / 2, found.count());
+
+        /* They come back, once, when registered again */
+        for (int i = 0; i < elements.count(); i += 2)
+            tree.RegisterElement(&elements[i]);
+        found.empty();
+        tree.FindElements(box3(vec3(-10.f), vec3(10.f)), found);
+        lolunit_assert_equal(elements.count(), found.count());
+
+        /* Moving elements around reuses the slots of the removed ones */
+        for (int n = 0; n < 20; ++n)
+            for (int i = n % 3; i < elements.count(); i += 3)
+            {
+                tree.UnregisterElement(&elements[i]);
+                tree.RegisterElement(&elements[i]);
+            }
+        lolunit_assert_equal(elements.count(), tree.GetElements().count());
+        found.empty();
+        tree.FindElements(box3(vec3(-10.f), vec3(10.f)), found);
+        lolunit_assert_equal(elements.count(), found.count());
+    }
+
+    lolunit_declare_test(dynamic_tree_moves)
+    {
+        array<TreeTestElement> elements;
+        array<bool> alive;
+        array<int> proxies;
+        elements.resize(1000);
+        alive.resize(1000, true);
+        proxies.resize(1000);
+
+        DynamicAABBTree3<TreeTestElement> tree;
+        for (int i = 0; i < elements.count(); ++i)
+        {
+            elements[i].m_box = random_box(10.f, 1.f);
+            proxies[i] = tree.Insert(&elements[i], elements[i].m_box);
+        }
+        lolunit_assert_equal(1000, tree.GetCount());
+        check_queries(tree, elements, alive);
+
+        /* Rotations keep the tree reasonably balanced */
+        lolunit_assert_less(tree.GetHeight(), 30);
+
+        for (int step = 0; step < 10; ++step)
+        {
+            for (int i = 0; i < elements.count(); ++i)
+            {
+                vec3 d(rand(-.3f, .3f), rand(-.3f, .3f), rand(-.3f, .3f));
+                elements[i].m_box += d;
+                if (alive[i])
+                    tree.Move(proxies[i], elements[i].m_box, d);
+            }
+
+            /* Remove a few elements, and bring back a few others */
+            for (int n = 0; n < 20; ++n)
+            {
+                int i = rand(elements.count());
+                if (alive[i])
+                    tree.Remove(proxies[i]);
+                else
+                    proxies[i] = tree.Insert(&elements[i], elements[i].m_box);
+                alive[i] = !alive[i];
+            }
+
+            lolunit_set_context(step);
+            check_queries(tree, elements, alive);
+        }
+    }
+
+    lolunit_declare_test(dynamic_tree_build)
+    {
+        array<TreeTestElement> elements;
+        array<bool> alive;
+        elements.resize(2000);
+        alive.resize(2000, true);
+
+        array<TreeTestElement *, box3> input;
+        for (int i = 0; i < elements.count(); ++i)
+        {
+            elements[i].m_box = random_box(10.f, 1.f);
+            input.push(&elements[i], elements[i].m_box);
+        }
+
+        DynamicAABBTree3<TreeTestElement> tree;
+        array<int> proxies;
+        tree.Build(input, proxies);
+        lolunit_assert_equal(2000, tree.GetCount());
+        check_queries(tree, elements, alive);
+        for (int i = 0; i < proxies.count(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert(tree.GetElement(proxies[i]) == &elements[i]);
+        }
+
+        /* The SAH tree beats one built by insertions */
+        DynamicAABBTree3<TreeTestElement> incremental;
+        for (int i = 0; i < elements.count(); ++i)
+            incremental.Insert(&elements[i], elements[i].m_box);
+        lolunit_assert_less(tree.GetCost(), incremental.GetCost());
+
+        /* Built trees still accept changes */
+        for (int i = 0; i < elements.count(); i += 3)
+        {
+            tree.Remove(proxies[i]);
+            alive[i] = false;
+        }
+        check_queries(tree, elements, alive);
+    }
+};
+
+} /* namespace lol */
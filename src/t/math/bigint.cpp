@@ -21,6 +21,19 @@ namespace lol
 
 lolunit_declare_fixture(bigint_test)
 {
+    typedef bigint<4, uint8_t> int32x8;
+    typedef bigint<8, uint8_t> int64x8;
+    typedef bigint<2, uint16_t> int32x16;
+    typedef bigint<3, uint16_t> int48x16;
+    typedef bigint<1, uint32_t> int32x32;
+    typedef bigint<2, uint32_t> int64x32;
+    typedef bigint<3, uint32_t> int96x32;
+    typedef bigint<5, uint32_t> int160x32;
+#if defined __SIZEOF_INT128__
+    typedef bigint<1, uint64_t> int64x64;
+    typedef bigint<2, uint64_t> int128x64;
+#endif
+
     lolunit_declare_test(declaration)
     {
         bigint<> a;
@@ -236,6 +249,150 @@ lolunit_declare_fixture(bigint_test)
         lolunit_assert_equal((int32_t)(c * b), 0);
         lolunit_assert_equal((int32_t)(c * c), 100);
     }
+
+    lolunit_declare_test(int64_cast)
+    {
+        int64_t const values[] = { 0, 1, -1, (int64_t)0x123456789abcdefll,
+                                   -(int64_t)0x123456789abcdefll, INT64_MIN };
+
+        for (int64_t x : values)
+        {
+            lolunit_assert_equal((int64_t)int32x8(x), (int64_t)(int32_t)x);
+            lolunit_assert_equal((int64_t)int64x8(x), x);
+            lolunit_assert_equal((int64_t)int48x16(x), x << 16 >> 16);
+            lolunit_assert_equal((int64_t)int64x32(x), x);
+            lolunit_assert_equal((int64_t)int96x32(x), x);
+#if defined __SIZEOF_INT128__
+            lolunit_assert_equal((int64_t)int64x64(x), x);
+            lolunit_assert_equal((int64_t)int128x64(x), x);
+#endif
+        }
+
+        /* Sign extension when growing a bigint */
+        int64x32 a(-5);
+        lolunit_assert_equal((int64_t)int160x32(a), -5);
+        lolunit_assert_equal((uint32_t)int96x32(a), (uint32_t)-5);
+    }
+
+    lolunit_declare_test(full_width_digits)
+    {
+        /* All bits of every digit are used */
+        int64x32 a(0xffffffffu), b(1);
+
+        lolunit_assert_equal((int64_t)(a + b), 0x100000000ll);
+        lolunit_assert_equal((int64_t)(a + b - b), 0xffffffffll);
+        lolunit_assert_equal((int64_t)(b - a), 1 - 0xffffffffll);
+        lolunit_assert_equal((int64_t)(a << 4), 0xffffffff0ll);
+        lolunit_assert_equal((int64_t)((a << 36) >> 40), -1);
+        lolunit_assert_equal((int64_t)(-a), -0xffffffffll);
+        lolunit_assert_equal((int64_t)~a, ~0xffffffffll);
+    }
+
+    lolunit_declare_test(compare_digits)
+    {
+        /* The most significant digit decides */
+        int64x32 a((int64_t)0x100000000ll), b((int64_t)0xffffffffll);
+
+        lolunit_assert(a > b);
+        lolunit_assert(b < a);
+        lolunit_assert(-a < -b);
+        lolunit_assert(-b > -a);
+    }
+
+    lolunit_declare_test(multiply_random)
+    {
+        for (int n = 0; n < 1000; ++n)
+        {
+            /* Signed values of any magnitude; the wider one stays within
+             * 33 bits so that its product with x32 / 2 fits in 64 bits */
+            int32_t x32 = (int32_t)(next_signed() >> (32 + next() % 32));
+            int32_t y32 = (int32_t)(next_signed() >> (32 + next() % 32));
+            int64_t y = next_signed() >> (31 + next() % 32);
+
+            lolunit_assert_equal((int64_t)(int32x8(x32) * int32x8(y32)), (int64_t)x32 * y32);
+            lolunit_assert_equal((int64_t)(int32x16(x32) * int32x16(y32)), (int64_t)x32 * y32);
+            lolunit_assert_equal((int64_t)(int32x32(x32) * int32x32(y32)), (int64_t)x32 * y32);
+            lolunit_assert_equal((int64_t)(int32x32(x32 / 2) * int96x32(y)), (int64_t)(x32 / 2) * y);
+        }
+    }
+
+    lolunit_declare_test(divide_random)
+    {
+        for (int n = 0; n < 1000; ++n)
+        {
+            int64_t x = next_signed() >> (next() % 60);
+            int64_t y = next_signed() >> (next() % 60);
+            if (!y)
+                continue;
+
+            lolunit_assert_equal((int64_t)(int64x32(x) / int64x32(y)), x / y);
+            lolunit_assert_equal((int64_t)(int64x32(x) % int64x32(y)), x % y);
+            lolunit_assert_equal((int64_t)(int64x8(x) / int64x8(y)), x / y);
+            lolunit_assert_equal((int64_t)(int64x8(x) % int64x8(y)), x % y);
+            lolunit_assert_equal((int64_t)(int96x32(x) / int64x32(y)), x / y);
+            lolunit_assert_equal((int64_t)(int96x32(x) % int64x32(y)), x % y);
+        }
+    }
+
+    lolunit_declare_test(large_numbers)
+    {
+        /* Check that (a.b + c) / b == a and (a.b + c) % b == c for
+         * sizes that use both Comba and Karatsuba multiplication. */
+        check_large<8, uint32_t>();
+        check_large<64, uint32_t>();
+        check_large<128, uint32_t>();
+#if defined __SIZEOF_INT128__
+        check_large<4, uint64_t>();
+        check_large<64, uint64_t>();
+#endif
+    }
+
+    template<unsigned int N, typename T>
+    void check_large()
+    {
+        for (int n = 0; n < 20; ++n)
+        {
+            bigint<N, T> zero(0), a = random<N, T>(), b = random<N, T>();
+
+            /* Pick a remainder with the same sign as the product */
+            bigint<N, T> c = random<N, T>() % b;
+            if ((c < zero) != ((a < zero) != (b < zero)))
+                c = -c;
+
+            auto p = a * b + c;
+            bool quotient_ok = p / b == bigint<2 * N, T>(a);
+            lolunit_assert(quotient_ok);
+            lolunit_assert(p % b == c);
+
+            /* Squares of negative numbers */
+            lolunit_assert(a * a == (-a) * (-a));
+        }
+    }
+
+    template<unsigned int N, typename T>
+    bigint<N, T> random()
+    {
+        /* Random digits and a random number of leading zero or one bits */
+        bigint<N, T> ret(0);
+        for (unsigned int i = 0; i < N * sizeof(T); ++i)
+            ret = (ret << 8) ^ bigint<N, T>(next() & 0xff);
+        return ret >> (int)(next() % (N * sizeof(T) * 4));
+    }
+
+    uint32_t next()
+    {
+        m_seed = m_seed * 6364136223846793005ull + 1442695040888963407ull;
+        return (uint32_t)(m_seed >> 32);
+    }
+
+    /* Half of these are negative, and shifting them keeps the sign */
+    int64_t next_signed()
+    {
+        uint64_t hi = next();
+        return (int64_t)(hi << 32 | next());
+    }
+
+    uint64_t m_seed = 1;
 };
 
 } /* namespace lol */
@@ -0,0 +1,72 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(geometry_test)
+{
+    lolunit_declare_test(orient3d_simple)
+    {
+        vec3 a(0.f, 0.f, 0.f), b(1.f, 0.f, 0.f), c(0.f, 1.f, 0.f);
+
+        lolunit_assert_greater(Orient3D(a, b, c, vec3(0.f, 0.f, 1.f)), 0.0);
+        lolunit_assert_less(Orient3D(a, b, c, vec3(0.f, 0.f, -1.f)), 0.0);
+        lolunit_assert_equal(0.0, Orient3D(a, b, c, vec3(5.f, 7.f, 0.f)));
+
+        /* Swapping two points flips the plane */
+        lolunit_assert_less(Orient3D(a, c, b, vec3(0.f, 0.f, 1.f)), 0.0);
+    }
+
+    lolunit_declare_test(orient3d_nearly_coplanar)
+    {
+        /* Large integer points on the plane x + 2y = z, where the double
+         * precision determinant is mostly rounding noise. They are exact
+         * floats, so the expected signs are known. */
+        for (int n = 0; n < 10000; ++n)
+        {
+            vec3 p[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                float x = (float)rand(-(1 << 21), 1 << 21);
+                float y = (float)rand(-(1 << 20), 1 << 20);
+                p[i] = vec3(x, y, x + 2.f * y);
+            }
+
+            vec3 up = p[3] + vec3(0.f, 0.f, 1.f);
+            vec3 down = p[3] - vec3(0.f, 0.f, 1.f);
+            double on = Orient3D(p[0], p[1], p[2], p[3]);
+            double above = Orient3D(p[0], p[1], p[2], up);
+            double below = Orient3D(p[0], p[1], p[2], down);
+
+            lolunit_set_context(n);
+            lolunit_assert_equal(0.0, on);
+
+            /* Either the points are aligned, or the sides are opposite */
+            if (above == 0.0)
+            {
+                lolunit_assert_equal(0.0, below);
+                continue;
+            }
+            lolunit_assert_less(above * below, 0.0);
+            lolunit_assert_less(above * Orient3D(p[1], p[0], p[2], up), 0.0);
+            lolunit_assert_greater(above * Orient3D(p[1], p[2], p[0], up), 0.0);
+        }
+    }
+};
+
+} /* namespace lol */
+
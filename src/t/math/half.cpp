@@ -21,6 +21,26 @@ namespace lol
 
 lolunit_declare_fixture(half_test)
 {
+    void setup()
+    {
+        /* Random floats around the half range, and some special values */
+        for (int n = 0; n < 10000; ++n)
+        {
+            union { uint32_t x; float f; } u;
+            u.x = (rand<uint32_t>() & 0x87ffffffu) + 0x30000000u;
+            floats << u.f;
+        }
+        for (size_t i = 0; i < sizeof(pairs) / sizeof(*pairs); i++)
+            floats << pairs[i].f;
+        floats << 65504.f << 65519.f << 65520.f << 1e10f << -1e-10f;
+    }
+
+    void teardown()
+    {
+        floats.empty();
+        half::set_conversion(half::conversion::automatic);
+    }
+
     lolunit_declare_test(float_to_half)
     {
         for (size_t i = 0; i < sizeof(pairs) / sizeof(*pairs); i++)
@@ -168,6 +188,111 @@ lolunit_declare_fixture(half_test)
         }
     }
 
+    lolunit_declare_test(array_half_to_float)
+    {
+        half h[0x10000];
+        float f[0x10000];
+        for (uint32_t i = 0; i < 0x10000; i++)
+            h[i] = half::makebits(i);
+
+        half::conversion const list[] = { half::conversion::table,
+                                          half::conversion::sse2,
+                                          half::conversion::f16c };
+        for (auto c : list)
+        {
+            if (!half::set_conversion(c))
+                continue;
+
+            half::convert(f, h, 0x10000);
+            for (uint32_t i = 0; i < 0x10000; i++)
+            {
+                lolunit_set_context(i);
+                /* Compare bits, since -ffast-math assumes there is no NaN */
+                union { float f; uint32_t x; } u = { f[i] };
+                if (h[i].is_nan())
+                    lolunit_assert((u.x & 0x7fffffffu) > 0x7f800000u);
+                else
+                    lolunit_assert_equal(f[i], (float)h[i]);
+            }
+        }
+    }
+
+    lolunit_declare_test(array_float_to_half)
+    {
+        array<half> h;
+        h.resize(floats.count());
+
+        half::conversion const list[] = { half::conversion::table,
+                                          half::conversion::sse2,
+                                          half::conversion::f16c };
+        for (auto c : list)
+        {
+            if (!half::set_conversion(c))
+                continue;
+
+            half::convert(h.data(), floats.data(), floats.count());
+            for (int i = 0; i < floats.count(); i++)
+            {
+                lolunit_set_context(i);
+                lolunit_assert_equal(h[i].bits, half(floats[i]).bits);
+            }
+        }
+    }
+
+    lolunit_declare_test(array_float_to_half_rounded)
+    {
+        array<half> h, ref;
+        h.resize(floats.count());
+        ref.resize(floats.count());
+
+        half::set_conversion(half::conversion::table);
+        half::convert(ref.data(), floats.data(), floats.count(), true);
+
+        /* The result must be at least as close as the accurate conversion,
+         * which rounds ties up and flushes some denormals to zero. */
+        for (int i = 0; i < floats.count(); i++)
+        {
+            lolunit_set_context(i);
+            half a = half::makeaccurate(floats[i]);
+            if (a.is_nan())
+            {
+                lolunit_assert(ref[i].is_nan());
+                continue;
+            }
+
+            double f = floats[i];
+            lolunit_assert(std::fabs((double)ref[i] - f)
+                            <= std::fabs((double)a - f));
+        }
+
+        half::conversion const list[] = { half::conversion::sse2,
+                                          half::conversion::f16c };
+        for (auto c : list)
+        {
+            if (!half::set_conversion(c))
+                continue;
+
+            half::convert(h.data(), floats.data(), floats.count(), true);
+            for (int i = 0; i < floats.count(); i++)
+            {
+                lolunit_set_context(i);
+                lolunit_assert_equal(h[i].bits, ref[i].bits);
+            }
+        }
+
+        /* Ties go to the even value */
+        float const ties[] = { 1.f + 1.f / 2048, 1.f + 3.f / 2048,
+                               1.f / (1 << 25), 3.f / (1 << 25), 65520.f };
+        uint16_t const bits[] = { 0x3c00, 0x3c02, 0x0000, 0x0002, 0x7c00 };
+        half::set_conversion(half::conversion::automatic);
+        half::convert(h.data(), ties, 5, true);
+        for (int i = 0; i < 5; i++)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_equal(h[i].bits, bits[i]);
+        }
+    }
+
     lolunit_declare_test(half_to_int)
     {
         lolunit_assert_equal((int)(half)(0.0f), 0);
@@ -268,6 +393,8 @@ lolunit_declare_fixture(half_test)
     struct test_pair { float f; uint16_t x; };
 
     static test_pair const pairs[11];
+
+    array<float> floats;
 };
 
 half_test::test_pair const half_test::pairs[] =
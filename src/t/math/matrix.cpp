@@ -358,6 +358,77 @@ lolunit_declare_fixture(matrix_test)
             lolunit_assert_doubles_equal(m2[i][j], mat4(1.f)[i][j], 1e-5);
     }
 
+    lolunit_declare_test(determinant_singular)
+    {
+        mat3 m3(vec3(1, 2, 3),
+                vec3(4, 5, 6),
+                vec3(7, 8, 9));
+        lolunit_assert_doubles_equal(determinant(m3), 0.f, 1e-5);
+
+        mat4 m4(vec4(1, 2, 3, 4),
+                vec4(5, 6, 7, 8),
+                vec4(1, 2, 3, 4),
+                vec4(9, 1, 2, 3));
+        lolunit_assert_doubles_equal(determinant(m4), 0.f, 1e-5);
+
+        typedef mat_t<float, 5, 5> mat5;
+        mat5 m5(0.f);
+        m5[1][2] = m5[2][3] = m5[3][4] = 1.f;
+        lolunit_assert_equal(determinant(m5), 0.f);
+    }
+
+    lolunit_declare_test(determinant_5x5)
+    {
+        typedef mat_t<double, 5, 5> dmat5;
+        dmat5 m;
+        for (int i = 0; i < 5; ++i)
+            for (int j = 0; j < 5; ++j)
+                m[i][j] = (double)((i * 7 + j * 3) % 11) - 5.0;
+
+        /* Compare with a cofactor expansion along the first column,
+         * which uses the closed-form 4×4 determinant. */
+        double expected = 0.0;
+        for (int j = 0; j < 5; ++j)
+            expected += m[0][j] * cofactor(m, 0, j);
+
+        lolunit_assert_doubles_equal(determinant(m), expected,
+                                     1e-9 * abs(expected));
+    }
+
+    lolunit_declare_test(inverse_4x4_random)
+    {
+        for (int n = 0; n < 100; ++n)
+        {
+            /* Diagonally dominant matrices are well conditioned */
+            mat4 m(4.f);
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    m[i][j] += rand(-1.f, 1.f);
+
+            mat4 m2 = inverse(m) * m;
+            lolunit_set_context(n);
+            for (int j = 0; j < 4; ++j)
+            for (int i = 0; i < 4; ++i)
+                lolunit_assert_doubles_equal(m2[i][j], mat4(1.f)[i][j], 1e-5);
+            lolunit_unset_context(n);
+        }
+    }
+
+    lolunit_declare_test(inverse_5x5)
+    {
+        typedef mat_t<double, 5, 5> dmat5;
+        dmat5 m;
+        for (int i = 0; i < 5; ++i)
+            for (int j = 0; j < 5; ++j)
+                m[i][j] = (double)((i * 7 + j * 3) % 11) - 5.0;
+
+        /* Multiply with original matrix and check that we get identity */
+        dmat5 m2 = inverse(m) * m;
+        for (int j = 0; j < 5; ++j)
+        for (int i = 0; i < 5; ++i)
+            lolunit_assert_doubles_equal(m2[i][j], dmat5(1.0)[i][j], 1e-12);
+    }
+
     lolunit_declare_test(kronecker_product)
     {
         int const COLS1 = 2, ROWS1 = 3;
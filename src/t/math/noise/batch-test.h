@@ -0,0 +1,85 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// Checks shared by the noise batch tests
+// --------------------------------------
+//
+// Batch results must stay within 1e-4 of eval() for coordinates up to
+// 100, the bound documented in <lol/math/noise/batch.h>. They only match
+// to the last bit if the compiler does not reorder float operations, and
+// the tests are built with -ffast-math like the rest of the engine.
+//
+
+namespace lol
+{
+
+static double const noise_batch_error = 1e-4;
+
+/* Largest error of eval_points() on random points, compared to eval()
+ * or eval_fbm() */
+template<template<int> class NOISE, int N>
+double noise_points_error(NOISE<N> const &noise, int octaves)
+{
+    /* An odd count to exercise the partial last batch */
+    array<vec_t<float, N>> points;
+    array<float> values;
+    for (int n = 0; n < 1001; ++n)
+    {
+        vec_t<float, N> p;
+        for (int i = 0; i < N; ++i)
+            p[i] = rand(-50.f, 50.f);
+        points << p;
+    }
+    values.resize(points.count());
+
+    noise.eval_points(points.data(), values.data(), points.count(), octaves);
+
+    double ret = 0.0;
+    for (int n = 0; n < points.count(); ++n)
+    {
+        float expected = octaves == 1 ? noise.eval(points[n])
+                                      : noise.eval_fbm(points[n], octaves);
+        ret = max(ret, (double)abs(expected - values[n]));
+    }
+    return ret;
+}
+
+/* Largest error of eval_grid() on a 3D grid, compared to eval_fbm() */
+template<template<int> class NOISE>
+double noise_grid_error(NOISE<3> const &noise)
+{
+    /* Large enough to be split across threads */
+    vec3 const origin(-3.7f, 11.f, 0.25f), step(0.031f, 0.f, 0.017f);
+    ivec3 const dims(317, 1, 211);
+
+    array<float> values;
+    values.resize(dims.x * dims.y * dims.z);
+    noise.eval_grid(origin, step, dims, values.data(), 3);
+
+    double ret = 0.0;
+    for (int k = 0; k < dims.z; ++k)
+    for (int j = 0; j < dims.y; ++j)
+    for (int i = 0; i < dims.x; ++i)
+    {
+        vec3 p = origin + step * vec3(ivec3(i, j, k));
+        float expected = noise.eval_fbm(p, 3);
+        float value = values[(k * dims.y + j) * dims.x + i];
+        ret = max(ret, (double)abs(expected - value));
+    }
+    return ret;
+}
+
+} /* namespace lol */
+
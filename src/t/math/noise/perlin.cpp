@@ -0,0 +1,55 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+#include "batch-test.h"
+
+namespace lol
+{
+
+lolunit_declare_fixture(perlin_noise_test)
+{
+    lolunit_declare_test(eval_points)
+    {
+        /* No batch kernel in 1D, the points are evaluated one by one */
+        lolunit_assert_lequal(noise_points_error(perlin_noise<1>(42), 1),
+                              noise_batch_error);
+        lolunit_assert_lequal(noise_points_error(perlin_noise<2>(42), 1),
+                              noise_batch_error);
+        lolunit_assert_lequal(noise_points_error(perlin_noise<3>(42), 1),
+                              noise_batch_error);
+        lolunit_assert_lequal(noise_points_error(perlin_noise<4>(42), 1),
+                              noise_batch_error);
+        lolunit_assert_lequal(noise_points_error(perlin_noise<6>(42), 1),
+                              noise_batch_error);
+    }
+
+    lolunit_declare_test(eval_points_fbm)
+    {
+        lolunit_assert_lequal(noise_points_error(perlin_noise<2>(42), 5),
+                              noise_batch_error);
+        lolunit_assert_lequal(noise_points_error(perlin_noise<3>(42), 3),
+                              noise_batch_error);
+    }
+
+    lolunit_declare_test(eval_grid)
+    {
+        lolunit_assert_lequal(noise_grid_error(perlin_noise<3>()),
+                              noise_batch_error);
+    }
+};
+
+}
+
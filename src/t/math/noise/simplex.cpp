@@ -16,11 +16,39 @@
 
 #include <lolunit.h>
 
+#include "batch-test.h"
+
 namespace lol
 {
 
 lolunit_declare_fixture(simplex_noise_test)
 {
+    lolunit_declare_test(eval_points)
+    {
+        lolunit_assert_lequal(noise_points_error(simplex_noise<2>(42), 1),
+                              noise_batch_error);
+        lolunit_assert_lequal(noise_points_error(simplex_noise<3>(42), 1),
+                              noise_batch_error);
+        lolunit_assert_lequal(noise_points_error(simplex_noise<4>(42), 1),
+                              noise_batch_error);
+        lolunit_assert_lequal(noise_points_error(simplex_noise<7>(42), 1),
+                              noise_batch_error);
+    }
+
+    lolunit_declare_test(eval_points_fbm)
+    {
+        lolunit_assert_lequal(noise_points_error(simplex_noise<2>(42), 5),
+                              noise_batch_error);
+        lolunit_assert_lequal(noise_points_error(simplex_noise<3>(42), 3),
+                              noise_batch_error);
+    }
+
+    lolunit_declare_test(eval_grid)
+    {
+        lolunit_assert_lequal(noise_grid_error(simplex_noise<3>()),
+                              noise_batch_error);
+    }
 };
 
 }
+
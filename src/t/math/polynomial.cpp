@@ -315,6 +315,86 @@ lolunit_declare_fixture(polynomial_test)
         lolunit_assert_doubles_equal(roots1[2], -10, 1e-5);
     }
 
+    lolunit_declare_test(degree_4_roots)
+    {
+        /* (x - 1)(x + 2)(x² + 1) has two real and two complex roots */
+        polynomial<double> p = polynomial<double> { -1.0, 1.0 }
+                             * polynomial<double> { 2.0, 1.0 }
+                             * polynomial<double> { 1.0, 0.0, 1.0 };
+        auto roots1 = p.roots();
+
+        lolunit_assert_equal(roots1.count(), 2);
+        lolunit_assert_doubles_equal(roots1[0], -2, 1e-10);
+        lolunit_assert_doubles_equal(roots1[1], 1, 1e-10);
+    }
+
+    lolunit_declare_test(degree_5_roots)
+    {
+        double const expected[] = { -3.0, -0.5, 1.0, 2.0, 4.0 };
+
+        polynomial<double> p { 1.0 };
+        for (double r : expected)
+            p *= polynomial<double> { -r, 1.0 };
+        auto roots1 = p.roots();
+
+        lolunit_assert_equal(roots1.count(), 5);
+        for (int i = 0; i < 5; ++i)
+            lolunit_assert_doubles_equal(roots1[i], expected[i], 1e-10);
+    }
+
+    lolunit_declare_test(degree_6_double_root)
+    {
+        /* (x - 1)²(x + 1)(x - 3)(x² + 4) */
+        polynomial<double> p = polynomial<double> { -1.0, 1.0 }
+                             * polynomial<double> { -1.0, 1.0 }
+                             * polynomial<double> { 1.0, 1.0 }
+                             * polynomial<double> { -3.0, 1.0 }
+                             * polynomial<double> { 4.0, 0.0, 1.0 };
+        auto roots1 = p.roots();
+
+        lolunit_assert_equal(roots1.count(), 3);
+        lolunit_assert_doubles_equal(roots1[0], -1, 1e-7);
+        lolunit_assert_doubles_equal(roots1[1], 1, 1e-7);
+        lolunit_assert_doubles_equal(roots1[2], 3, 1e-7);
+    }
+
+    lolunit_declare_test(triple_root)
+    {
+        /* (x - 1)³ goes through the cubic formula */
+        polynomial<double> p = polynomial<double> { -1.0, 1.0 }
+                             * polynomial<double> { -1.0, 1.0 }
+                             * polynomial<double> { -1.0, 1.0 };
+        auto roots1 = p.roots();
+
+        lolunit_assert_equal(roots1.count(), 1);
+        lolunit_assert_doubles_equal(roots1[0], 1, 1e-12);
+
+        /* (x - 1)³(x + 2)(x² + 1) goes through the Aberth method, which
+         * leaves three approximations about ε^⅓ away from 1 */
+        auto roots2 = (p * polynomial<double> { 2.0, 1.0 }
+                         * polynomial<double> { 1.0, 0.0, 1.0 }).roots();
+
+        lolunit_assert_equal(roots2.count(), 2);
+        lolunit_assert_doubles_equal(roots2[0], -2, 1e-10);
+        lolunit_assert_doubles_equal(roots2[1], 1, 1e-10);
+    }
+
+    lolunit_declare_test(close_distinct_roots)
+    {
+        /* (x - 1)(x - 1.000001)(x + 2)(x² + 1) has two real roots
+         * 1e-6 apart, which must not be merged as a double root */
+        polynomial<double> p = polynomial<double> { -1.0, 1.0 }
+                             * polynomial<double> { -1.000001, 1.0 }
+                             * polynomial<double> { 2.0, 1.0 }
+                             * polynomial<double> { 1.0, 0.0, 1.0 };
+        auto roots1 = p.roots();
+
+        lolunit_assert_equal(roots1.count(), 3);
+        lolunit_assert_doubles_equal(roots1[0], -2, 1e-10);
+        lolunit_assert_doubles_equal(roots1[1], 1, 1e-8);
+        lolunit_assert_doubles_equal(roots1[2], 1.000001, 1e-8);
+    }
+
     lolunit_declare_test(chebyshev)
     {
         polynomial<float> t0 = polynomial<float>::chebyshev(0);
@@ -349,6 +429,101 @@ lolunit_declare_fixture(polynomial_test)
         lolunit_assert_equal(t4[3], 0.f);
         lolunit_assert_equal(t4[4], 8.f);
     }
+
+    lolunit_declare_test(eval_estrin)
+    {
+        polynomial<double> p = polynomial<double>::chebyshev(13);
+
+        for (double x = -1.0; x <= 1.0; x += 0.125)
+        {
+            lolunit_set_context(x);
+            lolunit_assert_doubles_equal(p.eval_estrin(x), p.eval(x), 1e-12);
+            lolunit_unset_context(x);
+        }
+
+        /* Short polynomials and compositions still work */
+        polynomial<double> q { 2.0, 3.0 };
+        lolunit_assert_equal(q.eval_estrin(2.0), 8.0);
+        lolunit_assert_equal(polynomial<double>().eval_estrin(2.0), 0.0);
+        lolunit_assert_equal(q.eval_estrin(q)[1], 9.0);
+    }
+
+    lolunit_declare_test(eval_batch)
+    {
+        /* Use a count that is not a multiple of the vector size, so
+         * that the tail code is exercised too. */
+        polynomial<float> p = polynomial<float>::chebyshev(9);
+        polynomial<double> q = polynomial<double>::chebyshev(9);
+
+        float xf[77], yf[77];
+        double xd[77], yd[77];
+        for (int n = 0; n < 77; ++n)
+            xd[n] = xf[n] = rand(-1.f, 1.f);
+
+        p.eval(xf, yf, 77);
+        q.eval(xd, yd, 77);
+
+        for (int n = 0; n < 77; ++n)
+        {
+            lolunit_set_context(n);
+            /* Chebyshev polynomials have large coefficients, so the
+             * float version is compared to the double result */
+            lolunit_assert_doubles_equal(yf[n], q.eval(xd[n]), 1e-4);
+            lolunit_assert_doubles_equal(yd[n], q.eval(xd[n]), 1e-12);
+            lolunit_unset_context(n);
+        }
+
+        /* Constant polynomials */
+        polynomial<float> c { 3.f };
+        c.eval(xf, yf, 5);
+        lolunit_assert_equal(yf[4], 3.f);
+    }
+
+    lolunit_declare_test(fixed_size)
+    {
+        /* 1 - 2x + 0.5x³ */
+        fixed_polynomial<double, 4> p(1.0, -2.0, 0, 0.5);
+        polynomial<double> q = p.to_polynomial();
+
+        lolunit_assert_equal(p.degree(), 3);
+        lolunit_assert_equal(q.degree(), 3);
+        lolunit_assert_equal(p[1], -2.0);
+
+        for (double x = -3.0; x <= 3.0; x += 0.25)
+            lolunit_assert_equal(p.eval(x), q.eval(x));
+
+#if LOL_FEATURE_CXX11_CONSTEXPR
+        constexpr fixed_polynomial<int, 3> r(1, 2, 3);
+        static_assert(r.eval(2) == 17, "constexpr evaluation failed");
+#endif
+    }
+
+    lolunit_declare_test(karatsuba_multiplication)
+    {
+        /* Degree 40 is large enough to use Karatsuba multiplication; the
+         * results are exact with small integer coefficients. */
+        polynomial<double> p, q;
+        for (int i = 0; i <= 40; ++i)
+        {
+            p.set(i, (double)(rand(20) - 10));
+            q.set(i + 5, (double)(rand(20) - 10));
+        }
+        p.set(40, 1.0);
+        q.set(45, 1.0);
+
+        polynomial<double> r = p * q;
+        lolunit_assert_equal(r.degree(), p.degree() + q.degree());
+
+        for (int n = 0; n <= r.degree(); ++n)
+        {
+            double expected = 0.0;
+            for (int i = 0; i <= n; ++i)
+                expected += p[i] * q[n - i];
+            lolunit_set_context(n);
+            lolunit_assert_equal(r[n], expected);
+            lolunit_unset_context(n);
+        }
+    }
 };
 
 } /* namespace lol */
@@ -105,6 +105,136 @@ lolunit_declare_fixture(rand_test)
             lolunit_unset_context(k);
         }
     }
+
+    lolunit_declare_test(rng_seed)
+    {
+        rng a(42), b(42), c(43);
+
+        bool differ = false;
+        for (int i = 0; i < 100; ++i)
+        {
+            uint64_t x = a.next();
+            lolunit_assert_equal(x, b.next());
+            differ |= x != c.next();
+        }
+        lolunit_assert(differ);
+
+        /* Reseeding restarts the sequence */
+        a.seed(42);
+        b.seed(42);
+        lolunit_assert_equal(a.next(), b.next());
+    }
+
+    lolunit_declare_test(rng_jump)
+    {
+        rng a(1), b(1), c(1);
+        b.jump();
+        c.long_jump();
+
+        int same = 0;
+        for (int i = 0; i < 100; ++i)
+        {
+            uint64_t x = a.next(), y = b.next(), z = c.next();
+            same += (x == y) + (x == z) + (y == z);
+        }
+        lolunit_assert_equal(same, 0);
+    }
+
+    lolunit_declare_test(rng_fill_uint32)
+    {
+        /* Use a size that is not a multiple of the vector step */
+        int const count = 2003;
+
+        uint32_t values[count];
+        rng a(7), b(7);
+        a.fill(values, count);
+
+        int bits[32];
+        memset(bits, 0, sizeof(bits));
+        for (int i = 0; i < count; ++i)
+            for (int k = 0; k < 32; ++k)
+                bits[k] += (values[i] >> k) & 1;
+
+        for (int k = 0; k < 32; ++k)
+        {
+            lolunit_set_context(k);
+            lolunit_assert_gequal(bits[k], count / 3);
+            lolunit_assert_lequal(bits[k], count * 2 / 3);
+            lolunit_unset_context(k);
+        }
+
+        /* The first values come from the generator’s own sequence */
+        uint64_t x = b.next();
+        lolunit_assert_equal(values[0], (uint32_t)x);
+        lolunit_assert_equal(values[1], (uint32_t)(x >> 32));
+
+        /* Filling is reproducible and several small fills match one
+         * large fill as long as they are multiples of 8 */
+        uint32_t more[count];
+        b.seed(7);
+        b.fill(more, 1000);
+        b.fill(more + 1000, count - 1000);
+        for (int i = 0; i < count; ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_equal(values[i], more[i]);
+            lolunit_unset_context(i);
+        }
+    }
+
+    lolunit_declare_test(rng_fill_jump)
+    {
+        /* Filling 8 values uses one step of the main stream */
+        uint32_t tmp[8], values[64], expected[64];
+        rng a(5), b(5);
+        a.fill(tmp, 8);
+        b.next();
+
+        /* After a jump, the extra streams restart from the new state */
+        a.jump();
+        b.jump();
+        a.fill(values, 64);
+        b.fill(expected, 64);
+        for (int i = 0; i < 64; ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_equal(values[i], expected[i]);
+            lolunit_unset_context(i);
+        }
+    }
+
+    lolunit_declare_test(rng_fill_float)
+    {
+        int const count = 1001;
+
+        float values[count];
+        rng::get().fill(values, count);
+
+        float sum = 0.f;
+        for (int i = 0; i < count; ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_gequal(values[i], 0.f);
+            lolunit_assert_less(values[i], 1.f);
+            lolunit_unset_context(i);
+            sum += values[i];
+        }
+
+        lolunit_assert_doubles_equal(sum / count, 0.5f, 0.05f);
+    }
+
+#if LOL_FEATURE_THREADS
+    lolunit_declare_test(rng_threads)
+    {
+        /* Each thread gets its own default generator */
+        uint64_t x[2];
+        std::thread t([&]() { x[1] = rng::get().next(); });
+        t.join();
+        x[0] = rng::get().next();
+
+        lolunit_assert_different(x[0], x[1]);
+    }
+#endif
 };
 
 } /* namespace lol */
@@ -0,0 +1,238 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+struct RayTestSphere
+{
+    vec3 m_center;
+    float m_radius;
+};
+
+/* Distance along dir to the first intersection, or -1 */
+static float ray_vs_sphere(RayTestSphere const *sphere, vec3 const &origin,
+                           vec3 const &dir, float tmax)
+{
+    vec3 oc = origin - sphere->m_center;
+    float a = dot(dir, dir), b = dot(oc, dir);
+    float c = dot(oc, oc) - sphere->m_radius * sphere->m_radius;
+    float delta = b * b - a * c;
+    if (delta < 0.f)
+        return -1.f;
+
+    float t = (-b - lol::sqrt(delta)) / a;
+    if (t < 0.f)
+        t = (-b + lol::sqrt(delta)) / a;
+    return t < tmax ? t : -1.f;
+}
+
+lolunit_declare_fixture(raybatch_test)
+{
+    void setup()
+    {
+        /* A few hundred small random triangles, and a count of rays
+         * that is not a multiple of the packet size */
+        for (int n = 0; n < 300; ++n)
+        {
+            vec3 p(rand(-5.f, 5.f), rand(-5.f, 5.f), rand(-5.f, 5.f));
+            for (int k = 0; k < 3; ++k)
+            {
+                indices << (uint32_t)vertices.count();
+                vertices << p + vec3(rand(-1.f, 1.f), rand(-1.f, 1.f),
+                                     rand(-1.f, 1.f));
+            }
+        }
+
+        for (int n = 0; n < 203; ++n)
+        {
+            vec3 origin(rand(-8.f, 8.f), rand(-8.f, 8.f), -10.f);
+            vec3 target(rand(-5.f, 5.f), rand(-5.f, 5.f), 0.f);
+            rays.Push(origin, target - origin, n % 5 ? FLT_MAX : 1.f);
+        }
+    }
+
+    void teardown()
+    {
+        vertices.empty();
+        indices.empty();
+        rays.Empty();
+    }
+
+    /* Hits must lie on the triangle they report */
+    void check_hits(RayBatch const &batch)
+    {
+        for (int i = 0; i < batch.GetCount(); ++i)
+        {
+            if (!batch.IsHit(i))
+                continue;
+
+            lolunit_set_context(i);
+            int t = batch.GetHit(i);
+            vec3 v0 = vertices[indices[3 * t]];
+            vec3 e1 = vertices[indices[3 * t + 1]] - v0;
+            vec3 e2 = vertices[indices[3 * t + 2]] - v0;
+            vec2 uv = batch.GetBarycentric(i);
+            vec3 p = v0 + uv.x * e1 + uv.y * e2;
+            vec3 q = batch.GetHitPoint(i);
+            lolunit_assert_doubles_equal(p.x, q.x, 1e-3f);
+            lolunit_assert_doubles_equal(p.y, q.y, 1e-3f);
+            lolunit_assert_doubles_equal(p.z, q.z, 1e-3f);
+            lolunit_assert_greater(batch.GetDistance(i), 0.f);
+            lolunit_unset_context(i);
+        }
+    }
+
+    lolunit_declare_test(closest_hit)
+    {
+        RayMesh mesh;
+        mesh.Build(vertices, indices);
+        lolunit_assert_equal(300, mesh.GetTriangleCount());
+
+        /* The tree finds the same hits as testing all triangles */
+        RayBatch all = rays;
+        all.IntersectTriangles(vertices.data(), indices.data(),
+                               indices.count(), RayQuery::ClosestHit);
+        rays.Intersect(mesh, RayQuery::ClosestHit);
+
+        lolunit_assert_greater(rays.GetHitCount(), 20);
+        lolunit_assert_equal(all.GetHitCount(), rays.GetHitCount());
+        for (int i = 0; i < rays.GetCount(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_equal(all.GetHit(i), rays.GetHit(i));
+            lolunit_assert_doubles_equal(all.GetDistance(i),
+                                         rays.GetDistance(i), 1e-5f);
+            /* Short rays stop at tmax */
+            if (i % 5 == 0)
+                lolunit_assert_lequal(rays.GetDistance(i), 1.f);
+            lolunit_unset_context(i);
+        }
+        check_hits(rays);
+    }
+
+    lolunit_declare_test(any_hit)
+    {
+        RayMesh mesh;
+        mesh.Build(vertices, indices);
+
+        RayBatch closest = rays;
+        closest.Intersect(mesh, RayQuery::ClosestHit);
+        rays.Intersect(mesh, RayQuery::AnyHit);
+
+        /* Any hit finds something exactly when there is something */
+        for (int i = 0; i < rays.GetCount(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_equal(closest.IsHit(i), rays.IsHit(i));
+            if (rays.IsHit(i))
+                lolunit_assert_gequal(rays.GetDistance(i),
+                                      closest.GetDistance(i) - 1e-5f);
+            lolunit_unset_context(i);
+        }
+        check_hits(rays);
+    }
+
+    lolunit_declare_test(large_batch)
+    {
+        /* Enough rays to use several threads, on a stride-separated
+         * vertex layout */
+        struct PaddedVertex { vec3 m_coord; vec3 m_normal; };
+        array<PaddedVertex> padded;
+        padded.resize(vertices.count());
+        for (int i = 0; i < vertices.count(); ++i)
+            padded[i].m_coord = vertices[i];
+
+        RayMesh mesh;
+        mesh.Build(&padded[0].m_coord, indices.data(), indices.count(),
+                   sizeof(PaddedVertex));
+
+        RayBatch batch;
+        for (int n = 0; n < 5000; ++n)
+        {
+            vec3 origin(rand(-8.f, 8.f), rand(-8.f, 8.f), rand(-8.f, 8.f));
+            batch.Push(origin, vec3(rand(-1.f, 1.f), rand(-1.f, 1.f),
+                                    rand(-1.f, 1.f)));
+        }
+        RayBatch all = batch;
+        batch.Intersect(mesh, RayQuery::ClosestHit);
+        all.IntersectTriangles(vertices.data(), indices.data(),
+                               indices.count(), RayQuery::ClosestHit);
+
+        for (int i = 0; i < batch.GetCount(); ++i)
+        {
+            lolunit_set_context(i);
+            lolunit_assert_equal(all.GetHit(i), batch.GetHit(i));
+            lolunit_unset_context(i);
+        }
+        check_hits(batch);
+    }
+
+    lolunit_declare_test(dynamic_tree)
+    {
+        array<RayTestSphere> spheres;
+        spheres.resize(200);
+        DynamicAABBTree3<RayTestSphere> tree;
+        for (int i = 0; i < spheres.count(); ++i)
+        {
+            spheres[i].m_center = vec3(rand(-5.f, 5.f), rand(-5.f, 5.f),
+                                       rand(-5.f, 5.f));
+            spheres[i].m_radius = rand(.1f, .5f);
+            vec3 r(spheres[i].m_radius);
+            tree.Insert(&spheres[i], box3(spheres[i].m_center - r,
+                                          spheres[i].m_center + r));
+        }
+
+        rays.Intersect(array<RayBatchNode>(), RayQuery::ClosestHit,
+                       nullptr, nullptr);
+        lolunit_assert_equal(0, rays.GetHitCount());
+
+        tree.CastRays(rays, RayQuery::ClosestHit, ray_vs_sphere);
+        lolunit_assert_greater(rays.GetHitCount(), 5);
+
+        for (int i = 0; i < rays.GetCount(); ++i)
+        {
+            /* Compare with testing every sphere */
+            int best = -1;
+            float best_t = i % 5 ? FLT_MAX : 1.f;
+            for (int j = 0; j < spheres.count(); ++j)
+            {
+                float t = ray_vs_sphere(&spheres[j], rays.GetOrigin(i),
+                                        rays.GetDir(i), best_t);
+                if (t >= 0.f)
+                {
+                    best = j;
+                    best_t = t;
+                }
+            }
+
+            lolunit_set_context(i);
+            lolunit_assert_equal(best >= 0, rays.IsHit(i));
+            if (best >= 0)
+            {
+                lolunit_assert(tree.GetElement(rays.GetHit(i)) == &spheres[best]);
+                lolunit_assert_doubles_equal(best_t, rays.GetDistance(i), 1e-5f);
+            }
+            lolunit_unset_context(i);
+        }
+    }
+
+    array<vec3> vertices;
+    array<uint32_t> indices;
+    RayBatch rays;
+};
+
+} /* namespace lol */
@@ -16,6 +16,8 @@
 
 #include <lolunit.h>
 
+#include "../../math/real-private.h"
+
 namespace lol
 {
 
@@ -231,6 +233,59 @@ lolunit_declare_fixture(real_test)
         lolunit_assert_equal(m4, -1.5f * -1.5f);
     }
 
+    lolunit_declare_test(karatsuba_multiplication)
+    {
+        /* Sizes above the Karatsuba threshold, including odd halves that
+         * fall back to the column-wise product, must give the same bigits
+         * as a plain schoolbook multiplication */
+        int const sizes[] = { 32, 34, 48, 64, 100, 128, 256 };
+        for (int n : sizes)
+        {
+            array<uint32_t> a, b, expected, product;
+            a.resize(n);
+            b.resize(n);
+            expected.resize(2 * n);
+            product.resize(2 * n);
+
+            for (int pass = 0; pass < 4; ++pass)
+            {
+                /* All ones first, for the longest carry chains */
+                for (int i = 0; i < n; ++i)
+                {
+                    a[i] = pass ? rand<uint32_t>() : 0xffffffffu;
+                    b[i] = pass ? rand<uint32_t>() : 0xffffffffu;
+                }
+                /* Equal halves make the Karatsuba middle term vanish */
+                if (pass == 3)
+                    for (int i = 0; i < n / 2; ++i)
+                        a[n / 2 + i] = a[i];
+
+                for (int i = 0; i < 2 * n; ++i)
+                    expected[i] = 0;
+                for (int i = n; i--; )
+                {
+                    uint64_t carry = 0;
+                    for (int j = n; j--; )
+                    {
+                        carry += (uint64_t)a[i] * b[j] + expected[i + j + 1];
+                        expected[i + j + 1] = (uint32_t)carry;
+                        carry >>= 32;
+                    }
+                    expected[i] = (uint32_t)carry;
+                }
+
+                real_mantissa_mul(product.data(), a.data(), b.data(), n);
+
+                lolunit_set_context(n);
+                lolunit_set_context(pass);
+                for (int i = 0; i < 2 * n; ++i)
+                    lolunit_assert_equal(expected[i], product[i]);
+                lolunit_unset_context(pass);
+                lolunit_unset_context(n);
+            }
+        }
+    }
+
     lolunit_declare_test(exact_division)
     {
         float m1 = real::R_1() / real::R_1();
@@ -254,6 +309,58 @@ lolunit_declare_fixture(real_test)
         real b = ldexp(real::R_1() - a, real::BIGITS * real::BIGIT_BITS);
 
         lolunit_assert_lequal((double)fabs(b), 1.0);
+
+        /* Same with less friendly values */
+        for (int i = 1; i < 100; ++i)
+        {
+            real x = real::R_PI() * i, y = real::R_E() / (i + 7);
+            real c = x / y * y;
+            real d = ldexp(fabs(x - c), real::BIGITS * real::BIGIT_BITS);
+
+            lolunit_assert_lequal((double)d, 4.0 * (double)fabs(x));
+        }
+    }
+
+    lolunit_declare_test(exact_sqrt)
+    {
+        /* The square root of a perfect square must be exact */
+        for (int i = 1; i < 1000; ++i)
+        {
+            lolunit_assert(sqrt(real(i * i)) == real(i));
+            lolunit_assert(sqrt(ldexp(real(i * i), -40)) == ldexp(real(i), -20));
+        }
+
+        /* And other results are within one ulp */
+        for (int i = 2; i < 100; ++i)
+        {
+            real x = real::R_PI() * i;
+            real s = sqrt(x);
+
+            lolunit_assert((s - ulp(s)) * (s - ulp(s)) <= x);
+            lolunit_assert((s + ulp(s)) * (s + ulp(s)) >= x);
+        }
+    }
+
+    lolunit_declare_test(rounded_sqrt)
+    {
+        /* With u the last mantissa bit of 1, sqrt(1 + ju) is just below
+         * 1 + ju/2, so it must round to 1 + ju/2 when j is even, where
+         * truncation would give 1 + (j/2 - 1)u, and round down to
+         * 1 + (j - 1)u/2 when j is odd. Scaling x by 4^k must scale the
+         * result by 2^k. */
+        real u = ldexp(real::R_1(), -real::BIGITS * real::BIGIT_BITS);
+        for (int k = -3; k <= 3; ++k)
+            for (int j = 4; j < 24; ++j)
+            {
+                real x = ldexp(real::R_1() + u * j, 2 * k);
+                real expected = ldexp(real::R_1() + u * (j / 2), k);
+
+                lolunit_set_context(k);
+                lolunit_set_context(j);
+                lolunit_assert(sqrt(x) == expected);
+                lolunit_unset_context(j);
+                lolunit_unset_context(k);
+            }
     }
 
     lolunit_declare_test(real_ldexp)
@@ -0,0 +1,201 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <limits>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(soa_test)
+{
+    void setup()
+    {
+        /* Use a count that is not a multiple of the vector size, so
+         * that the tail code is exercised too. */
+        for (int n = 0; n < 37; ++n)
+        {
+            vec4 a(rand(-5.f, 5.f), rand(-5.f, 5.f),
+                   rand(-5.f, 5.f), rand(-5.f, 5.f));
+            vec4 b(rand(-5.f, 5.f), rand(-5.f, 5.f),
+                   rand(-5.f, 5.f), rand(-5.f, 5.f));
+            a3 << a.xyz; b3 << b.xyz;
+            a4 << a; b4 << b;
+        }
+
+        a3.set(5, vec3(0.f));
+    }
+
+    void teardown()
+    {
+        a3.empty(); b3.empty();
+        a4.empty(); b4.empty();
+    }
+
+    template<int N>
+    void check(soa_array<vec_t<float, N>> const &soa,
+               vec_t<float, N> const *expected)
+    {
+        for (int n = 0; n < soa.count(); ++n)
+        {
+            lolunit_set_context(n);
+            for (int k = 0; k < N; ++k)
+                lolunit_assert_doubles_equal(soa.get(n)[k], expected[n][k],
+                                             1e-4f);
+            lolunit_unset_context(n);
+        }
+    }
+
+    lolunit_declare_test(load_store)
+    {
+        struct vertex { vec3 coord; int pad; } verts[10];
+        for (int n = 0; n < 10; ++n)
+            verts[n].coord = a3.get(n);
+
+        soa_array<vec3> tmp;
+        tmp.load(&verts[0].coord, 10, sizeof(vertex));
+        lolunit_assert_equal(tmp.count(), 10);
+
+        for (int n = 0; n < 10; ++n)
+            verts[n].coord = vec3(0.f);
+
+        tmp.store(&verts[0].coord, sizeof(vertex));
+        for (int n = 0; n < 10; ++n)
+            for (int k = 0; k < 3; ++k)
+                lolunit_assert_equal(verts[n].coord[k], a3.get(n)[k]);
+    }
+
+    lolunit_declare_test(transform)
+    {
+        mat4 m = mat4::translate(vec3(1.f, 2.f, 3.f))
+               * mat4::rotate(radians(30.f), vec3(1.f, 2.f, 0.f))
+               * mat4::scale(vec3(2.f, 0.5f, 1.f));
+        mat3 m3(m);
+
+        array<vec3> e3, f3;
+        array<vec4> e4;
+        for (int n = 0; n < a3.count(); ++n)
+        {
+            e3 << (m * vec4(a3.get(n), 1.f)).xyz;
+            f3 << m3 * a3.get(n);
+            e4 << m * a4.get(n);
+        }
+
+        soa_array<vec3> out;
+        transform_points(m, a3, out);
+        check(out, e3.data());
+
+        transform_vectors(m3, a3, out);
+        check(out, f3.data());
+
+        /* Transforming in place is allowed */
+        transform_vectors(m, a4, a4);
+        check(a4, e4.data());
+    }
+
+    lolunit_declare_test(translate)
+    {
+        vec3 v(1.f, -2.f, 3.f);
+
+        array<vec3> e3;
+        for (int n = 0; n < a3.count(); ++n)
+            e3 << a3.get(n) + v;
+
+        soa_array<vec3> out;
+        translate_points(v, a3, out);
+        for (int n = 0; n < out.count(); ++n)
+            for (int k = 0; k < 3; ++k)
+                lolunit_assert_equal(out.get(n)[k], e3[n][k]);
+
+        /* Infinite coordinates stay infinite, in place too */
+        float const inf = std::numeric_limits<float>::infinity();
+        out.set(3, vec3(inf, -inf, 0.f));
+        translate_points(v, out, out);
+        lolunit_assert_equal(out.get(3).x, inf);
+        lolunit_assert_equal(out.get(3).y, -inf);
+        lolunit_assert_equal(out.get(3).z, 3.f);
+    }
+
+    lolunit_declare_test(normalize_vectors)
+    {
+        array<vec3> e3;
+        array<vec4> e4;
+        for (int n = 0; n < a3.count(); ++n)
+        {
+            e3 << normalize(a3.get(n));
+            e4 << normalize(a4.get(n));
+        }
+
+        soa_array<vec3> out3;
+        normalize_all(a3, out3);
+        check(out3, e3.data());
+
+        soa_array<vec4> out4;
+        normalize_all(a4, out4);
+        check(out4, e4.data());
+
+        /* The same vector gives the same result in the vector lanes and
+         * in the tail */
+        soa_array<vec3> same;
+        for (int n = 0; n < a3.count(); ++n)
+            same << a3.get(0);
+        normalize_all(same, out3);
+        for (int n = 1; n < out3.count(); ++n)
+        {
+            lolunit_set_context(n);
+            for (int k = 0; k < 3; ++k)
+                lolunit_assert_equal(out3.get(n)[k], out3.get(0)[k]);
+            lolunit_unset_context(n);
+        }
+    }
+
+    lolunit_declare_test(dot_and_lerp)
+    {
+        array<float> d3, d4;
+        d3.resize(a3.count());
+        d4.resize(a4.count());
+        dot_all(a3, b3, d3.data());
+        dot_all(a4, b4, d4.data());
+
+        array<vec3> e3;
+        array<vec4> e4;
+        for (int n = 0; n < a3.count(); ++n)
+        {
+            lolunit_set_context(n);
+            lolunit_assert_doubles_equal(d3[n], dot(a3.get(n), b3.get(n)),
+                                         1e-4f);
+            lolunit_assert_doubles_equal(d4[n], dot(a4.get(n), b4.get(n)),
+                                         1e-4f);
+            lolunit_unset_context(n);
+
+            e3 << mix(a3.get(n), b3.get(n), 0.3f);
+            e4 << mix(a4.get(n), b4.get(n), 0.3f);
+        }
+
+        soa_array<vec3> out3;
+        lerp_all(a3, b3, 0.3f, out3);
+        check(out3, e3.data());
+
+        soa_array<vec4> out4;
+        lerp_all(a4, b4, 0.3f, out4);
+        check(out4, e4.data());
+    }
+
+    soa_array<vec3> a3, b3;
+    soa_array<vec4> a4, b4;
+};
+
+} /* namespace lol */
+
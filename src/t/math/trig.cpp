@@ -202,6 +202,162 @@ lolunit_declare_fixture(trig_test)
                 lolunit_assert_doubles_equal(a, b, fabs(f) * 1e-11);
         }
     }
+
+    lolunit_declare_test(sin_cos_batch)
+    {
+        using std::fabs;
+
+        /* Use an odd count to check the last, incomplete vector */
+        size_t const count = 20001;
+        array<double> x, s, c, s2, c2;
+        for (size_t i = 0; i < count; ++i)
+            x << (double)((ptrdiff_t)i - 10000) * (1.0 / 1000.0);
+        s.resize(count);
+        c.resize(count);
+        s2.resize(count);
+        c2.resize(count);
+
+        lol_sin(x.data(), s.data(), count);
+        lol_cos(x.data(), c.data(), count);
+        lol_sincos(x.data(), s2.data(), c2.data(), count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            double f = x[i];
+#if defined __GNUC__ && !defined __SNC__
+            double a1 = __builtin_sin(f);
+            double a2 = __builtin_cos(f);
+#else
+            double a1 = std::sin(f);
+            double a2 = std::cos(f);
+#endif
+            lolunit_set_context(f);
+            lolunit_assert_doubles_equal(a1, s[i], fabs(f) * 1e-11);
+            lolunit_assert_doubles_equal(a2, c[i], fabs(f) * 1e-11);
+            lolunit_assert_equal(s[i], s2[i]);
+            lolunit_assert_equal(c[i], c2[i]);
+        }
+
+        /* Float versions must also work in place */
+        array<float> xf, sf, cf;
+        for (size_t i = 0; i < count; ++i)
+            xf << (float)x[i] * 123.f;
+        sf = xf;
+        cf.resize(count);
+
+        lol_cos(xf.data(), cf.data(), count);
+        lol_sin(sf.data(), sf.data(), count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            double f = xf[i];
+#if defined __GNUC__ && !defined __SNC__
+            float a1 = (float)__builtin_sin(f);
+            float a2 = (float)__builtin_cos(f);
+#else
+            float a1 = (float)std::sin(f);
+            float a2 = (float)std::cos(f);
+#endif
+            lolunit_set_context(f);
+            lolunit_assert_doubles_equal(a1, sf[i], 1e-6f);
+            lolunit_assert_doubles_equal(a2, cf[i], 1e-6f);
+        }
+    }
+
+    lolunit_declare_test(batch_range)
+    {
+        using std::fabs;
+
+        double const range = 6442450944.0;
+
+        /* The vector range reduction stops at 3·2^31; larger values,
+         * mixed with small ones in the same vectors, must give exactly
+         * the results of the scalar functions */
+        array<double> x;
+        for (int i = 0; i < 37; ++i)
+        {
+            double big = std::ldexp(1.0 + i / 37.0, 30 + i);
+            x << (i & 1 ? -big : big) << i * 0.1 << range * (1.0 + i * 1e-9);
+        }
+
+        size_t const count = x.count();
+        array<double> s, c, t, s2, c2;
+        s.resize(count);
+        c.resize(count);
+        t.resize(count);
+        s2.resize(count);
+        c2.resize(count);
+
+        lol_sin(x.data(), s.data(), count);
+        lol_cos(x.data(), c.data(), count);
+        lol_tan(x.data(), t.data(), count);
+        lol_sincos(x.data(), s2.data(), c2.data(), count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            double f = x[i], s3, c3;
+            lol_sincos(f, &s3, &c3);
+
+            lolunit_set_context(f);
+            if (fabs(f) < range)
+            {
+                lolunit_assert_doubles_equal(s3, s[i], 1e-11 + fabs(f) * 1e-11);
+                lolunit_assert_doubles_equal(c3, c[i], 1e-11 + fabs(f) * 1e-11);
+                continue;
+            }
+            lolunit_assert_equal(lol_sin(f), s[i]);
+            lolunit_assert_equal(lol_cos(f), c[i]);
+            lolunit_assert_equal(lol_tan(f), t[i]);
+            lolunit_assert_equal(s3, s2[i]);
+            lolunit_assert_equal(c3, c2[i]);
+        }
+
+        /* Same in place with floats */
+        array<float> xf, sf;
+        for (size_t i = 0; i < count; ++i)
+            xf << (float)x[i];
+        sf = xf;
+        lol_sin(sf.data(), sf.data(), count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            lolunit_set_context(xf[i]);
+            if (fabs(xf[i]) < range)
+                continue;
+            lolunit_assert_equal((float)lol_sin((double)xf[i]), sf[i]);
+        }
+    }
+
+    lolunit_declare_test(tan_batch)
+    {
+        using std::fabs;
+
+        size_t const count = 200003;
+        array<double> x, t;
+        for (size_t i = 0; i < count; ++i)
+            x << (double)((ptrdiff_t)i - 100000) * (1.0 / 10000.0);
+        t.resize(count);
+
+        lol_tan(x.data(), t.data(), count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            double f = x[i];
+#if defined __GNUC__ && !defined __SNC__
+            double a = __builtin_tan(f);
+#else
+            double a = std::tan(f);
+#endif
+            double b = t[i];
+            lolunit_set_context(f);
+            if (fabs(a) > 1e4)
+                lolunit_assert_doubles_equal(a, b, fabs(a) * fabs(a) * 1e-11);
+            else if (fabs(a) > 1.0)
+                lolunit_assert_doubles_equal(a, b, fabs(a) * 1e-11);
+            else
+                lolunit_assert_doubles_equal(a, b, fabs(f) * 1e-11);
+        }
+    }
 };
 
 } /* namespace lol */
@@ -219,6 +219,54 @@ lolunit_declare_fixture(thread_test)
         lolunit_assert_equal(false, b2);
         lolunit_assert_equal(42, tmp);
     }
+
+    lolunit_declare_test(parallel_for_slices)
+    {
+        /* Every item must be visited exactly once, whatever the number
+         * of slices */
+        for (int count : { 0, 1, 999, 1000, 123457 })
+        {
+            array<int> visits;
+            visits.resize(count);
+            for (int &v : visits)
+                v = 0;
+
+            parallel_for(count, 1000, [&](int begin, int end)
+            {
+                for (int i = begin; i < end; ++i)
+                    ++visits[i];
+            });
+
+            lolunit_set_context(count);
+            for (int v : visits)
+                lolunit_assert_equal(1, v);
+        }
+    }
+
+    lolunit_declare_test(parallel_for_nested)
+    {
+        /* Slices may call parallel_for() themselves, and the workers are
+         * reused across calls */
+        for (int n = 0; n < 100; ++n)
+        {
+            array<int> visits;
+            visits.resize(64 * 1000, 0);
+
+            parallel_for(64, 1, [&](int begin, int end)
+            {
+                for (int i = begin; i < end; ++i)
+                    parallel_for(1000, 100, [&](int begin2, int end2)
+                    {
+                        for (int j = begin2; j < end2; ++j)
+                            ++visits[i * 1000 + j];
+                    });
+            });
+
+            lolunit_set_context(n);
+            for (int v : visits)
+                lolunit_assert_equal(1, v);
+        }
+    }
 };
 
 } /* namespace lol */
@@ -44,6 +44,57 @@ lolunit_declare_fixture(timer_test)
         timer1.Wait(1.5);
         lolunit_assert_doubles_equal(3.0, timer0.Get(), 1e-3);
     }
+
+    lolunit_declare_test(monotonic_nanoseconds)
+    {
+        int64_t prev = Timer::Now();
+        for (int n = 0; n < 100000; ++n)
+        {
+            int64_t t = Timer::Now();
+            lolunit_assert_lequal(prev, t);
+            prev = t;
+        }
+
+        /* The clock resolution is far below the old float precision. The
+         * smallest of a few steps is checked, in case we get preempted. */
+        Timer timer;
+        int64_t step = INT64_MAX;
+        for (int n = 0; n < 10; ++n)
+        {
+            int64_t t0 = timer.PollNs(), t1;
+            while ((t1 = timer.PollNs()) == t0)
+                ;
+            step = lol::min(step, t1 - t0);
+        }
+        lolunit_assert_less(step, (int64_t)100000);
+    }
+
+    lolunit_declare_test(precise_wait)
+    {
+        /* The hybrid sleep and spin wait should never end early, and
+         * usually ends within half a millisecond, even over several
+         * frames. A loaded machine may still preempt us, so only the
+         * median lateness is checked against that bound. */
+        Timer timer;
+        array<int64_t> lates;
+        for (int n = 1; n <= 10; ++n)
+        {
+            timer.WaitNs(n * 5000000);
+            int64_t late = timer.PollNs() - n * 5000000;
+            lolunit_set_context(n);
+            lolunit_assert_lequal((int64_t)0, late);
+            lates << late;
+            lolunit_unset_context(n);
+        }
+
+        lates.sort(SortAlgorithm::QuickSwap);
+        lolunit_assert_less(lates[lates.count() / 2], (int64_t)500000);
+
+        /* GetNs() returns the whole wait and restarts the timer */
+        int64_t t = timer.GetNs();
+        lolunit_assert_lequal((int64_t)50000000, t);
+        lolunit_assert_less(timer.PollNs(), t);
+    }
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,662 @@
+//
+//  Lol Engine — Benchmark framework
+//
+//  Copyright © 2010—2016 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The benchmark framework
+// -----------------------
+//
+//  Benchmarks are declared the same way as lolunit tests:
+//
+//    lolbench_declare_fixture(trig_bench)
+//    {
+//        void setup() { /* fill the input tables */ }
+//
+//        lolbench_declare_bench(lol_sin, TABLE_SIZE)
+//        {
+//            for (size_t i = 0; i < TABLE_SIZE; ++i)
+//                out[i] = lol_sin(in[i]);
+//        }
+//    };
+//
+//  The second argument is the number of items processed by one call. The
+//  runner first finds how many calls last at least a few milliseconds,
+//  which also warms up the caches, then times several repetitions of that
+//  many calls and reports the median time per item and its median absolute
+//  deviation (MAD), in nanoseconds and in timestamp counter cycles. Times
+//  are measured with lol::Timer::Now(), so the program must be linked with
+//  the engine.
+//
+
+#include <lol/sys/timer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#if defined _MSC_VER && (defined _M_IX86 || defined _M_X64)
+#   include <intrin.h>
+#   define LOLBENCH_HAVE_RDTSC 1
+#elif defined __GNUC__ && (defined __i386__ || defined __x86_64__)
+#   include <x86intrin.h>
+#   define LOLBENCH_HAVE_RDTSC 1
+#else
+#   define LOLBENCH_HAVE_RDTSC 0
+#endif
+
+namespace lol
+{
+
+/*
+ * This is the base class for all benchmark fixtures. Just like lolunit
+ * fixtures, they register themselves in a linked list when the
+ * lolbench_declare_fixture macro instantiates them.
+ */
+class bench_fixture_base
+{
+    friend class bench_runner;
+
+public:
+    virtual void setup() {}
+    virtual void teardown() {}
+
+    /* A fixture may be run several times with different data, for
+     * instance different input ranges. setup() can read m_variant to
+     * know which one is being run. */
+    virtual int variant_count() const { return 1; }
+    virtual char const *variant_name(int variant) const
+    {
+        (void)variant;
+        return "";
+    }
+
+    /* When variants work on data of different sizes, the item counts of
+     * the benchmarks are multiplied by this value. */
+    virtual size_t variant_items(int variant) const
+    {
+        (void)variant;
+        return 1;
+    }
+
+protected:
+    struct bench_case
+    {
+        char const *m_name;
+        size_t m_items;
+        bench_case *m_next;
+    };
+
+    bench_fixture_base()
+      : m_next(nullptr), m_fixturename(""), m_variant(0), m_skip(false) {}
+    virtual ~bench_fixture_base() {}
+
+    static void add_fixture(bench_fixture_base *fixture)
+    {
+        fixture_list_helper(fixture);
+    }
+    static bench_fixture_base *fixture_list()
+    {
+        return fixture_list_helper(nullptr);
+    }
+
+    virtual bench_case *case_list() = 0;
+    virtual void run_case(bench_case *c, size_t calls) = 0;
+
+    /* Mark the current benchmark as unsupported on this machine */
+    void skip() { m_skip = true; }
+
+    bench_fixture_base *m_next;
+    char const *m_fixturename;
+    int m_variant;
+    bool m_skip;
+
+private:
+    static bench_fixture_base *fixture_list_helper(bench_fixture_base *set)
+    {
+        static bench_fixture_base *head = nullptr, *tail = nullptr;
+
+        if (set)
+        {
+            if (!head) head = set;
+            if (tail) tail->m_next = set;
+            tail = set;
+        }
+        return head;
+    }
+};
+
+/*
+ * This template specialises bench_fixture_base and keeps track of the
+ * benchmarks registered through the lolbench_declare_bench macro.
+ */
+template<class T> class bench_fixture : protected bench_fixture_base
+{
+public:
+    typedef T FixtureClass;
+
+    struct typed_case : public bench_case
+    {
+        void (FixtureClass::* m_fun)();
+    };
+
+    bench_fixture()
+    {
+        add_fixture(this);
+    }
+
+    void set_fixture_name(char const *name)
+    {
+        m_fixturename = name;
+    }
+
+    static void add_case(typed_case *that, char const *name, size_t items,
+                         void (FixtureClass::*fun)())
+    {
+        that->m_fun = fun;
+        that->m_name = name;
+        that->m_items = items ? items : 1;
+        that->m_next = nullptr;
+        case_list_helper(that);
+    }
+
+protected:
+    virtual bench_case *case_list()
+    {
+        return case_list_helper(nullptr);
+    }
+
+    virtual void run_case(bench_case *c, size_t calls)
+    {
+        void (FixtureClass::* fun)() = static_cast<typed_case *>(c)->m_fun;
+        FixtureClass *that = static_cast<FixtureClass *>(this);
+        for (size_t n = 0; n < calls; ++n)
+            (that->*fun)();
+    }
+
+private:
+    static bench_case *case_list_helper(bench_case *set)
+    {
+        static bench_case *head = nullptr, *tail = nullptr;
+        if (set)
+        {
+            if (!head) head = set;
+            if (tail) tail->m_next = set;
+            tail = set;
+        }
+        return head;
+    }
+};
+
+/*
+ * The results of one benchmark. Times are per item; cycle counts are
+ * negative when no timestamp counter is available.
+ */
+struct bench_result
+{
+    std::string name;
+    size_t items, calls;
+    int repetitions;
+    double median_ns, mad_ns;
+    double median_cycles, mad_cycles;
+};
+
+/*
+ * This class runs all registered benchmarks, prints a table of results,
+ * optionally saves them as JSON or CSV, and compares them to a baseline
+ * saved by a previous run.
+ */
+class bench_runner
+{
+public:
+    bench_runner()
+      : m_repetitions(11),
+        m_min_time(0.01),
+        m_threshold(0.1)
+    {}
+
+    /* Only run benchmarks whose full name contains one of the filters */
+    void add_filter(char const *filter) { m_filters.push_back(filter); }
+
+    void set_repetitions(int count) { m_repetitions = std::max(count, 1); }
+
+    /* Minimum duration of one repetition, in seconds */
+    void set_min_time(double seconds) { m_min_time = seconds; }
+
+    void set_json_output(char const *path) { m_json = path; }
+    void set_csv_output(char const *path) { m_csv = path; }
+
+    /* A JSON or CSV file saved by a previous run; a benchmark is a
+     * regression if it is slower by more than “ratio” and the difference
+     * is larger than the measurement noise. */
+    void set_baseline(char const *path) { m_baseline = path; }
+    void set_threshold(double ratio) { m_threshold = ratio; }
+
+    std::vector<bench_result> const &results() const { return m_results; }
+
+    /* Print the names of all benchmarks matching the filters */
+    void List()
+    {
+        for_each_case([](bench_fixture_base *f,
+                         bench_fixture_base::bench_case *c,
+                         std::string const &name)
+        {
+            (void)f; (void)c;
+            printf("%s\n", name.c_str());
+        });
+    }
+
+    /* Run the benchmarks; return false if any regression was found */
+    bool Run()
+    {
+        std::map<std::string, std::pair<double, double>> baseline;
+        if (m_baseline.length() && !load_baseline(m_baseline, baseline))
+        {
+            fprintf(stderr, "lolbench: cannot read baseline %s\n",
+                    m_baseline.c_str());
+            return false;
+        }
+
+        print_machine_info();
+
+        printf("%-44s %9s %8s %9s%s\n", "", "ns/item", "MAD",
+               LOLBENCH_HAVE_RDTSC ? "cycles" : "",
+               baseline.size() ? "  baseline" : "");
+
+        int regressions = 0;
+        m_results.clear();
+
+        for_each_variant([&](bench_fixture_base *f,
+                             bench_fixture_base::bench_case *c,
+                             std::string const &name)
+        {
+            bench_result r;
+            if (!measure(f, c, name, r))
+            {
+                printf("%-44s %9s\n", name.c_str(), "skipped");
+                return;
+            }
+            m_results.push_back(r);
+
+            char cycles[32] = "        -";
+            if (r.median_cycles >= 0.0)
+                snprintf(cycles, sizeof(cycles), "%9.2f", r.median_cycles);
+            printf("%-44s %9.3f %8.3f %s", name.c_str(),
+                   r.median_ns, r.mad_ns, cycles);
+
+            auto b = baseline.find(name);
+            if (b != baseline.end() && b->second.first > 0.0)
+            {
+                double base = b->second.first, noise = b->second.second;
+                double delta = r.median_ns / base - 1.0;
+                bool significant = std::fabs(r.median_ns - base)
+                                       > 3.0 * (r.mad_ns + noise);
+                printf("  %+7.1f%%", 100.0 * delta);
+                if (significant && delta > m_threshold)
+                {
+                    printf("  REGRESSION");
+                    ++regressions;
+                }
+                else if (significant && delta < -m_threshold)
+                    printf("  faster");
+            }
+            printf("\n");
+            fflush(stdout);
+        });
+
+        if (m_json.length())
+            save_json(m_json);
+        if (m_csv.length())
+            save_csv(m_csv);
+
+        printf("\n%d benchmarks", (int)m_results.size());
+        if (baseline.size())
+            printf(", %d regressions", regressions);
+        printf("\n");
+
+        return regressions == 0;
+    }
+
+private:
+    static inline int64_t now_ns()
+    {
+        return Timer::Now();
+    }
+
+    static inline uint64_t now_cycles()
+    {
+#if LOLBENCH_HAVE_RDTSC
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    /* Call f for all benchmarks matching the filters, in all variants */
+    template<typename F> void for_each_case(F const &f)
+    {
+        for (bench_fixture_base *fixture = bench_fixture_base::fixture_list();
+             fixture; fixture = fixture->m_next)
+        {
+            for (int v = 0; v < fixture->variant_count(); ++v)
+                for (auto c = fixture->case_list(); c; c = c->m_next)
+                {
+                    std::string name = full_name(fixture, v, c);
+                    if (matches(name))
+                        f(fixture, c, name);
+                }
+        }
+    }
+
+    /* Same as for_each_case(), but also set up and tear down fixtures */
+    template<typename F> void for_each_variant(F const &f)
+    {
+        for (bench_fixture_base *fixture = bench_fixture_base::fixture_list();
+             fixture; fixture = fixture->m_next)
+        {
+            for (int v = 0; v < fixture->variant_count(); ++v)
+            {
+                bool ready = false;
+                for (auto c = fixture->case_list(); c; c = c->m_next)
+                {
+                    std::string name = full_name(fixture, v, c);
+                    if (!matches(name))
+                        continue;
+
+                    if (!ready)
+                    {
+                        fixture->m_variant = v;
+                        fixture->setup();
+                        ready = true;
+                    }
+                    f(fixture, c, name);
+                }
+
+                if (ready)
+                    fixture->teardown();
+            }
+        }
+    }
+
+    static std::string full_name(bench_fixture_base *f, int variant,
+                                 bench_fixture_base::bench_case *c)
+    {
+        std::string ret = f->m_fixturename;
+        char const *v = f->variant_name(variant);
+        if (v && *v)
+            ret = ret + "/" + v;
+        return ret + "/" + c->m_name;
+    }
+
+    bool matches(std::string const &name) const
+    {
+        if (m_filters.empty())
+            return true;
+        for (auto const &filter : m_filters)
+            if (name.find(filter) != std::string::npos)
+                return true;
+        return false;
+    }
+
+    static double median(std::vector<double> v)
+    {
+        std::sort(v.begin(), v.end());
+        size_t n = v.size();
+        return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+    }
+
+    static double mad(std::vector<double> v, double med)
+    {
+        for (auto &x : v)
+            x = std::fabs(x - med);
+        return median(v);
+    }
+
+    bool measure(bench_fixture_base *f, bench_fixture_base::bench_case *c,
+                 std::string const &name, bench_result &ret)
+    {
+        /* Find how many calls last at least m_min_time */
+        size_t calls = 1;
+        for (f->m_skip = false; ; )
+        {
+            int64_t t0 = now_ns();
+            f->run_case(c, calls);
+            double t = (double)(now_ns() - t0) * 1e-9;
+
+            if (f->m_skip)
+                return false;
+
+            if (t >= m_min_time || calls >= ((size_t)1 << 30))
+                break;
+
+            double k = t > 0.0 ? 1.2 * m_min_time / t : 100.0;
+            calls = (size_t)((double)calls * std::min(std::max(k, 2.0), 100.0));
+        }
+
+        std::vector<double> ns, cycles;
+        size_t const call_items = c->m_items * f->variant_items(f->m_variant);
+        double const items = (double)call_items * (double)calls;
+
+        for (int n = 0; n < m_repetitions; ++n)
+        {
+            int64_t t0 = now_ns();
+            uint64_t c0 = now_cycles();
+            f->run_case(c, calls);
+            uint64_t c1 = now_cycles();
+            int64_t t1 = now_ns();
+
+            ns.push_back((double)(t1 - t0) / items);
+            cycles.push_back((double)(c1 - c0) / items);
+        }
+
+        ret.name = name;
+        ret.items = call_items;
+        ret.calls = calls;
+        ret.repetitions = m_repetitions;
+        ret.median_ns = median(ns);
+        ret.mad_ns = mad(ns, ret.median_ns);
+#if LOLBENCH_HAVE_RDTSC
+        ret.median_cycles = median(cycles);
+        ret.mad_cycles = mad(cycles, ret.median_cycles);
+#else
+        ret.median_cycles = ret.mad_cycles = -1.0;
+#endif
+        return true;
+    }
+
+    /* Estimate the timestamp counter frequency by spinning for a while,
+     * and print the current CPU frequency if the system reports it. */
+    void print_machine_info()
+    {
+        m_tsc_ghz = 0.0;
+#if LOLBENCH_HAVE_RDTSC
+        int64_t t0 = now_ns(), t1;
+        uint64_t c0 = now_cycles();
+        do
+            t1 = now_ns();
+        while (t1 - t0 < 20000000);
+        m_tsc_ghz = (double)(now_cycles() - c0) / (double)(t1 - t0);
+        printf("timestamp counter: %.3f GHz\n", m_tsc_ghz);
+#endif
+        printf("clock: %s\n", Timer::HasTsc() ? "invariant TSC"
+                                               : "operating system");
+
+        std::ifstream f("/sys/devices/system/cpu/cpu0/cpufreq/"
+                        "scaling_cur_freq");
+        double khz = 0.0;
+        if (f >> khz)
+            printf("cpu0 frequency: %.3f GHz\n", khz * 1e-6);
+
+        printf("repetitions: %d, minimum time: %.0f ms\n\n",
+               m_repetitions, m_min_time * 1e3);
+    }
+
+    void save_json(std::string const &path)
+    {
+        std::ofstream f(path);
+        f << "{\n";
+        f << "  \"tsc_ghz\": " << m_tsc_ghz << ",\n";
+        f << "  \"benchmarks\": [\n";
+        for (size_t i = 0; i < m_results.size(); ++i)
+        {
+            bench_result const &r = m_results[i];
+            f << "    { \"name\": \"" << r.name << "\""
+              << ", \"items\": " << r.items
+              << ", \"calls\": " << r.calls
+              << ", \"repetitions\": " << r.repetitions
+              << ", \"median_ns\": " << r.median_ns
+              << ", \"mad_ns\": " << r.mad_ns
+              << ", \"median_cycles\": " << r.median_cycles
+              << ", \"mad_cycles\": " << r.mad_cycles << " }"
+              << (i + 1 < m_results.size() ? ",\n" : "\n");
+        }
+        f << "  ]\n";
+        f << "}\n";
+    }
+
+    void save_csv(std::string const &path)
+    {
+        std::ofstream f(path);
+        f << "name,items,calls,repetitions,median_ns,mad_ns,"
+             "median_cycles,mad_cycles\n";
+        for (auto const &r : m_results)
+            f << r.name << ',' << r.items << ',' << r.calls << ','
+              << r.repetitions << ',' << r.median_ns << ',' << r.mad_ns
+              << ',' << r.median_cycles << ',' << r.mad_cycles << '\n';
+    }
+
+    /* Read the median and MAD of each benchmark from a file written by
+     * save_json() or save_csv(). */
+    static bool load_baseline(std::string const &path,
+                 std::map<std::string, std::pair<double, double>> &out)
+    {
+        std::ifstream f(path);
+        if (!f)
+            return false;
+
+        std::string line;
+        while (std::getline(f, line))
+        {
+            std::string name;
+            double med = 0.0, dev = 0.0;
+
+            if (line.find("\"name\"") != std::string::npos)
+            {
+                /* One JSON object per line */
+                size_t p = line.find('"', line.find(':') + 1);
+                size_t q = line.find('"', p + 1);
+                if (p == std::string::npos || q == std::string::npos)
+                    continue;
+                name = line.substr(p + 1, q - p - 1);
+                med = json_number(line, "\"median_ns\"");
+                dev = json_number(line, "\"mad_ns\"");
+            }
+            else if (line.find(',') != std::string::npos
+                      && line.compare(0, 5, "name,") != 0)
+            {
+                std::vector<std::string> fields;
+                std::stringstream ss(line);
+                for (std::string s; std::getline(ss, s, ','); )
+                    fields.push_back(s);
+                if (fields.size() < 6)
+                    continue;
+                name = fields[0];
+                med = atof(fields[4].c_str());
+                dev = atof(fields[5].c_str());
+            }
+            else
+                continue;
+
+            out[name] = std::make_pair(med, dev);
+        }
+
+        return true;
+    }
+
+    static double json_number(std::string const &line, char const *key)
+    {
+        size_t p = line.find(key);
+        if (p == std::string::npos)
+            return 0.0;
+        p = line.find(':', p);
+        return atof(line.c_str() + p + 1);
+    }
+
+    std::vector<std::string> m_filters;
+    int m_repetitions;
+    double m_min_time, m_threshold, m_tsc_ghz;
+    std::string m_json, m_csv, m_baseline;
+    std::vector<bench_result> m_results;
+};
+
+/*
+ * Public helper macros
+ */
+
+#define lolbench_declare_fixture(N) \
+    class N; \
+    /* Same pattern as lolunit: create a fixture instance statically, \
+     * before its implementation was defined. */ \
+    template<typename T> struct lol_bench_helper_fixture_##N \
+    { \
+        lol_bench_helper_fixture_##N() \
+        { \
+            p = new T(); \
+            p->set_fixture_name(#N); \
+        } \
+        ~lol_bench_helper_fixture_##N() { delete p; } \
+        T *p; \
+    }; \
+    lol_bench_helper_fixture_##N<N> lol_bench_helper_fixture_##N##_instance; \
+    class N : public lol::bench_fixture<N>
+
+#define lolbench_declare_bench(N, items) \
+    /* Each benchmark registers itself in a list global to the fixture */ \
+    class lol_bench_helper_case_##N : public typed_case \
+    { \
+    public: \
+        lol_bench_helper_case_##N() \
+        { \
+            add_case(this, #N, (items), \
+                     (void (FixtureClass::*)()) &FixtureClass::N); \
+        } \
+    }; \
+    lol_bench_helper_case_##N lol_bench_helper_case_instance_##N; \
+    void N()
+
+/* Skip the current benchmark, for instance because the machine does not
+ * support the instruction set it measures */
+#define lolbench_skip() \
+    do { \
+        skip(); \
+        return; \
+    } while (0)
+
+/* Prevent the compiler from optimising away a computed value */
+template<typename T> static inline void bench_keep(T const &value)
+{
+#if defined __GNUC__
+    __asm__ __volatile__("" : : "g"(&value) : "memory");
+#else
+    static void const * volatile sink;
+    sink = &value;
+#endif
+}
+
+} /* namespace lol */
+
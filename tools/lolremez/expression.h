@@ -20,6 +20,11 @@
 //   e.parse(" 2*x^3 + 3 * sin(x - atan(x))");
 //   auto y = e.eval("1.5");
 //
+// Parsing produces a list of operations in reverse Polish notation, which
+// is then compiled into a small register bytecode: subexpressions that do
+// not depend on x are computed once, identical subexpressions are shared,
+// and intermediate values live in a fixed number of registers.
+//
 
 #include "pegtl.hh"
 
@@ -53,74 +58,263 @@ struct expression
      */
     lol::real eval(lol::real const &x) const
     {
-        /* Use a stack */
-        lol::array<lol::real> stack;
+        return run(x, m_constants);
+    }
+
+    /*
+     * Evaluate expression at x with double precision, for instance to
+     * get a quick estimate before refining it with eval(real)
+     */
+    double eval(double x) const
+    {
+        return run(x, m_dconstants);
+    }
+
+private:
+    /* Operands are registers if positive, or constants if negative:
+     * ~k is constant number k. Register 0 holds x. */
+    struct instruction
+    {
+        id op;
+        int dst, a, b;
+    };
+
+    static int const LOCAL_REGISTERS = 16;
+
+    template<typename T>
+    T run(T const &x, lol::array<T> const &constants) const
+    {
+        /* Use registers on the stack unless there are too many */
+        T local[LOCAL_REGISTERS];
+        lol::array<T> heap;
+        T *regs = local;
+        if (m_registers > LOCAL_REGISTERS)
+        {
+            heap.resize(m_registers);
+            regs = heap.data();
+        }
+
+        regs[0] = x;
+
+        for (auto const &in : m_code)
+        {
+            T const &a = in.a >= 0 ? regs[in.a] : constants[~in.a];
+            T const &b = in.b >= 0 ? regs[in.b] : constants[~in.b];
+            regs[in.dst] = apply(in.op, a, b);
+        }
+
+        return m_result >= 0 ? regs[m_result] : constants[~m_result];
+    }
+
+    /* Apply an operation; unary operations ignore “b”. This is used both
+     * at runtime and for constant folding. */
+    template<typename T>
+    static T apply(id op, T const &a, T const &b)
+    {
+        using std::fabs; using std::sqrt; using std::cbrt;
+        using std::exp; using std::exp2; using std::log;
+        using std::log2; using std::log10;
+        using std::sin; using std::cos; using std::tan;
+        using std::asin; using std::acos; using std::atan;
+        using std::sinh; using std::cosh; using std::tanh;
+        using std::atan2; using std::pow; using std::min; using std::max;
+
+        switch (op)
+        {
+        case id::plus:  return a;
+        case id::minus: return -a;
+
+        case id::abs:   return fabs(a);
+        case id::sqrt:  return sqrt(a);
+        case id::cbrt:  return cbrt(a);
+        case id::exp:   return exp(a);
+        case id::exp2:  return exp2(a);
+        case id::log:   return log(a);
+        case id::log2:  return log2(a);
+        case id::log10: return log10(a);
+        case id::sin:   return sin(a);
+        case id::cos:   return cos(a);
+        case id::tan:   return tan(a);
+        case id::asin:  return asin(a);
+        case id::acos:  return acos(a);
+        case id::atan:  return atan(a);
+        case id::sinh:  return sinh(a);
+        case id::cosh:  return cosh(a);
+        case id::tanh:  return tanh(a);
+
+        case id::add:   return a + b;
+        case id::sub:   return a - b;
+        case id::mul:   return a * b;
+        case id::div:   return a / b;
+
+        case id::atan2: return atan2(a, b);
+        case id::pow:   return pow(a, b);
+        case id::min:   return min(a, b);
+        case id::max:   return max(a, b);
+
+        case id::x:
+        case id::constant:
+            /* Never emitted */
+            break;
+        }
+
+        return a;
+    }
+
+    static bool is_binary(id op)
+    {
+        return op == id::add || op == id::sub || op == id::mul
+            || op == id::div || op == id::atan2 || op == id::pow
+            || op == id::min || op == id::max;
+    }
+
+    /*
+     * Compile the operation list into bytecode
+     */
+    void compile()
+    {
+        /* Build a graph of nodes from the operations. Nodes with the same
+         * operation and arguments are only created once, and nodes that
+         * only depend on constants are computed right away. */
+        struct node
+        {
+            id op;
+            int a, b;
+            bool is_constant;
+            lol::real value;
+        };
+
+        lol::array<node> nodes;
+        lol::array<int> stack;
 
-        for (int i = 0; i < m_ops.count(); ++i)
+        for (auto const &op : m_ops)
         {
-            /* Rules that do not consume stack elements */
-            if (m_ops[i].m1 == id::x)
+            node n { op.m1, -1, -1, op.m1 == id::constant, lol::real(0) };
+
+            if (op.m1 == id::constant)
+                n.value = m_constants[op.m2];
+            else if (op.m1 != id::x)
             {
-                stack.push(x);
-                continue;
+                n.b = is_binary(op.m1) ? stack.pop() : -1;
+                n.a = stack.pop();
             }
-            else if (m_ops[i].m1 == id::constant)
+
+            /* Unary plus does nothing */
+            if (op.m1 == id::plus)
             {
-                stack.push(m_constants[m_ops[i].m2]);
+                stack.push(n.a);
                 continue;
             }
 
-            /* All other rules consume at least the head of the stack */
-            lol::real head = stack.pop();
+            /* Look for an identical node. Parsed constants are never
+             * negative, so equal values also have the same sign. */
+            int i = 0;
+            for ( ; i < nodes.count(); ++i)
+            {
+                node const &m = nodes[i];
+                if (m.op == n.op && m.a == n.a && m.b == n.b
+                     && (n.op != id::constant || m.value == n.value))
+                    break;
+            }
 
-            switch (m_ops[i].m1)
+            if (i == nodes.count())
             {
-            case id::plus:  stack.push(head);  break;
-            case id::minus: stack.push(-head); break;
-
-            case id::abs:   stack.push(fabs(head));  break;
-            case id::sqrt:  stack.push(sqrt(head));  break;
-            case id::cbrt:  stack.push(cbrt(head));  break;
-            case id::exp:   stack.push(exp(head));   break;
-            case id::exp2:  stack.push(exp2(head));  break;
-            case id::log:   stack.push(log(head));   break;
-            case id::log2:  stack.push(log2(head));  break;
-            case id::log10: stack.push(log10(head)); break;
-            case id::sin:   stack.push(sin(head));   break;
-            case id::cos:   stack.push(cos(head));   break;
-            case id::tan:   stack.push(tan(head));   break;
-            case id::asin:  stack.push(asin(head));  break;
-            case id::acos:  stack.push(acos(head));  break;
-            case id::atan:  stack.push(atan(head));  break;
-            case id::sinh:  stack.push(sinh(head));  break;
-            case id::cosh:  stack.push(cosh(head));  break;
-            case id::tanh:  stack.push(tanh(head));  break;
-
-            case id::add:   stack.push(stack.pop() + head); break;
-            case id::sub:   stack.push(stack.pop() - head); break;
-            case id::mul:   stack.push(stack.pop() * head); break;
-            case id::div:   stack.push(stack.pop() / head); break;
-
-            case id::atan2: stack.push(atan2(stack.pop(), head)); break;
-            case id::pow:   stack.push(pow(stack.pop(), head));   break;
-            case id::min:   stack.push(min(stack.pop(), head));   break;
-            case id::max:   stack.push(max(stack.pop(), head));   break;
-
-            case id::x:
-            case id::constant:
-                /* Already handled above */
-                break;
+                /* Constant folding */
+                if (n.a >= 0 && nodes[n.a].is_constant
+                     && (n.b < 0 || nodes[n.b].is_constant))
+                {
+                    lol::real const &a = nodes[n.a].value;
+                    n.value = apply(n.op, a, n.b < 0 ? a : nodes[n.b].value);
+                    n.is_constant = true;
+                }
+
+                nodes.push(n);
             }
+
+            stack.push(i);
         }
 
         ASSERT(stack.count() == 1);
-        return stack.pop();
+        int const root = stack.pop();
+
+        /* Find the last use of every node, so that registers can be
+         * reused once their value is no longer needed. */
+        lol::array<int> last_use;
+        last_use.resize(nodes.count());
+        for (int i = 0; i < nodes.count(); ++i)
+        {
+            last_use[i] = -1;
+            if (!nodes[i].is_constant && nodes[i].op != id::x)
+            {
+                last_use[nodes[i].a] = i;
+                if (nodes[i].b >= 0)
+                    last_use[nodes[i].b] = i;
+            }
+        }
+        last_use[root] = nodes.count();
+
+        /* Emit code for all nodes that are used, allocating registers
+         * as we go. Register 0 is x and is never freed. */
+        m_code.empty();
+        m_constants.empty();
+        m_dconstants.empty();
+        m_registers = 1;
+
+        lol::array<int> operand, free_registers;
+        operand.resize(nodes.count());
+
+        for (int i = 0; i < nodes.count(); ++i)
+        {
+            node const &n = nodes[i];
+
+            if (last_use[i] < 0)
+                continue;
+
+            if (n.op == id::x)
+            {
+                operand[i] = 0;
+                continue;
+            }
+
+            if (n.is_constant)
+            {
+                operand[i] = ~m_constants.count();
+                m_constants.push(n.value);
+                m_dconstants.push((double)n.value);
+                continue;
+            }
+
+            instruction in { n.op, -1, operand[n.a],
+                             n.b >= 0 ? operand[n.b] : operand[n.a] };
+
+            /* Free the arguments’ registers if this is their last use;
+             * the result may then go into one of them. */
+            for (int arg : { n.a, n.b })
+                if (arg >= 0 && last_use[arg] == i && operand[arg] > 0
+                     && (arg == n.a || n.b != n.a))
+                    free_registers.push(operand[arg]);
+
+            in.dst = free_registers.count() ? free_registers.pop()
+                                            : m_registers++;
+            operand[i] = in.dst;
+            m_code.push(in);
+        }
+
+        m_result = operand[root];
     }
 
 private:
+    /* The parsed operations, and the constants they refer to. Once the
+     * expression is compiled, m_constants holds the compiled constants
+     * instead, after folding and removal of duplicates. */
     lol::array<id, int> m_ops;
     lol::array<lol::real> m_constants;
 
+    /* Compiled code */
+    lol::array<instruction> m_code;
+    lol::array<double> m_dconstants;
+    int m_registers = 1, m_result = 0;
+
 private:
     struct r_expr;
 
@@ -252,6 +446,7 @@ public:
         m_constants.empty();
 
         pegtl::parse_string<r_stmt, action>(str, "expression", this);
+        compile();
     }
 };
 
@@ -337,7 +532,7 @@ struct expression::action<expression::r_constant>
 {
     static void apply(action_input const &in, expression *that)
     {
-        /* FIXME: check if the constant is already in the list */
+        /* Duplicate constants are merged by compile() */
         that->m_ops.push(id::constant, that->m_constants.count());
         that->m_constants.push(lol::real(in.string().c_str()));
     }
@@ -39,7 +39,7 @@ static void version(void)
 
 static void usage()
 {
-    printf("Usage: lolremez [-d degree] [-r xmin:xmax] x-expression [x-error]\n");
+    printf("Usage: lolremez [-d degree] [-r xmin:xmax] [-p digits] x-expression [x-error]\n");
     printf("       lolremez -h | --help\n");
     printf("       lolremez -V | --version\n");
     printf("Find a polynomial approximation for x-expression.\n");
@@ -47,6 +47,7 @@ static void usage()
     printf("Mandatory arguments to long options are mandatory for short options too.\n");
     printf("  -d, --degree <degree>      degree of final polynomial\n");
     printf("  -r, --range <xmin>:<xmax>  range over which to approximate\n");
+    printf("  -p, --precision <digits>   number of decimal digits (default 20)\n");
     printf("  -h, --help                 display this help and exit\n");
     printf("  -V, --version              output version information and exit\n");
     printf("\n");
@@ -70,13 +71,14 @@ int main(int argc, char **argv)
 {
     String xmin("-1"), xmax("1");
     char const *f = nullptr, *g = nullptr;
-    int degree = 4;
+    int degree = 4, digits = 20;
 
     lol::getopt opt(argc, argv);
     opt.add_opt('h', "help",    false);
     opt.add_opt('v', "version", false);
     opt.add_opt('d', "degree",  true);
     opt.add_opt('r', "range",   true);
+    opt.add_opt('p', "precision", true);
 
     for (;;)
     {
@@ -96,6 +98,11 @@ int main(int argc, char **argv)
             xmin = arg[0];
             xmax = arg[1];
           } break;
+        case 'p': /* --precision */
+            digits = atoi(opt.arg);
+            if (digits <= 0)
+                FAIL("invalid precision");
+            break;
         case 'h': /* --help */
             usage();
             return EXIT_SUCCESS;
@@ -121,7 +128,7 @@ int main(int argc, char **argv)
     if (real(xmin.C()) >= real(xmax.C()))
         FAIL("invalid range");
 
-    remez_solver solver(degree, 20);
+    remez_solver solver(degree, digits);
     solver.run(xmin.C(), xmax.C(), f, g);
 
     return 0;
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <functional>
+
 using namespace lol;
 
 /*
@@ -40,6 +42,19 @@ struct linear_system : public array2d<T>
 
     /* Naive matrix inversion */
     linear_system<T> inverse() const
+    {
+        return inverse([](int count, std::function<void(int, int)> const &f)
+        {
+            f(0, count);
+        });
+    }
+
+    /* Naive matrix inversion, with the elimination of the other rows
+     * split into slices: for_each(count, f) must call f(begin, end) on
+     * slices covering [0, count[, in any order, and return when they
+     * are all done. */
+    template<typename F>
+    linear_system<T> inverse(F const &for_each) const
     {
         int const n = this->size().x;
         linear_system a(*this), b(n);
@@ -69,26 +84,30 @@ struct linear_system : public array2d<T>
             }
 
             /* Now we know the diagonal term is non-zero. Get its inverse
-             * and use that to nullify all other terms in the column */
+             * and ensure the diagonal term is 1 */
             T x = (T)1 / a[i][i];
-            for (int j = 0; j < n; j++)
-            {
-                if (j == i)
-                    continue;
-                T mul = x * a[i][j];
-                for (int k = 0; k < n; k++)
-                {
-                    a[k][j] -= mul * a[k][i];
-                    b[k][j] -= mul * b[k][i];
-                }
-            }
-
-            /* Finally, ensure the diagonal term is 1 */
             for (int k = 0; k < n; k++)
             {
                 a[k][i] *= x;
                 b[k][i] *= x;
             }
+
+            /* Use row i to nullify all other terms in the column; each
+             * slice of the rows may be handled by a different thread */
+            for_each(n, [&](int j0, int j1)
+            {
+                for (int j = j0; j < j1; j++)
+                {
+                    if (j == i)
+                        continue;
+                    T mul = a[i][j];
+                    for (int k = 0; k < n; k++)
+                    {
+                        a[k][j] -= mul * a[k][i];
+                        b[k][j] -= mul * b[k][i];
+                    }
+                }
+            });
         }
 
         return b;
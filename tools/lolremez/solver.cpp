@@ -26,36 +26,21 @@
 
 using lol::real;
 
+/* Smallest number of matrix rows worth a thread */
+static int const SOLVER_THREAD_MIN_ROWS = 4;
+
 remez_solver::remez_solver(int order, int decimals)
   : m_order(order),
     m_decimals(decimals),
     m_has_weight(false)
 {
-    /* Spawn 4 worker threads */
-    for (int i = 0; i < 4; ++i)
-    {
-        auto th = new thread(std::bind(&remez_solver::worker_thread, this));
-        m_workers.push(th);
-    }
-}
-
-remez_solver::~remez_solver()
-{
-    /* Signal worker threads to quit, wait for worker threads to answer,
-     * and kill worker threads. */
-    for (auto worker : m_workers)
-        UNUSED(worker), m_questions.push(-1);
-
-    for (auto worker : m_workers)
-        UNUSED(worker), m_answers.pop();
-
-    for (auto worker : m_workers)
-        delete worker;
 }
 
 void remez_solver::run(real a, real b, char const *func, char const *weight)
 {
     m_func.parse(func);
+    m_cache.func.clear();
+    m_cache.weight.clear();
 
     if (weight)
     {
@@ -106,27 +91,42 @@ void remez_solver::remez_init()
     /* m_order extrema to find */
     m_extrema_state.resize(m_order);
 
-    /* Initial estimates for the x_i where the error will be zero and
-     * precompute f(x_i). */
-    array<real> fxn;
+    /* The Chebyshev polynomials used to build the estimates */
+    m_chebyshev.empty();
+    for (int n = 0; n < m_order + 1; n++)
+        m_chebyshev.push(polynomial<real>::chebyshev(n));
+
+    /* Initial estimates for the x_i where the error will be zero */
     for (int i = 0; i < m_order + 1; i++)
-    {
         m_zeroes[i] = (real)(2 * i - m_order) / (real)(m_order + 1);
-        fxn.push(eval_func(m_zeroes[i]));
-    }
 
-    /* We build a matrix of Chebyshev evaluations: row i contains the
-     * evaluations of x_i for polynomial order n = 0, 1, ... */
-    linear_system<real> system(m_order + 1);
-    for (int n = 0; n < m_order + 1; n++)
+    /* Precompute f(x_i) and build a matrix of Chebyshev evaluations:
+     * row i contains the evaluations of x_i for polynomial order
+     * n = 0, 1, ... */
+    int const rows = m_order + 1;
+    array<real> fxn;
+    fxn.resize(rows);
+    linear_system<real> system(rows);
+    begin_pass(rows);
+    lol::parallel_for(rows, SOLVER_THREAD_MIN_ROWS, [&](int i0, int i1)
     {
-        auto p = polynomial<real>::chebyshev(n);
-        for (int i = 0; i < m_order + 1; i++)
-            system[i][n] = p.eval(m_zeroes[i]);
-    }
+        array<real> row;
+        row.resize(m_order + 1);
+        for (int i = i0; i < i1; i++)
+        {
+            fxn[i] = eval_func(m_zeroes[i], m_pass_cache[i]);
+            chebyshev_row(m_zeroes[i], row.data());
+            for (int k = 0; k < m_order + 1; k++)
+                system[i][k] = row[k];
+        }
+    });
+    end_pass();
 
     /* Solve the system */
-    system = system.inverse();
+    system = system.inverse([](int count, std::function<void(int, int)> const &f)
+    {
+        lol::parallel_for(count, SOLVER_THREAD_MIN_ROWS, f);
+    });
 
     /* Compute new Chebyshev estimate */
     m_estimate = polynomial<real>();
@@ -136,7 +136,7 @@ void remez_solver::remez_init()
         for (int i = 0; i < m_order + 1; i++)
             weight += system[n][i] * fxn[i];
 
-        m_estimate += weight * polynomial<real>::chebyshev(n);
+        m_estimate += weight * m_chebyshev[n];
     }
 }
 
@@ -148,30 +148,37 @@ void remez_solver::remez_step()
 {
     Timer t;
 
-    /* Pick up x_i where error will be 0 and compute f(x_i) */
+    /* Pick up x_i where error will be 0, compute f(x_i), and build a
+     * matrix of Chebyshev evaluations: row i contains the evaluations
+     * of x_i for polynomial order n = 0, 1, ... The last column is the
+     * oscillating error. */
+    int const rows = m_order + 2;
     array<real> fxn;
-    for (int i = 0; i < m_order + 2; i++)
-        fxn.push(eval_func(m_control[i]));
-
-    /* We build a matrix of Chebyshev evaluations: row i contains the
-     * evaluations of x_i for polynomial order n = 0, 1, ... */
-    linear_system<real> system(m_order + 2);
-    for (int n = 0; n < m_order + 1; n++)
+    fxn.resize(rows);
+    linear_system<real> system(rows);
+    begin_pass(rows);
+    lol::parallel_for(rows, SOLVER_THREAD_MIN_ROWS, [&](int i0, int i1)
     {
-        auto p = polynomial<real>::chebyshev(n);
-        for (int i = 0; i < m_order + 2; i++)
-            system[i][n] = p.eval(m_control[i]);
-    }
+        array<real> row;
+        row.resize(m_order + 1);
+        for (int i = i0; i < i1; i++)
+        {
+            fxn[i] = eval_func(m_control[i], m_pass_cache[i]);
+            chebyshev_row(m_control[i], row.data());
+            for (int k = 0; k < m_order + 1; k++)
+                system[i][k] = row[k];
 
-    /* The last line of the system is the oscillating error */
-    for (int i = 0; i < m_order + 2; i++)
-    {
-        real error = fabs(eval_weight(m_control[i]));
-        system[i][m_order + 1] = (i & 1) ? error : -error;
-    }
+            real error = fabs(eval_weight(m_control[i], m_pass_cache[i]));
+            system[i][m_order + 1] = (i & 1) ? error : -error;
+        }
+    });
+    end_pass();
 
     /* Solve the system */
-    system = system.inverse();
+    system = system.inverse([](int count, std::function<void(int, int)> const &f)
+    {
+        lol::parallel_for(count, SOLVER_THREAD_MIN_ROWS, f);
+    });
 
     /* Compute new polynomial estimate */
     m_estimate = polynomial<real>();
@@ -181,7 +188,7 @@ void remez_solver::remez_step()
         for (int i = 0; i < m_order + 2; i++)
             weight += system[n][i] * fxn[i];
 
-        m_estimate += weight * polynomial<real>::chebyshev(n);
+        m_estimate += weight * m_chebyshev[n];
     }
 
     /* Compute the error (FIXME: unused?) */
@@ -204,44 +211,112 @@ void remez_solver::find_zeroes()
 {
     Timer t;
 
-    static real const limit = ldexp((real)1, -500);
-    static real const zero = (real)0;
+    /* A double precision copy of the estimate, for narrow_bracket() */
+    m_estimate_double = polynomial<double>();
+    for (int n = 0; n <= m_estimate.degree(); n++)
+        m_estimate_double.set(n, (double)m_estimate[n]);
 
-    /* Initialise an [a,b] bracket for each zero we try to find */
-    for (int i = 0; i < m_order + 1; i++)
+    /* Each zero is searched for in its own bracket, independently of
+     * the others, so the brackets are split between threads */
+    begin_pass(m_order + 1);
+    lol::parallel_for(m_order + 1, 1, [&](int i0, int i1)
     {
-        point &a = m_zeroes_state[i].m1;
-        point &b = m_zeroes_state[i].m2;
+        for (int i = i0; i < i1; i++)
+            find_zero(i);
+    });
+    end_pass();
 
-        a.x = m_control[i];
-        a.err = eval_estimate(a.x) - eval_func(a.x);
-        b.x = m_control[i + 1];
-        b.err = eval_estimate(b.x) - eval_func(b.x);
+    using std::printf;
+    printf(" -:- timing for zeroes: %f ms\n", t.Get() * 1000.f);
+}
 
-        m_questions.push(i);
-    }
+void remez_solver::find_zero(int i)
+{
+    static real const limit = ldexp((real)1, -500);
+    static real const zero = (real)0;
+
+    point &a = m_zeroes_state[i].m1;
+    point &b = m_zeroes_state[i].m2;
+    point &c = m_zeroes_state[i].m3;
+    eval_cache &cache = m_pass_cache[i];
 
-    /* Watch all brackets for updates from worker threads */
-    for (int finished = 0; finished < m_order + 1; )
+    /* Initialise an [a,b] bracket */
+    a.x = m_control[i];
+    b.x = m_control[i + 1];
+    narrow_bracket(a, b, cache);
+
+    for (;;)
     {
-        int i = m_answers.pop();
+        real s = abs(b.err) / (abs(a.err) + abs(b.err));
+        real newc = b.x + s * (a.x - b.x);
+
+        /* If the third point didn't change since last iteration,
+         * we may be at an inflection point. Use the midpoint to get
+         * out of this situation. */
+        c.x = newc != c.x ? newc : (a.x + b.x) / 2;
+        c.err = eval_estimate(c.x) - eval_func(c.x, cache);
 
-        point &a = m_zeroes_state[i].m1;
-        point &b = m_zeroes_state[i].m2;
-        point &c = m_zeroes_state[i].m3;
+        if ((a.err < zero && c.err < zero)
+             || (a.err > zero && c.err > zero))
+            a = c;
+        else
+            b = c;
 
         if (c.err == zero || fabs(a.x - b.x) <= limit)
         {
             m_zeroes[i] = c.x;
-            ++finished;
-            continue;
+            return;
         }
+    }
+}
+
+/*
+ * Shrink the [a,b] bracket around a zero of the error function using
+ * double precision bisection, which is several orders of magnitude
+ * faster than evaluating reals. Doubles may lack the precision to see
+ * the error function’s actual sign, so the new bracket is checked with
+ * reals and the original one is kept if it does not contain a zero.
+ */
+void remez_solver::narrow_bracket(point &a, point &b, eval_cache &cache)
+{
+    double x0 = (double)a.x, x1 = (double)b.x;
+    double e0 = eval_estimate(x0) - eval_func(x0);
+    double e1 = eval_estimate(x1) - eval_func(x1);
 
-        m_questions.push(i);
+    int steps = 0;
+    if ((e0 < 0.0 && e1 > 0.0) || (e0 > 0.0 && e1 < 0.0))
+    {
+        for ( ; steps < 40; ++steps)
+        {
+            double xm = (x0 + x1) / 2, em = eval_estimate(xm) - eval_func(xm);
+            if (em == 0.0)
+                break;
+            if ((em < 0.0) == (e0 < 0.0))
+                x0 = xm, e0 = em;
+            else
+                x1 = xm, e1 = em;
+        }
     }
 
-    using std::printf;
-    printf(" -:- timing for zeroes: %f ms\n", t.Get() * 1000.f);
+    if (steps > 0)
+    {
+        point c, d;
+        c.x = real(x0);
+        c.err = eval_estimate(c.x) - eval_func(c.x, cache);
+        d.x = real(x1);
+        d.err = eval_estimate(d.x) - eval_func(d.x, cache);
+
+        if ((c.err < real(0) && d.err > real(0))
+             || (c.err > real(0) && d.err < real(0)))
+        {
+            a = c;
+            b = d;
+            return;
+        }
+    }
+
+    a.err = eval_estimate(a.x) - eval_func(a.x, cache);
+    b.err = eval_estimate(b.x) - eval_func(b.x, cache);
 }
 
 /*
@@ -271,34 +346,20 @@ void remez_solver::find_extrema()
         a.x = m_zeroes[i];
         b.x = m_zeroes[i + 1];
         c.x = a.x + (b.x - a.x) * real(rand(0.4f, 0.6f));
-
-        a.err = eval_error(a.x);
-        b.err = eval_error(b.x);
-        c.err = eval_error(c.x);
-
-        m_questions.push(i + 1000);
     }
 
-    /* Watch all brackets for updates from worker threads */
-    for (int finished = 0; finished < m_order; )
+    /* The brackets are independent, so they are split between threads */
+    begin_pass(m_order);
+    lol::parallel_for(m_order, 1, [&](int i0, int i1)
     {
-        int i = m_answers.pop();
+        for (int i = i0; i < i1; i++)
+            find_extremum(i);
+    });
+    end_pass();
 
-        point &a = m_extrema_state[i - 1000].m1;
-        point &b = m_extrema_state[i - 1000].m2;
-        point &c = m_extrema_state[i - 1000].m3;
-
-        if (b.x - a.x <= m_epsilon)
-        {
-            m_control[i - 1000 + 1] = c.x;
-            if (c.err > m_error)
-                m_error = c.err;
-            ++finished;
-            continue;
-        }
-
-        m_questions.push(i);
-    }
+    for (int i = 0; i < m_order; i++)
+        if (m_extrema_state[i].m3.err > m_error)
+            m_error = m_extrema_state[i].m3.err;
 
     using std::printf;
     printf(" -:- timing for extrema: %f ms\n", t.Get() * 1000.f);
@@ -307,6 +368,52 @@ void remez_solver::find_extrema()
     printf("\n");
 }
 
+void remez_solver::find_extremum(int i)
+{
+    point &a = m_extrema_state[i].m1;
+    point &b = m_extrema_state[i].m2;
+    point &c = m_extrema_state[i].m3;
+    eval_cache &cache = m_pass_cache[i];
+
+    a.err = eval_error(a.x, cache);
+    b.err = eval_error(b.x, cache);
+    c.err = eval_error(c.x, cache);
+
+    for (;;)
+    {
+        point d;
+
+        real d1 = c.x - a.x, d2 = c.x - b.x;
+        real k1 = d1 * (c.err - b.err);
+        real k2 = d2 * (c.err - a.err);
+        d.x = c.x - (d1 * k1 - d2 * k2) / (k1 - k2) / 2;
+
+        /* If parabolic interpolation failed, pick a number
+         * inbetween. */
+        if (d.x <= a.x || d.x >= b.x)
+            d.x = (a.x + b.x) / 2;
+
+        d.err = eval_error(d.x, cache);
+
+        /* Update bracketing depending on the new point. */
+        if (d.err < c.err)
+        {
+            (d.x > c.x ? b : a) = d;
+        }
+        else
+        {
+            (d.x > c.x ? a : b) = c;
+            c = d;
+        }
+
+        if (b.x - a.x <= m_epsilon)
+        {
+            m_control[i + 1] = c.x;
+            return;
+        }
+    }
+}
+
 void remez_solver::print_poly()
 {
     /* Transform our polynomial in the [-1..1] range into a polynomial
@@ -331,89 +438,85 @@ real remez_solver::eval_estimate(real const &x)
     return m_estimate.eval(x);
 }
 
-real remez_solver::eval_func(real const &x)
+real remez_solver::eval_func(real const &x, eval_cache &cache)
 {
-    return m_func.eval(x * m_k2 + m_k1);
+    return eval_cached(m_func, m_cache.func, cache.func, x);
 }
 
-real remez_solver::eval_weight(real const &x)
+double remez_solver::eval_estimate(double x)
 {
-    return m_has_weight ? m_weight.eval(x * m_k2 + m_k1) : real(1);
+    return m_estimate_double.eval(x);
 }
 
-real remez_solver::eval_error(real const &x)
+double remez_solver::eval_func(double x)
 {
-    return fabs((eval_estimate(x) - eval_func(x)) / eval_weight(x));
+    return m_func.eval(x * (double)m_k2 + (double)m_k1);
 }
 
-void remez_solver::worker_thread()
+real remez_solver::eval_weight(real const &x, eval_cache &cache)
 {
-    static real const zero = (real)0;
+    if (!m_has_weight)
+        return real(1);
+    return eval_cached(m_weight, m_cache.weight, cache.weight, x);
+}
 
-    for (;;)
+/*
+ * Each pass of the solver starts where the previous one stopped: the
+ * extrema are searched between the zeroes just found, the system is built
+ * at these extrema, and the next zeroes are searched between them. So
+ * every pass reads the values used by the previous pass, and records the
+ * values it uses itself, with one table per bracket or row so that the
+ * threads need no lock. The tables are merged at the end of the pass, and
+ * older values are dropped, so the cache never grows beyond one pass.
+ */
+void remez_solver::begin_pass(int count)
+{
+    m_pass_cache.resize(count);
+}
+
+void remez_solver::end_pass()
+{
+    m_cache.func.clear();
+    m_cache.weight.clear();
+
+    for (eval_cache &cache : m_pass_cache)
     {
-        int i = m_questions.pop();
+        for (auto value : cache.func)
+            m_cache.func.insert(value.key, value.value);
+        for (auto value : cache.weight)
+            m_cache.weight.insert(value.key, value.value);
+        cache.func.clear();
+        cache.weight.clear();
+    }
+}
 
-        if (i < 0)
-        {
-            m_answers.push(i);
-            break;
-        }
-        else if (i < 1000)
-        {
-            point &a = m_zeroes_state[i].m1;
-            point &b = m_zeroes_state[i].m2;
-            point &c = m_zeroes_state[i].m3;
-
-            real s = abs(b.err) / (abs(a.err) + abs(b.err));
-            real newc = b.x + s * (a.x - b.x);
-
-            /* If the third point didn't change since last iteration,
-             * we may be at an inflection point. Use the midpoint to get
-             * out of this situation. */
-            c.x = newc != c.x ? newc : (a.x + b.x) / 2;
-            c.err = eval_estimate(c.x) - eval_func(c.x);
-
-            if ((a.err < zero && c.err < zero)
-                 || (a.err > zero && c.err > zero))
-                a = c;
-            else
-                b = c;
+real remez_solver::eval_cached(expression const &expr,
+                               avl_tree<real, real> const &known,
+                               avl_tree<real, real> &cache, real const &x)
+{
+    real *value = nullptr;
+    if (cache.try_get(x, value))
+        return *value;
 
-            m_answers.push(i);
-        }
-        else if (i < 2000)
-        {
-            point &a = m_extrema_state[i - 1000].m1;
-            point &b = m_extrema_state[i - 1000].m2;
-            point &c = m_extrema_state[i - 1000].m3;
-            point d;
-
-            real d1 = c.x - a.x, d2 = c.x - b.x;
-            real k1 = d1 * (c.err - b.err);
-            real k2 = d2 * (c.err - a.err);
-            d.x = c.x - (d1 * k1 - d2 * k2) / (k1 - k2) / 2;
-
-            /* If parabolic interpolation failed, pick a number
-             * inbetween. */
-            if (d.x <= a.x || d.x >= b.x)
-                d.x = (a.x + b.x) / 2;
-
-            d.err = eval_error(d.x);
-
-            /* Update bracketing depending on the new point. */
-            if (d.err < c.err)
-            {
-                (d.x > c.x ? b : a) = d;
-            }
-            else
-            {
-                (d.x > c.x ? a : b) = c;
-                c = d;
-            }
+    real ret = known.try_get(x, value) ? *value : expr.eval(x * m_k2 + m_k1);
+    cache.insert(x, ret);
+    return ret;
+}
 
-            m_answers.push(i);
-        }
-    }
+/* Evaluate all Chebyshev polynomials up to m_order at x, using the
+ * recurrence Tn(x) = 2 x Tn-1(x) - Tn-2(x) */
+void remez_solver::chebyshev_row(real const &x, real *row)
+{
+    row[0] = real(1);
+    if (m_order > 0)
+        row[1] = x;
+    for (int n = 2; n < m_order + 1; n++)
+        row[n] = (real)2 * x * row[n - 1] - row[n - 2];
+}
+
+real remez_solver::eval_error(real const &x, eval_cache &cache)
+{
+    return fabs((eval_estimate(x) - eval_func(x, cache))
+                 / eval_weight(x, cache));
 }
 
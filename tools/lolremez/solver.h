@@ -25,7 +25,6 @@ class remez_solver
 {
 public:
     remez_solver(int order, int decimals);
-    ~remez_solver();
 
     void run(lol::real a, lol::real b,
              char const *func, char const *weight = nullptr);
@@ -36,15 +35,32 @@ private:
 
     void find_zeroes();
     void find_extrema();
+    void find_zero(int i);
+    void find_extremum(int i);
 
-    void worker_thread();
+    void chebyshev_row(lol::real const &x, lol::real *row);
 
     void print_poly();
 
+    /* Function and weight values, memoised per x */
+    struct eval_cache
+    {
+        lol::avl_tree<lol::real, lol::real> func, weight;
+    };
+
+    void begin_pass(int count);
+    void end_pass();
+
     lol::real eval_estimate(lol::real const &x);
-    lol::real eval_func(lol::real const &x);
-    lol::real eval_weight(lol::real const &x);
-    lol::real eval_error(lol::real const &x);
+    lol::real eval_func(lol::real const &x, eval_cache &cache);
+    double eval_estimate(double x);
+    double eval_func(double x);
+    lol::real eval_weight(lol::real const &x, eval_cache &cache);
+    lol::real eval_error(lol::real const &x, eval_cache &cache);
+    lol::real eval_cached(expression const &expr,
+                          lol::avl_tree<lol::real, lol::real> const &known,
+                          lol::avl_tree<lol::real, lol::real> &cache,
+                          lol::real const &x);
 
 private:
     /* User-defined parameters */
@@ -54,6 +70,8 @@ private:
 
     /* Solver state */
     lol::polynomial<lol::real> m_estimate;
+    lol::polynomial<double> m_estimate_double;
+    lol::array<lol::polynomial<lol::real>> m_chebyshev;
 
     lol::array<lol::real> m_zeroes;
     lol::array<lol::real> m_control;
@@ -65,11 +83,14 @@ private:
         lol::real x, err;
     };
 
+    void narrow_bracket(point &a, point &b, eval_cache &cache);
+
     lol::array<point, point, point> m_zeroes_state;
     lol::array<point, point, point> m_extrema_state;
 
-    /* Threading information */
-    lol::array<lol::thread *> m_workers;
-    lol::queue<int> m_questions, m_answers;
+    /* The values used by the previous pass, which are read-only, and the
+     * values used by each bracket or row of the current pass */
+    eval_cache m_cache;
+    lol::array<eval_cache> m_pass_cache;
 };
 